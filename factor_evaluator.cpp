@@ -0,0 +1,50 @@
+#include "factor_evaluator.h"
+#include "config.h"
+#include "spdlog/sinks/basic_file_sink.h"
+#include <chrono>
+#include <stdexcept>
+
+using namespace std::chrono;
+
+// 因子评估：读取config.xml的<Evaluation>配置，一次评估日期范围内的所有候选因子
+// 用法：FactorEvaluator [config_path]
+int main(int argc, char* argv[]) {
+    // 1. 初始化日志
+    auto file_logger = spdlog::basic_logger_mt("factor_evaluator", "factor_evaluator.log", true);
+    file_logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%n] [%l] %v");
+    file_logger->set_level(spdlog::level::info);
+    file_logger->flush_on(spdlog::level::info);
+    spdlog::set_default_logger(file_logger);
+    spdlog::info("=== 启动因子评估 ===");
+
+    try {
+        // 2. 加载配置
+        std::string config_path = argc > 1 ? argv[1] : "config/config.xml";
+        ConfigLoader config_loader;
+        GlobalConfig config;
+        if (!config_loader.load(config_path, config)) {
+            throw std::runtime_error("加载配置文件失败");
+        }
+
+        // 3. 评估
+        auto start_time = high_resolution_clock::now();
+        FactorEvaluator evaluator(config.evaluation);
+        std::map<std::string, EvaluationStats> results;
+        if (!evaluator.run(config.calculate_date, results)) {
+            throw std::runtime_error("没有可评估的因子结果");
+        }
+
+        // 4. 输出报告
+        if (!evaluator.write_report(results, config.evaluation.output)) {
+            throw std::runtime_error("写入评估报告失败");
+        }
+        auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start_time);
+        spdlog::info("=== 因子评估完成: {}个因子, 耗时{}ms ===", results.size(), duration.count());
+
+    } catch (const std::exception& e) {
+        spdlog::critical("因子评估异常终止: {}", e.what());
+        return 1;
+    }
+
+    return 0;
+}
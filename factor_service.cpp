@@ -43,6 +43,7 @@ int main() {
         
         // 5. 设置factor依赖关系
         framework.setup_factor_dependencies();
+        framework.open_result_journals();
 
         // 6. 生成时间事件并运行Factor计算引擎
         spdlog::info("开始运行Factor计算引擎...");
@@ -51,8 +52,8 @@ int main() {
         std::vector<uint64_t> time_points = framework.generate_time_points(60, config.calculate_date);
         spdlog::info("生成了 {} 个时间事件", time_points.size());
         
-        // 运行Factor计算引擎
-        framework.get_engine()->process_factor_time_events(time_points);
+        // 运行Factor计算引擎（指标已从文件加载完毕，支持整日回填的Factor一次算完全天）
+        framework.get_engine()->process_factor_full_day(time_points);
         
         // 7. 保存Factor结果
         spdlog::info("开始保存Factor结果...");
@@ -6,51 +6,31 @@
 #include "my_indicator.h"
 #include "my_factor.h"
 #include "diff_indicator.h"
+#include "order_flow_indicator.h"
 #include <memory>
 #include <vector>
 #include <unordered_map>
 #include <set>
+#include <map>
+#include <algorithm>
 #include <thread>
+#include <atomic>
+#include <limits>
+#include <filesystem>
 #include <spdlog/spdlog.h>
 
 class Framework {
 public:
     Framework(const GlobalConfig& config)
-        : config_(config), engine_(std::make_shared<CalculationEngine>(config)) {
+        : config_(config), engine_(std::make_shared<CalculationEngine>(config_)) {
         stock_list_ = DataLoader().get_stock_list_from_data();
     }
 
     void register_indicators_factors(const std::vector<ModuleConfig>& modules) {
         for (const auto& module : modules) {
             if (module.handler == "Indicator") {
-                std::shared_ptr<Indicator> indicator;
-                
-                // 根据id创建对应的Indicator实例
-                if (module.id == "VolumeIndicator") {
-                    indicator = std::make_shared<VolumeIndicator>(module);
-                    // 为VolumeIndicator设置CalculationEngine引用
-                    auto volume_indicator = std::dynamic_pointer_cast<VolumeIndicator>(indicator);
-                    if (volume_indicator) {
-                        volume_indicator->set_calculation_engine(engine_);
-                    }
-                } else if (module.id == "AmountIndicator") {
-                    indicator = std::make_shared<AmountIndicator>(module);
-                    // 为AmountIndicator设置CalculationEngine引用
-                    auto amount_indicator = std::dynamic_pointer_cast<AmountIndicator>(indicator);
-                    if (amount_indicator) {
-                        amount_indicator->set_calculation_engine(engine_);
-                    }
-                } else if (module.id == "DiffIndicator") {
-                    indicator = std::make_shared<DiffIndicator>(module, config_.pre_days);
-                    // 为DiffIndicator设置CalculationEngine引用，使其能够获取指定股票的BarSeriesHolder
-                    auto diff_indicator = std::dynamic_pointer_cast<DiffIndicator>(indicator);
-                    if (diff_indicator) {
-                        diff_indicator->set_calculation_engine(engine_);
-                    }
-                } else {
-                    spdlog::error("未知的Indicator类型: {}", module.id);
-                    continue;
-                }
+                std::shared_ptr<Indicator> indicator = create_indicator(module);
+                if (!indicator) continue;
                 
                 engine_->add_indicator(module.name, indicator);
                 indicator_map_[module.name] = indicator;
@@ -63,6 +43,20 @@ public:
                     factor = std::make_shared<VolumeFactor>(module);
                 } else if (module.id == "PriceFactor") {
                     factor = std::make_shared<PriceFactor>(module);
+                } else if (module.id == "IntradayVwapFactor") {
+                    factor = std::make_shared<IntradayVwapFactor>(module);
+                } else if (module.id == "ExpressionFactor") {
+                    // 同频率的表达式因子编译进同一个执行计划，公共子表达式只算一次；
+                    // 叶子按因子频率读取，不同频率的因子各用一个计划
+                    if (module.expression.empty()) {
+                        spdlog::error("ExpressionFactor[{}]缺少expression属性", module.name);
+                        continue;
+                    }
+                    auto& plan = expression_plans_[module.frequency];
+                    if (!plan) plan = std::make_shared<ExpressionPlan>();
+                    int root = plan->add_root(module.name, module.expression);
+                    if (root < 0) continue;
+                    factor = std::make_shared<ExpressionFactor>(module, plan, root);
                 } else {
                     spdlog::error("未知的Factor类型: {}", module.id);
                     continue;
@@ -75,6 +69,12 @@ public:
                 factor_map_[module.name] = factor;
             }
         }
+        // 所有指标注册后才能校验中性化暴露
+        setup_factor_neutralization();
+        // 按因子声明的输入裁剪未被使用的指标、字段和频率
+        prune_unused_indicators();
+        // 所有指标注册完成后构建依赖图，确定每个tick的计算顺序
+        if (!engine_->compile_indicators()) drop_unresolved_indicators();
         engine_->init_indicator_storage(stock_list_);
     }
 
@@ -82,57 +82,49 @@ public:
     void register_indicators_to_shared_storage(const std::vector<ModuleConfig>& modules) {
         for (const auto& module : modules) {
             if (module.handler == "Indicator") {
-                std::shared_ptr<Indicator> indicator;
-                
-                // 根据id创建对应的Indicator实例
-                if (module.id == "VolumeIndicator") {
-                    indicator = std::make_shared<VolumeIndicator>(module);
-                    // 为VolumeIndicator设置CalculationEngine引用
-                    auto volume_indicator = std::dynamic_pointer_cast<VolumeIndicator>(indicator);
-                    if (volume_indicator) {
-                        volume_indicator->set_calculation_engine(engine_);
-                    }
-                } else if (module.id == "AmountIndicator") {
-                    indicator = std::make_shared<AmountIndicator>(module);
-                    // 为AmountIndicator设置CalculationEngine引用
-                    auto amount_indicator = std::dynamic_pointer_cast<AmountIndicator>(indicator);
-                    if (amount_indicator) {
-                        amount_indicator->set_calculation_engine(engine_);
-                    }
-                } else if (module.id == "DiffIndicator") {
-                    indicator = std::make_shared<DiffIndicator>(module, config_.pre_days);
-                    // 为DiffIndicator设置CalculationEngine引用
-                    auto diff_indicator = std::dynamic_pointer_cast<DiffIndicator>(indicator);
-                    if (diff_indicator) {
-                        diff_indicator->set_calculation_engine(engine_);
-                    }
-                } else {
-                    spdlog::error("未知的Indicator类型: {}", module.id);
-                    continue;
-                }
-                
-                // 加载历史数据到共享存储
-                spdlog::info("加载指标[{}]的历史数据到共享存储", module.name);
-                // 修复：传递cal_engine参数，确保历史数据能加载到BarSeriesHolder中
-                ResultStorage::load_multi_day_indicators(indicator, module, config_, engine_);
+                std::shared_ptr<Indicator> indicator = create_indicator(module);
+                if (!indicator) continue;
                 
                 // 添加到engine的共享存储
                 engine_->add_indicator(module.name, indicator);
                 indicator_map_[module.name] = indicator;
             }
         }
+        
+        // 先裁剪，只为因子实际读取的指标加载历史数据
+        prune_unused_indicators();
+        
+        for (const auto& module : modules) {
+            if (module.handler != "Indicator") continue;
+            auto it = indicator_map_.find(module.name);
+            if (it == indicator_map_.end()) continue;
+            // 加载历史数据到共享存储
+            spdlog::info("加载指标[{}]的历史数据到共享存储", module.name);
+            // 修复：传递cal_engine参数，确保历史数据能加载到BarSeriesHolder中
+            ResultStorage::load_multi_day_indicators(it->second, module, history_config(module.name), engine_);
+        }
+        // 所有指标注册完成后构建依赖图，确定每个tick的计算顺序
+        if (!engine_->compile_indicators()) drop_unresolved_indicators();
     }
 
     void load_all_indicators() {
         spdlog::info("开始加载所有指标数据...");
         for (const auto& module : config_.modules) {
             if (module.handler == "Indicator") {
+                if (pruned_indicators_.count(module.name)) {
+                    spdlog::info("指标[{}]未被因子使用，跳过加载", module.name);
+                    continue;
+                }
+                if (unresolved_indicators_.count(module.name)) {
+                    spdlog::warn("指标[{}]的依赖无法满足，跳过加载", module.name);
+                    continue;
+                }
                 spdlog::info("处理指标模块: {}", module.name);
                 auto it = indicator_map_.find(module.name);
                 if (it != indicator_map_.end()) {
                     spdlog::info("调用load_multi_day_indicators for {}", module.name);
                     // 修复：传递cal_engine参数，确保历史数据能加载到BarSeriesHolder中
-                    ResultStorage::load_multi_day_indicators(it->second, module, config_, engine_);
+                    ResultStorage::load_multi_day_indicators(it->second, module, history_config(module.name), engine_);
                 } else {
                     spdlog::error("未找到指标: {}", module.name);
                 }
@@ -141,6 +133,37 @@ public:
         spdlog::info("指标数据加载完成");
     }
 
+    // 新增：连续多日回放时切换到下一个计算日
+    // 与当前日期相隔的自然日数不超过保留的历史天数时，BarSeriesHolder按间隔换日（原当日成为T-1，不重新加载历史，
+    // 中间的非交易日对应空日槽，与按get_prev_date加载历史的布局一致），再加载新T日已有的指标文件；
+    // 否则重新初始化存储并完整加载。因子结果和指标完成标记按新日期重置，盘中日志到run_engine时才按新日期打开
+    void advance_to_date(const std::string& date) {
+        int gap = 0;
+        for (int days = 1; days <= config_.pre_days + 1; ++days) {
+            if (get_prev_date(date, days) == config_.calculate_date) {
+                gap = days;
+                break;
+            }
+        }
+        spdlog::info("切换计算日期: {} -> {}（{}）", config_.calculate_date, date, gap > 0 ? "换日" : "重新加载");
+        config_.calculate_date = date;
+        resumed_from_checkpoint_ = false;
+        engine_->reset_factor_storage();
+        for (auto& [name, indicator] : indicator_map_) {
+            indicator->reset_calculation_status();
+        }
+
+        if (gap > 0) {
+            for (int days = 0; days < gap; ++days) {
+                engine_->roll_bar_series_holders_day();
+            }
+            load_today_indicators();
+        } else {
+            engine_->init_indicator_storage(stock_list_);
+            load_all_indicators();
+        }
+    }
+
     std::vector<MarketAllField> load_and_sort_market_data(DataLoader& data_loader) {
         std::vector<MarketAllField> all_tick_datas;
         for (const auto& stock : stock_list_) {
@@ -151,12 +174,21 @@ public:
         return all_tick_datas;
     }
 
-    void run_engine(const std::vector<MarketAllField>& all_tick_datas) {
-        spdlog::info("开始运行引擎，数据量: {}", all_tick_datas.size());
+    // batch_mode：离线回放时整日行情已知，每只股票走批量路径（实现了CalculateBatch的指标整列计算）；
+    // 为false时逐事件调用update，与实时路径一致
+    // 配置了<Checkpoint>时：逐事件模式按interval_seconds把行情切成时间段，每段全部股票处理完后写一次检查点；
+    // 否则在指标回放完成后写一次。已从检查点恢复时（restore_checkpoint）各股票从断点继续，不重置指标状态
+    void run_engine(const std::vector<MarketAllField>& all_tick_datas, bool batch_mode = true) {
+        spdlog::info("开始运行引擎，数据量: {}, 模式: {}", all_tick_datas.size(), batch_mode ? "批量" : "逐事件");
+
+        // 当日有行情才打开盘中日志，非交易日不留下空日志
+        open_result_journals();
         
         // 重置所有指标的计算状态和差分存储
 //        engine_.reset_all_indicator_status();
-        engine_->reset_diff_storage();
+        if (!resumed_from_checkpoint_) {
+            engine_->reset_diff_storage();
+        }
 
         // 设置factor依赖关系
         setup_factor_dependencies();
@@ -173,41 +205,84 @@ public:
         }
         
         spdlog::info("数据分组完成，共{}只股票", stock_data_map.size());
-        
-        // 启动Indicator线程组（按股票）
-        std::vector<std::thread> indicator_threads;
-        for (const auto& [stock, stock_data] : stock_data_map) {
-            indicator_threads.emplace_back([this, stock_code = stock, data = stock_data]() {
-                spdlog::info("开始处理股票{}的行情数据，共{}条", stock_code, data.size());
-                for (const auto& tick_data : data) {
-                    engine_->update(tick_data);
-                }
-                spdlog::info("股票{}行情数据处理完成", stock_code);
-
-            });
-        }
 
-        
-        // 等待所有Indicator线程完成
-        spdlog::info("等待所有Indicator线程完成...");
-        for (auto& thread : indicator_threads) {
-            thread.join();
+        const CheckpointConfig& checkpoint = config_.checkpoint;
+        if (!checkpoint.path.empty() && !batch_mode && checkpoint.interval_seconds > 0) {
+            // 按行情时间分段回放，段与段之间所有股票都停在段末，状态一致，可写检查点
+            std::vector<uint64_t> boundaries = generate_time_points(checkpoint.interval_seconds, config_.calculate_date);
+            if (!boundaries.empty()) boundaries.erase(boundaries.begin());  // 开盘前的事件并入第一段
+            boundaries.push_back(std::numeric_limits<uint64_t>::max());
+            for (uint64_t boundary : boundaries) {
+                if (replay_stock_events(stock_data_map, batch_mode, boundary) > 0) {
+                    save_checkpoint();
+                }
+            }
+        } else {
+            if (!checkpoint.path.empty() && checkpoint.interval_seconds > 0) {
+                spdlog::warn("批量模式下忽略检查点间隔interval_seconds={}，只在指标回放完成后写一次检查点",
+                             checkpoint.interval_seconds);
+            }
+            replay_stock_events(stock_data_map, batch_mode, std::numeric_limits<uint64_t>::max());
+            // 指标回放完成后的检查点：之后因子计算或保存中途退出时，重启无需再回放行情
+            if (!checkpoint.path.empty()) save_checkpoint();
         }
 
-        // 启动Factor线程组（按时间事件顺序，每个时间事件内按Factor多线程）
+        // 启动Factor线程组：指标已全部算完，支持整日回填的Factor一次算出全部时间桶，其余按时间事件逐桶计算
         spdlog::info("启动Factor线程组，处理时间事件");
-        engine_->process_factor_time_events(time_points);
+        engine_->process_factor_full_day(time_points);
         
         spdlog::info("引擎运行完成");
     }
 
+    // 新增：从<Checkpoint>配置的检查点恢复引擎状态，之后的run_engine从各股票的断点继续回放
+    // all_tick_datas须与run_engine使用的行情相同：每只股票断点处事件的序列号必须与检查点记录的一致，否则不恢复
+    bool restore_checkpoint(const std::vector<MarketAllField>& all_tick_datas) {
+        const std::string& path = config_.checkpoint.path;
+        std::error_code ec;
+        if (path.empty() || !std::filesystem::exists(path, ec)) {
+            return false;
+        }
+        // 与run_engine相同的分组顺序，只保留序列号用于核对断点
+        std::unordered_map<std::string, std::vector<uint64_t>> sequence_of;
+        for (const auto& data : all_tick_datas) {
+            sequence_of[data.symbol].push_back(data.appl_seq_num);
+        }
+        bool restored = engine_->load_checkpoint(path, [&](const std::string& symbol, const ReplayProgress& progress) {
+            if (progress.events == 0) return true;
+            auto it = sequence_of.find(symbol);
+            if (it == sequence_of.end() || progress.events > it->second.size() ||
+                it->second[progress.events - 1] != progress.last_appl_seq_num) {
+                spdlog::error("检查点中股票{}的断点（第{}个事件，序列号{}）与行情数据不一致",
+                              symbol, progress.events, progress.last_appl_seq_num);
+                return false;
+            }
+            return true;
+        });
+        resumed_from_checkpoint_ = restored;
+        return restored;
+    }
+
+    // 新增：当日结果保存完成后删除检查点，之后重跑该日（配置或代码可能已变）从头回放，不会恢复旧状态
+    void discard_checkpoint() {
+        const std::string& path = config_.checkpoint.path;
+        std::error_code ec;
+        if (path.empty() || !std::filesystem::remove(path, ec)) return;
+        spdlog::info("当日结果已保存，删除检查点: {}", path);
+    }
+
     void setup_factor_dependencies() {
         spdlog::info("设置factor依赖关系...");
         for (auto& [factor_name, factor] : factor_map_) {
-            // 收集所有indicators作为依赖
+            // 声明了输入的因子只拿到所声明的指标，未声明的因子拿到所有indicators
+            std::set<std::string> declared;
+            for (const auto& requirement : factor->required_inputs()) {
+                declared.insert(requirement.indicator);
+            }
             std::vector<const Indicator*> dependent_indicators;
             for (auto& [indicator_name, indicator] : indicator_map_) {
-                dependent_indicators.push_back(indicator.get());
+                if (declared.empty() || declared.count(indicator_name)) {
+                    dependent_indicators.push_back(indicator.get());
+                }
             }
             factor->set_dependent_indicators(dependent_indicators);
             spdlog::debug("Factor[{}]设置了{}个indicator依赖", factor_name, dependent_indicators.size());
@@ -219,45 +294,125 @@ public:
         
         // 注意：不再在这里调用wait_for_completion，因为上层已经调用过了
         // 避免重复等待，提高性能
+
+        // 新增：各模块写不同的文件，按模块并行保存；每个csv.gz文件内部再按块并行压缩（GzTableWriter），
+        // 总线程数约为save_thread_count
+        size_t thread_count = config_.save_thread_count;
+        if (thread_count == 0) {
+            thread_count = std::thread::hardware_concurrency();
+            if (thread_count == 0) thread_count = 4;  // 保底4线程
+        }
+        const size_t module_count = config_.modules.size();
+        const size_t module_threads = std::max<size_t>(1, std::min(thread_count, module_count));
+        GzTableWriter::set_default_threads(static_cast<int>(std::max<size_t>(1, thread_count / module_threads)));
+
+        std::atomic<size_t> next_module{0};
+        auto worker = [&]() {
+            for (size_t m = next_module++; m < module_count; m = next_module++) {
+                save_module_result(config_.modules[m]);
+            }
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(module_threads);
+        for (size_t t = 1; t < module_threads; ++t) workers.emplace_back(worker);
+        worker();
+        for (auto& thread : workers) thread.join();
+        GzTableWriter::set_default_threads(0);
         
+        spdlog::info("所有结果保存完成（{}个模块，{}个保存线程）", module_count, module_threads);
+    }
+
+    // 新增：为配置了journal的因子打开当前计算日的盘中日志（已打开的跳过），在确认当日有行情后调用
+    void open_result_journals() {
+        for (const auto& module : config_.modules) {
+            if (module.handler != "Factor" || !module.journal || !factor_map_.count(module.name)) continue;
+            auto it = result_journals_.find(module.name);
+            if (it != result_journals_.end() && it->second->is_open()) continue;
+            open_result_journal(module);
+        }
+    }
+
+    // 新增：为配置了neutralize的因子注册中性化暴露，需要行业时加载股票行业；暴露无效的因子不中性化
+    void setup_factor_neutralization() {
+        bool needs_industry = false;
+        for (const auto& module : config_.modules) {
+            if (module.handler != "Factor" || !factor_map_.count(module.name)) continue;
+            needs_industry = needs_industry ||
+                std::find(module.neutralize.begin(), module.neutralize.end(), "industry") != module.neutralize.end();
+        }
+        if (needs_industry && !config_.industry_file.empty()) {
+            engine_->set_stock_industries(load_stock_industries(config_.industry_file));
+        }
+        for (const auto& module : config_.modules) {
+            if (module.handler != "Factor" || module.neutralize.empty() || !factor_map_.count(module.name)) continue;
+            if (!engine_->set_factor_neutralization(module.name, module.neutralize)) {
+                spdlog::error("因子[{}]的中性化配置无效，按原值输出", module.name);
+            }
+        }
+    }
+
+    // 新增：为因子打开盘中结果日志并注册到引擎，时间桶封口时即追加写盘（上次运行中途退出时续写已有日志）
+    bool open_result_journal(const ModuleConfig& module) {
+        std::string journal_path = ResultStorage::factor_journal_path(module, config_.calculate_date);
+        if (!IndicatorStorageHelper::ensure_directory(std::filesystem::path(journal_path).parent_path().string())) {
+            return false;
+        }
+        auto journal = std::make_shared<ResultJournal>();
+        if (!journal->open(journal_path, stock_list_, module.journal_sync)) {
+            spdlog::error("因子[{}]的盘中日志打开失败，收盘时按内存结果保存", module.name);
+            return false;
+        }
+        engine_->set_result_journal(module.name, journal);
+        result_journals_[module.name] = journal;
+        spdlog::info("因子[{}]开启盘中日志: {}", module.name, journal_path);
+        return true;
+    }
+
+    // 保存单个模块的结果（save_all_results的工作线程调用，异常在此处记录，不影响其他模块）
+    void save_module_result(const ModuleConfig& module) {
         try {
-            for (const auto& module : config_.modules) {
-                try {
-                    if (module.handler == "Indicator") {
-                        auto it = indicator_map_.find(module.name);
-                        if (it != indicator_map_.end() && it->second) {
-                            spdlog::info("保存指标: {}", module.name);
-                            // 修复：传递cal_engine参数，确保能正确保存指标数据
-                            if (!ResultStorage::save_indicator(it->second, module, config_.calculate_date, engine_)) {
-                                spdlog::error("保存指标[{}]失败", module.name);
-                            }
-                        } else {
-                            spdlog::warn("指标[{}]不存在或为空", module.name);
-                        }
-                    } else if (module.handler == "Factor") {
-                        auto it = factor_map_.find(module.name);
-                        if (it != factor_map_.end() && it->second) {
-                            spdlog::info("保存因子: {}", module.name);
-                            // 修复：传递cal_engine参数，确保能正确保存因子数据
-                            if (!ResultStorage::save_factor(it->second, module, config_.calculate_date, stock_list_, engine_)) {
-                                spdlog::error("保存因子[{}]失败", module.name);
-                            }
-                        } else {
-                            spdlog::warn("因子[{}]不存在或为空", module.name);
-                        }
+            if (module.handler == "Indicator") {
+                auto it = indicator_map_.find(module.name);
+                if (it != indicator_map_.end() && it->second) {
+                    spdlog::info("保存指标: {}", module.name);
+                    // 修复：传递cal_engine参数，确保能正确保存指标数据
+                    if (!ResultStorage::save_indicator(it->second, module, config_.calculate_date, engine_)) {
+                        spdlog::error("保存指标[{}]失败", module.name);
                     }
-                } catch (const std::exception& e) {
-                    spdlog::error("保存模块[{}]时发生异常: {}", module.name, e.what());
-                } catch (...) {
-                    spdlog::error("保存模块[{}]时发生未知异常", module.name);
+                } else if (pruned_indicators_.count(module.name)) {
+                    spdlog::info("指标[{}]未被因子使用，未计算也不保存", module.name);
+                } else if (unresolved_indicators_.count(module.name)) {
+                    spdlog::warn("指标[{}]的依赖无法满足，未计算也不保存", module.name);
+                } else {
+                    spdlog::warn("指标[{}]不存在或为空", module.name);
+                }
+            } else if (module.handler == "Factor") {
+                auto it = factor_map_.find(module.name);
+                auto journal_it = result_journals_.find(module.name);
+                if (journal_it != result_journals_.end() && journal_it->second->is_open()) {
+                    // 开启盘中日志的因子：结果已随时间桶封口写入日志，收盘只需顺序压缩为日文件
+                    // 关闭后引擎再提交的结果不再写日志（再次保存时按内存结果保存）
+                    spdlog::info("压缩因子盘中日志: {}", module.name);
+                    journal_it->second->close();
+                    if (!ResultStorage::compact_factor_journal(module, config_.calculate_date)) {
+                        spdlog::error("压缩因子[{}]盘中日志失败，改为按内存结果保存", module.name);
+                        ResultStorage::save_factor(it->second, module, config_.calculate_date, stock_list_, engine_);
+                    }
+                } else if (it != factor_map_.end() && it->second) {
+                    spdlog::info("保存因子: {}", module.name);
+                    // 修复：传递cal_engine参数，确保能正确保存因子数据
+                    if (!ResultStorage::save_factor(it->second, module, config_.calculate_date, stock_list_, engine_)) {
+                        spdlog::error("保存因子[{}]失败", module.name);
+                    }
+                } else {
+                    spdlog::warn("因子[{}]不存在或为空", module.name);
                 }
             }
         } catch (const std::exception& e) {
-            spdlog::error("保存结果时发生异常: {}", e.what());
-            throw; // 重新抛出异常，让上层处理
+            spdlog::error("保存模块[{}]时发生异常: {}", module.name, e.what());
+        } catch (...) {
+            spdlog::error("保存模块[{}]时发生未知异常", module.name);
         }
-        
-        spdlog::info("所有结果保存完成");
     }
     
     // 新增：保存指定频率的DiffIndicator结果
@@ -344,6 +499,224 @@ public:
     const std::unordered_map<std::string, std::shared_ptr<Factor>>& get_factor_map() const { return factor_map_; }
 
 private:
+    // 因子对单个指标的需求汇总
+    struct IndicatorDemand {
+        std::set<std::string> fields;       // 读取的字段
+        std::set<Frequency> frequencies;    // 读取的频率
+        bool all_fields = false;            // 需要全部字段
+        bool all_frequencies = false;       // 需要全部频率
+        int pre_days = 0;                   // 需要的历史天数
+    };
+
+    // 换日后只加载新T日已有的指标文件（历史日已在多日缓冲中），存在时标记为已计算
+    void load_today_indicators() {
+        std::vector<std::string> today_stocks = load_stock_list(config_.stock_universe, config_.calculate_date);
+        for (const auto& module : config_.modules) {
+            if (module.handler != "Indicator" || pruned_indicators_.count(module.name)) continue;
+            auto it = indicator_map_.find(module.name);
+            if (it == indicator_map_.end()) continue;
+            if (ResultStorage::load_single_day_indicator(it->second, module, config_.calculate_date, today_stocks, engine_)) {
+                spdlog::info("指标{}T日[{}]指标已存在，直接复用", module.name, config_.calculate_date);
+                it->second->mark_as_calculated();
+                it->second->set_frequency(module.frequency);
+            }
+        }
+    }
+
+    // 每只股票一个线程，从引擎记录的回放进度处理到时间戳until之前，返回本次处理的事件数
+    // 批量模式下整日行情一次处理完的股票走批量路径，从断点继续或只处理一段时逐事件处理
+    size_t replay_stock_events(const std::unordered_map<std::string, std::vector<MarketAllField>>& stock_data_map,
+                               bool batch_mode, uint64_t until) {
+        std::atomic<size_t> processed{0};
+        std::vector<std::thread> indicator_threads;
+        for (const auto& [stock, stock_data] : stock_data_map) {
+            const ReplayProgress* progress = engine_->get_replay_progress(stock);
+            size_t begin = progress ? static_cast<size_t>(progress->events) : 0;
+            size_t end = begin;
+            while (end < stock_data.size() && stock_data[end].timestamp < until) ++end;
+            if (begin >= end) continue;
+
+            indicator_threads.emplace_back([this, batch_mode, begin, end, &processed, &stock_code = stock, &data = stock_data]() {
+                spdlog::info("开始处理股票{}的行情数据，第{}-{}条（共{}条）", stock_code, begin, end, data.size());
+                if (batch_mode && begin == 0 && end == data.size()) {
+                    engine_->process_stock_batch(stock_code, data);
+                } else {
+                    for (size_t i = begin; i < end; ++i) {
+                        engine_->update(data[i]);
+                    }
+                }
+                processed += end - begin;
+                spdlog::info("股票{}行情数据处理完成", stock_code);
+            });
+        }
+
+        // 等待所有Indicator线程完成
+        spdlog::info("等待所有Indicator线程完成...");
+        for (auto& thread : indicator_threads) {
+            thread.join();
+        }
+        return processed.load();
+    }
+
+    void save_checkpoint() {
+        std::filesystem::path parent = std::filesystem::path(config_.checkpoint.path).parent_path();
+        if (!parent.empty() && !IndicatorStorageHelper::ensure_directory(parent.string())) {
+            return;
+        }
+        engine_->save_checkpoint(config_.checkpoint.path);
+    }
+
+    // 根据id创建对应的Indicator实例，未知类型返回nullptr
+    std::shared_ptr<Indicator> create_indicator(const ModuleConfig& module) {
+        if (module.id == "VolumeIndicator") {
+            auto volume_indicator = std::make_shared<VolumeIndicator>(module);
+            // 为VolumeIndicator设置CalculationEngine引用
+            volume_indicator->set_calculation_engine(engine_);
+            return volume_indicator;
+        } else if (module.id == "AmountIndicator") {
+            auto amount_indicator = std::make_shared<AmountIndicator>(module);
+            // 为AmountIndicator设置CalculationEngine引用
+            amount_indicator->set_calculation_engine(engine_);
+            return amount_indicator;
+        } else if (module.id == "DiffIndicator") {
+            auto diff_indicator = std::make_shared<DiffIndicator>(module, config_.pre_days);
+            // 为DiffIndicator设置CalculationEngine引用，使其能够获取指定股票的BarSeriesHolder
+            diff_indicator->set_calculation_engine(engine_);
+            return diff_indicator;
+        } else if (module.id == "VwapIndicator") {
+            // 派生指标：依赖inputs中的上游指标，由engine按依赖顺序计算
+            auto vwap_indicator = std::make_shared<VwapIndicator>(module);
+            vwap_indicator->set_calculation_engine(engine_);
+            return vwap_indicator;
+        } else if (module.id == "OrderFlowIndicator") {
+            // 订单流指标族：汇总快照间的逐笔成交和委托
+            auto order_flow_indicator = std::make_shared<OrderFlowIndicator>(module);
+            order_flow_indicator->set_calculation_engine(engine_);
+            return order_flow_indicator;
+        }
+        spdlog::error("未知的Indicator类型: {}", module.id);
+        return nullptr;
+    }
+
+    // 从因子声明的输入出发，沿指标依赖图向上游求出可达的指标/字段/频率，
+    // 未被任何因子使用的指标从engine中移除（不计算、不加载历史、不保存）
+    // 没有因子（如只计算指标的服务）或有因子未声明输入时不裁剪
+    bool prune_unused_indicators() {
+        if (factor_map_.empty() || indicator_map_.empty()) return false;
+
+        std::map<std::string, IndicatorDemand> demands;
+        for (const auto& [factor_name, factor] : factor_map_) {
+            auto requirements = factor->required_inputs();
+            if (requirements.empty()) {
+                spdlog::warn("因子[{}]未声明输入指标，保留全部指标", factor_name);
+                return false;
+            }
+            for (const auto& requirement : requirements) {
+                auto it = indicator_map_.find(requirement.indicator);
+                if (it == indicator_map_.end()) {
+                    if (!requirement.optional) {
+                        spdlog::error("因子[{}]依赖的指标[{}]未配置", factor_name, requirement.indicator);
+                    }
+                    continue;
+                }
+                IndicatorDemand& demand = demands[requirement.indicator];
+                if (requirement.field.empty()) {
+                    demand.all_fields = true;
+                } else {
+                    demand.fields.insert(requirement.field);
+                }
+                Frequency frequency = it->second->frequency();
+                if (!requirement.frequency.empty() && !parse_frequency(requirement.frequency, frequency)) {
+                    spdlog::error("因子[{}]声明了未知频率: {}", factor_name, requirement.frequency);
+                    demand.all_frequencies = true;
+                }
+                demand.frequencies.insert(frequency);
+                demand.pre_days = std::max(demand.pre_days, requirement.pre_days);
+            }
+        }
+
+        // FactorEvaluator从已保存的指标文件读取价格，价格字段不随因子需求裁剪
+        const EvaluationConfig& evaluation = config_.evaluation;
+        auto price_indicator = indicator_map_.find(evaluation.price_indicator);
+        if (price_indicator != indicator_map_.end()) {
+            IndicatorDemand& demand = demands[evaluation.price_indicator];
+            demand.fields.insert(evaluation.price_field);
+            demand.frequencies.insert(price_indicator->second->frequency());
+        }
+
+        // 中性化的风格暴露按指标的基础频率读取后聚合到因子时间桶
+        for (const auto& module : config_.modules) {
+            if (module.handler != "Factor" || !factor_map_.count(module.name)) continue;
+            for (const auto& exposure : module.neutralize) {
+                if (exposure == "industry") continue;
+                size_t dot = exposure.find('.');
+                std::string name = exposure.substr(0, dot);
+                auto it = indicator_map_.find(name);
+                if (it == indicator_map_.end()) continue;
+                IndicatorDemand& demand = demands[name];
+                demand.fields.insert(dot == std::string::npos ? name : exposure.substr(dot + 1));
+                demand.frequencies.insert(it->second->frequency());
+            }
+        }
+
+        // 派生指标读取的上游指标保留全部字段和频率，并继承下游需要的历史天数
+        std::vector<std::string> pending;
+        for (const auto& [name, demand] : demands) pending.push_back(name);
+        while (!pending.empty()) {
+            std::string name = pending.back();
+            pending.pop_back();
+            int pre_days = demands[name].pre_days;
+            for (const auto& input_name : indicator_map_.at(name)->input_names()) {
+                if (!indicator_map_.count(input_name)) continue;  // 缺失的输入由compile_indicators报告
+                auto [it, inserted] = demands.try_emplace(input_name);
+                IndicatorDemand& demand = it->second;
+                bool changed = inserted || !demand.all_fields || !demand.all_frequencies || demand.pre_days < pre_days;
+                demand.all_fields = true;
+                demand.all_frequencies = true;
+                demand.pre_days = std::max(demand.pre_days, pre_days);
+                if (changed) pending.push_back(input_name);
+            }
+        }
+
+        for (auto it = indicator_map_.begin(); it != indicator_map_.end();) {
+            auto demand = demands.find(it->first);
+            if (demand == demands.end()) {
+                spdlog::warn("指标[{}]未被任何因子使用，跳过计算和历史加载", it->first);
+                engine_->remove_indicator(it->first);
+                pruned_indicators_.insert(it->first);
+                it = indicator_map_.erase(it);
+                continue;
+            }
+            if (!demand->second.all_fields) it->second->retain_fields(demand->second.fields);
+            if (!demand->second.all_frequencies) it->second->retain_rollup_frequencies(demand->second.frequencies);
+            ++it;
+        }
+        history_days_.clear();
+        for (const auto& [name, demand] : demands) history_days_[name] = demand.pre_days;
+        spdlog::info("按因子需求保留{}个指标，裁剪{}个", indicator_map_.size(), pruned_indicators_.size());
+        return true;
+    }
+
+    // 依赖图中缺失输入或成环的指标（及其下游）从Framework和引擎中移除，不再加载、计算或保存；
+    // 读取它们的因子在setup_factor_dependencies中拿不到对应输入
+    void drop_unresolved_indicators() {
+        for (const auto& name : engine_->unresolved_indicators()) {
+            spdlog::error("指标[{}]的依赖无法满足，已从本次运行中移除", name);
+            indicator_map_.erase(name);
+            unresolved_indicators_.insert(name);
+        }
+        for (const auto& name : unresolved_indicators_) engine_->remove_indicator(name);
+    }
+
+    // 加载指定指标历史时使用的配置：pre_days取因子实际需要的天数（不超过全局配置）
+    GlobalConfig history_config(const std::string& indicator_name) const {
+        GlobalConfig config = config_;
+        auto it = history_days_.find(indicator_name);
+        if (it != history_days_.end()) {
+            config.pre_days = std::min(config_.pre_days, it->second);
+        }
+        return config;
+    }
     
     // 将时间转换为纳秒级时间戳
     uint64_t convert_to_timestamp(int year, int month, int day, int seconds_in_day) const {
@@ -369,4 +742,10 @@ private:
     std::vector<std::string> stock_list_;
     std::unordered_map<std::string, std::shared_ptr<Indicator>> indicator_map_;
     std::unordered_map<std::string, std::shared_ptr<Factor>> factor_map_;
+    std::set<std::string> pruned_indicators_;                  // 新增：未被因子使用而被裁剪的指标
+    std::set<std::string> unresolved_indicators_;              // 新增：依赖图中缺失输入或成环而被移除的指标
+    std::unordered_map<std::string, int> history_days_;        // 新增：各指标需要加载的历史天数
+    std::map<std::string, std::shared_ptr<ExpressionPlan>> expression_plans_;  // 新增：表达式因子的执行计划，key: 因子频率
+    std::unordered_map<std::string, std::shared_ptr<ResultJournal>> result_journals_;  // 新增：开启盘中日志的因子
+    bool resumed_from_checkpoint_ = false;                     // 新增：已从检查点恢复，run_engine从断点继续
 }; 
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <type_traits>
+#include <zlib.h>
+
+// 本机字节序的二进制流读写（引擎检查点等使用），边写/读边累计crc32
+// 只支持平凡可复制类型、字符串和这两者的vector；读取出错（截断、长度越界）后ok()为false，后续读取全部失败
+class BinaryWriter {
+public:
+    explicit BinaryWriter(FILE* fp) : fp_(fp) {}
+
+    void put_bytes(const void* data, size_t length) {
+        if (!ok_ || length == 0) return;
+        if (std::fwrite(data, 1, length, fp_) != length) {
+            ok_ = false;
+            return;
+        }
+        crc_ = ::crc32(crc_, static_cast<const Bytef*>(data), static_cast<uInt>(length));
+    }
+
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryWriter::put只支持平凡可复制类型");
+        put_bytes(&value, sizeof(T));
+    }
+
+    void put_string(const std::string& value) {
+        put<uint32_t>(static_cast<uint32_t>(value.size()));
+        put_bytes(value.data(), value.size());
+    }
+
+    template <typename T>
+    void put_vector(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryWriter::put_vector只支持平凡可复制类型");
+        put<uint64_t>(values.size());
+        put_bytes(values.data(), values.size() * sizeof(T));
+    }
+
+    bool ok() const { return ok_; }
+    uint32_t crc() const { return static_cast<uint32_t>(crc_); }
+
+private:
+    FILE* fp_;
+    bool ok_ = true;
+    uLong crc_ = ::crc32(0L, Z_NULL, 0);
+};
+
+class BinaryReader {
+public:
+    // remaining为可读字节数上限（通常为文件大小），用于在分配前拒绝损坏的长度字段
+    BinaryReader(FILE* fp, uint64_t remaining) : fp_(fp), remaining_(remaining) {}
+
+    bool get_bytes(void* data, size_t length) {
+        if (!ok_) return false;
+        if (length == 0) return true;
+        if (length > remaining_ || std::fread(data, 1, length, fp_) != length) {
+            ok_ = false;
+            return false;
+        }
+        remaining_ -= length;
+        crc_ = ::crc32(crc_, static_cast<const Bytef*>(data), static_cast<uInt>(length));
+        return true;
+    }
+
+    template <typename T>
+    bool get(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryReader::get只支持平凡可复制类型");
+        return get_bytes(&value, sizeof(T));
+    }
+
+    bool get_string(std::string& value) {
+        uint32_t length = 0;
+        if (!get(length) || !check_length(length)) return false;
+        value.resize(length);
+        return get_bytes(&value[0], length);
+    }
+
+    template <typename T>
+    bool get_vector(std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryReader::get_vector只支持平凡可复制类型");
+        uint64_t count = 0;
+        if (!get(count) || count > remaining_ / sizeof(T)) {
+            ok_ = false;
+            return false;
+        }
+        values.resize(static_cast<size_t>(count));
+        return get_bytes(values.data(), values.size() * sizeof(T));
+    }
+
+    bool ok() const { return ok_; }
+    uint64_t remaining() const { return remaining_; }
+    uint32_t crc() const { return static_cast<uint32_t>(crc_); }
+
+private:
+    bool check_length(uint64_t length) {
+        if (length > remaining_) ok_ = false;
+        return ok_;
+    }
+
+    FILE* fp_;
+    uint64_t remaining_;
+    bool ok_ = true;
+    uLong crc_ = ::crc32(0L, Z_NULL, 0);
+};
@@ -5,6 +5,10 @@
 #include "config.h"
 #include "my_indicator.h"  // 添加这行以支持VolumeIndicator和AmountIndicator
 #include "diff_indicator.h"  // 添加这行以支持DiffIndicator
+#include "order_book.h"  // 新增：逐笔重建订单簿
+#include "event_cache.h"  // 新增：时间事件内Factor间共享的中间结果缓存
+#include "result_journal.h"  // 新增：时间桶封口即写入的盘中结果日志
+#include "neutralization.h"  // 新增：因子输出前的行业/风格中性化
 #include <unordered_map>
 #include <vector>
 #include <queue>
@@ -17,7 +21,12 @@
 #include <atomic>
 #include <chrono>
 #include <ctime>
+#include <cstdio>
+#include <cstring>
 #include <limits>
+#include <unistd.h>
+#include <algorithm>
+#include <set>
 #include <functional>  // 新增：支持std::enable_shared_from_this
 #include "spdlog/spdlog.h"
 #include "spdlog/fmt/bundled/format.h"
@@ -110,6 +119,13 @@ public:
 std::vector<std::string> get_history_dates(const std::string& current_date, int days);
 GSeries load_gseries_from_file(const std::string& file_path);
 
+// 新增：一只股票的回放进度（检查点恢复后据此从断点继续）
+struct ReplayProgress {
+    uint64_t events = 0;             // 已处理的事件数，即该股票按时间排序的事件流中的偏移
+    uint64_t last_appl_seq_num = 0;  // 最后处理的事件的序列号，恢复时用于核对事件流
+    uint64_t last_timestamp = 0;     // 最后处理的事件的时间戳
+};
+
 class CalculationEngine : public std::enable_shared_from_this<CalculationEngine> {
 private:
     // 重构：为每只股票维护一个 SyncTickData，直接管理数据
@@ -133,10 +149,46 @@ private:
     std::unordered_map<std::string, std::map<int, std::unordered_map<std::string, double>>> factor_storage_;
     // 去掉 factor_storage_mutex_ - 每个Factor独立写入，无竞争条件
 
+    // 新增：每只股票已处理的行情事件（init_indicator_storage时为所有股票建好条目，之后各股票线程只改自己的值）
+    std::unordered_map<std::string, ReplayProgress> replay_progress_;
+
+    // 新增：开启了盘中日志的Factor（factor_name -> 日志），计算前注册，之后只读
+    std::unordered_map<std::string, std::shared_ptr<ResultJournal>> result_journals_;
+
+    // 新增：因子输出前的中性化暴露（factor_name -> 暴露），计算前注册，之后只读
+    struct NeutralizationSpec {
+        bool industry = false;                                      // 是否带行业哑变量
+        std::vector<std::pair<std::string, std::string>> styles;    // 风格暴露（指标名, 字段）
+    };
+    std::unordered_map<std::string, NeutralizationSpec> neutralization_specs_;
+    std::unordered_map<std::string, std::string> stock_industries_;   // 股票代码 -> 行业代码
+
     // 指标和因子容器 - 在初始化后基本不变，可以去掉锁保护
     std::unordered_map<std::string, std::shared_ptr<Indicator>> indicators_;  // key: 指标名
+    std::vector<std::string> indicator_order_;  // 新增：指标的注册顺序（即槽位分配顺序）
+    int state_slot_count_ = 0;   // 新增：已分配给指标的每股状态槽数
+    int handle_slot_count_ = 0;  // 新增：已分配给指标的序列句柄槽数
     std::unordered_map<std::string, std::shared_ptr<Factor>> factors_;  // key: 因子名
 
+    std::set<std::string> unresolved_indicators_;  // 新增：编译依赖图时被排除的指标
+
+    // 新增：注册时编译出的扁平指标列表（按依赖拓扑排序，同层按名称），onTick按此顺序一次遍历
+    std::vector<Indicator*> compiled_indicators_;
+
+    // 新增：每只股票的逐笔订单簿，初始化后映射结构不变，每只股票的事件由同一线程处理
+    // 只在有指标读取订单簿时建立（order_books_enabled_由compile_indicators确定）
+    std::unordered_map<std::string, OrderBook> order_books_;
+    bool order_books_enabled_ = false;
+    // 新增：需要逐笔订单簿事件的指标（compile_indicators时从compiled_indicators_中筛出）
+    std::vector<Indicator*> book_listeners_;
+    // 新增：离线整日批量回放时的两组指标（均保持拓扑顺序）：
+    // event_indicators_逐tick计算，batch_indicators_在整日快照就绪后调用CalculateBatch
+    std::vector<Indicator*> event_indicators_;
+    std::vector<Indicator*> batch_indicators_;
+
+    // 新增：时间事件内Factor间共享的中间结果缓存，每个时间事件的Factor全部完成后释放
+    EventCache event_cache_;
+
     // 存储股票列表 - 在初始化后不变，不需要锁保护
     std::vector<std::string> stock_list_;
 
@@ -275,6 +327,101 @@ private:
     //     task_cond_.notify_one();
     // }
 
+    // 新增：检查点文件格式
+    static constexpr char kCheckpointMagic[8] = {'A', 'F', 'C', 'H', 'E', 'C', 'K', 'P'};
+    static constexpr uint32_t kCheckpointVersion = 4;
+
+    // 检查点对应的引擎布局：指标（注册顺序、精度、基础与汇总频率）、状态槽/句柄槽数和历史天数，
+    // 任何一项变化都会改变各指标状态槽和序列的含义，不一致的检查点不能恢复
+    std::string checkpoint_layout() const {
+        std::string layout = fmt::format("pre_days={};state_slots={};handle_slots={};",
+                                         config_.pre_days, state_slot_count_, handle_slot_count_);
+        for (const auto& name : indicator_order_) {
+            auto it = indicators_.find(name);
+            if (it == indicators_.end() || !it->second) continue;
+            const Indicator& indicator = *it->second;
+            layout += fmt::format("{}:{}:{}", name, storage_precision_to_string(indicator.precision()),
+                                  static_cast<int>(indicator.frequency()));
+            for (Frequency frequency : indicator.rollup_frequencies()) {
+                layout += fmt::format(",{}", static_cast<int>(frequency));
+            }
+            layout += ";";
+        }
+        return layout;
+    }
+
+    // 股票列表（含顺序）的crc32
+    uint32_t stock_list_crc() const {
+        uLong crc = ::crc32(0L, Z_NULL, 0);
+        for (const auto& stock_code : stock_list_) {
+            crc = ::crc32(crc, reinterpret_cast<const Bytef*>(stock_code.c_str()), static_cast<uInt>(stock_code.size() + 1));
+        }
+        return static_cast<uint32_t>(crc);
+    }
+
+    // 记录一只股票处理到的事件（各股票只由自己的线程处理，条目在初始化时已建好）
+    void record_progress(const MarketAllField& field, uint64_t count) {
+        auto it = replay_progress_.find(field.symbol);
+        if (it == replay_progress_.end()) return;
+        it->second.events += count;
+        it->second.last_appl_seq_num = field.appl_seq_num;
+        it->second.last_timestamp = field.timestamp;
+    }
+
+    static void write_order(BinaryWriter& out, const OrderData& order) {
+        out.put(order.order_number);
+        out.put(order.order_kind);
+        out.put(order.price);
+        out.put(order.volume);
+        out.put(order.bs_flag);
+        out.put(order.real_time);
+        out.put(order.appl_seq_num);
+        out.put_string(order.symbol);
+    }
+
+    static bool read_order(BinaryReader& in, OrderData& order) {
+        return in.get(order.order_number) && in.get(order.order_kind) && in.get(order.price) &&
+               in.get(order.volume) && in.get(order.bs_flag) && in.get(order.real_time) &&
+               in.get(order.appl_seq_num) && in.get_string(order.symbol);
+    }
+
+    static void write_trade(BinaryWriter& out, const TradeData& trade) {
+        out.put(trade.ask_no);
+        out.put(trade.bid_no);
+        out.put(trade.trade_no);
+        out.put(trade.side);
+        out.put(trade.cancel_flag);
+        out.put(trade.price);
+        out.put(trade.volume);
+        out.put(trade.trade_money);
+        out.put(trade.real_time);
+        out.put(trade.appl_seq_num);
+        out.put_string(trade.symbol);
+    }
+
+    static bool read_trade(BinaryReader& in, TradeData& trade) {
+        return in.get(trade.ask_no) && in.get(trade.bid_no) && in.get(trade.trade_no) && in.get(trade.side) &&
+               in.get(trade.cancel_flag) && in.get(trade.price) && in.get(trade.volume) &&
+               in.get(trade.trade_money) && in.get(trade.real_time) && in.get(trade.appl_seq_num) &&
+               in.get_string(trade.symbol);
+    }
+
+    // 读入一只股票尚未随快照处理的逐笔委托和成交（条数先与剩余字节数比较，损坏的长度不会触发大分配）
+    static bool read_pending(BinaryReader& in, std::vector<OrderData>& orders, std::vector<TradeData>& trades) {
+        uint64_t count = 0;
+        if (!in.get(count) || count > in.remaining() / sizeof(uint32_t)) return false;
+        orders.resize(static_cast<size_t>(count));
+        for (auto& order : orders) {
+            if (!read_order(in, order)) return false;
+        }
+        if (!in.get(count) || count > in.remaining() / sizeof(uint32_t)) return false;
+        trades.resize(static_cast<size_t>(count));
+        for (auto& trade : trades) {
+            if (!read_trade(in, trade)) return false;
+        }
+        return true;
+    }
+
 public:
     const GlobalConfig& config_;
 
@@ -343,6 +490,12 @@ public:
         // 初始化TickDataManager和BarSeriesHolder
         init_tick_data_managers(stock_list);
         init_bar_series_holders(stock_list);
+        init_order_books(stock_list);
+        replay_progress_.clear();
+        for (const auto& stock_code : stock_list) replay_progress_[stock_code];
+        // 预先建好每只股票的待归属逐笔缓冲，回放线程只访问已有条目，不会并发插入
+        stock_sync_data_.clear();
+        for (const auto& stock_code : stock_list) stock_sync_data_[stock_code];
 
         spdlog::info("所有指标已完成{}只股票的存储初始化", stock_list.size());
     }
@@ -365,14 +518,34 @@ public:
         spdlog::info("已初始化{}只股票的TickDataManager", stock_list.size());
     }
 
+    // 新增：初始化每只股票的订单簿（没有指标读取订单簿时不建立）
+    // 最小变动价位取配置的tick_size，未配置时按证券代码推断
+    void init_order_books(const std::vector<std::string>& stock_list) {
+        order_books_.clear();
+        if (!order_books_enabled_) return;
+        order_books_.reserve(stock_list.size());
+        for (const auto& stock_code : stock_list) {
+            order_books_.emplace(stock_code, OrderBook(stock_code, config_.tick_size));
+        }
+        spdlog::info("已初始化{}只股票的OrderBook", stock_list.size());
+    }
+
+    // 新增：获取指定股票的订单簿
+    const OrderBook* get_order_book(const std::string& stock_code) const {
+        auto it = order_books_.find(stock_code);
+        return it != order_books_.end() ? &it->second : nullptr;
+    }
+
     // 新增：初始化BarSeriesHolder
     void init_bar_series_holders(const std::vector<std::string>& stock_list) {
         // 清空现有的holders
         stock_bar_holders_.clear();
         
-        // 为每只股票创建BarSeriesHolder
+        // 为每只股票创建BarSeriesHolder（序列按pre_days + 1个日槽的多日缓冲分配）
         for (const auto& stock_code : stock_list) {
-            stock_bar_holders_[stock_code] = std::make_shared<BarSeriesHolder>(stock_code);
+            auto holder = std::make_shared<BarSeriesHolder>(stock_code);
+            holder->set_pre_days(config_.pre_days);
+            stock_bar_holders_[stock_code] = holder;
         }
         
         spdlog::info("已初始化{}只股票的BarSeriesHolder", stock_list.size());
@@ -380,10 +553,129 @@ public:
 
     // 添加指标和因子 - 通常在初始化阶段调用，不需要锁保护
     void add_indicator(const std::string& name, std::shared_ptr<Indicator> ind) {
+        // 新增：状态槽和句柄槽在本引擎内连续分配，同一配置在每个引擎中得到相同的槽位
+        ind->assign_slots(state_slot_count_, handle_slot_count_);
+        state_slot_count_ += ind->state_slot_count();
+        handle_slot_count_ += ind->handle_slot_count();
         indicators_[name] = ind;
+        indicator_order_.push_back(name);
         spdlog::info("添加指标到engine: {}", name);
     }
 
+    // 新增：移除指标（未被任何因子使用的指标在编译依赖图前移除），需在处理行情前调用
+    void remove_indicator(const std::string& name) {
+        if (indicators_.erase(name) > 0) {
+            spdlog::info("从engine移除指标: {}", name);
+        }
+    }
+
+    // 新增：构建指标依赖图（DAG）并编译为扁平的执行列表，需在所有指标注册后、处理行情前调用
+    // 上游指标总在下游之前计算，每个中间结果每只股票每个tick只计算一次；
+    // 缺失输入或成环的指标及其全部下游不进入执行列表，返回false，名单见unresolved_indicators()
+    bool compile_indicators() {
+        std::unordered_map<std::string, int> in_degree;
+        std::unordered_map<std::string, std::vector<std::string>> dependents;
+        std::vector<std::string> missing_input;
+        unresolved_indicators_.clear();
+
+        for (const auto& [name, indicator] : indicators_) {
+            if (!indicator) continue;
+            in_degree.emplace(name, 0);
+            std::vector<const Indicator*> inputs;
+            for (const auto& input_name : indicator->input_names()) {
+                auto it = indicators_.find(input_name);
+                if (it == indicators_.end() || !it->second || input_name == name) {
+                    spdlog::error("指标[{}]的输入指标[{}]不存在", name, input_name);
+                    missing_input.push_back(name);
+                    in_degree[name]++;  // 缺失的输入永不就绪，该指标及其下游都不会进入执行列表
+                    continue;
+                }
+                inputs.push_back(it->second.get());
+                dependents[input_name].push_back(name);
+                in_degree[name]++;
+            }
+            indicator->bind_inputs(std::move(inputs));
+        }
+
+        // Kahn拓扑排序，同一层按名称排序保证顺序确定
+        std::set<std::string> ready;
+        for (const auto& [name, degree] : in_degree) {
+            if (degree == 0) ready.insert(name);
+        }
+        compiled_indicators_.clear();
+        while (!ready.empty()) {
+            std::string name = *ready.begin();
+            ready.erase(ready.begin());
+            compiled_indicators_.push_back(indicators_.at(name).get());
+            for (const auto& dependent : dependents[name]) {
+                if (--in_degree[dependent] == 0) ready.insert(dependent);
+            }
+        }
+
+        if (compiled_indicators_.size() != in_degree.size()) {
+            // 缺失输入的指标沿依赖边传递到的下游是受牵连的，其余未就绪的指标处在环上或环的下游
+            std::set<std::string> blocked(missing_input.begin(), missing_input.end());
+            std::vector<std::string> pending(blocked.begin(), blocked.end());
+            while (!pending.empty()) {
+                std::string name = pending.back();
+                pending.pop_back();
+                for (const auto& dependent : dependents[name]) {
+                    if (blocked.insert(dependent).second) pending.push_back(dependent);
+                }
+            }
+            for (const auto& [name, degree] : in_degree) {
+                if (degree == 0) continue;
+                unresolved_indicators_.insert(name);
+                if (!blocked.count(name)) {
+                    spdlog::error("指标[{}]存在循环依赖，已跳过", name);
+                } else if (std::find(missing_input.begin(), missing_input.end(), name) == missing_input.end()) {
+                    spdlog::error("指标[{}]依赖的指标无法计算，已跳过", name);
+                } else {
+                    spdlog::error("指标[{}]缺少输入指标，已跳过", name);
+                }
+            }
+        }
+
+        book_listeners_.clear();
+        bool books_needed = false;
+        for (Indicator* indicator : compiled_indicators_) {
+            if (indicator->wants_order_book_events()) book_listeners_.push_back(indicator);
+            books_needed = books_needed || indicator->uses_order_book();
+        }
+        // 股票列表已初始化时随之建立或释放订单簿，否则由init_indicator_storage按此标志建立
+        if (books_needed != order_books_enabled_) {
+            order_books_enabled_ = books_needed;
+            init_order_books(stock_list_);
+        }
+
+        // 批量路径：指标实现了CalculateBatch且所有下游也走批量时才批量计算，
+        // 否则下游逐tick计算时读不到上游结果；按逆拓扑序确定
+        std::unordered_map<std::string, bool> batch_run;
+        for (auto it = compiled_indicators_.rbegin(); it != compiled_indicators_.rend(); ++it) {
+            bool run_batch = (*it)->supports_batch();
+            for (const auto& dependent : dependents[(*it)->name()]) {
+                run_batch = run_batch && batch_run[dependent];
+            }
+            batch_run[(*it)->name()] = run_batch;
+        }
+        event_indicators_.clear();
+        batch_indicators_.clear();
+        for (Indicator* indicator : compiled_indicators_) {
+            (batch_run[indicator->name()] ? batch_indicators_ : event_indicators_).push_back(indicator);
+        }
+
+        std::string order;
+        for (const Indicator* indicator : compiled_indicators_) {
+            if (!order.empty()) order += " -> ";
+            order += indicator->name();
+        }
+        spdlog::info("指标计算顺序: {}", order);
+        return unresolved_indicators_.empty();
+    }
+
+    // 新增：最近一次compile_indicators因缺失输入或循环依赖未进入执行列表的指标
+    const std::set<std::string>& unresolved_indicators() const { return unresolved_indicators_; }
+
     void add_factor(std::shared_ptr<Factor> factor) {
         factors_[factor->get_name()] = factor;
     }
@@ -421,6 +713,131 @@ public:
         return nullptr;
     }
     
+    // 新增：时间事件内的中间结果缓存（Factor可用自己的键共享任意中间量）
+    EventCache& event_cache() { return event_cache_; }
+
+    // 新增：stocks中每只股票某字段的当日序列视图（零拷贝），同一时间事件内各Factor共享一次查找
+    std::shared_ptr<const std::vector<GSeriesView>> shared_field_views(
+        const std::vector<std::string>& stocks, Frequency frequency, const std::string& field) {
+        std::string key = fmt::format("field_views|{}|{}|{}", EventCache::universe_key(stocks),
+                                      static_cast<int>(frequency), field);
+        return event_cache_.get_or_compute<std::vector<GSeriesView>>(key, [&]() {
+            std::vector<GSeriesView> views(stocks.size());
+            for (size_t i = 0; i < stocks.size(); ++i) {
+                auto holder = get_bar_series_holder(stocks[i]);
+                if (holder) views[i] = holder->get_data_view(frequency, field, 0, -1);
+            }
+            return views;
+        });
+    }
+
+    // 新增：stocks的行业组号（0开始，按行业代码排序，缺失为-1），同一时间事件内共享
+    std::shared_ptr<const std::vector<int>> shared_industry_groups(const std::vector<std::string>& stocks) {
+        std::string key = fmt::format("industry_groups|{}", EventCache::universe_key(stocks));
+        return event_cache_.get_or_compute<std::vector<int>>(key, [&]() {
+            std::vector<int> groups(stocks.size(), stock_industries_.empty() ? 0 : -1);
+            if (stock_industries_.empty()) return groups;
+            std::map<std::string, int> codes;
+            for (const auto& stock : stocks) {
+                auto it = stock_industries_.find(stock);
+                if (it != stock_industries_.end()) codes.emplace(it->second, 0);
+            }
+            int next = 0;
+            for (auto& [code, group] : codes) group = next++;
+            for (size_t i = 0; i < stocks.size(); ++i) {
+                auto it = stock_industries_.find(stocks[i]);
+                if (it != stock_industries_.end()) groups[i] = codes[it->second];
+            }
+            return groups;
+        });
+    }
+
+    // 新增：风格暴露在因子时间桶ti的截面，已按截面标准化（不改变残差，只改善法方程的条件数）
+    // 指标已汇总到因子频率时直接读取，否则按字段的合并方式把基础频率的行聚合到因子时间桶
+    std::shared_ptr<const GSeries> shared_exposure_section(const std::vector<std::string>& stocks,
+                                                           const std::string& indicator_name, const std::string& field,
+                                                           Frequency frequency, int ti) {
+        std::string key = fmt::format("exposure|{}|{}|{}|{}|{}", EventCache::universe_key(stocks), indicator_name,
+                                      field, static_cast<int>(frequency), ti);
+        return event_cache_.get_or_compute<GSeries>(key, [&]() {
+            GSeries result;
+            result.resize(stocks.size());
+            std::vector<double> values(stocks.size(), NAN);
+            std::shared_ptr<Indicator> indicator = get_indicator(indicator_name);
+            if (indicator) {
+                bool direct = indicator->has_frequency(frequency);
+                Frequency read_freq = direct ? frequency : indicator->frequency();
+                RollupMethod method = indicator->field_rollup(field);
+                auto views = shared_field_views(stocks, read_freq, field);
+                for (size_t i = 0; i < stocks.size(); ++i) {
+                    const GSeriesView& series = (*views)[i];
+                    int size = series.get_size();
+                    if (direct) {
+                        if (ti < size) values[i] = series[ti];
+                        continue;
+                    }
+                    auto [start_index, end_index] = get_time_bucket_range(ti, read_freq, frequency);
+                    for (int j = start_index; j <= end_index && j < size; ++j) {
+                        values[i] = rollup_combine(method, values[i], series[j]);
+                    }
+                }
+            }
+            // 截面为常数时只去均值（全为0的列在回归中按共线列剔除）
+            double sum = 0.0, sum_sq = 0.0;
+            int count = 0;
+            for (double v : values) {
+                if (std::isfinite(v)) { sum += v; ++count; }
+            }
+            double mean = count > 0 ? sum / count : 0.0;
+            for (double v : values) {
+                if (std::isfinite(v)) sum_sq += (v - mean) * (v - mean);
+            }
+            double std_dev = count > 1 ? std::sqrt(sum_sq / (count - 1)) : 0.0;
+            double scale = std_dev > 0.0 ? 1.0 / std_dev : 1.0;
+            for (size_t i = 0; i < values.size(); ++i) {
+                result.set(i, std::isfinite(values[i]) ? (values[i] - mean) * scale : NAN);
+            }
+            return result;
+        });
+    }
+
+    // 新增：Factor截面对行业哑变量和风格暴露做最小二乘，返回残差
+    GSeries neutralize_factor_section(const std::string& factor_name, const NeutralizationSpec& spec, int ti,
+                                      const std::vector<std::string>& stock_list, const GSeries& series) {
+        std::shared_ptr<Factor> factor = get_factor(factor_name);
+        Frequency frequency = factor ? factor->get_frequency() : Frequency::F5MIN;
+        std::vector<std::string> stocks(stock_list.begin(),
+                                        stock_list.begin() + std::min<size_t>(stock_list.size(), series.get_size()));
+        GSeries factor_section;
+        factor_section.resize(stocks.size());
+        for (size_t i = 0; i < stocks.size(); ++i) factor_section.set(i, series.get(i));
+
+        std::vector<int> industry;
+        if (spec.industry) industry = *shared_industry_groups(stocks);
+        std::vector<GSeries> styles;
+        styles.reserve(spec.styles.size());
+        for (const auto& [indicator_name, field] : spec.styles) {
+            styles.push_back(*shared_exposure_section(stocks, indicator_name, field, frequency, ti));
+        }
+        return Neutralizer::neutralize_section(factor_section, industry, styles);
+    }
+
+    // 新增：区间[start, end]的VWAP截面（amount/volume前缀和），同一时间事件内相同区间只算一次
+    std::shared_ptr<const GSeries> shared_range_vwap(
+        const std::vector<std::string>& stocks, Frequency frequency, int start, int end) {
+        std::string key = fmt::format("range_vwap|{}|{}|{}|{}", EventCache::universe_key(stocks),
+                                      static_cast<int>(frequency), start, end);
+        return event_cache_.get_or_compute<GSeries>(key, [&]() {
+            GSeries result;
+            result.resize(stocks.size());
+            for (size_t i = 0; i < stocks.size(); ++i) {
+                auto holder = get_bar_series_holder(stocks[i]);
+                result.set(i, holder ? holder->range_vwap(frequency, start, end) : NAN);
+            }
+            return result;
+        });
+    }
+
     // 新增：获取所有BarSeriesHolder
     const std::unordered_map<std::string, std::shared_ptr<BarSeriesHolder>>& get_all_bar_series_holders() const {
         return stock_bar_holders_;
@@ -468,6 +885,9 @@ public:
         // 新增：同时重置所有TickDataManager、BarSeriesHolder（但不重置Factor存储）
         reset_tick_data_managers();
         reset_bar_series_holders();
+        reset_order_books();
+        // 指标状态已清空，回放进度随之归零
+        for (auto& [stock_code, progress] : replay_progress_) progress = ReplayProgress{};
         // 注意：不重置Factor存储，因为Factor数据需要在完整计算周期后保存
     }
     
@@ -489,6 +909,14 @@ public:
         spdlog::info("已重置所有TickDataManager的历史数据");
     }
     
+    // 新增：清空所有订单簿
+    void reset_order_books() {
+        for (auto& [stock_code, book] : order_books_) {
+            book.clear();
+        }
+        spdlog::info("已重置所有OrderBook");
+    }
+
     // 重构：更新指定股票的BarSeriesHolder的时间
     void update_bar_series_holder_time(const std::string& stock_symbol, uint64_t real_time) {
         auto it = stock_bar_holders_.find(stock_symbol);
@@ -513,6 +941,15 @@ public:
         spdlog::info("已重置所有BarSeriesHolder");
     }
     
+    // 新增：所有BarSeriesHolder换日（连续多日回放时使用，历史日槽随之前移）
+    void roll_bar_series_holders_day() {
+        for (auto& [stock_code, holder] : stock_bar_holders_) {
+            holder->roll_day();
+            holder->reset_indices();
+        }
+        spdlog::info("所有BarSeriesHolder已换日");
+    }
+
     // 新增：设置Factor结果到CalculationEngine的存储中
     void set_factor_result(const std::string& factor_name, int ti, const std::string& stock_code, double value) {
         factor_storage_[factor_name][ti][stock_code] = value;
@@ -523,10 +960,18 @@ public:
     void set_factor_result_batch(const std::string& factor_name, int ti, const std::vector<std::string>& stock_list, const GSeries& series) {
         spdlog::info("开始设置Factor[{}]结果: ti={}, 股票数量={}, GSeries大小={}", 
                      factor_name, ti, stock_list.size(), series.get_size());
-        
+
+        // 配置了中性化的Factor，存储和写日志的都是残差
+        GSeries residual;
+        auto spec_it = neutralization_specs_.find(factor_name);
+        if (spec_it != neutralization_specs_.end()) {
+            residual = neutralize_factor_section(factor_name, spec_it->second, ti, stock_list, series);
+        }
+        const GSeries& output = spec_it != neutralization_specs_.end() ? residual : series;
+
         int valid_count = 0;
-        for (int i = 0; i < series.get_size() && i < stock_list.size(); ++i) {
-            double value = series.get(i);
+        for (int i = 0; i < output.get_size() && i < stock_list.size(); ++i) {
+            double value = output.get(i);
             if (!std::isnan(value)) {
                 factor_storage_[factor_name][ti][stock_list[i]] = value;
                 valid_count++;
@@ -534,7 +979,64 @@ public:
         }
         
         spdlog::info("Factor[{}]结果设置完成: ti={}, 有效数据: {}/{}, 存储后factor_storage_大小: {}", 
-                     factor_name, ti, valid_count, series.get_size(), factor_storage_.size());
+                     factor_name, ti, valid_count, output.get_size(), factor_storage_.size());
+
+        // 开启了盘中日志的Factor同时提交到日志，ti前进时上一个时间桶封口写盘
+        auto journal_it = result_journals_.find(factor_name);
+        if (journal_it != result_journals_.end()) {
+            journal_it->second->stage(ti, output);
+        }
+    }
+
+    // 新增：为Factor注册盘中结果日志（须在时间事件处理开始前调用，journal为空时取消）
+    void set_result_journal(const std::string& factor_name, std::shared_ptr<ResultJournal> journal) {
+        if (journal) {
+            result_journals_[factor_name] = std::move(journal);
+        } else {
+            result_journals_.erase(factor_name);
+        }
+    }
+
+    // 新增：为Factor注册输出前的中性化暴露（须在时间事件处理开始前调用，exposures为空时取消）
+    // "industry"为行业哑变量（行业由set_stock_industries给出），其余为"指标名.字段"的风格暴露，
+    // 单一输出的指标可只写指标名；风格暴露按因子频率读取，与因子同一时间桶
+    bool set_factor_neutralization(const std::string& factor_name, const std::vector<std::string>& exposures) {
+        if (exposures.empty()) {
+            neutralization_specs_.erase(factor_name);
+            return true;
+        }
+        NeutralizationSpec spec;
+        for (const auto& exposure : exposures) {
+            if (exposure == "industry") {
+                spec.industry = true;
+                continue;
+            }
+            size_t dot = exposure.find('.');
+            std::string indicator = exposure.substr(0, dot);
+            std::string field = dot == std::string::npos ? indicator : exposure.substr(dot + 1);
+            if (indicator.empty() || field.empty() || !get_indicator(indicator)) {
+                spdlog::error("Factor[{}]的中性化暴露[{}]无效或指标未配置", factor_name, exposure);
+                return false;
+            }
+            spec.styles.emplace_back(indicator, field);
+        }
+        if (spec.industry && stock_industries_.empty()) {
+            spdlog::warn("Factor[{}]按行业中性化，但未加载股票行业，行业哑变量退化为截距", factor_name);
+        }
+        neutralization_specs_[factor_name] = std::move(spec);
+        return true;
+    }
+
+    // 新增：股票代码 -> 行业代码，行业中性化时缺失行业的股票残差为NaN
+    void set_stock_industries(std::unordered_map<std::string, std::string> industries) {
+        stock_industries_ = std::move(industries);
+    }
+
+    // 新增：当日时间事件处理完，封口所有日志中最后一个时间桶
+    void seal_result_journals() {
+        for (auto& [factor_name, journal] : result_journals_) {
+            journal->seal();
+        }
     }
     
     // 新增：获取Factor结果
@@ -581,11 +1083,369 @@ public:
         spdlog::info("已重置所有Factor存储");
     }
 
+    // 新增：某只股票的回放进度，不在股票列表中时返回nullptr
+    const ReplayProgress* get_replay_progress(const std::string& stock_code) const {
+        auto it = replay_progress_.find(stock_code);
+        return it != replay_progress_.end() ? &it->second : nullptr;
+    }
+
+    // 新增：引擎检查点 - 把回放到目前为止的状态写入一个二进制文件：
+    // 每只股票的回放进度、BarSeriesHolder（全部序列、各频率索引、指标状态槽，DiffIndicator的前值即在其中）、
+    // 订单簿、尚未随快照交给指标的逐笔委托/成交，以及Factor结果；文件末尾为全部内容的crc32
+    // 文件头记录计算日期、引擎布局（checkpoint_layout）和股票列表的crc32，恢复时逐项核对
+    // 调用方保证调用期间没有线程在处理行情或计算因子。先写临时文件再rename，中途崩溃不破坏上一个检查点
+    bool save_checkpoint(const std::string& file_path) const {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        std::string tmp_path = file_path + ".tmp";
+        FILE* fp = std::fopen(tmp_path.c_str(), "wb");
+        if (!fp) {
+            spdlog::error("无法创建检查点文件: {}", tmp_path);
+            return false;
+        }
+
+        BinaryWriter out(fp);
+        out.put_bytes(kCheckpointMagic, sizeof(kCheckpointMagic));
+        out.put<uint32_t>(kCheckpointVersion);
+        out.put_string(config_.calculate_date);
+        out.put_string(checkpoint_layout());
+        out.put<uint32_t>(stock_list_crc());
+        out.put<uint32_t>(static_cast<uint32_t>(stock_list_.size()));
+        static const SyncTickData kNoPending;
+        uint64_t total_events = 0;
+        for (const auto& stock_code : stock_list_) {
+            out.put_string(stock_code);
+            auto progress_it = replay_progress_.find(stock_code);
+            ReplayProgress progress = progress_it != replay_progress_.end() ? progress_it->second : ReplayProgress{};
+            out.put(progress);
+            total_events += progress.events;
+
+            auto holder_it = stock_bar_holders_.find(stock_code);
+            bool has_holder = holder_it != stock_bar_holders_.end() && holder_it->second;
+            out.put<uint8_t>(has_holder ? 1 : 0);
+            if (has_holder) holder_it->second->save_state(out);
+
+            auto book_it = order_books_.find(stock_code);
+            out.put<uint8_t>(book_it != order_books_.end() ? 1 : 0);
+            if (book_it != order_books_.end()) book_it->second.save_state(out);
+
+            auto sync_it = stock_sync_data_.find(stock_code);
+            const SyncTickData& pending = sync_it != stock_sync_data_.end() ? sync_it->second : kNoPending;
+            out.put<uint64_t>(pending.orders.size());
+            for (const auto& order : pending.orders) write_order(out, order);
+            out.put<uint64_t>(pending.trans.size());
+            for (const auto& trade : pending.trans) write_trade(out, trade);
+        }
+
+        out.put<uint32_t>(static_cast<uint32_t>(factor_storage_.size()));
+        for (const auto& [factor_name, buckets] : factor_storage_) {
+            out.put_string(factor_name);
+            out.put<uint32_t>(static_cast<uint32_t>(buckets.size()));
+            for (const auto& [ti, values] : buckets) {
+                out.put<int32_t>(ti);
+                out.put<uint32_t>(static_cast<uint32_t>(values.size()));
+                for (const auto& [stock_code, value] : values) {
+                    out.put_string(stock_code);
+                    out.put(value);
+                }
+            }
+        }
+
+        uint32_t crc = out.crc();
+        bool ok = out.ok() && std::fwrite(&crc, sizeof(crc), 1, fp) == 1 &&
+                  std::fflush(fp) == 0 && ::fsync(::fileno(fp)) == 0;
+        if (std::fclose(fp) != 0) ok = false;
+        if (!ok || std::rename(tmp_path.c_str(), file_path.c_str()) != 0) {
+            spdlog::error("检查点写入失败: {}", file_path);
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start_time);
+        spdlog::info("检查点已保存: {}（{}只股票，已处理{}个事件，耗时{}ms）",
+                     file_path, stock_list_.size(), total_events, duration.count());
+        return true;
+    }
+
+    // 新增：从检查点恢复引擎状态（需在init_indicator_storage、compile_indicators和历史数据加载之后调用）
+    // 计算日期不同的检查点（如多日回放中前一日的）不恢复；日期相同但引擎布局或股票列表不同时视为无效
+    // 先完整读入并校验crc；validate对每只股票的回放进度返回false时放弃恢复，引擎状态不变
+    // 检查点中不在当前股票列表里的股票被忽略，当前列表中检查点没有的股票从头回放
+    bool load_checkpoint(const std::string& file_path,
+                         const std::function<bool(const std::string&, const ReplayProgress&)>& validate = nullptr) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        FILE* fp = std::fopen(file_path.c_str(), "rb");
+        if (!fp) {
+            spdlog::error("无法打开检查点文件: {}", file_path);
+            return false;
+        }
+        std::fseek(fp, 0, SEEK_END);
+        long file_size = std::ftell(fp);
+        std::fseek(fp, 0, SEEK_SET);
+        if (file_size < static_cast<long>(sizeof(kCheckpointMagic) + sizeof(uint32_t))) {
+            std::fclose(fp);
+            spdlog::error("检查点文件过短: {}", file_path);
+            return false;
+        }
+
+        struct StagedStock {
+            std::string stock_code;
+            ReplayProgress progress;
+            std::unique_ptr<BarSeriesHolder> holder;
+            std::unique_ptr<OrderBook> book;
+            std::vector<OrderData> orders;
+            std::vector<TradeData> trades;
+        };
+        std::vector<StagedStock> staged;
+        decltype(factor_storage_) factors;
+
+        BinaryReader in(fp, static_cast<uint64_t>(file_size) - sizeof(uint32_t));
+        auto fail = [&](const char* reason) {
+            std::fclose(fp);
+            spdlog::error("检查点{}无效: {}", file_path, reason);
+            return false;
+        };
+
+        char magic[sizeof(kCheckpointMagic)] = {};
+        uint32_t version = 0;
+        std::string date, layout;
+        uint32_t stock_crc = 0;
+        uint32_t stock_count = 0;
+        if (!in.get_bytes(magic, sizeof(magic)) || std::memcmp(magic, kCheckpointMagic, sizeof(magic)) != 0 ||
+            !in.get(version) || version != kCheckpointVersion) {
+            return fail("文件头或版本不符");
+        }
+        if (!in.get_string(date)) return fail("计算日期缺失");
+        if (date != config_.calculate_date) {
+            std::fclose(fp);
+            spdlog::info("检查点{}属于{}，与当前计算日{}不同，不恢复", file_path, date, config_.calculate_date);
+            return false;
+        }
+        if (!in.get_string(layout) || layout != checkpoint_layout()) {
+            return fail("指标布局（指标、精度、频率、槽位或历史天数）与当前配置不一致");
+        }
+        if (!in.get(stock_crc) || stock_crc != stock_list_crc()) return fail("股票列表与当前配置不一致");
+        if (!in.get(stock_count)) return fail("股票数缺失");
+        for (uint32_t i = 0; i < stock_count; ++i) {
+            StagedStock stock;
+            uint8_t has_holder = 0, has_book = 0;
+            if (!in.get_string(stock.stock_code) || !in.get(stock.progress) || !in.get(has_holder)) {
+                return fail("股票记录截断");
+            }
+            if (has_holder) {
+                stock.holder = std::make_unique<BarSeriesHolder>(stock.stock_code);
+                if (!stock.holder->restore_state(in)) return fail("BarSeriesHolder状态损坏");
+            }
+            if (!in.get(has_book)) return fail("股票记录截断");
+            if (has_book) {
+                stock.book = std::make_unique<OrderBook>(stock.stock_code);
+                if (!stock.book->restore_state(in)) return fail("订单簿状态损坏");
+            }
+            if (!read_pending(in, stock.orders, stock.trades)) return fail("逐笔数据损坏");
+            staged.push_back(std::move(stock));
+        }
+
+        uint32_t factor_count = 0;
+        if (!in.get(factor_count)) return fail("因子数缺失");
+        for (uint32_t f = 0; f < factor_count; ++f) {
+            std::string factor_name;
+            uint32_t bucket_count = 0;
+            if (!in.get_string(factor_name) || !in.get(bucket_count)) return fail("因子记录截断");
+            auto& buckets = factors[factor_name];
+            for (uint32_t b = 0; b < bucket_count; ++b) {
+                int32_t ti = 0;
+                uint32_t value_count = 0;
+                if (!in.get(ti) || !in.get(value_count)) return fail("因子记录截断");
+                auto& values = buckets[ti];
+                for (uint32_t v = 0; v < value_count; ++v) {
+                    std::string stock_code;
+                    double value = 0.0;
+                    if (!in.get_string(stock_code) || !in.get(value)) return fail("因子记录截断");
+                    values.emplace(std::move(stock_code), value);
+                }
+            }
+        }
+
+        uint32_t stored_crc = 0;
+        if (!in.ok() || in.remaining() != 0 || std::fread(&stored_crc, sizeof(stored_crc), 1, fp) != 1 ||
+            stored_crc != in.crc()) {
+            return fail("校验和不符");
+        }
+        std::fclose(fp);
+
+        // 全部读入并校验通过后，先核对断点，再一次性替换引擎状态
+        if (validate) {
+            for (const auto& stock : staged) {
+                if (replay_progress_.count(stock.stock_code) && !validate(stock.stock_code, stock.progress)) {
+                    spdlog::error("检查点{}与当前行情不一致，放弃恢复", file_path);
+                    return false;
+                }
+            }
+        }
+
+        uint64_t total_events = 0;
+        size_t restored = 0;
+        for (auto& stock : staged) {
+            auto progress_it = replay_progress_.find(stock.stock_code);
+            if (progress_it == replay_progress_.end()) {
+                spdlog::warn("检查点中的股票{}不在当前股票列表中，已忽略", stock.stock_code);
+                continue;
+            }
+            if (stock.holder) {
+                auto holder_it = stock_bar_holders_.find(stock.stock_code);
+                if (holder_it != stock_bar_holders_.end() && holder_it->second) {
+                    holder_it->second->adopt_state(std::move(*stock.holder));
+                }
+            }
+            if (stock.book) {
+                auto book_it = order_books_.find(stock.stock_code);
+                if (book_it != order_books_.end()) book_it->second = std::move(*stock.book);
+            }
+            SyncTickData& pending = stock_sync_data_[stock.stock_code];
+            pending.orders = std::move(stock.orders);
+            pending.trans = std::move(stock.trades);
+            progress_it->second = stock.progress;
+            total_events += stock.progress.events;
+            ++restored;
+        }
+        factor_storage_ = std::move(factors);
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start_time);
+        spdlog::info("已从检查点恢复: {}（{}只股票，已处理{}个事件，{}个因子，耗时{}ms）",
+                     file_path, restored, total_events, factor_storage_.size(), duration.count());
+        return true;
+    }
+
+    // 新增：离线回放一只股票一整天的行情（事件按时间排序）
+    // 逐事件维护订单簿、TickDataManager和BarSeriesHolder时间，并记录每个快照所在的各频率时间桶；
+    // 未实现批量的指标逐tick计算，实现了的指标在整日快照就绪后各调用一次CalculateBatch
+    // 最终结果与逐事件调用update一致；实时场景仍使用update
+    void process_stock_batch(const std::string& symbol, const std::vector<MarketAllField>& events) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        BarSeriesHolder* holder = get_stock_bar_holder(symbol);
+        if (!holder || batch_indicators_.empty()) {
+            for (const auto& event : events) update(event);
+            return;
+        }
+        auto book_it = order_books_.find(symbol);
+        OrderBook* book = book_it != order_books_.end() ? &book_it->second : nullptr;
+
+        std::vector<SyncTickData> ticks;
+        std::vector<int> buckets[kFrequencyCount];
+        // 与onOrder/onTrade共用同一份待归属缓冲：先接上此前（如检查点恢复）未归属的逐笔，
+        // 结束时把最后一个快照之后的逐笔留给下一个快照
+        SyncTickData& pending = stock_sync_data_[symbol];
+        size_t order_count = 0, trade_count = 0;
+
+        for (const auto& event : events) {
+            switch (event.type) {
+                case MarketBufferType::Order: {
+                    const OrderData& order = event.get_order();
+                    pending.orders.push_back(order);
+                    if (book) {
+                        book->on_order(order);
+                        notify_order_book_listeners(*book);
+                    }
+                    ++order_count;
+                    break;
+                }
+                case MarketBufferType::Trade: {
+                    const TradeData& trade = event.get_trade();
+                    pending.trans.push_back(trade);
+                    if (book) {
+                        book->on_trade(trade);
+                        notify_order_book_listeners(*book);
+                    }
+                    ++trade_count;
+                    break;
+                }
+                case MarketBufferType::Tick: {
+                    const TickData& tick = event.get_tick();
+                    SyncTickData& sync_tick = ticks.emplace_back();
+                    sync_tick.symbol = tick.symbol;
+                    sync_tick.local_time_stamp = tick.real_time;
+                    sync_tick.tick_data = tick;
+                    sync_tick.orders.swap(pending.orders);
+                    sync_tick.trans.swap(pending.trans);
+
+                    update_tick_data_manager(sync_tick);
+                    holder->update_time(tick.real_time);
+                    for (int f = 0; f < kFrequencyCount; ++f) {
+                        buckets[f].push_back(holder->get_idx(static_cast<Frequency>(f)));
+                    }
+
+                    if (!event_indicators_.empty()) {
+                        IndicatorTickContext ctx = IndicatorTickContext::resolve(sync_tick, holder);
+                        ctx.book = book;
+                        for (Indicator* indicator : event_indicators_) {
+                            try {
+                                indicator->try_calculate_with_context(ctx);
+                            } catch (const std::exception& e) {
+                                spdlog::error("Indicator[{}] 计算失败 for {}: {}", indicator->name(), symbol, e.what());
+                            }
+                        }
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        IndicatorBatchContext batch;
+        batch.ticks = ticks.data();
+        batch.count = ticks.size();
+        batch.holder = holder;
+        for (int f = 0; f < kFrequencyCount; ++f) {
+            batch.bucket_index[f] = buckets[f].data();
+        }
+        for (Indicator* indicator : batch_indicators_) {
+            try {
+                indicator->try_calculate_batch(batch);
+            } catch (const std::exception& e) {
+                spdlog::error("Indicator[{}] 批量计算失败 for {}: {}", indicator->name(), symbol, e.what());
+            }
+        }
+
+        if (!events.empty()) record_progress(events.back(), events.size());
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+        perf_stats_.total_ticks.fetch_add(ticks.size());
+        perf_stats_.total_orders.fetch_add(order_count);
+        perf_stats_.total_trades.fetch_add(trade_count);
+        perf_stats_.total_tick_time_us.fetch_add(duration.count());
+        spdlog::info("[process_stock_batch] {} 完成: {}个快照, {}个批量指标, {}个逐tick指标, 耗时:{}μs",
+                     symbol, ticks.size(), batch_indicators_.size(), event_indicators_.size(), duration.count());
+    }
+
+    // 新增：逐笔事件应用到订单簿后通知需要订单簿事件的指标（没有此类指标时不做任何额外工作）
+    void notify_order_book_listeners(const OrderBook& book) {
+        if (book_listeners_.empty()) return;
+        BarSeriesHolder* holder = get_stock_bar_holder(book.symbol());
+        if (holder) {
+            holder->update_time(book.last_update_time());
+        }
+        for (Indicator* indicator : book_listeners_) {
+            try {
+                indicator->on_order_book_event(book, holder);
+            } catch (const std::exception& e) {
+                spdlog::error("Indicator[{}] 订单簿事件处理失败 for {}: {}", indicator->name(), book.symbol(), e.what());
+            }
+        }
+    }
+
     // 重构：处理订单（直接添加到对应股票的 SyncTickData）
     void onOrder(const OrderData& order) {
         auto start_time = std::chrono::high_resolution_clock::now();
         
         stock_sync_data_[order.symbol].orders.push_back(order);
+        auto book_it = order_books_.find(order.symbol);
+        if (book_it != order_books_.end()) {
+            book_it->second.on_order(order);
+            notify_order_book_listeners(book_it->second);
+        }
         
         auto end_time = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
@@ -598,6 +1458,11 @@ public:
         auto start_time = std::chrono::high_resolution_clock::now();
         
         stock_sync_data_[trade.symbol].trans.push_back(trade);
+        auto book_it = order_books_.find(trade.symbol);
+        if (book_it != order_books_.end()) {
+            book_it->second.on_trade(trade);
+            notify_order_book_listeners(book_it->second);
+        }
         
         auto end_time = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
@@ -625,32 +1490,32 @@ public:
         sync_tick.symbol = tick.symbol;
         sync_tick.local_time_stamp = tick.real_time;
         
-        // 先更新TickDataManager和BarSeriesHolder的时间索引
+        // 先更新TickDataManager和BarSeriesHolder的时间索引（股票的BarSeriesHolder只查找一次）
         auto time_update_start = std::chrono::high_resolution_clock::now();
         update_tick_data_manager(sync_tick);
-//        auto time_update_end = std::chrono::high_resolution_clock::now();
-        update_bar_series_holder_time(sync_tick.symbol, sync_tick.tick_data.real_time);
+        BarSeriesHolder* holder = get_stock_bar_holder(sync_tick.symbol);
+        if (holder) {
+            holder->update_time(sync_tick.tick_data.real_time);
+        }
         auto time_update_end = std::chrono::high_resolution_clock::now();
         auto time_update_duration = std::chrono::duration_cast<std::chrono::microseconds>(time_update_end - time_update_start);
         
         // 然后立即同步计算所有Indicator（在当前线程中）
+        // 共享前置：holder和各频率桶索引只解析一次，各Indicator直接使用预解析的上下文
         auto indicator_calc_start = std::chrono::high_resolution_clock::now();
+        IndicatorTickContext ctx = IndicatorTickContext::resolve(sync_tick, holder);
+        ctx.book = get_order_book(sync_tick.symbol);
         int indicator_count = 0;
-        for (auto &[name, indicator]: indicators_) {
+        for (Indicator* indicator : compiled_indicators_) {
             try {
-                // 修改：不再设置current_bar_holder_，让indicator直接通过股票代码获取BarSeriesHolder
-                // 这样可以避免线程竞争，实现真正的并行处理
-                
-                auto single_indicator_start = std::chrono::high_resolution_clock::now();
-                indicator->try_calculate(sync_tick);
-                auto single_indicator_end = std::chrono::high_resolution_clock::now();
-                auto single_indicator_duration = std::chrono::duration_cast<std::chrono::microseconds>(single_indicator_end - single_indicator_start);
-                
-                spdlog::debug("[onTick] Indicator[{}] 计算完成, 耗时:{}μs", name, single_indicator_duration.count());
+                if (holder) {
+                    indicator->try_calculate_with_context(ctx);
+                } else {
+                    indicator->try_calculate(sync_tick);
+                }
                 indicator_count++;
-
             } catch (const std::exception &e) {
-                spdlog::error("Indicator[{}] 计算失败 for {}: {}", name, sync_tick.symbol, e.what());
+                spdlog::error("Indicator[{}] 计算失败 for {}: {}", indicator->name(), sync_tick.symbol, e.what());
             }
         }
         auto indicator_calc_end = std::chrono::high_resolution_clock::now();
@@ -671,17 +1536,82 @@ public:
                      indicator_count, indicator_calc_duration.count(), cleanup_duration.count(), total_duration.count());
     }
 
+    // 新增：整日Factor处理 - 调用方保证所有输入指标已是最终值（行情已回放完或从文件加载）
+    // 支持整日回填的Factor每个一次调用算出全部时间桶，其余Factor仍按时间事件逐桶计算
+    void process_factor_full_day(const std::vector<uint64_t>& time_events) {
+        std::set<std::string> full_day_factors;
+        std::vector<std::thread> factor_threads;
+        // 整日回填的所有Factor视为同一个时间事件，共享中间结果
+        event_cache_.begin_event();
+
+        for (auto& [factor_name, factor_ptr] : factors_) {
+            if (!factor_ptr->supports_full_day()) continue;
+
+            // 时间事件落在的时间桶（与逐桶路径写出的桶一致）
+            std::vector<int> buckets;
+            for (const auto& timestamp : time_events) {
+                int ti = calculate_time_bucket(timestamp, factor_ptr->get_frequency());
+                if (ti >= 0 && (buckets.empty() || buckets.back() != ti)) buckets.push_back(ti);
+            }
+            if (buckets.empty()) continue;
+            full_day_factors.insert(factor_name);
+            factor_storage_[factor_name];  // 在启动线程前建好外层条目，各线程只写自己的内层map
+
+            factor_threads.emplace_back([this, factor_ptr = factor_ptr, buckets = std::move(buckets)]() {
+                try {
+                    auto calc_start = std::chrono::high_resolution_clock::now();
+                    int bar_count = *std::max_element(buckets.begin(), buckets.end()) + 1;
+                    std::vector<GSeries> panel = factor_ptr->definition_full_day(shared_from_this(), stock_list_, bar_count);
+
+                    for (int ti : buckets) {
+                        if (ti < static_cast<int>(panel.size()) && panel[ti].get_size() > 0) {
+                            set_factor_result_batch(factor_ptr->get_name(), ti, stock_list_, panel[ti]);
+                        }
+                    }
+                    auto calc_duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::high_resolution_clock::now() - calc_start);
+                    spdlog::info("Factor[{}]整日回填完成: {}个时间桶, 耗时{}μs",
+                                 factor_ptr->get_name(), buckets.size(), calc_duration.count());
+                } catch (const std::exception& e) {
+                    spdlog::error("Factor[{}]整日回填失败: {}", factor_ptr->get_name(), e.what());
+                }
+            });
+        }
+
+        for (auto& thread : factor_threads) {
+            thread.join();
+        }
+        event_cache_.end_event();
+
+        if (full_day_factors.size() < factors_.size()) {
+            process_factor_time_events(time_events, full_day_factors);
+        } else {
+            seal_result_journals();
+        }
+    }
+
     // 新增：独立的Factor时间处理（按时间事件顺序，每个时间事件内按Factor多线程）
-    void process_factor_time_events(const std::vector<uint64_t>& time_events) {
+    // skip_factors中的Factor不参与（已由整日回填算完）
+    void process_factor_time_events(const std::vector<uint64_t>& time_events,
+                                    const std::set<std::string>& skip_factors = {}) {
         spdlog::info("开始处理{}个时间事件", time_events.size());
+
+        // 增量因子在第一个时间事件前初始化当日状态
+        for (auto& [factor_name, factor_ptr] : factors_) {
+            if (!skip_factors.count(factor_name) && factor_ptr->supports_incremental()) {
+                factor_ptr->on_day_start(shared_from_this(), stock_list_);
+            }
+        }
         
         for (const auto& timestamp : time_events) {
             spdlog::debug("处理时间事件: {}", timestamp);
             
             // 创建Factor线程组，每个Factor一个线程
             std::vector<std::thread> factor_threads;
+            event_cache_.begin_event();
             
             for (auto& [factor_name, factor_ptr] : factors_) {
+                if (skip_factors.count(factor_name)) continue;
                 factor_threads.emplace_back([this, factor_ptr = factor_ptr, timestamp]() {
                     try {
                         // 定义get_indicator函数
@@ -699,7 +1629,9 @@ public:
                             // 尝试使用CalculationEngine驱动
                             int ti = calculate_time_bucket(timestamp, factor_ptr->get_frequency());
                             if (ti >= 0) {
-                                result = factor_ptr->definition_with_cal_engine(shared_from_this(), stock_list_, ti);
+                                result = factor_ptr->supports_incremental()
+                                    ? factor_ptr->on_bucket(shared_from_this(), stock_list_, ti)
+                                    : factor_ptr->definition_with_cal_engine(shared_from_this(), stock_list_, ti);
                             }
                             
                             // 如果CalculationEngine驱动返回空结果，回退到时间戳驱动
@@ -742,20 +1674,30 @@ public:
             for (auto& thread : factor_threads) {
                 thread.join();
             }
+            // 释放本事件的共享中间结果
+            event_cache_.end_event();
 
             spdlog::debug("时间事件 {} 的所有Factor处理完成", timestamp);
         }
         
-        spdlog::info("所有Factor时间事件处理完成");
+        seal_result_journals();
+        spdlog::info("所有Factor时间事件处理完成，事件缓存命中{}次、计算{}次", event_cache_.hits(), event_cache_.misses());
     }
 
     // 新增：同步运行的Factor时间处理（与Indicator同时运行）
     void process_factor_time_events_sync(const std::vector<uint64_t>& time_events) {
+
+        for (auto& [factor_name, factor_ptr] : factors_) {
+            if (factor_ptr->supports_incremental()) {
+                factor_ptr->on_day_start(shared_from_this(), stock_list_);
+            }
+        }
         
         for (const auto& timestamp : time_events) {
             
             // 创建Factor线程组，每个Factor一个线程
             std::vector<std::thread> factor_threads;
+            event_cache_.begin_event();
             
             for (auto& [factor_name, factor_ptr] : factors_) {
                 factor_threads.emplace_back([this, factor_ptr = factor_ptr, timestamp]() {
@@ -774,7 +1716,9 @@ public:
                             // 尝试使用CalculationEngine驱动
                             int ti = calculate_time_bucket(timestamp, factor_ptr->get_frequency());
                             if (ti >= 0) {
-                                result = factor_ptr->definition_with_cal_engine(shared_from_this(), stock_list_, ti);
+                                result = factor_ptr->supports_incremental()
+                                    ? factor_ptr->on_bucket(shared_from_this(), stock_list_, ti)
+                                    : factor_ptr->definition_with_cal_engine(shared_from_this(), stock_list_, ti);
                             }
                             
                             // 如果CalculationEngine驱动返回空结果，回退到ti驱动
@@ -810,11 +1754,14 @@ public:
             for (auto& thread : factor_threads) {
                 thread.join();
             }
+            // 释放本事件的共享中间结果
+            event_cache_.end_event();
 
 //            spdlog::debug("同步时间事件 {} 的所有Factor处理完成", timestamp);
         }
         
-        spdlog::info("所有Factor时间事件处理完成");
+        seal_result_journals();
+        spdlog::info("所有Factor时间事件处理完成，事件缓存命中{}次、计算{}次", event_cache_.hits(), event_cache_.misses());
     }
 
     // 计算时间桶索引（通用函数，支持不同频率）
@@ -936,6 +1883,7 @@ public:
             default:
                 spdlog::warn("未知数据类型: {}", static_cast<int>(field.type));
         }
+        record_progress(field, 1);
         
         // 检查是否需要输出性能统计
         auto now = std::chrono::steady_clock::now();
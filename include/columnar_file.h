@@ -0,0 +1,360 @@
+#pragma once
+
+#include "data_structures.h"
+#include "config.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <limits>
+#include <unordered_map>
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "spdlog/spdlog.h"
+
+// 列式二进制指标/因子文件（.col），替代按行格式化/解析的宽表csv.gz
+//
+// 文件布局（本机字节序，即小端；各段起点按8字节对齐）：
+//   [Header]          魔数、版本、数值宽度(4/8)、时间桶数、股票数、频率、各段偏移
+//   [符号字典]        stock_count个 (u16长度 + 股票代码字节)
+//   [块目录]          stock_count个 Block{偏移, 存储字节数, 编码}
+//   [数据块]          每只股票一列，bucket_count个float/double，NaN为缺失；
+//                     未压缩块之间间距固定为column_stride_bytes
+// 块可选用zlib最快档压缩（codec=1），压缩后不更小的块按原样存储
+//
+// 读取时mmap整个文件：全部块未压缩时直接在映射内存上给出按股票（连续）或按时间桶（跨列步长）的视图，
+// 不做任何文本解析；有压缩块时解压到读取器自有的同布局缓冲区，视图接口不变
+class ColumnarFile {
+public:
+    static constexpr char kMagic[8] = {'A', 'F', 'C', 'O', 'L', 'U', 'M', 'N'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kCodecRaw = 0;
+    static constexpr uint32_t kCodecZlib = 1;
+    static constexpr const char* kExtension = ".col";
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t value_bytes;           // 4=float32, 8=float64
+        uint32_t bucket_count;
+        uint32_t stock_count;
+        uint32_t codec;                 // 写入时请求的编码（各块实际编码见块目录）
+        uint32_t reserved;
+        char frequency[16];             // 如"1min"，以0结尾
+        uint64_t dict_offset;
+        uint64_t dir_offset;
+        uint64_t data_offset;
+        uint64_t column_stride_bytes;   // 每列占用的字节数（按8字节对齐）
+    };
+    static_assert(sizeof(Header) == 80, "ColumnarFile::Header布局变化会破坏已有文件");
+
+    struct Block {
+        uint64_t offset;
+        uint32_t stored_bytes;
+        uint32_t codec;
+    };
+    static_assert(sizeof(Block) == 16, "ColumnarFile::Block布局变化会破坏已有文件");
+
+    static uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+    // 写出一个时间桶×股票的表：columns[i]为stocks[i]的整日序列，长度不足bucket_count的部分写NaN
+    // 先写临时文件再rename，正在mmap旧文件的读取器不受影响
+    static bool write(const std::string& file_path, const std::string& frequency,
+                      const std::vector<std::string>& stocks, const std::vector<GSeriesView>& columns,
+                      int bucket_count, StoragePrecision precision, bool compress) {
+        if (stocks.size() != columns.size()) {
+            spdlog::error("ColumnarFile: 股票数{}与列数{}不一致: {}", stocks.size(), columns.size(), file_path);
+            return false;
+        }
+        if (bucket_count < 0 || frequency.size() >= sizeof(Header::frequency)) {
+            spdlog::error("ColumnarFile: 时间桶数{}或频率[{}]无效: {}", bucket_count, frequency, file_path);
+            return false;
+        }
+
+        const uint32_t value_bytes = precision == StoragePrecision::Float32 ? 4 : 8;
+        const uint64_t raw_bytes = static_cast<uint64_t>(bucket_count) * value_bytes;
+
+        Header header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.value_bytes = value_bytes;
+        header.bucket_count = static_cast<uint32_t>(bucket_count);
+        header.stock_count = static_cast<uint32_t>(stocks.size());
+        header.codec = compress ? kCodecZlib : kCodecRaw;
+        std::memcpy(header.frequency, frequency.data(), frequency.size());
+        header.column_stride_bytes = align8(raw_bytes);
+
+        std::string dict;
+        for (const auto& stock : stocks) {
+            if (stock.size() > 0xFFFF) {
+                spdlog::error("ColumnarFile: 股票代码过长: {}", stock);
+                return false;
+            }
+            uint16_t len = static_cast<uint16_t>(stock.size());
+            dict.append(reinterpret_cast<const char*>(&len), sizeof(len));
+            dict.append(stock);
+        }
+        header.dict_offset = sizeof(Header);
+        header.dir_offset = align8(header.dict_offset + dict.size());
+        header.data_offset = align8(header.dir_offset + sizeof(Block) * stocks.size());
+
+        // 逐列编码（NaN补齐 -> 可选压缩）
+        std::vector<Block> blocks(stocks.size());
+        std::vector<std::string> payloads(stocks.size());
+        std::string column(raw_bytes, '\0');
+        uint64_t offset = header.data_offset;
+        for (size_t i = 0; i < stocks.size(); ++i) {
+            encode_column(columns[i], bucket_count, precision, &column[0]);
+            Block& block = blocks[i];
+            block.codec = kCodecRaw;
+            if (compress && raw_bytes > 0) {
+                uLongf bound = compressBound(static_cast<uLong>(raw_bytes));
+                std::string packed(bound, '\0');
+                if (compress2(reinterpret_cast<Bytef*>(&packed[0]), &bound,
+                              reinterpret_cast<const Bytef*>(column.data()), static_cast<uLong>(raw_bytes),
+                              Z_BEST_SPEED) == Z_OK && bound < raw_bytes) {
+                    packed.resize(bound);
+                    payloads[i] = std::move(packed);
+                    block.codec = kCodecZlib;
+                }
+            }
+            if (block.codec == kCodecRaw) payloads[i] = column;
+            block.offset = offset;
+            block.stored_bytes = static_cast<uint32_t>(payloads[i].size());
+            // 未压缩块占满整列的对齐间距，保证全raw文件中列间距固定
+            offset += block.codec == kCodecRaw ? header.column_stride_bytes : align8(payloads[i].size());
+        }
+
+        std::string tmp_path = file_path + ".tmp";
+        FILE* fp = std::fopen(tmp_path.c_str(), "wb");
+        if (!fp) {
+            spdlog::error("ColumnarFile: 无法创建文件: {}", tmp_path);
+            return false;
+        }
+        bool ok = true;
+        uint64_t written = 0;
+        auto put = [&](const void* data, uint64_t size) {
+            if (ok && size > 0 && std::fwrite(data, 1, size, fp) != size) ok = false;
+            written += size;
+        };
+        auto pad_to = [&](uint64_t target) {
+            static const char zeros[8] = {0};
+            while (ok && written < target) put(zeros, std::min<uint64_t>(8, target - written));
+        };
+        put(&header, sizeof(header));
+        put(dict.data(), dict.size());
+        pad_to(header.dir_offset);
+        put(blocks.data(), sizeof(Block) * blocks.size());
+        pad_to(header.data_offset);
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            pad_to(blocks[i].offset);
+            put(payloads[i].data(), payloads[i].size());
+        }
+        pad_to(offset);
+        if (std::fclose(fp) != 0) ok = false;
+        if (!ok) {
+            spdlog::error("ColumnarFile: 写入失败: {}", tmp_path);
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        if (std::rename(tmp_path.c_str(), file_path.c_str()) != 0) {
+            spdlog::error("ColumnarFile: 无法重命名{} -> {}", tmp_path, file_path);
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static void encode_column(const GSeriesView& src, int bucket_count, StoragePrecision precision, char* out) {
+        int n = std::min(src.get_size(), bucket_count);
+        if (precision == StoragePrecision::Float32) {
+            float* dst = reinterpret_cast<float*>(out);
+            for (int i = 0; i < n; ++i) dst[i] = static_cast<float>(src[i]);
+            std::fill(dst + n, dst + bucket_count, std::numeric_limits<float>::quiet_NaN());
+        } else {
+            double* dst = reinterpret_cast<double*>(out);
+            for (int i = 0; i < n; ++i) dst[i] = src[i];
+            std::fill(dst + n, dst + bucket_count, std::numeric_limits<double>::quiet_NaN());
+        }
+    }
+};
+
+// .col文件的只读映射；返回的视图在读取器析构前有效
+class ColumnarReader {
+public:
+    ColumnarReader() = default;
+    ~ColumnarReader() { close(); }
+
+    ColumnarReader(const ColumnarReader&) = delete;
+    ColumnarReader& operator=(const ColumnarReader&) = delete;
+
+    bool open(const std::string& file_path) {
+        close();
+        int fd = ::open(file_path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            spdlog::error("ColumnarReader: 无法打开文件: {}", file_path);
+            return false;
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ColumnarFile::Header))) {
+            spdlog::error("ColumnarReader: 文件过小或无法读取: {}", file_path);
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);  // 映射建立后即可关闭描述符
+        if (mapped == MAP_FAILED) {
+            spdlog::error("ColumnarReader: mmap失败: {}", file_path);
+            size_ = 0;
+            return false;
+        }
+        map_ = static_cast<const char*>(mapped);
+        if (!parse(file_path)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (map_) ::munmap(const_cast<char*>(map_), size_);
+        map_ = nullptr;
+        size_ = 0;
+        stocks_.clear();
+        stock_index_.clear();
+        owned_.clear();
+        base_ = nullptr;
+        header_ = ColumnarFile::Header{};
+    }
+
+    bool is_open() const { return map_ != nullptr; }
+    const std::vector<std::string>& stocks() const { return stocks_; }
+    int stock_count() const { return static_cast<int>(header_.stock_count); }
+    int bucket_count() const { return static_cast<int>(header_.bucket_count); }
+    std::string frequency() const { return std::string(header_.frequency, strnlen(header_.frequency, sizeof(header_.frequency))); }
+    StoragePrecision precision() const {
+        return header_.value_bytes == 4 ? StoragePrecision::Float32 : StoragePrecision::Float64;
+    }
+    // 是否直接在映射内存上读取（没有压缩块）
+    bool is_zero_copy() const { return base_ != nullptr && owned_.empty(); }
+
+    // 股票在文件中的列号，不存在返回-1
+    int stock_index(const std::string& stock) const {
+        auto it = stock_index_.find(stock);
+        return it == stock_index_.end() ? -1 : it->second;
+    }
+
+    // 一只股票的整日序列（连续）
+    GSeriesView stock_view(int i) const {
+        if (i < 0 || i >= stock_count()) return GSeriesView();
+        const char* column = base_ + static_cast<size_t>(i) * header_.column_stride_bytes;
+        if (header_.value_bytes == 4) return GSeriesView(reinterpret_cast<const float*>(column), bucket_count());
+        return GSeriesView(reinterpret_cast<const double*>(column), bucket_count());
+    }
+
+    GSeriesView stock_view(const std::string& stock) const { return stock_view(stock_index(stock)); }
+
+    // 一个时间桶的截面（按文件中的股票顺序，跨列步长访问）
+    GSeriesView bucket_view(int ti) const {
+        if (ti < 0 || ti >= bucket_count() || stock_count() == 0) return GSeriesView();
+        int stride = static_cast<int>(header_.column_stride_bytes / header_.value_bytes);
+        if (header_.value_bytes == 4) return GSeriesView(reinterpret_cast<const float*>(base_) + ti, stock_count(), stride);
+        return GSeriesView(reinterpret_cast<const double*>(base_) + ti, stock_count(), stride);
+    }
+
+private:
+    bool parse(const std::string& file_path) {
+        std::memcpy(&header_, map_, sizeof(header_));
+        if (std::memcmp(header_.magic, ColumnarFile::kMagic, sizeof(ColumnarFile::kMagic)) != 0 ||
+            header_.version != ColumnarFile::kVersion) {
+            spdlog::error("ColumnarReader: 不是列式文件或版本不支持: {}", file_path);
+            return false;
+        }
+        const uint64_t stocks = header_.stock_count;
+        const uint64_t raw_bytes = static_cast<uint64_t>(header_.bucket_count) * header_.value_bytes;
+        if ((header_.value_bytes != 4 && header_.value_bytes != 8) ||
+            header_.column_stride_bytes != ColumnarFile::align8(raw_bytes) ||
+            header_.dir_offset + stocks * sizeof(ColumnarFile::Block) > size_ || header_.data_offset > size_ ||
+            header_.data_offset % 8 != 0) {
+            spdlog::error("ColumnarReader: 文件头无效: {}", file_path);
+            return false;
+        }
+
+        // 符号字典
+        uint64_t pos = header_.dict_offset;
+        stocks_.reserve(stocks);
+        for (uint64_t i = 0; i < stocks; ++i) {
+            uint16_t len = 0;
+            if (pos + sizeof(len) > header_.dir_offset) return corrupt(file_path);
+            std::memcpy(&len, map_ + pos, sizeof(len));
+            pos += sizeof(len);
+            if (pos + len > header_.dir_offset) return corrupt(file_path);
+            stocks_.emplace_back(map_ + pos, len);
+            stock_index_.emplace(stocks_.back(), static_cast<int>(i));
+            pos += len;
+        }
+        if (stocks == 0) return true;
+
+        // 块目录：全部为raw且按固定间距排布时零拷贝，否则解压/拷贝到自有缓冲区
+        std::vector<ColumnarFile::Block> blocks(stocks);
+        std::memcpy(blocks.data(), map_ + header_.dir_offset, sizeof(ColumnarFile::Block) * stocks);
+        bool contiguous = true;
+        for (uint64_t i = 0; i < stocks; ++i) {
+            const auto& block = blocks[i];
+            if (block.offset + block.stored_bytes > size_) return corrupt(file_path);
+            if (block.codec == ColumnarFile::kCodecRaw && block.stored_bytes != raw_bytes) return corrupt(file_path);
+            if (block.codec != ColumnarFile::kCodecRaw ||
+                block.offset != header_.data_offset + i * header_.column_stride_bytes) {
+                contiguous = false;
+            }
+        }
+        if (contiguous) {
+            base_ = map_ + header_.data_offset;
+            return true;
+        }
+
+        owned_.assign(stocks * header_.column_stride_bytes / sizeof(double), 0.0);
+        char* dst_base = reinterpret_cast<char*>(owned_.data());
+        for (uint64_t i = 0; i < stocks; ++i) {
+            const auto& block = blocks[i];
+            char* dst = dst_base + i * header_.column_stride_bytes;
+            if (block.codec == ColumnarFile::kCodecRaw) {
+                std::memcpy(dst, map_ + block.offset, raw_bytes);
+            } else if (block.codec == ColumnarFile::kCodecZlib) {
+                uLongf out_len = static_cast<uLongf>(raw_bytes);
+                if (uncompress(reinterpret_cast<Bytef*>(dst), &out_len,
+                               reinterpret_cast<const Bytef*>(map_ + block.offset), block.stored_bytes) != Z_OK ||
+                    out_len != raw_bytes) {
+                    spdlog::error("ColumnarReader: 第{}列解压失败: {}", i, file_path);
+                    return false;
+                }
+            } else {
+                spdlog::error("ColumnarReader: 第{}列编码{}不支持: {}", i, block.codec, file_path);
+                return false;
+            }
+        }
+        base_ = dst_base;
+        return true;
+    }
+
+    bool corrupt(const std::string& file_path) const {
+        spdlog::error("ColumnarReader: 文件内容越界或损坏: {}", file_path);
+        return false;
+    }
+
+    const char* map_ = nullptr;
+    size_t size_ = 0;
+    ColumnarFile::Header header_{};
+    std::vector<std::string> stocks_;
+    std::unordered_map<std::string, int> stock_index_;
+    std::vector<double> owned_;     // 有压缩块时的解压缓冲（double保证8字节对齐）
+    const char* base_ = nullptr;    // 第0列起点（映射内存或owned_）
+};
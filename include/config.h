@@ -9,6 +9,69 @@
 #include <tinyxml2.h>
 #include "spdlog/spdlog.h"
 
+// 新增：序列存储精度（float32存储可减半内存，统计归约仍按double累加）
+enum class StoragePrecision {
+    Float64,
+    Float32
+};
+
+inline StoragePrecision parse_storage_precision(const std::string& precision_str) {
+    if (precision_str == "float32") return StoragePrecision::Float32;
+    return StoragePrecision::Float64;
+}
+
+inline const char* storage_precision_to_string(StoragePrecision precision) {
+    return precision == StoragePrecision::Float32 ? "float32" : "float64";
+}
+
+// 新增：指标/因子结果文件格式（csv.gz宽表，或列式二进制.col，可选按列zlib压缩）
+enum class StorageFormat {
+    CsvGz,
+    Columnar,
+    ColumnarZlib
+};
+
+inline bool parse_storage_format(const std::string& format_str, StorageFormat& format) {
+    if (format_str == "csv") { format = StorageFormat::CsvGz; return true; }
+    if (format_str == "columnar") { format = StorageFormat::Columnar; return true; }
+    if (format_str == "columnar_zlib") { format = StorageFormat::ColumnarZlib; return true; }
+    return false;
+}
+
+inline bool is_columnar_format(StorageFormat format) {
+    return format != StorageFormat::CsvGz;
+}
+
+// 新增：盘中结果日志的落盘策略（每个封口桶都会fflush到操作系统，进程崩溃不丢；fsync决定断电时丢多少）
+enum class JournalSync {
+    None,    // 从不fsync，由操作系统回写
+    Close,   // 收盘关闭日志时fsync一次
+    Bucket   // 每个时间桶封口时fsync
+};
+
+inline bool parse_journal_sync(const std::string& sync_str, JournalSync& sync) {
+    if (sync_str == "none") { sync = JournalSync::None; return true; }
+    if (sync_str == "close") { sync = JournalSync::Close; return true; }
+    if (sync_str == "bucket") { sync = JournalSync::Bucket; return true; }
+    return false;
+}
+
+// 新增：解析逗号分隔的属性列表（如"1min,5min,30min"），去除空白和空项
+inline std::vector<std::string> split_list_attribute(const std::string& value) {
+    std::vector<std::string> items;
+    size_t begin = 0;
+    while (begin <= value.size()) {
+        size_t end = value.find(',', begin);
+        if (end == std::string::npos) end = value.size();
+        std::string item = value.substr(begin, end - begin);
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (!item.empty()) items.push_back(item);
+        begin = end + 1;
+    }
+    return items;
+}
+
 // 模块配置（Indicator/Factor，PDF 1.2节）
 struct ModuleConfig {
     std::string handler;   // "Indicator"或"Factor"
@@ -16,12 +79,47 @@ struct ModuleConfig {
     std::string id;        // 计算类名（如MAIndicator、VolFactor）
     std::string path ;      // 存储路径（如/dat/indicator）
     std::string frequency; // 频率（Indicator:15S/1min/5min/30min；Factor:5min）
+    StoragePrecision precision = StoragePrecision::Float64; // 可选：存储精度（float64/float32）
+    StorageFormat format = StorageFormat::CsvGz; // 可选：结果文件格式（csv/columnar/columnar_zlib）
+    bool journal = false; // 可选：Factor盘中把每个封口的时间桶追加写入日志，收盘压缩为日文件
+    JournalSync journal_sync = JournalSync::Close; // 可选：日志的fsync策略（none/close/bucket）
+    std::vector<std::string> rollup_frequencies; // 可选：写入时同步汇总的更粗频率（如1min,5min,30min）
+    std::vector<std::string> fields; // 可选：启用的字段（如DiffIndicator的volume,amount），为空时使用指标默认字段
+    std::vector<std::string> inputs; // 可选：派生指标依赖的上游Indicator模块名（如VwapIndicator依赖diff_volume_amount）
+    std::vector<double> size_thresholds; // 可选：按成交金额划分单笔大小的升序阈值（如OrderFlowIndicator的小/中/大/特大单）
+    std::string expression; // 可选：ExpressionFactor的因子表达式（如rank(ts_mean(diff_volume_amount.amount, 6))）
+    std::vector<std::string> neutralize; // 可选：Factor输出前中性化的暴露（industry和/或指标名.字段，如industry,diff_volume_amount.amount）
+};
+
+// 新增：因子评估配置（<Evaluation>节点，可选，FactorEvaluator使用）
+struct EvaluationConfig {
+    std::string start_date;                       // 评估起始日期（含，YYYYMMDD），为空时只评估calculate_date
+    std::string end_date;                         // 评估结束日期（含），为空时与start_date相同
+    std::string factor_path = "data/factor";      // 因子结果根目录（ResultStorage::save_factor的输出）
+    std::vector<std::string> factors;             // 待评估的因子名，为空时评估目录下发现的所有因子
+    std::string price_path = "data/indicator";    // 价格指标根目录
+    std::string price_indicator = "diff_volume_amount";  // 提供价格的指标模块名
+    std::string price_field = "last_price";       // 价格字段（各时间桶最后价）
+    std::string frequency = "5min";               // 因子与价格的时间桶频率
+    std::vector<int> horizons = {1, 2, 4, 8};     // 远期收益的持有时间桶数（IC衰减）
+    int quantiles = 5;                            // 分组收益的组数
+    int threads = 0;                              // 评估线程数（0表示CPU核心数）
+    std::string output = "factor_evaluation.csv"; // 汇总报告路径
+};
+
+// 新增：引擎检查点配置（<Checkpoint>节点，可选）
+struct CheckpointConfig {
+    std::string path;              // 检查点文件路径，为空时不写检查点也不恢复
+    int interval_seconds = 0;      // 逐事件回放时每隔多少秒行情时间写一次检查点（0表示只在指标回放完成后写一次）
 };
 
 // 全局配置（PDF 1.2节）
 struct GlobalConfig {
     std::string calculate_date = "20240701.csv";   // 计算日期（如20240701）
+    std::string end_date;         // 新增：连续回放的最后一日（含），为空时只计算calculate_date
     std::string stock_universe;   // 股票池名称（如1800）
+    double tick_size = 0.0;       // 新增：订单簿的最小变动价位，0表示按证券代码推断（基金/ETF/可转债0.001，股票0.01）
+    std::string industry_file;    // 新增：股票行业文件（每行"股票代码,行业代码"），Factor按industry中性化时使用
     int pre_days;             // 提前加载的Indicator天数（如5）
     std::vector<ModuleConfig> modules;  // 所有模块配置
     uint64_t  factor_frequency = 300000; //因子factor计算触发间隔（毫秒，如5分钟=300000ms）
@@ -30,6 +128,12 @@ struct GlobalConfig {
     size_t indicator_thread_count = 0;
     // factor因子线程数（0表示自动根据CPU核心数确定）
     size_t factor_thread_count = 0;
+    // 结果保存线程数（0表示自动根据CPU核心数确定）
+    size_t save_thread_count = 0;
+    // 新增：因子评估配置
+    EvaluationConfig evaluation;
+    // 新增：引擎检查点配置
+    CheckpointConfig checkpoint;
 };
 
 // 配置加载器（解析XML配置文件）
@@ -65,6 +169,16 @@ public:
         config.calculate_date = calc_date;
         config.stock_universe = stock_univ;
         config.pre_days = pre_days;
+        // 可选属性：end_date，从calculate_date逐日回放到end_date，相邻两日之间换日而不重新加载历史
+        if (const char* end_date = universe_node->Attribute("end_date")) {
+            config.end_date = end_date;
+        }
+        // 可选属性：tick_size，统一指定订单簿的最小变动价位
+        universe_node->QueryDoubleAttribute("tick_size", &config.tick_size);
+        // 可选属性：industry_file，行业中性化使用的股票行业
+        if (const char* industry_file = universe_node->Attribute("industry_file")) {
+            config.industry_file = industry_file;
+        }
 
         // 解析<Tsaigu>-><Modules>-><Module>（PDF 1.2节）
         auto* modules_node = tsaigu_node->FirstChildElement("Modules");
@@ -79,6 +193,63 @@ public:
             module.id = module_node->Attribute("id");
             module.path = module_node->Attribute("path");
             module.frequency = module_node->Attribute("frequency");
+            // 可选属性：precision="float32"时按单精度存储序列
+            if (const char* precision = module_node->Attribute("precision")) {
+                if (std::string(precision) != "float32" && std::string(precision) != "float64") {
+                    spdlog::warn("Module {} unknown precision {}, fallback to float64", module.name, precision);
+                }
+                module.precision = parse_storage_precision(precision);
+            }
+
+            // 可选属性：format="columnar"时结果写为列式二进制文件（.col），读取时mmap直接取视图
+            if (const char* format = module_node->Attribute("format")) {
+                if (!parse_storage_format(format, module.format)) {
+                    spdlog::warn("Module {} unknown format {}, fallback to csv", module.name, format);
+                }
+            }
+
+            // 可选属性：journal="true"时Factor结果在时间桶封口时即写入盘中日志，journal_sync指定fsync策略
+            if (const char* journal = module_node->Attribute("journal")) {
+                module.journal = std::string(journal) == "true";
+            }
+            if (const char* journal_sync = module_node->Attribute("journal_sync")) {
+                if (!parse_journal_sync(journal_sync, module.journal_sync)) {
+                    spdlog::warn("Module {} unknown journal_sync {}, fallback to close", module.name, journal_sync);
+                }
+            }
+
+            // 可选属性：rollup="1min,5min,30min"时，Indicator每个tick同时写入这些频率的bar
+            if (const char* rollup = module_node->Attribute("rollup")) {
+                module.rollup_frequencies = split_list_attribute(rollup);
+            }
+            // 可选属性：fields="volume,amount,last_price"时，只计算列出的字段
+            if (const char* fields = module_node->Attribute("fields")) {
+                module.fields = split_list_attribute(fields);
+            }
+            // 可选属性：inputs="diff_volume_amount"时，该指标读取上游指标的结果，按依赖顺序计算
+            if (const char* inputs = module_node->Attribute("inputs")) {
+                module.inputs = split_list_attribute(inputs);
+            }
+            // 可选属性：size_thresholds="40000,200000,1000000"时，按成交金额划分单笔大小
+            if (const char* thresholds = module_node->Attribute("size_thresholds")) {
+                try {
+                    for (const auto& item : split_list_attribute(thresholds)) {
+                        module.size_thresholds.push_back(std::stod(item));
+                    }
+                } catch (const std::exception& e) {
+                    spdlog::error("Module[{}]的size_thresholds无效: {}", module.name, thresholds);
+                    module.size_thresholds.clear();
+                }
+            }
+
+            // 可选属性：expression="..."时，ExpressionFactor按表达式计算因子
+            if (const char* expression = module_node->Attribute("expression")) {
+                module.expression = expression;
+            }
+            // 可选属性：neutralize="industry,diff_volume_amount.amount"时，Factor结果对这些暴露做截面回归后输出残差
+            if (const char* neutralize = module_node->Attribute("neutralize")) {
+                module.neutralize = split_list_attribute(neutralize);
+            }
 
             // 校验Module字段
             if (module.handler.empty() || module.name.empty() || module.id.empty() || module.path.empty() || module.frequency.empty()) {
@@ -98,6 +269,15 @@ public:
                     spdlog::error("Indicator {} invalid frequency (got {})", module.name, module.frequency);
                     continue;
                 }
+                std::vector<std::string> rollups;
+                for (const auto& freq : module.rollup_frequencies) {
+                    if (std::find(allowed_freq.begin(), allowed_freq.end(), freq) == allowed_freq.end()) {
+                        spdlog::warn("Indicator {} invalid rollup frequency {}, skipping", module.name, freq);
+                    } else if (freq != module.frequency && std::find(rollups.begin(), rollups.end(), freq) == rollups.end()) {
+                        rollups.push_back(freq);
+                    }
+                }
+                module.rollup_frequencies = std::move(rollups);
             }
             config.modules.push_back(module);
         }
@@ -105,10 +285,58 @@ public:
         if (config.modules.empty()) {
             spdlog::info("No valid modules loaded from config");
         }
+
+        // 解析<Tsaigu>-><Evaluation>（可选）
+        if (auto* evaluation_node = tsaigu_node->FirstChildElement("Evaluation")) {
+            load_evaluation(evaluation_node, config.evaluation);
+        }
+        // 解析<Tsaigu>-><Checkpoint>（可选）
+        if (auto* checkpoint_node = tsaigu_node->FirstChildElement("Checkpoint")) {
+            if (const char* path = checkpoint_node->Attribute("path")) config.checkpoint.path = path;
+            checkpoint_node->QueryIntAttribute("interval_seconds", &config.checkpoint.interval_seconds);
+            if (config.checkpoint.interval_seconds < 0) config.checkpoint.interval_seconds = 0;
+        }
         spdlog::info("Config loaded successfully (date: {}, universe: {}, pre_days: {})",
                      config.calculate_date, config.stock_universe, config.pre_days);
         return true;
     }
+
+private:
+    static void load_evaluation(const tinyxml2::XMLElement* node, EvaluationConfig& evaluation) {
+        auto read_string = [node](const char* name, std::string& target) {
+            if (const char* value = node->Attribute(name)) target = value;
+        };
+        read_string("start_date", evaluation.start_date);
+        read_string("end_date", evaluation.end_date);
+        read_string("factor_path", evaluation.factor_path);
+        read_string("price_path", evaluation.price_path);
+        read_string("price_indicator", evaluation.price_indicator);
+        read_string("price_field", evaluation.price_field);
+        read_string("frequency", evaluation.frequency);
+        read_string("output", evaluation.output);
+        if (const char* factors = node->Attribute("factors")) {
+            evaluation.factors = split_list_attribute(factors);
+        }
+        if (const char* horizons = node->Attribute("horizons")) {
+            std::vector<int> parsed;
+            try {
+                for (const auto& item : split_list_attribute(horizons)) {
+                    int horizon = std::stoi(item);
+                    if (horizon > 0) parsed.push_back(horizon);
+                }
+            } catch (const std::exception& e) {
+                spdlog::error("Evaluation的horizons无效: {}", horizons);
+                parsed.clear();
+            }
+            if (!parsed.empty()) evaluation.horizons = std::move(parsed);
+        }
+        node->QueryIntAttribute("quantiles", &evaluation.quantiles);
+        node->QueryIntAttribute("threads", &evaluation.threads);
+        if (evaluation.quantiles < 2) {
+            spdlog::warn("Evaluation的quantiles至少为2，使用默认值5");
+            evaluation.quantiles = 5;
+        }
+    }
 };
 
 
@@ -0,0 +1,314 @@
+#pragma once
+
+#include "data_structures.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <utility>
+
+// 截面面板：buckets行 × stocks列，按时间桶行主序存放（每个时间桶的截面连续）
+// 截面算子逐行处理，一行内的数据在同一段连续内存上
+struct FactorPanel {
+    int buckets = 0;
+    int stocks = 0;
+    std::vector<double> values;
+
+    FactorPanel() = default;
+    FactorPanel(int bucket_count, int stock_count, double fill = std::numeric_limits<double>::quiet_NaN())
+        : buckets(bucket_count), stocks(stock_count),
+          values(static_cast<size_t>(std::max(bucket_count, 0)) * std::max(stock_count, 0), fill) {}
+
+    // 形状不同时才重新分配
+    void reshape(int bucket_count, int stock_count) {
+        if (bucket_count == buckets && stock_count == stocks) return;
+        buckets = bucket_count;
+        stocks = stock_count;
+        values.assign(static_cast<size_t>(std::max(bucket_count, 0)) * std::max(stock_count, 0),
+                      std::numeric_limits<double>::quiet_NaN());
+    }
+
+    bool same_shape(const FactorPanel& other) const { return buckets == other.buckets && stocks == other.stocks; }
+
+    double* row(int ti) { return values.data() + static_cast<size_t>(ti) * stocks; }
+    const double* row(int ti) const { return values.data() + static_cast<size_t>(ti) * stocks; }
+    double& at(int ti, int i) { return row(ti)[i]; }
+    double at(int ti, int i) const { return row(ti)[i]; }
+
+    // 与因子整日回填的截面列表互转（下标为时间桶）
+    static FactorPanel from_sections(const std::vector<GSeries>& sections, int stock_count) {
+        FactorPanel panel(static_cast<int>(sections.size()), stock_count);
+        for (int ti = 0; ti < panel.buckets; ++ti) {
+            int n = std::min(sections[ti].get_size(), stock_count);
+            for (int i = 0; i < n; ++i) panel.at(ti, i) = sections[ti].get(i);
+        }
+        return panel;
+    }
+
+    GSeries section(int ti) const {
+        return GSeries(std::vector<double>(row(ti), row(ti) + stocks));
+    }
+};
+
+// 排名的并列处理方式
+enum class RankTies {
+    Average,    // 并列取平均名次
+    Min,        // 并列取最小名次
+    Max,        // 并列取最大名次
+    First       // 按股票顺序依次给名次
+};
+
+// 截面算子库 - 对FactorPanel的多个时间桶一次计算，结果写入预分配的输出面板（可与输入相同，原地计算）
+// 每个线程复用thread_local的工作区，稳定后不再分配内存；threads > 1时按行分块并行
+// 非有限值（NaN/Inf）不参与统计，输出为NaN
+class CrossSection {
+public:
+    // ---------------- 单行内核（n个股票的一个截面） ----------------
+
+    // 排名：名次从1开始；pct为true时输出(名次 - 1) / (有效数 - 1)，只有一个有效值时为0.5
+    static void rank_row(const double* in, double* out, int n, bool pct = false,
+                         bool ascending = true, RankTies ties = RankTies::Average) {
+        auto& sorted = scratch().sorted;
+        int valid = sort_valid(in, n, ascending, sorted);
+        std::fill(out, out + n, kNaN);
+        for (int start = 0; start < valid;) {
+            int end = start + 1;
+            if (ties != RankTies::First) {
+                while (end < valid && sorted[end].first == sorted[start].first) ++end;
+            }
+            double rank = 0.0;
+            switch (ties) {
+                case RankTies::Average: rank = (start + end + 1) / 2.0; break;
+                case RankTies::Min: rank = start + 1; break;
+                case RankTies::Max: rank = end; break;
+                case RankTies::First: rank = start + 1; break;
+            }
+            if (pct) rank = valid > 1 ? (rank - 1.0) / (valid - 1) : 0.5;
+            for (int k = start; k < end; ++k) out[sorted[k].second] = rank;
+            start = end;
+        }
+    }
+
+    // 标准化：(x - 均值) / 样本标准差，有效值少于2个或标准差为0时整行为NaN
+    static void z_score_row(const double* in, double* out, int n) {
+        double sum = 0.0;
+        int count = 0;
+        for (int i = 0; i < n; ++i) {
+            if (std::isfinite(in[i])) { sum += in[i]; ++count; }
+        }
+        double mean = count > 0 ? sum / count : kNaN;
+        double sum_sq = 0.0;
+        for (int i = 0; i < n; ++i) {
+            if (std::isfinite(in[i])) sum_sq += (in[i] - mean) * (in[i] - mean);
+        }
+        double std_dev = count > 1 ? std::sqrt(sum_sq / (count - 1)) : kNaN;
+        if (!std::isfinite(std_dev) || std_dev == 0.0) {
+            std::fill(out, out + n, kNaN);
+            return;
+        }
+        double inv_std = 1.0 / std_dev;
+        for (int i = 0; i < n; ++i) {
+            out[i] = std::isfinite(in[i]) ? (in[i] - mean) * inv_std : kNaN;
+        }
+    }
+
+    // 按固定上下界截断
+    static void clip_row(const double* in, double* out, int n, double lower, double upper) {
+        for (int i = 0; i < n; ++i) {
+            out[i] = std::isfinite(in[i]) ? std::min(std::max(in[i], lower), upper) : kNaN;
+        }
+    }
+
+    // 按截面分位数截断（分位数线性插值，与GSeries::nanquantile一致），两个分位数各一次nth_element
+    static void winsorize_row(const double* in, double* out, int n, double lower_q, double upper_q) {
+        auto& values = scratch().values;
+        values.clear();
+        for (int i = 0; i < n; ++i) {
+            if (std::isfinite(in[i])) values.push_back(in[i]);
+        }
+        if (values.empty()) {
+            std::fill(out, out + n, kNaN);
+            return;
+        }
+        double lower = quantile_inplace(values, lower_q);
+        double upper = quantile_inplace(values, upper_q);
+        clip_row(in, out, n, lower, upper);
+    }
+
+    // 组内去均值（如按行业）；scale为true时再除以组内样本标准差（组内标准化）
+    // groups[i]为股票i的组号（0开始），负数表示无分组，输出NaN；组内有效值少于2个时scale结果为NaN
+    static void demean_by_group_row(const double* in, double* out, int n, const int* groups,
+                                    int group_count, bool scale = false) {
+        auto& ws = scratch();
+        ws.group_sum.assign(group_count, 0.0);
+        ws.group_sq.assign(group_count, 0.0);
+        ws.group_count.assign(group_count, 0);
+        for (int i = 0; i < n; ++i) {
+            int g = groups[i];
+            if (g >= 0 && g < group_count && std::isfinite(in[i])) {
+                ws.group_sum[g] += in[i];
+                ws.group_count[g]++;
+            }
+        }
+        for (int g = 0; g < group_count; ++g) {
+            ws.group_sum[g] = ws.group_count[g] > 0 ? ws.group_sum[g] / ws.group_count[g] : kNaN;
+        }
+        if (scale) {
+            for (int i = 0; i < n; ++i) {
+                int g = groups[i];
+                if (g >= 0 && g < group_count && std::isfinite(in[i])) {
+                    double d = in[i] - ws.group_sum[g];
+                    ws.group_sq[g] += d * d;
+                }
+            }
+            for (int g = 0; g < group_count; ++g) {
+                double std_dev = ws.group_count[g] > 1 ? std::sqrt(ws.group_sq[g] / (ws.group_count[g] - 1)) : kNaN;
+                ws.group_sq[g] = std_dev > 0.0 ? 1.0 / std_dev : kNaN;
+            }
+        }
+        for (int i = 0; i < n; ++i) {
+            int g = groups[i];
+            if (g < 0 || g >= group_count || !std::isfinite(in[i])) {
+                out[i] = kNaN;
+                continue;
+            }
+            double d = in[i] - ws.group_sum[g];
+            out[i] = scale ? d * ws.group_sq[g] : d;
+        }
+    }
+
+    // 分组（如十分位）：按升序平均名次输出组号0..bins-1，并列值落在同一组
+    static void quantile_bucket_row(const double* in, double* out, int n, int bins) {
+        auto& sorted = scratch().sorted;
+        int valid = sort_valid(in, n, true, sorted);
+        std::fill(out, out + n, kNaN);
+        if (bins <= 0) return;
+        for (int start = 0; start < valid;) {
+            int end = start + 1;
+            while (end < valid && sorted[end].first == sorted[start].first) ++end;
+            double avg_rank = (start + end - 1) / 2.0;    // 0开始的平均名次
+            double bucket = std::min(std::floor(avg_rank * bins / valid), static_cast<double>(bins - 1));
+            for (int k = start; k < end; ++k) out[sorted[k].second] = bucket;
+            start = end;
+        }
+    }
+
+    // ---------------- 面板接口（所有时间桶） ----------------
+
+    static void rank(const FactorPanel& in, FactorPanel& out, bool pct = false, bool ascending = true,
+                     RankTies ties = RankTies::Average, int threads = 1) {
+        prepare(in, out);
+        for_each_row(in.buckets, threads, [&](int ti) {
+            rank_row(in.row(ti), out.row(ti), in.stocks, pct, ascending, ties);
+        });
+    }
+
+    static void z_score(const FactorPanel& in, FactorPanel& out, int threads = 1) {
+        prepare(in, out);
+        for_each_row(in.buckets, threads, [&](int ti) {
+            z_score_row(in.row(ti), out.row(ti), in.stocks);
+        });
+    }
+
+    static void clip(const FactorPanel& in, FactorPanel& out, double lower, double upper, int threads = 1) {
+        prepare(in, out);
+        for_each_row(in.buckets, threads, [&](int ti) {
+            clip_row(in.row(ti), out.row(ti), in.stocks, lower, upper);
+        });
+    }
+
+    static void winsorize(const FactorPanel& in, FactorPanel& out, double lower_q = 0.01, double upper_q = 0.99,
+                          int threads = 1) {
+        prepare(in, out);
+        for_each_row(in.buckets, threads, [&](int ti) {
+            winsorize_row(in.row(ti), out.row(ti), in.stocks, lower_q, upper_q);
+        });
+    }
+
+    // groups长度应为in.stocks（按股票列表顺序的组号）
+    static void demean_by_group(const FactorPanel& in, FactorPanel& out, const std::vector<int>& groups,
+                                bool scale = false, int threads = 1) {
+        prepare(in, out);
+        if (static_cast<int>(groups.size()) < in.stocks) {
+            spdlog::error("CrossSection::demean_by_group分组数量{}小于股票数量{}", groups.size(), in.stocks);
+            std::fill(out.values.begin(), out.values.end(), kNaN);
+            return;
+        }
+        int group_count = groups.empty() ? 0 : *std::max_element(groups.begin(), groups.end()) + 1;
+        for_each_row(in.buckets, threads, [&](int ti) {
+            demean_by_group_row(in.row(ti), out.row(ti), in.stocks, groups.data(), group_count, scale);
+        });
+    }
+
+    static void quantile_bucket(const FactorPanel& in, FactorPanel& out, int bins = 10, int threads = 1) {
+        prepare(in, out);
+        for_each_row(in.buckets, threads, [&](int ti) {
+            quantile_bucket_row(in.row(ti), out.row(ti), in.stocks, bins);
+        });
+    }
+
+    // 按行分块并行执行fn(ti)；行数很少或threads <= 1时在当前线程执行
+    template <typename RowFn>
+    static void for_each_row(int rows, int threads, RowFn&& fn) {
+        threads = std::max(1, std::min(threads, rows));
+        if (threads == 1) {
+            for (int ti = 0; ti < rows; ++ti) fn(ti);
+            return;
+        }
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        int chunk = (rows + threads - 1) / threads;
+        for (int begin = 0; begin < rows; begin += chunk) {
+            int end = std::min(rows, begin + chunk);
+            workers.emplace_back([&fn, begin, end]() {
+                for (int ti = begin; ti < end; ++ti) fn(ti);
+            });
+        }
+        for (auto& worker : workers) worker.join();
+    }
+
+private:
+    static constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+    // 每个线程复用的工作区
+    struct Scratch {
+        std::vector<std::pair<double, int>> sorted;
+        std::vector<double> values;
+        std::vector<double> group_sum;
+        std::vector<double> group_sq;
+        std::vector<int> group_count;
+    };
+
+    static Scratch& scratch() {
+        thread_local Scratch ws;
+        return ws;
+    }
+
+    static void prepare(const FactorPanel& in, FactorPanel& out) {
+        if (&in != &out) out.reshape(in.buckets, in.stocks);
+    }
+
+    // 有效值按(值, 股票下标)排序，相同值保持股票顺序；返回有效值个数
+    static int sort_valid(const double* in, int n, bool ascending, std::vector<std::pair<double, int>>& sorted) {
+        sorted.clear();
+        for (int i = 0; i < n; ++i) {
+            if (std::isfinite(in[i])) sorted.emplace_back(ascending ? in[i] : -in[i], i);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        return static_cast<int>(sorted.size());
+    }
+
+    // 线性插值分位数，values会被部分重排
+    static double quantile_inplace(std::vector<double>& values, double q) {
+        int n = static_cast<int>(values.size());
+        double id = std::max(0.0, std::min((n - 1) * q, static_cast<double>(n - 1)));
+        int lo = static_cast<int>(std::floor(id));
+        std::nth_element(values.begin(), values.begin() + lo, values.end());
+        double lo_value = values[lo];
+        double h = id - lo;
+        if (h == 0.0 || lo + 1 >= n) return lo_value;
+        double hi_value = *std::min_element(values.begin() + lo + 1, values.end());
+        return (1.0 - h) * lo_value + h * hi_value;
+    }
+};
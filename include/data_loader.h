@@ -221,8 +221,8 @@ public:
                 // 4. 成交方向（TradeBSFlag）→ side（0=中性，1=买，2=卖，根据实际业务调整）
                 trade.side = tokens[12][0];  // tokens[12]是TradeBSFlag
 
-                // 5. 取消标志（未在数据中明确体现，默认为'N'表示正常成交）
-                trade.cancel_flag = 'N';  // 实际数据中无cancel_flag字段，暂设为正常
+                // 5. 取消标志：深交所撤单以成交回报下发（TradeType为'4'或'C'），订单簿据此撤销挂单
+                trade.cancel_flag = (!tokens[11].empty() && (tokens[11][0] == '4' || tokens[11][0] == 'C')) ? 'C' : 'N';
 
                 // 6. 成交价格（TradePrice）→ price
                 trade.price = std::stod(tokens[13]);  // tokens[13]是TradePrice
@@ -15,6 +15,7 @@ class CalculationEngine;
 #include "spdlog/spdlog.h"
 #include <memory>
 #include "config.h"
+#include "binary_io.h"
 #include "factor_utils.h"
 #include "compute_utils.h"
 #include "increasing.h"
@@ -24,11 +25,126 @@ class CalculationEngine;
 #include <queue>
 #include <limits>
 #include <atomic>
+#include <set>
 #include <spdlog/fmt/bundled/format.h> // 使用项目中已有的fmt库
 #include <chrono>
 
 // 前向声明 - 移除，因为不再需要
 
+class GSeries;
+
+// 新增：GSeries的非拥有视图（指针 + 长度 + 步长），用于head/tail/历史切片等只读访问，避免深拷贝
+// 注意：视图不持有数据，底层GSeries被resize/析构后视图失效；有效值个数在第一次使用时才计算
+// 视图既可指向double序列，也可指向float32存储的序列（读取时提升为double，统计按double累加）
+class GSeriesView {
+private:
+    const double* ptr_ = nullptr;
+    const float* fptr_ = nullptr;  // 非空表示底层为float32存储
+    int length_ = 0;
+    int stride_ = 1;
+    mutable int valid_num_ = -1;  // -1表示尚未统计
+
+    // 以当前视图为基准偏移start个元素，生成新的子视图
+    GSeriesView sub_view(int start, int len, int stride) const {
+        std::ptrdiff_t offset = static_cast<std::ptrdiff_t>(start) * stride_;
+        if (fptr_) return GSeriesView(fptr_ + offset, len, stride);
+        return GSeriesView(ptr_ + offset, len, stride);
+    }
+
+public:
+    GSeriesView() = default;
+
+    GSeriesView(const double* ptr, int length, int stride = 1)
+            : ptr_(ptr), length_(length > 0 ? length : 0), stride_(stride > 0 ? stride : 1) {}
+
+    GSeriesView(const float* ptr, int length, int stride = 1)
+            : fptr_(ptr), length_(length > 0 ? length : 0), stride_(stride > 0 ? stride : 1) {}
+
+    explicit GSeriesView(const std::vector<double>& vec)
+            : ptr_(vec.data()), length_(int(vec.size())), stride_(1) {}
+
+    explicit GSeriesView(const std::vector<float>& vec)
+            : fptr_(vec.data()), length_(int(vec.size())), stride_(1) {}
+
+    // 基本访问
+    int get_size() const { return length_; }
+    int length() const { return length_; }
+    int stride() const { return stride_; }
+    bool empty() const { return length_ == 0; }
+    bool is_contiguous() const { return stride_ == 1; }
+    bool is_float32() const { return fptr_ != nullptr; }
+    const double* raw_data() const { return ptr_; }  // float32存储时为nullptr
+
+    // 不做边界检查的访问，调用方保证 0 <= idx < length
+    double operator[](int idx) const {
+        std::ptrdiff_t offset = static_cast<std::ptrdiff_t>(idx) * stride_;
+        return fptr_ ? static_cast<double>(fptr_[offset]) : ptr_[offset];
+    }
+
+    double locate(const int & idx) const;
+    double r_locate(const int & idx) const;
+    double get(int idx) const { return locate(idx); }
+    bool is_valid(int idx) const { return idx >= 0 && idx < length_ && !std::isnan((*this)[idx]); }
+
+    double back() const {
+        if (length_ == 0) return std::numeric_limits<double>::quiet_NaN();
+        return (*this)[length_ - 1];
+    }
+
+    double front() const {
+        if (length_ == 0) return std::numeric_limits<double>::quiet_NaN();
+        return (*this)[0];
+    }
+
+    double first_valid() const;
+    double last_valid() const;
+
+    // 子视图（仍然不拷贝数据）
+    GSeriesView head(const int & num) const {
+        if (num <= 0) return GSeriesView();
+        return sub_view(0, std::min(num, length_), stride_);
+    }
+
+    GSeriesView tail(const int & num) const {
+        if (num <= 0) return GSeriesView();
+        int n = std::min(num, length_);
+        return sub_view(length_ - n, n, stride_);
+    }
+
+    GSeriesView slice(int start, int len) const {
+        if (start < 0) start = 0;
+        if (start >= length_ || len <= 0) return GSeriesView();
+        return sub_view(start, std::min(len, length_ - start), stride_);
+    }
+
+    // 按步长抽样，例如 every(4) 可把15秒序列的每个分钟首桶取出
+    GSeriesView every(int step, int offset = 0) const {
+        if (step <= 0 || offset < 0 || offset >= length_) return GSeriesView();
+        return sub_view(offset, (length_ - offset + step - 1) / step, stride_ * step);
+    }
+
+    // 统计方法（与GSeries语义保持一致：count按非NaN统计，其余按有限值统计）
+    int count() const;
+    double nansum() const;
+    double nansum(const int & head_num) const;
+    double nanmean() const;
+    double nanmean(const int & head_num) const;
+    double nanstd() const;
+    double nanmedian() const;
+    double nanquantile(const double & q) const;
+    double skewness() const;
+    double kurtosis() const;
+    double max() const;
+    double min() const;
+    int argmax() const;
+    int argmin() const;
+    double corrwith(const GSeriesView &other) const;
+
+    // 需要持有数据时再显式物化
+    std::vector<double> to_vector() const;
+    GSeries to_series() const;
+};
+
 // 存储计算结果的序列（PDF 1.3节）
 class GSeries {
 private:
@@ -57,12 +173,39 @@ public:
         }
     }
 
+    // 新增：移动构造/移动赋值，避免返回值和map赋值时的深拷贝
+    GSeries(GSeries &&other) noexcept
+            : d_vec(std::move(other.d_vec)), valid_num(other.valid_num), size(other.size) {
+        other.valid_num = 0;
+        other.size = 0;
+    }
+
+    GSeries& operator= (GSeries &&other) noexcept {
+        if (this != &other) {
+            d_vec = std::move(other.d_vec);
+            size = other.size;
+            valid_num = other.valid_num;
+            other.valid_num = 0;
+            other.size = 0;
+        }
+        return *this;
+    }
+
     explicit GSeries(const std::vector<double> & new_vec) {
         this->d_vec = new_vec;
         this->size = int(d_vec.size());
         this->valid_num = std::count_if(d_vec.begin(), d_vec.end(), [](double v) { return !std::isnan(v); });
     }
 
+    // 新增：接管临时vector，不再拷贝
+    explicit GSeries(std::vector<double> && new_vec) noexcept : d_vec(std::move(new_vec)) {
+        this->size = int(d_vec.size());
+        this->valid_num = std::count_if(d_vec.begin(), d_vec.end(), [](double v) { return !std::isnan(v); });
+    }
+
+    // 新增：从视图物化
+    explicit GSeries(const GSeriesView & view) : GSeries(view.to_vector()) {}
+
     GSeries(int n, double val): d_vec(n, val) {
         this->size = n;
         this->valid_num = std::count_if(d_vec.begin(), d_vec.end(), [](double v) { return !std::isnan(v); });
@@ -117,6 +260,19 @@ public:
     std::vector<double> vec() const{
         return d_vec;}
 
+    // 新增：交出底层数据（之后本序列为空），用于移动进其他存储
+    std::vector<double> release() {
+        size = 0;
+        valid_num = 0;
+        return std::move(d_vec);
+    }
+
+    // 新增：零拷贝视图
+    GSeriesView view() const { return GSeriesView(d_vec.data(), size); }
+    GSeriesView head_view(const int & num) const { return view().head(num); }
+    GSeriesView tail_view(const int & num) const { return view().tail(num); }
+    GSeriesView slice_view(int start, int len) const { return view().slice(start, len); }
+
     double back() const{
         if (d_vec.empty()) return std::numeric_limits<double>::quiet_NaN();
         else return d_vec.back();
@@ -370,7 +526,7 @@ public:
     static GSeries concat(const GSeries & series1, const GSeries & series2){
         std::vector<double> cnt(series1.d_vec);
         cnt.insert(cnt.end(), series2.d_vec.begin(), series2.d_vec.end());
-        return GSeries(cnt);
+        return GSeries(std::move(cnt));
     }
 
     GSeries neutralize(const GSeries &other) const; // neu = this - b * other
@@ -417,7 +573,7 @@ public:
             if (std::isfinite(d_vec[i]) && ComputeUtils::greater_than_zero(d_vec[i])) new_vec[i] = std::log(d_vec[i]);
             else new_vec[i] = std::numeric_limits<double>::quiet_NaN();
         }
-        return GSeries(new_vec);
+        return GSeries(std::move(new_vec));
     }
 
     void element_log_inplace(){
@@ -434,7 +590,7 @@ public:
             if (std::isfinite(d_vec[i])) new_vec[i] = std::exp(d_vec[i]);
             else new_vec[i] = std::numeric_limits<double>::quiet_NaN();
         }
-        return GSeries(new_vec);
+        return GSeries(std::move(new_vec));
     }
 
     void element_exp_inplace(){
@@ -458,7 +614,7 @@ public:
             }
         }
 
-        return GSeries(max_data);
+        return GSeries(std::move(max_data));
     }
 
     double max_draw_down() const{
@@ -506,7 +662,265 @@ public:
             }
         }
 
-        return GSeries(min_data);
+        return GSeries(std::move(min_data));
+    }
+};
+
+inline GSeries GSeriesView::to_series() const {
+    return GSeries(to_vector());
+}
+
+// 新增：按存储精度保存的定长bar序列
+// Float32模式下只保存float（内存减半），读取统一走GSeriesView并提升为double，归约按double累加
+// 多日缓冲：day_slots个日槽（pre_days + 1）组成环，today_slot_指向当日，换日只把today_slot_前移一格并清空新的当日槽，
+// 不搬动历史数据，代价O(bars_per_day)（每日一次，持有者加锁且无读者时调用）
+// 为使跨日窗口始终物理连续，环镜像存放：物理上共2 * day_slots - 1个日槽，日槽p（p < day_slots - 1）同时存放在p和p + day_slots，
+// 写入时两份同时更新；以当日结尾、不超过day_slots日的窗口总能在镜像中找到一段连续内存，读取不修改布局
+class BarBuffer {
+private:
+    StoragePrecision precision_ = StoragePrecision::Float64;
+    std::vector<double> d_vec_;
+    std::vector<float> f_vec_;
+    int bars_per_day_ = 0;
+    int day_slots_ = 1;
+    int today_slot_ = 0;  // 当日所在的日槽（0 ~ day_slots - 1）
+
+    // 新增：当日槽的前缀和索引（可加字段的区间和O(1)），首次查询时建立，写入时只回退有效位置
+    // prefix_sum_[i] = 当日[0, i]有效值之和，prefix_cnt_[i] = 有效值个数；prefix_upto_之后的部分待补齐
+    mutable std::vector<double> prefix_sum_;
+    mutable std::vector<int> prefix_cnt_;
+    mutable int prefix_upto_ = -1;
+
+    // 把前缀和补齐到idx（写入基本按时间单调推进，均摊O(1)）
+    void ensure_prefix(int idx) const {
+        if (idx <= prefix_upto_) return;
+        if (static_cast<int>(prefix_sum_.size()) != bars_per_day_) {
+            prefix_sum_.assign(bars_per_day_, 0.0);
+            prefix_cnt_.assign(bars_per_day_, 0);
+            prefix_upto_ = -1;
+        }
+        size_t base = day_offset(0);
+        for (int i = prefix_upto_ + 1; i <= idx; ++i) {
+            double v = is_float32() ? static_cast<double>(f_vec_[base + i]) : d_vec_[base + i];
+            bool valid = std::isfinite(v);
+            prefix_sum_[i] = (i > 0 ? prefix_sum_[i - 1] : 0.0) + (valid ? v : 0.0);
+            prefix_cnt_[i] = (i > 0 ? prefix_cnt_[i - 1] : 0) + (valid ? 1 : 0);
+        }
+        prefix_upto_ = idx;
+    }
+
+    void invalidate_prefix(int idx) const {
+        if (idx <= prefix_upto_) prefix_upto_ = idx - 1;
+    }
+
+    // 物理日槽数（镜像后）
+    static int physical_slots(int day_slots) { return day_slots > 1 ? 2 * day_slots - 1 : 1; }
+
+    // days_ago日（0=当日）所在的日槽
+    int slot_of(int days_ago) const { return (today_slot_ - days_ago + day_slots_) % day_slots_; }
+
+    // days_ago日的主副本在整块内存中的起始位置
+    size_t day_offset(int days_ago) const { return static_cast<size_t>(slot_of(days_ago)) * bars_per_day_; }
+
+    // 日槽slot的镜像副本起始位置，没有镜像时返回npos
+    size_t mirror_offset(int slot) const {
+        return slot + 1 < day_slots_ ? static_cast<size_t>(slot + day_slots_) * bars_per_day_ : std::string::npos;
+    }
+
+    // 物理区间[start, start+len)的视图
+    GSeriesView physical_view(size_t start, int len) const {
+        if (precision_ == StoragePrecision::Float32) return GSeriesView(f_vec_.data() + start, len);
+        return GSeriesView(d_vec_.data() + start, len);
+    }
+
+    void store(size_t pos, double value) {
+        if (is_float32()) f_vec_[pos] = static_cast<float>(value);
+        else d_vec_[pos] = value;
+    }
+
+    void fill_range_nan(size_t begin) {
+        if (is_float32()) {
+            std::fill(f_vec_.begin() + begin, f_vec_.begin() + begin + bars_per_day_, std::numeric_limits<float>::quiet_NaN());
+        } else {
+            std::fill(d_vec_.begin() + begin, d_vec_.begin() + begin + bars_per_day_, std::numeric_limits<double>::quiet_NaN());
+        }
+    }
+
+    void fill_day_nan(int days_ago) {
+        int slot = slot_of(days_ago);
+        fill_range_nan(static_cast<size_t>(slot) * bars_per_day_);
+        size_t mirror = mirror_offset(slot);
+        if (mirror != std::string::npos) fill_range_nan(mirror);
+    }
+
+public:
+    BarBuffer() = default;
+
+    // NaN填充的定长序列，day_slots > 1时同时保留历史日槽
+    BarBuffer(int n, StoragePrecision precision, int day_slots = 1)
+            : precision_(precision), bars_per_day_(n), day_slots_(std::max(1, day_slots)) {
+        size_t total = static_cast<size_t>(bars_per_day_) * physical_slots(day_slots_);
+        if (precision_ == StoragePrecision::Float32) {
+            f_vec_.assign(total, std::numeric_limits<float>::quiet_NaN());
+        } else {
+            d_vec_.assign(total, std::numeric_limits<double>::quiet_NaN());
+        }
+    }
+
+    // double存储时直接接管GSeries的数据，不拷贝
+    static BarBuffer from_series(GSeries series, StoragePrecision precision) {
+        if (precision == StoragePrecision::Float64) {
+            BarBuffer buffer;
+            buffer.d_vec_ = series.release();
+            buffer.bars_per_day_ = int(buffer.d_vec_.size());
+            return buffer;
+        }
+        return from_view(series.view(), precision);
+    }
+
+    static BarBuffer from_view(const GSeriesView& view, StoragePrecision precision) {
+        BarBuffer buffer(view.get_size(), precision);
+        for (int i = 0; i < view.get_size(); ++i) buffer.set(i, view[i]);
+        return buffer;
+    }
+
+    StoragePrecision precision() const { return precision_; }
+    bool is_float32() const { return precision_ == StoragePrecision::Float32; }
+    int day_slots() const { return day_slots_; }
+
+    // 当日序列长度
+    int get_size() const { return bars_per_day_; }
+
+    // 写入/读取当日槽（有镜像时两份同时写入）
+    void set(int idx, double value) {
+        if (idx < 0 || idx >= bars_per_day_) return;
+        store(day_offset(0) + idx, value);
+        size_t mirror = mirror_offset(today_slot_);
+        if (mirror != std::string::npos) store(mirror + idx, value);
+        invalidate_prefix(idx);
+    }
+
+    // 新增：当日[start, end]区间内有效值之和，无有效值时返回NaN
+    double range_sum(int start, int end) const {
+        start = std::max(start, 0);
+        end = std::min(end, bars_per_day_ - 1);
+        if (start > end) return std::numeric_limits<double>::quiet_NaN();
+        ensure_prefix(end);
+        int cnt = prefix_cnt_[end] - (start > 0 ? prefix_cnt_[start - 1] : 0);
+        if (cnt == 0) return std::numeric_limits<double>::quiet_NaN();
+        return prefix_sum_[end] - (start > 0 ? prefix_sum_[start - 1] : 0.0);
+    }
+
+    // 新增：当日[start, end]区间内有效值个数
+    int range_count(int start, int end) const {
+        start = std::max(start, 0);
+        end = std::min(end, bars_per_day_ - 1);
+        if (start > end) return 0;
+        ensure_prefix(end);
+        return prefix_cnt_[end] - (start > 0 ? prefix_cnt_[start - 1] : 0);
+    }
+
+    double get(int idx) const {
+        if (idx < 0 || idx >= bars_per_day_) return std::numeric_limits<double>::quiet_NaN();
+        size_t pos = day_offset(0) + idx;
+        return is_float32() ? static_cast<double>(f_vec_[pos]) : d_vec_[pos];
+    }
+
+    // 当日视图
+    GSeriesView view() const { return day_view(0); }
+
+    // 第days_ago日的视图（0=当日，1=T-1...），超出保留天数返回空视图
+    GSeriesView day_view(int days_ago) const {
+        if (days_ago < 0 || days_ago >= day_slots_ || bars_per_day_ == 0) return GSeriesView();
+        return physical_view(day_offset(days_ago), bars_per_day_);
+    }
+
+    // 写入历史日（days_ago >= 1），长度不足部分保持NaN
+    bool set_day(int days_ago, const GSeriesView& data) {
+        if (days_ago < 0 || days_ago >= day_slots_) return false;
+        fill_day_nan(days_ago);
+        if (days_ago == 0) invalidate_prefix(0);
+        size_t begin = day_offset(days_ago);
+        size_t mirror = mirror_offset(slot_of(days_ago));
+        int n = std::min(data.get_size(), bars_per_day_);
+        for (int i = 0; i < n; ++i) {
+            store(begin + i, data[i]);
+            if (mirror != std::string::npos) store(mirror + i, data[i]);
+        }
+        return true;
+    }
+
+    // 跨日窗口：[T-days_back日开盘, 当日today_end_index]的视图（O(1)，不拷贝）
+    // 起始日槽在当日之后（环绕）时，当日及之前的日槽取镜像副本，整段仍然连续
+    GSeriesView window_view(int days_back, int today_end_index) const {
+        if (days_back < 0 || days_back >= day_slots_ || bars_per_day_ == 0) return GSeriesView();
+        int today_len = std::min(std::max(today_end_index + 1, 0), bars_per_day_);
+        return physical_view(day_offset(days_back), days_back * bars_per_day_ + today_len);
+    }
+
+    // 最近n个bar（截止当日today_end_index，可跨日）
+    GSeriesView last_n_view(int n, int today_end_index) const {
+        if (n <= 0) return GSeriesView();
+        int today_len = std::min(std::max(today_end_index + 1, 0), bars_per_day_);
+        int days_back = n > today_len ? (n - today_len + bars_per_day_ - 1) / bars_per_day_ : 0;
+        days_back = std::min(days_back, day_slots_ - 1);
+        return window_view(days_back, today_end_index).tail(n);
+    }
+
+    // 换日：当日槽前移一格（原当日变为T-1，最老的一日被新的当日覆盖）并填NaN，历史数据不移动
+    // 此前取得的视图失效，调用方需保证此时没有读者
+    void roll_day() {
+        today_slot_ = (today_slot_ + 1) % day_slots_;
+        fill_day_nan(0);
+        invalidate_prefix(0);
+    }
+
+    // 清空当日槽，保留历史日
+    void clear_today() {
+        fill_day_nan(0);
+        invalidate_prefix(0);
+    }
+
+    // 清空全部日槽（长度和精度不变）
+    void clear_all_days() {
+        if (is_float32()) std::fill(f_vec_.begin(), f_vec_.end(), std::numeric_limits<float>::quiet_NaN());
+        else std::fill(d_vec_.begin(), d_vec_.end(), std::numeric_limits<double>::quiet_NaN());
+        invalidate_prefix(0);
+    }
+
+    GSeries to_series() const { return view().to_series(); }
+
+    // 实际占用的数据字节数（用于内存统计，含镜像）
+    size_t bytes() const {
+        return is_float32() ? f_vec_.size() * sizeof(float) : d_vec_.size() * sizeof(double);
+    }
+
+    // 新增：检查点读写（全部日槽含镜像原样保存，前缀和索引不保存，恢复后首次查询时重建）
+    void save_state(BinaryWriter& out) const {
+        out.put<uint8_t>(is_float32() ? 1 : 0);
+        out.put<int32_t>(bars_per_day_);
+        out.put<int32_t>(day_slots_);
+        out.put<int32_t>(today_slot_);
+        if (is_float32()) out.put_vector(f_vec_);
+        else out.put_vector(d_vec_);
+    }
+
+    bool restore_state(BinaryReader& in) {
+        uint8_t float32 = 0;
+        int32_t bars_per_day = 0, day_slots = 0, today_slot = 0;
+        if (!in.get(float32) || !in.get(bars_per_day) || !in.get(day_slots) || !in.get(today_slot)) return false;
+        if (bars_per_day < 0 || day_slots < 1 || today_slot < 0 || today_slot >= day_slots) return false;
+        BarBuffer buffer;
+        buffer.precision_ = float32 ? StoragePrecision::Float32 : StoragePrecision::Float64;
+        buffer.bars_per_day_ = bars_per_day;
+        buffer.day_slots_ = day_slots;
+        buffer.today_slot_ = today_slot;
+        size_t expected = static_cast<size_t>(bars_per_day) * physical_slots(day_slots);
+        bool ok = float32 ? in.get_vector(buffer.f_vec_) && buffer.f_vec_.size() == expected
+                          : in.get_vector(buffer.d_vec_) && buffer.d_vec_.size() == expected;
+        if (!ok) return false;
+        *this = std::move(buffer);
+        return true;
     }
 };
 
@@ -748,7 +1162,8 @@ protected:
     // 格式：{output_key}_{his_day_index} -> GSeries
     // 例如："volume_1" -> GSeries (往前1日), "volume_2" -> GSeries (往前2日)
     // 这样与T日数据的MBarSeries格式保持一致，便于融合
-    std::unordered_map<std::string, GSeries> HisBarSeries;
+    // 新增：按模块配置的精度存储（float32/float64），见BarBuffer
+    std::unordered_map<std::string, BarBuffer> HisBarSeries;
 
 public:
     // 1. 构造函数（初始化智能指针）
@@ -775,14 +1190,16 @@ public:
 
     // 修改：设置历史序列（使用统一的key格式）
     // 新的索引逻辑：1=往前1日, 2=往前2日, ..., pre_days=往前pre_days日
-    void set_his_series(const std::string& output_key, int his_day_index, const GSeries& series) {
+    // 参数按值传入：调用方传右值时直接移动，不再深拷贝
+    void set_his_series(const std::string& output_key, int his_day_index, GSeries series,
+                        StoragePrecision precision = StoragePrecision::Float64) {
         if (his_day_index <= 0) {
             spdlog::error("{}: his_day_index must be > 0 (got {})", stock, his_day_index);
             return;
         }
         // 使用统一的key格式：{output_key}_{his_day_index}
         std::string key = fmt::format("{}_{}", output_key, his_day_index);
-        HisBarSeries[key] = series;
+        HisBarSeries[key] = BarBuffer::from_series(std::move(series), precision);
     }
 
     // 修改：获取历史序列片段（使用统一的key格式）
@@ -800,7 +1217,17 @@ public:
             spdlog::debug("{}: 可用的历史数据键: {}", stock, available_keys);
             return GSeries();
         }
-        return HisBarSeries.at(key);
+        return HisBarSeries.at(key).to_series();
+    }
+
+    // 新增：零拷贝版本的历史切片，key不存在时返回空视图
+    GSeriesView his_slice_bar_view(const std::string& output_key, int his_day_index) const {
+        auto it = HisBarSeries.find(fmt::format("{}_{}", output_key, his_day_index));
+        if (it == HisBarSeries.end()) {
+            spdlog::debug("{}: Key {}_{} not found in HisBarSeries", stock, output_key, his_day_index);
+            return GSeriesView();
+        }
+        return it->second.view();
     }
 
     // 获取股票代码
@@ -824,13 +1251,92 @@ enum class Frequency {
     F30MIN  // 30分钟
 };
 
+// 新增：频率字符串（"15S"/"15s"/"1min"/"5min"/"30min"）转换为Frequency，未知频率返回false
+inline bool parse_frequency(const std::string& freq_str, Frequency& frequency) {
+    if (freq_str == "15S" || freq_str == "15s") { frequency = Frequency::F15S; return true; }
+    if (freq_str == "1min") { frequency = Frequency::F1MIN; return true; }
+    if (freq_str == "5min") { frequency = Frequency::F5MIN; return true; }
+    if (freq_str == "30min") { frequency = Frequency::F30MIN; return true; }
+    return false;
+}
+
+// 新增：写入时把一个tick的贡献合并进时间桶的方式
+enum class RollupMethod {
+    Sum,    // 桶内累加（差分成交量/成交额等）
+    Last,   // 桶内最后一个值
+    Max,    // 桶内最大值
+    Min,    // 桶内最小值
+    First   // 桶内第一个值
+};
+
+// 新增：频率个数（用于按频率下标排布的句柄/索引数组）
+inline constexpr int kFrequencyCount = 4;
+
+// 新增：一个字段在当前tick的贡献（批量写入时使用，name指向静态字段表中的字符串）
+struct FieldContribution {
+    const char* name;
+    double value;
+    RollupMethod method;
+};
+
+inline double rollup_combine(RollupMethod method, double existing, double value) {
+    if (std::isnan(existing)) return value;
+    if (std::isnan(value)) return existing;
+    switch (method) {
+        case RollupMethod::Sum: return existing + value;
+        case RollupMethod::Last: return value;
+        case RollupMethod::Max: return std::max(existing, value);
+        case RollupMethod::Min: return std::min(existing, value);
+        case RollupMethod::First: return existing;
+    }
+    return value;
+}
+
+// 计算时间桶映射范围（从factor时间桶映射到indicator时间桶范围）
+inline std::pair<int, int> get_time_bucket_range(int factor_ti, Frequency indicator_freq, Frequency factor_freq) {
+    int indicator_seconds = 0;
+    int factor_seconds = 0;
+    
+    // 获取indicator频率的秒数
+    switch (indicator_freq) {
+        case Frequency::F15S: indicator_seconds = 15; break;
+        case Frequency::F1MIN: indicator_seconds = 60; break;
+        case Frequency::F5MIN: indicator_seconds = 300; break;
+        case Frequency::F30MIN: indicator_seconds = 1800; break;
+    }
+    
+    // 获取factor频率的秒数
+    switch (factor_freq) {
+        case Frequency::F15S: factor_seconds = 15; break;
+        case Frequency::F1MIN: factor_seconds = 60; break;
+        case Frequency::F5MIN: factor_seconds = 300; break;
+        case Frequency::F30MIN: factor_seconds = 1800; break;
+    }
+
+    // 计算比例（indicator频率 / factor频率）
+    int ratio = indicator_seconds / factor_seconds;
+    
+    if (ratio >= 1) {
+        // indicator频率 >= factor频率（如30min indicator vs 5min factor）
+        // 一个indicator时间桶对应多个factor时间桶
+        int indicator_ti = factor_ti / ratio;
+        return {indicator_ti, indicator_ti};  // 返回同一个indicator时间桶
+    } else {
+        // indicator频率 < factor频率（如1min indicator vs 5min factor）
+        // 一个factor时间桶对应多个indicator时间桶
+        int start_index = factor_ti * (factor_seconds / indicator_seconds);
+        int end_index = start_index + (factor_seconds / indicator_seconds) - 1;
+        return {start_index, end_index};
+    }
+}
+
 // BarSeriesHolder：包含T日数据的子类，扩展支持多频率管理
 class BarSeriesHolder : public BaseSeriesHolder {
 private:
     int current_time = 0;
     double current_minute_close = 0.0;
     double pre_close = 0.0;
-    std::unordered_map<std::string, GSeries> MBarSeries; // today m bar
+    std::unordered_map<std::string, BarBuffer> MBarSeries; // today m bar（按精度存储）
     mutable std::mutex m_bar_mutex_; // 保护MBarSeries的互斥锁
     
     // 新增：四个频率的时间桶映射：{时间戳 -> 桶索引}
@@ -853,6 +1359,22 @@ private:
     int m5_idx_ = 0;                            // 5分钟频率当前索引
     int m30_idx_ = 0;                           // 30分钟频率当前索引
 
+    // 新增：每个序列保留的历史天数，序列按pre_days_ + 1个日槽的多日缓冲分配
+    int pre_days_ = 0;
+
+    // 新增：指标的每股状态槽（如前一个tick的累计成交量），按Indicator分配的槽位下标访问
+    // 同一股票的tick只由一个线程处理，槽只被该线程读写，无需加锁；内存随槽数固定，不随tick增长
+    std::vector<double> state_slots_;
+
+    // 新增：预解析的序列句柄（按Indicator分配的槽位下标访问），保存当日序列BarBuffer的指针
+    // unordered_map的元素地址在rehash后保持不变，只有clear_daily_data删除序列时整体失效
+    std::vector<BarBuffer*> series_handles_;
+
+    // 新增：从T日结果文件加载的当日序列，clear_daily_data时保留（对应指标已标记为已计算，不会重新写入）
+    std::set<std::string> loaded_today_;
+
+    bool short_history_logged_ = false;  // 历史天数不足的错误只记录一次（m_bar_mutex_保护）
+
 public:
     bool status = false;
 
@@ -868,6 +1390,10 @@ public:
           current_minute_close(other.current_minute_close),
           pre_close(other.pre_close),
           MBarSeries(std::move(other.MBarSeries)),
+          pre_days_(other.pre_days_),
+          state_slots_(std::move(other.state_slots_)),
+          series_handles_(std::move(other.series_handles_)),
+          loaded_today_(std::move(other.loaded_today_)),
           status(other.status) {}
     
     // 继承移动赋值运算符
@@ -878,6 +1404,10 @@ public:
             current_minute_close = other.current_minute_close;
             pre_close = other.pre_close;
             MBarSeries = std::move(other.MBarSeries);
+            pre_days_ = other.pre_days_;
+            state_slots_ = std::move(other.state_slots_);
+            series_handles_ = std::move(other.series_handles_);
+            loaded_today_ = std::move(other.loaded_today_);
             status = other.status;
         }
         return *this;
@@ -891,53 +1421,262 @@ public:
         return pre_close;
     }
 
+    // 新增：设置保留的历史天数（需在写入序列前调用，已有序列不受影响）
+    void set_pre_days(int pre_days) { pre_days_ = std::max(0, pre_days); }
+    int get_pre_days() const { return pre_days_; }
+
+    // 新增：指标状态槽（未写入时为NaN），只能由处理该股票tick的线程调用
+    double& state_slot(int slot) {
+        if (slot >= static_cast<int>(state_slots_.size())) {
+            state_slots_.resize(slot + 1, std::numeric_limits<double>::quiet_NaN());
+        }
+        return state_slots_[slot];
+    }
+
+    // 新增：取得（必要时解析并缓存）slot对应的当日序列句柄，只能由处理该股票tick的线程调用
+    // 首次解析时按key查找或创建序列，之后每个tick直接使用指针，无需格式化key和哈希查找
+    BarBuffer* series_handle(int slot, Frequency frequency, const std::string& indicator_name,
+                             StoragePrecision precision = StoragePrecision::Float64) {
+        if (slot >= static_cast<int>(series_handles_.size())) {
+            series_handles_.resize(slot + 1, nullptr);
+        }
+        BarBuffer*& handle = series_handles_[slot];
+        if (handle == nullptr) {
+            std::lock_guard<std::mutex> lock(m_bar_mutex_);
+            std::string key = fmt::format("{}.{}.0", get_frequency_string(frequency), indicator_name);
+            auto it = MBarSeries.find(key);
+            if (it == MBarSeries.end()) {
+                it = MBarSeries.emplace(key, BarBuffer(get_bars_per_day(frequency), precision, pre_days_ + 1)).first;
+            }
+            handle = &it->second;
+        }
+        return handle;
+    }
+
+    // 新增：按预解析句柄批量合并写入（一次加锁）
+    struct ResolvedWrite {
+        BarBuffer* buffer;
+        int index;
+        double value;
+        RollupMethod method;
+    };
+
+    void apply_writes(const ResolvedWrite* writes, size_t count) {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        for (size_t i = 0; i < count; ++i) {
+            const ResolvedWrite& w = writes[i];
+            if (w.buffer == nullptr || w.index < 0 || w.index >= w.buffer->get_size()) continue;
+            w.buffer->set(w.index, rollup_combine(w.method, w.buffer->get(w.index), w.value));
+        }
+    }
+
+    // 新增：连续的count个状态槽（用于一次处理多个字段的指标）
+    double* state_block(int first_slot, int count) {
+        if (first_slot + count > static_cast<int>(state_slots_.size())) {
+            state_slots_.resize(first_slot + count, std::numeric_limits<double>::quiet_NaN());
+        }
+        return state_slots_.data() + first_slot;
+    }
+
+    void clear_state_slot(int slot) {
+        if (slot >= 0 && slot < static_cast<int>(state_slots_.size())) {
+            state_slots_[slot] = std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+
+    // 新增：检查点：全部序列（含历史日槽）、从T日文件加载的序列名、各频率当前索引和指标状态槽（如DiffIndicator的前值）
+    // 调用时该股票不能有正在处理的行情
+    void save_state(BinaryWriter& out) const {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        out.put<int32_t>(current_time);
+        out.put(current_minute_close);
+        out.put(pre_close);
+        out.put<int32_t>(pre_days_);
+        const int32_t indices[kFrequencyCount] = {t15_idx_, m1_idx_, m5_idx_, m30_idx_};
+        out.put(indices);
+        out.put_vector(state_slots_);
+        out.put<uint32_t>(static_cast<uint32_t>(MBarSeries.size()));
+        for (const auto& [key, buffer] : MBarSeries) {
+            out.put_string(key);
+            buffer.save_state(out);
+        }
+        out.put<uint32_t>(static_cast<uint32_t>(loaded_today_.size()));
+        for (const auto& key : loaded_today_) out.put_string(key);
+    }
+
+    // 读入到本对象（通常是临时对象，校验通过后再用adopt_state交给引擎中的holder）
+    bool restore_state(BinaryReader& in) {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        int32_t time = 0, pre_days = 0;
+        int32_t indices[kFrequencyCount] = {};
+        uint32_t series_count = 0;
+        if (!in.get(time) || !in.get(current_minute_close) || !in.get(pre_close) || !in.get(pre_days) ||
+            !in.get(indices) || !in.get_vector(state_slots_) || !in.get(series_count)) {
+            return false;
+        }
+        current_time = time;
+        pre_days_ = pre_days;
+        t15_idx_ = indices[0];
+        m1_idx_ = indices[1];
+        m5_idx_ = indices[2];
+        m30_idx_ = indices[3];
+        MBarSeries.clear();
+        series_handles_.clear();
+        for (uint32_t i = 0; i < series_count; ++i) {
+            std::string key;
+            BarBuffer buffer;
+            if (!in.get_string(key) || !buffer.restore_state(in)) return false;
+            MBarSeries.emplace(std::move(key), std::move(buffer));
+        }
+        uint32_t loaded_count = 0;
+        if (!in.get(loaded_count)) return false;
+        loaded_today_.clear();
+        for (uint32_t i = 0; i < loaded_count; ++i) {
+            std::string key;
+            if (!in.get_string(key)) return false;
+            loaded_today_.insert(std::move(key));
+        }
+        return true;
+    }
+
+    // 采用另一个holder（检查点读入的临时对象）的全部序列、T日加载标记、索引和状态槽，整体替换当前状态
+    // 已有序列原地赋值或清空为NaN（检查点中没有的序列），元素地址不变，指标预解析的序列句柄保持有效
+    void adopt_state(BarSeriesHolder&& other) {
+        std::scoped_lock lock(m_bar_mutex_, other.m_bar_mutex_);
+        current_time = other.current_time;
+        current_minute_close = other.current_minute_close;
+        pre_close = other.pre_close;
+        pre_days_ = other.pre_days_;
+        t15_idx_ = other.t15_idx_;
+        m1_idx_ = other.m1_idx_;
+        m5_idx_ = other.m5_idx_;
+        m30_idx_ = other.m30_idx_;
+        state_slots_ = std::move(other.state_slots_);
+        loaded_today_ = std::move(other.loaded_today_);
+        for (auto& [key, buffer] : MBarSeries) {
+            auto it = other.MBarSeries.find(key);
+            if (it == other.MBarSeries.end()) {
+                buffer.clear_all_days();
+                continue;
+            }
+            buffer = std::move(it->second);
+            other.MBarSeries.erase(it);
+        }
+        for (auto& [key, buffer] : other.MBarSeries) {
+            MBarSeries.emplace(key, std::move(buffer));
+        }
+    }
+
     bool check_data_exist(const std::string& name) const {
         std::lock_guard<std::mutex> lock(m_bar_mutex_);
         return MBarSeries.count(name) > 0;
     }
 
-    const GSeries& get_data(const std::string& name) const {
+    GSeries get_data(const std::string& name) const {
         std::lock_guard<std::mutex> lock(m_bar_mutex_);
-        return MBarSeries.at(name);
+        return MBarSeries.at(name).to_series();
     }
 
     GSeries get_today_min_series(
-            const std::string& factor_name, const int& pre_length, const int& today_minute_index) const {
+            const std::string& factor_name, const int& pre_length, const int& today_minute_index) {
         std::lock_guard<std::mutex> lock(m_bar_mutex_);
         int minute_len = today_minute_index + 1;
-        GSeries today_series;
-        
+
+        // 多日缓冲中已保留足够的历史日槽时，整段窗口物理连续，直接从视图物化
+        auto ring_it = MBarSeries.find(factor_name);
+        if (ring_it != MBarSeries.end() && pre_length < ring_it->second.day_slots()) {
+            return ring_it->second.window_view(pre_length, today_minute_index).to_series();
+        }
+
+        // 先收集各段视图，一次性分配，避免逐段append的重复拷贝
+        std::vector<GSeriesView> parts;
+        size_t total_len = 0;
+
         // 1. 先添加历史数据（按pre_length指定的天数）
         // 历史数据按时间倒序添加：pre_length天 -> pre_length-1天 -> ... -> 1天
         if (pre_length > 0) {
             for (int his_index = pre_length; his_index >= 1; his_index--) {
-                GSeries his_series = his_slice_bar(factor_name, his_index);
-                today_series.append(his_series);
+                GSeriesView his_view = his_slice_bar_view(factor_name, his_index);
+                if (his_view.empty()) {
+                    spdlog::error("{}: Key {}_{} not found in HisBarSeries", stock, factor_name, his_index);
+                }
+                parts.push_back(his_view);
+                total_len += his_view.get_size();
             }
         }
         
         // 2. 再添加当日数据（从索引0到today_minute_index）
-        if (MBarSeries.count(factor_name)) {
-            GSeries cur_series = MBarSeries.at(factor_name).head(minute_len);
-            today_series.append(cur_series);
+        auto it = MBarSeries.find(factor_name);
+        if (it != MBarSeries.end()) {
+            parts.push_back(it->second.view().head(minute_len));
+            total_len += parts.back().get_size();
         } else {
             spdlog::critical("{} m bar no factor {}", stock, factor_name);
         }
 
+        std::vector<double> fused;
+        fused.reserve(total_len);
+        for (const auto& part : parts) {
+            for (int i = 0; i < part.get_size(); ++i) fused.push_back(part[i]);
+        }
+        GSeries today_series(std::move(fused));
+
         // 返回的数据结构：
         // [历史数据pre_length天] + [历史数据pre_length-1天] + ... + [历史数据1天] + [当日数据(0到today_minute_index)]
         // 总长度 = 历史数据总长度 + (today_minute_index + 1)
         return today_series;
     }
 
-    void offline_set_m_bar(const std::string& factor_name, const GSeries& val) {
+    // 新增：只取当日数据时直接返回视图（0到today_minute_index），不拷贝
+    GSeriesView get_today_min_series_view(const std::string& factor_name, const int& today_minute_index) const {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        auto it = MBarSeries.find(factor_name);
+        if (it == MBarSeries.end()) {
+            spdlog::critical("{} m bar no factor {}", stock, factor_name);
+            return GSeriesView();
+        }
+        return it->second.view().head(today_minute_index + 1);
+    }
+
+    // 新增：[T-pre_length日, 当日0..today_minute_index]的连续视图，布局与get_today_min_series一致但不拷贝
+    // pre_length超过保留的历史天数时截断为保留天数（当日部分始终在视图末尾），首次出现时记录错误
+    GSeriesView get_today_min_series_view(const std::string& factor_name, int pre_length, int today_minute_index) {
         std::lock_guard<std::mutex> lock(m_bar_mutex_);
-        MBarSeries[factor_name] = val;
+        auto it = MBarSeries.find(factor_name);
+        if (it == MBarSeries.end()) {
+            spdlog::critical("{} m bar no factor {}", stock, factor_name);
+            return GSeriesView();
+        }
+        int kept_days = it->second.day_slots() - 1;
+        if (pre_length > kept_days) {
+            if (!short_history_logged_) {
+                spdlog::error("{}: {}只保留了{}日历史，请求{}日，按{}日截断", stock, factor_name, kept_days, pre_length, kept_days);
+                short_history_logged_ = true;
+            }
+            pre_length = kept_days;
+        }
+        return it->second.window_view(pre_length, today_minute_index);
+    }
+
+    // 新增：截止当日today_index的最近n个bar（可跨日）
+    GSeriesView get_last_n_bars_view(Frequency frequency, const std::string& indicator_name, int n, int today_index) {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        auto it = MBarSeries.find(fmt::format("{}.{}.0", get_frequency_string(frequency), indicator_name));
+        if (it == MBarSeries.end()) return GSeriesView();
+        return it->second.last_n_view(n, today_index);
+    }
+
+    void offline_set_m_bar(const std::string& factor_name, GSeries val,
+                           StoragePrecision precision = StoragePrecision::Float64) {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        MBarSeries[factor_name] = BarBuffer::from_series(std::move(val), precision);
+        loaded_today_.insert(factor_name);
         status = true;
     }
     
     // 新增：按照frequency.indicator_name.pre_length格式存储数据
-    void offline_set_m_bar_with_frequency(const std::string& frequency_str, const std::string& indicator_name, const GSeries& val, int pre_length = 0) {
+    void offline_set_m_bar_with_frequency(const std::string& frequency_str, const std::string& indicator_name, GSeries val, int pre_length = 0,
+                                          StoragePrecision precision = StoragePrecision::Float64) {
         std::lock_guard<std::mutex> lock(m_bar_mutex_);
         
         // 构建完整的key：frequency.indicator_name.pre_length
@@ -945,10 +1684,22 @@ public:
         // 已经构造好frequency.indicator_name.pre_length
 //        std::string key = indicator_name;
         
-        MBarSeries[key] = val;
+        int val_size = val.get_size();
+        auto it = MBarSeries.find(key);
+        if (it != MBarSeries.end() && it->second.day_slots() > 1) {
+            // 已有多日缓冲（例如历史先加载），只覆盖当日槽
+            it->second.set_day(0, val.view());
+        } else if (pre_days_ > 0) {
+            BarBuffer buffer(val_size, precision, pre_days_ + 1);
+            buffer.set_day(0, val.view());
+            MBarSeries[key] = std::move(buffer);
+        } else {
+            MBarSeries[key] = BarBuffer::from_series(std::move(val), precision);
+        }
+        if (pre_length == 0) loaded_today_.insert(key);
         status = true;
         
-        spdlog::info("[BarSeriesHolder] {} 离线存储数据: {} = GSeries(大小:{})", stock, key, val.get_size());
+        spdlog::info("[BarSeriesHolder] {} 离线存储数据: {} = GSeries(大小:{}, 精度:{})", stock, key, val_size, storage_precision_to_string(precision));
         
         // 添加调试信息：显示当前存储的所有key
         std::string all_keys;
@@ -959,6 +1710,58 @@ public:
         spdlog::info("[BarSeriesHolder] {} 当前存储的所有key: [{}]", stock, all_keys);
     }
 
+    // 新增：从只读视图（如列式文件的mmap列）写入T日序列，逐元素拷贝进当日槽，不经过GSeries
+    void offline_set_m_bar_with_frequency(const std::string& frequency_str, const std::string& indicator_name,
+                                          const GSeriesView& val, StoragePrecision precision) {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        std::string key = fmt::format("{}.{}.0", frequency_str, indicator_name);
+        auto it = MBarSeries.find(key);
+        if (it != MBarSeries.end() && it->second.day_slots() > 1) {
+            it->second.set_day(0, val);
+        } else {
+            BarBuffer buffer(val.get_size(), precision, pre_days_ + 1);
+            buffer.set_day(0, val);
+            MBarSeries[key] = std::move(buffer);
+        }
+        loaded_today_.insert(key);
+        status = true;
+        spdlog::debug("[BarSeriesHolder] {} 离线存储数据: {} = 视图(大小:{}, 精度:{})", stock, key, val.get_size(),
+                      storage_precision_to_string(precision));
+    }
+
+    // 新增：写入历史日数据到frequency.indicator_name.0的多日缓冲（his_day_index: 1=T-1, 2=T-2...）
+    void set_his_series_with_frequency(const std::string& frequency_str, const std::string& indicator_name,
+                                       int his_day_index, const GSeries& series,
+                                       StoragePrecision precision = StoragePrecision::Float64) {
+        set_his_series_with_frequency(frequency_str, indicator_name, his_day_index, series.view(), precision);
+    }
+
+    void set_his_series_with_frequency(const std::string& frequency_str, const std::string& indicator_name,
+                                       int his_day_index, const GSeriesView& series,
+                                       StoragePrecision precision = StoragePrecision::Float64) {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        if (his_day_index <= 0 || his_day_index > pre_days_) {
+            spdlog::error("{}: his_day_index超出范围 (got {}, pre_days={})", stock, his_day_index, pre_days_);
+            return;
+        }
+        std::string key = fmt::format("{}.{}.0", frequency_str, indicator_name);
+        auto it = MBarSeries.find(key);
+        if (it == MBarSeries.end()) {
+            it = MBarSeries.emplace(key, BarBuffer(series.get_size(), precision, pre_days_ + 1)).first;
+        }
+        it->second.set_day(his_day_index, series);
+    }
+
+    // 新增：换日，所有序列的当日槽前移（原当日变为T-1），无需重新加载历史
+    void roll_day() {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        for (auto& [key, buffer] : MBarSeries) {
+            buffer.roll_day();
+        }
+        loaded_today_.clear();
+        spdlog::debug("[BarSeriesHolder] {} 已换日", stock);
+    }
+
     // 新增：获取T日（今天）的数据
     GSeries get_m_bar(const std::string& factor_name) const {
         std::lock_guard<std::mutex> lock(m_bar_mutex_);
@@ -966,7 +1769,19 @@ public:
             spdlog::error("{}: Factor {} not found in MBarSeries", stock, factor_name);
             return GSeries();
         }
-        return MBarSeries.at(factor_name);
+        return MBarSeries.at(factor_name).to_series();
+    }
+
+    // 新增：零拷贝获取T日数据视图
+    // 注意：MBarSeries中的序列按整日长度一次性分配，写入只修改元素，视图在clear_daily_data前保持有效
+    GSeriesView get_m_bar_view(const std::string& factor_name) const {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        auto it = MBarSeries.find(factor_name);
+        if (it == MBarSeries.end()) {
+            spdlog::error("{}: Factor {} not found in MBarSeries", stock, factor_name);
+            return GSeriesView();
+        }
+        return it->second.view();
     }
 
     // 新增：检查T日数据是否存在
@@ -987,6 +1802,15 @@ public:
         }
         return keys;
     }
+
+    // 新增：统计当日+历史序列占用的字节数（用于观察float32存储的内存收益）
+    size_t get_storage_bytes() const {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        size_t total = 0;
+        for (const auto& kv : MBarSeries) total += kv.second.bytes();
+        for (const auto& kv : HisBarSeries) total += kv.second.bytes();
+        return total;
+    }
     
     // 新增：核心方法1 - Factor调用的数据获取函数
     GSeries get_data(Frequency frequency, const std::string& indicator_name, int pre_length, int today_index) {
@@ -999,11 +1823,11 @@ public:
         // 尝试从当前存储获取
         auto it = MBarSeries.find(key);
         if (it != MBarSeries.end()) {
-            GSeries result = it->second;
+            GSeriesView result = it->second.view();
             if (today_index >= 0 && today_index < result.get_size()) {
-                return result.head(today_index + 1);  // 返回从0到today_index的数据
+                return result.head(today_index + 1).to_series();  // 返回从0到today_index的数据
             }
-            return result;
+            return result.to_series();
         }
         
         // 如果当前存储没有，尝试从历史数据获取
@@ -1022,9 +1846,85 @@ public:
         spdlog::warn("[BarSeriesHolder] {} 当前存储的所有key: [{}]", stock, all_keys);
         return GSeries();
     }
-    
+
+    // 新增：get_data的零拷贝版本，只读取当日数据（从0到today_index）
+    GSeriesView get_data_view(Frequency frequency, const std::string& indicator_name, int pre_length, int today_index) const {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        std::string key = fmt::format("{}.{}.{}", get_frequency_string(frequency), indicator_name, pre_length);
+        auto it = MBarSeries.find(key);
+        if (it == MBarSeries.end()) {
+            spdlog::warn("[BarSeriesHolder] {} 未找到数据: {}", stock, key);
+            return GSeriesView();
+        }
+        if (today_index >= 0 && today_index < it->second.get_size()) {
+            return it->second.view().head(today_index + 1);
+        }
+        return it->second.view();
+    }
+
+    // 新增：当日[start, end]区间内有效值之和（前缀和O(1)，适用于volume/amount等可加字段），无有效值返回NaN
+    double range_sum(const std::string& key, int start, int end) const {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        auto it = MBarSeries.find(key);
+        if (it == MBarSeries.end()) return std::numeric_limits<double>::quiet_NaN();
+        return it->second.range_sum(start, end);
+    }
+
+    double range_sum(Frequency frequency, const std::string& indicator_name, int start, int end) const {
+        return range_sum(fmt::format("{}.{}.0", get_frequency_string(frequency), indicator_name), start, end);
+    }
+
+    // 新增：当日[start, end]区间内有效值个数
+    int range_count(Frequency frequency, const std::string& indicator_name, int start, int end) const {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        auto it = MBarSeries.find(fmt::format("{}.{}.0", get_frequency_string(frequency), indicator_name));
+        if (it == MBarSeries.end()) return 0;
+        return it->second.range_count(start, end);
+    }
+
+    // 新增：把base_freq的可加字段聚合到target_freq的第target_index个桶（两次前缀和查询）
+    double aggregated_sum(Frequency base_freq, const std::string& indicator_name,
+                          Frequency target_freq, int target_index) const {
+        // base频率比目标更粗时返回所在桶的值（start == end）
+        auto [start, end] = get_time_bucket_range(target_index, base_freq, target_freq);
+        return range_sum(base_freq, indicator_name, start, end);
+    }
+
+    // 新增：区间VWAP = sum(amount) / sum(volume)，成交量为0或无数据时返回NaN
+    // 两个字段各自只累加有效值（前缀和按字段独立维护），某个桶只有一个字段为NaN时另一个字段仍计入；
+    // 这与原先逐桶累加时"任一字段为NaN或volume <= 0则整桶跳过"不同，只在两个字段的缺失不一致时有差别；
+    // IntradayVwapFactor的增量路径使用同一规则
+    double range_vwap(const std::string& amount_key, const std::string& volume_key, int start, int end) const {
+        double amount_sum = range_sum(amount_key, start, end);
+        double volume_sum = range_sum(volume_key, start, end);
+        if (std::isnan(amount_sum) || std::isnan(volume_sum) || volume_sum <= 0.0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return amount_sum / volume_sum;
+    }
+
+    double range_vwap(Frequency frequency, int start, int end,
+                      const std::string& amount_name = "amount",
+                      const std::string& volume_name = "volume") const {
+        std::string freq_str = get_frequency_string(frequency);
+        return range_vwap(fmt::format("{}.{}.0", freq_str, amount_name),
+                          fmt::format("{}.{}.0", freq_str, volume_name), start, end);
+    }
+
+    // 新增：把base_freq的可加字段整日聚合为target_freq序列（每个目标桶一次区间查询）
+    GSeries aggregate_series(Frequency base_freq, const std::string& indicator_name, Frequency target_freq) const {
+        int target_bars = get_bars_per_day(target_freq);
+        std::vector<double> result(std::max(target_bars, 0));
+        for (int i = 0; i < target_bars; ++i) {
+            result[i] = aggregated_sum(base_freq, indicator_name, target_freq, i);
+        }
+        return GSeries(std::move(result));
+    }
+
     // 新增：核心方法2 - 更新数据（不传递时间戳，时间由频率和索引决定）
-    void update(Frequency frequency, const std::string& indicator_name, double value) {
+    // precision仅在首次创建该序列时生效
+    void update(Frequency frequency, const std::string& indicator_name, double value,
+                StoragePrecision precision = StoragePrecision::Float64) {
         std::lock_guard<std::mutex> lock(m_bar_mutex_);
         
         // 获取当前索引
@@ -1042,10 +1942,9 @@ public:
         // 获取或创建GSeries
         auto it = MBarSeries.find(key);
         if (it == MBarSeries.end()) {
-            // 创建新的GSeries，大小根据频率确定
+            // 创建新的序列，大小根据频率确定
             int size = get_bars_per_day(frequency);
-            MBarSeries[key] = GSeries(size, std::numeric_limits<double>::quiet_NaN());
-            it = MBarSeries.find(key);
+            it = MBarSeries.emplace(key, BarBuffer(size, precision, pre_days_ + 1)).first;
         }
         
         // 设置值
@@ -1062,6 +1961,35 @@ public:
         spdlog::debug("[BarSeriesHolder] {} 当前存储的所有key: {}", stock, all_keys);
     }
     
+    // 新增：把一个tick的贡献按rollup语义同时写入基础频率和各汇总频率的当前桶（一次加锁）
+    // 各频率的当前桶索引由update_time统一维护，因子读取任意频率时无需再聚合
+    void accumulate(Frequency base_frequency, const std::vector<Frequency>& rollup_frequencies,
+                    const std::string& indicator_name, double value, RollupMethod method,
+                    StoragePrecision precision = StoragePrecision::Float64) {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        accumulate_locked(base_frequency, indicator_name, value, method, precision);
+        for (Frequency frequency : rollup_frequencies) {
+            if (frequency != base_frequency) {
+                accumulate_locked(frequency, indicator_name, value, method, precision);
+            }
+        }
+    }
+
+    // 新增：批量版本，同一tick的多个字段在一次加锁内写入所有频率
+    void accumulate_fields(Frequency base_frequency, const std::vector<Frequency>& rollup_frequencies,
+                           const FieldContribution* fields, size_t count,
+                           StoragePrecision precision = StoragePrecision::Float64) {
+        std::lock_guard<std::mutex> lock(m_bar_mutex_);
+        for (size_t i = 0; i < count; ++i) {
+            accumulate_locked(base_frequency, fields[i].name, fields[i].value, fields[i].method, precision);
+            for (Frequency frequency : rollup_frequencies) {
+                if (frequency != base_frequency) {
+                    accumulate_locked(frequency, fields[i].name, fields[i].value, fields[i].method, precision);
+                }
+            }
+        }
+    }
+
     // 新增：核心方法3 - 时间更新函数，完成分桶任务
     void update_time(uint64_t real_time) {
         auto start_time = std::chrono::high_resolution_clock::now();
@@ -1129,7 +2057,21 @@ public:
     // 新增：清空当日数据（用于每天开始时）
     void clear_daily_data() {
         std::lock_guard<std::mutex> lock(m_bar_mutex_);
-        MBarSeries.clear();
+        // 被删除的序列会使预解析句柄失效，统一重新解析
+        std::fill(series_handles_.begin(), series_handles_.end(), nullptr);
+        // 多日缓冲只清空当日槽，保留已加载的历史日；从T日文件加载的当日序列整体保留
+        for (auto it = MBarSeries.begin(); it != MBarSeries.end();) {
+            if (loaded_today_.count(it->first)) {
+                ++it;
+            } else if (it->second.day_slots() > 1) {
+                it->second.clear_today();
+                ++it;
+            } else {
+                it = MBarSeries.erase(it);
+            }
+        }
+        // 累计量在新交易日重新开始，指标状态一并清空
+        std::fill(state_slots_.begin(), state_slots_.end(), std::numeric_limits<double>::quiet_NaN());
         spdlog::debug("[BarSeriesHolder] {} 当日数据已清空", stock);
     }
     
@@ -1307,6 +2249,20 @@ public:
     
     // 注意：get_bar_map函数已移除，现在使用calculate_time_bucket_index进行数学计算
     
+    // 在已持有m_bar_mutex_时合并写入frequency的当前桶
+    void accumulate_locked(Frequency frequency, const std::string& indicator_name, double value,
+                           RollupMethod method, StoragePrecision precision) {
+        int current_idx = get_idx(frequency);
+        if (current_idx < 0) return;
+        std::string key = fmt::format("{}.{}.0", get_frequency_string(frequency), indicator_name);
+        auto it = MBarSeries.find(key);
+        if (it == MBarSeries.end()) {
+            it = MBarSeries.emplace(key, BarBuffer(get_bars_per_day(frequency), precision, pre_days_ + 1)).first;
+        }
+        if (current_idx >= it->second.get_size()) return;
+        it->second.set(current_idx, rollup_combine(method, it->second.get(current_idx), value));
+    }
+
     // 新增：获取频率字符串
     std::string get_frequency_string(Frequency frequency) const {
         switch (frequency) {
@@ -1332,6 +2288,54 @@ public:
 
 };
 
+// 新增：一个tick在指标间共享的预解析上下文（由CalculationEngine每个tick构建一次）
+// 股票的BarSeriesHolder只查找一次，各频率的当前桶索引只读取一次
+class OrderBook;  // 新增：逐笔重建的订单簿（order_book.h）
+
+struct IndicatorTickContext {
+    const SyncTickData* tick = nullptr;
+    BarSeriesHolder* holder = nullptr;
+    const OrderBook* book = nullptr;    // 新增：该股票的订单簿（未启用时为空）
+    int bucket_index[kFrequencyCount] = {-1, -1, -1, -1};
+
+    int bucket(Frequency frequency) const { return bucket_index[static_cast<int>(frequency)]; }
+
+    static IndicatorTickContext resolve(const SyncTickData& tick_data, BarSeriesHolder* stock_holder) {
+        IndicatorTickContext ctx;
+        ctx.tick = &tick_data;
+        ctx.holder = stock_holder;
+        if (stock_holder != nullptr) {
+            for (int f = 0; f < kFrequencyCount; ++f) {
+                ctx.bucket_index[f] = stock_holder->get_idx(static_cast<Frequency>(f));
+            }
+        }
+        return ctx;
+    }
+};
+
+// 新增：一只股票一整天快照的批量上下文（离线回放时使用）
+// ticks按时间顺序排列，每个tick的订单/成交已挂在SyncTickData上；bucket_index每个频率一列，
+// 第i个元素为第i个tick所在的时间桶，由CalculationEngine逐tick推进BarSeriesHolder时间时记录
+struct IndicatorBatchContext {
+    const SyncTickData* ticks = nullptr;
+    size_t count = 0;
+    BarSeriesHolder* holder = nullptr;
+    const int* bucket_index[kFrequencyCount] = {nullptr, nullptr, nullptr, nullptr};
+
+    const int* buckets(Frequency frequency) const { return bucket_index[static_cast<int>(frequency)]; }
+
+    // 第i个tick的单tick上下文（不带订单簿，订单簿只在逐事件路径中可见）
+    IndicatorTickContext at(size_t i) const {
+        IndicatorTickContext ctx;
+        ctx.tick = ticks + i;
+        ctx.holder = holder;
+        for (int f = 0; f < kFrequencyCount; ++f) {
+            ctx.bucket_index[f] = bucket_index[f] ? bucket_index[f][i] : -1;
+        }
+        return ctx;
+    }
+};
+
 // Factor基类（PDF 3.4节）
 class BaseFactor {
 public:
@@ -1371,6 +2375,10 @@ protected:
     std::string path_;          // 持久化基础路径
     Frequency frequency_;       // 更新频率
     std::string storage_frequency_str_; //存储的频率
+    StoragePrecision precision_ = StoragePrecision::Float64; // 新增：序列存储精度
+    std::vector<Frequency> rollup_frequencies_; // 新增：写入时同步汇总的频率（不含frequency_本身）
+    std::vector<std::string> input_names_;      // 新增：依赖的上游指标名（派生指标）
+    std::vector<const Indicator*> inputs_;      // 新增：CalculationEngine编译依赖图时解析出的上游指标
     
     // 计算状态标记（线程安全）
     mutable std::atomic<bool> is_calculated_{false};  // 是否已计算完成
@@ -1413,6 +2421,61 @@ protected:
     // 新增：指向当前股票BarSeriesHolder的指针（用于存储计算结果）
     BarSeriesHolder* current_bar_holder_ = nullptr;
 
+    // 新增：本指标连续的每股状态槽（存放在各股票的BarSeriesHolder中）和序列句柄槽的起始槽位，
+    // 由CalculationEngine::add_indicator在本引擎内分配（见assign_slots）
+    int state_slot_base_ = 0;
+    int handle_slot_base_ = 0;
+
+    // 新增：通过预解析句柄把各字段的贡献写入基础频率和所有汇总频率的当前桶
+    // handle_base起每个字段占kFrequencyCount个句柄槽（按频率下标排布），所有写入一次加锁完成
+    void write_fields_with_context(const IndicatorTickContext& ctx, int handle_base,
+                                   const size_t* field_indices, const FieldContribution* fields, size_t count) {
+        BarSeriesHolder::ResolvedWrite writes[16];
+        size_t n = 0;
+        auto push = [&](size_t field_slot, const FieldContribution& field, Frequency frequency) {
+            int slot = handle_base + static_cast<int>(field_slot) * kFrequencyCount + static_cast<int>(frequency);
+            writes[n++] = {ctx.holder->series_handle(slot, frequency, field.name, precision_),
+                           ctx.bucket(frequency), field.value, field.method};
+            if (n == std::size(writes)) {
+                ctx.holder->apply_writes(writes, n);
+                n = 0;
+            }
+        };
+        for (size_t i = 0; i < count; ++i) {
+            push(field_indices[i], fields[i], frequency_);
+            for (Frequency frequency : rollup_frequencies_) {
+                if (frequency != frequency_) push(field_indices[i], fields[i], frequency);
+            }
+        }
+        if (n > 0) ctx.holder->apply_writes(writes, n);
+    }
+
+    // 新增：把一整天的一列逐tick贡献写入基础频率和所有汇总频率
+    // 同一桶内的连续tick先在本地按method合并，每个桶只写一次，所有写入一次加锁完成
+    void write_column_with_batch(const IndicatorBatchContext& batch, int handle_base, size_t field_slot,
+                                 const char* name, const double* values, RollupMethod method) {
+        std::vector<BarSeriesHolder::ResolvedWrite> writes;
+        auto write_frequency = [&](Frequency frequency) {
+            const int* buckets = batch.buckets(frequency);
+            if (buckets == nullptr) return;
+            int slot = handle_base + static_cast<int>(field_slot) * kFrequencyCount + static_cast<int>(frequency);
+            BarBuffer* buffer = batch.holder->series_handle(slot, frequency, name, precision_);
+            size_t i = 0;
+            while (i < batch.count) {
+                const int bucket = buckets[i];
+                double combined = std::numeric_limits<double>::quiet_NaN();
+                for (; i < batch.count && buckets[i] == bucket; ++i) {
+                    combined = rollup_combine(method, combined, values[i]);
+                }
+                if (bucket >= 0) writes.push_back({buffer, bucket, combined, method});
+            }
+        };
+        write_frequency(frequency_);
+        for (Frequency frequency : rollup_frequencies_) {
+            if (frequency != frequency_) write_frequency(frequency);
+        }
+        batch.holder->apply_writes(writes.data(), writes.size());
+    }
 
 public:
     // 通过ModuleConfig的参数初始化
@@ -1423,8 +2486,14 @@ public:
         if (freq_str == "5min") return Frequency::F5MIN;
         if (freq_str == "30min") return Frequency::F30MIN;
         return Frequency::F15S; // 默认
-    }(module.frequency)) {
+    }(module.frequency)), precision_(module.precision), input_names_(module.inputs) {
         init_frequency_params();
+        for (const auto& freq_str : module.rollup_frequencies) {
+            Frequency freq;
+            if (parse_frequency(freq_str, freq) && freq != frequency_) {
+                rollup_frequencies_.push_back(freq);
+            }
+        }
     }
 
     virtual ~Indicator()=default;
@@ -1448,6 +2517,8 @@ public:
     const std::string& name() const { return name_; }
     // 获取更新频率
     Frequency frequency() const { return frequency_; }
+    // 新增：获取存储精度
+    StoragePrecision precision() const { return precision_; }
     
     // 新增：输出时间桶信息的辅助函数
     void log_time_bucket_info(const std::string& symbol, int bucket_index, double value) const {
@@ -1480,11 +2551,59 @@ public:
         spdlog::warn("指标[{}] store_result方法需要股票代码参数，请使用store_result_to_stock", name_);
     }
     
+    // 新增：写入时汇总的频率
+    const std::vector<Frequency>& rollup_frequencies() const { return rollup_frequencies_; }
+
+    // 新增：依赖的上游指标（按名称声明，由CalculationEngine在编译依赖图时绑定）
+    const std::vector<std::string>& input_names() const { return input_names_; }
+    const std::vector<const Indicator*>& inputs() const { return inputs_; }
+    void bind_inputs(std::vector<const Indicator*> inputs) { inputs_ = std::move(inputs); }
+
+    // 新增：每只股票需要的状态槽/序列句柄槽个数，注册到引擎时按此分配
+    virtual int state_slot_count() const { return 0; }
+    virtual int handle_slot_count() const { return 0; }
+
+    // 新增：由CalculationEngine注册指标时调用，槽位只在该引擎的BarSeriesHolder内有效
+    void assign_slots(int state_slot_base, int handle_slot_base) {
+        state_slot_base_ = state_slot_base;
+        handle_slot_base_ = handle_slot_base;
+    }
+
+    // 新增：只保留下游实际读取的汇总频率（基础频率始终计算），由Framework按因子需求裁剪
+    void retain_rollup_frequencies(const std::set<Frequency>& frequencies) {
+        rollup_frequencies_.erase(std::remove_if(rollup_frequencies_.begin(), rollup_frequencies_.end(),
+                                                 [&](Frequency f) { return frequencies.count(f) == 0; }),
+                                  rollup_frequencies_.end());
+    }
+
+    // 新增：只保留下游实际读取的输出字段，默认指标只有一个输出，无可裁剪字段
+    virtual void retain_fields(const std::set<std::string>& /*fields*/) {}
+
+    // 新增：字段从基础频率合并到更粗频率的方式（读取方需要未汇总的频率时按此聚合），默认可加
+    virtual RollupMethod field_rollup(const std::string& /*field*/) const { return RollupMethod::Sum; }
+
+    // 新增：该指标是否在frequency下有bar（基础频率或汇总频率）
+    bool has_frequency(Frequency frequency) const {
+        return frequency == frequency_ ||
+               std::find(rollup_frequencies_.begin(), rollup_frequencies_.end(), frequency) != rollup_frequencies_.end();
+    }
+
+    // 新增：把一个tick的贡献按rollup语义一次性写入基础频率和所有汇总频率的当前桶
+    void accumulate_to_stock(const std::string& indicator_name, double value, const std::string& stock_code,
+                             RollupMethod method = RollupMethod::Sum) {
+        BarSeriesHolder* stock_holder = get_stock_bar_holder(stock_code);
+        if (stock_holder != nullptr) {
+            stock_holder->accumulate(frequency_, rollup_frequencies_, indicator_name, value, method, precision_);
+        } else {
+            spdlog::warn("指标[{}]无法存储结果到股票{}，BarSeriesHolder为空", name_, stock_code);
+        }
+    }
+
     // 新增：存储计算结果到指定股票的BarSeriesHolder的辅助方法
     void store_result_to_stock(const std::string& indicator_name, double value, const std::string& stock_code) {
         BarSeriesHolder* stock_holder = get_stock_bar_holder(stock_code);
         if (stock_holder != nullptr) {
-            stock_holder->update(frequency_, indicator_name, value);
+            stock_holder->update(frequency_, indicator_name, value, precision_);
             spdlog::debug("指标[{}]存储结果到股票{}成功: {} = {}", name_, stock_code, indicator_name, value);
         } else {
             spdlog::warn("指标[{}]无法存储结果到股票{}，BarSeriesHolder为空", name_, stock_code);
@@ -1493,6 +2612,42 @@ public:
 
     
     // 修改：尝试计算（增加状态检查）
+    // 新增：融合tick内核入口，ctx由CalculationEngine每个tick预解析一次；默认回退到Calculate
+    virtual void calculate_with_context(const IndicatorTickContext& ctx) {
+        Calculate(*ctx.tick);
+    }
+
+    // 新增：是否实现了整日批量计算（CalculateBatch）；只有实现了的指标才会在离线回放时走批量路径
+    virtual bool supports_batch() const { return false; }
+
+    // 新增：一次处理一只股票一整天的快照，默认逐tick调用calculate_with_context
+    virtual void CalculateBatch(const IndicatorBatchContext& batch) {
+        for (size_t i = 0; i < batch.count; ++i) {
+            calculate_with_context(batch.at(i));
+        }
+    }
+
+    // 新增：是否需要在每个逐笔委托/成交事件后收到订单簿更新（默认只在快照时计算）
+    virtual bool wants_order_book_events() const { return false; }
+
+    // 新增：是否读取订单簿（逐笔事件回调或快照时的ctx.book）；没有指标需要时引擎不建订单簿
+    virtual bool uses_order_book() const { return wants_order_book_events(); }
+
+    // 新增：逐笔事件回调，book为已应用该事件后的订单簿，holder的时间桶已推进到事件时间
+    virtual void on_order_book_event(const OrderBook& /*book*/, BarSeriesHolder* /*holder*/) {}
+
+    // 新增：带预解析上下文的计算（跳过已完成的指标）
+    void try_calculate_with_context(const IndicatorTickContext& ctx) {
+        if (is_calculated_) return;
+        calculate_with_context(ctx);
+    }
+
+    // 批量路径同样跳过已完成（如已从T日文件加载）的指标，否则合并写入会叠加到已加载的时间桶上
+    void try_calculate_batch(const IndicatorBatchContext& batch) {
+        if (is_calculated_) return;
+        CalculateBatch(batch);
+    }
+
     void try_calculate(const SyncTickData& sync_tick) {
         auto start_time = std::chrono::high_resolution_clock::now();
         
@@ -1674,6 +2829,15 @@ public:
 };
 
 // 因子类：依赖Indicator结果计算，结果存储在factor_storage
+// 新增：因子声明的一项输入（读取哪个指标的哪个字段、哪个频率的bar、需要多少天历史）
+struct IndicatorRequirement {
+    std::string indicator;      // 指标名
+    std::string field;          // 输出字段（为空表示该指标的全部输出）
+    std::string frequency;      // 读取的频率（为空表示指标的基础频率）
+    int pre_days = 0;           // 需要的历史天数
+    bool optional = false;      // 可选输入：未配置该指标时不报错（如有vwap则用，否则回退到差分）
+};
+
 class Factor {
 protected:
     std::string name_;          // 因子名称（如"volatility")
@@ -1768,6 +2932,46 @@ public:
         return GSeries();
     }
 
+    // 新增：增量生命周期 - CalculationEngine在当日第一个时间事件前调用on_day_start，
+    // 之后按时间事件顺序（ti递增，可跳桶）调用on_bucket代替definition_with_cal_engine；
+    // 因子在自身的逐股票状态中只消化上次调用后新到的行，每个事件O(股票数 × 新行数)
+    virtual bool supports_incremental() const { return false; }
+
+    virtual void on_day_start(
+        const std::shared_ptr<CalculationEngine>& /*cal_engine*/,
+        const std::vector<std::string>& /*sorted_stock_list*/
+    ) {}
+
+    virtual GSeries on_bucket(
+        const std::shared_ptr<CalculationEngine>& cal_engine,
+        const std::vector<std::string>& sorted_stock_list,
+        int ti
+    ) {
+        return definition_with_cal_engine(cal_engine, sorted_stock_list, ti);
+    }
+
+    // 新增：整日回填接口 - 输入指标已全部算完（离线回放/因子服务）时，一次调用算出当日所有时间桶
+    // 返回bar_count个截面（下标为时间桶ti，每个截面按sorted_stock_list排列），
+    // 子类按 股票 × 时间桶 遍历，每只股票的输入序列只取一次
+    virtual bool supports_full_day() const { return false; }
+
+    virtual std::vector<GSeries> definition_full_day(
+        const std::shared_ptr<CalculationEngine>& cal_engine,
+        const std::vector<std::string>& sorted_stock_list,
+        int bar_count
+    ) {
+        // 默认实现：增量因子从日初依次推进，其余逐桶调用definition_with_cal_engine
+        std::vector<GSeries> panel(std::max(bar_count, 0));
+        if (supports_incremental()) {
+            on_day_start(cal_engine, sorted_stock_list);
+        }
+        for (int ti = 0; ti < bar_count; ++ti) {
+            panel[ti] = supports_incremental() ? on_bucket(cal_engine, sorted_stock_list, ti)
+                                               : definition_with_cal_engine(cal_engine, sorted_stock_list, ti);
+        }
+        return panel;
+    }
+
     // 获取完整存储路径（path/date/frequency/name.gz）
     std::string get_full_storage_path(const std::string& date) const {
         std::string freq_str;
@@ -1796,6 +3000,10 @@ public:
     //     return factor_storage;
     // }
     
+    // 新增：声明因子读取的指标输入，Framework据此只计算和加载可达的指标
+    // 返回空表示未声明，此时保守地保留全部指标
+    virtual std::vector<IndicatorRequirement> required_inputs() const { return {}; }
+
     // 设置依赖的indicators
     void set_dependent_indicators(const std::vector<const Indicator*>& indicators) {
         dependent_indicators_ = indicators;
@@ -1817,44 +3025,6 @@ public:
     }
 };
 
-// 计算时间桶映射范围（从factor时间桶映射到indicator时间桶范围）
-inline std::pair<int, int> get_time_bucket_range(int factor_ti, Frequency indicator_freq, Frequency factor_freq) {
-    int indicator_seconds = 0;
-    int factor_seconds = 0;
-    
-    // 获取indicator频率的秒数
-    switch (indicator_freq) {
-        case Frequency::F15S: indicator_seconds = 15; break;
-        case Frequency::F1MIN: indicator_seconds = 60; break;
-        case Frequency::F5MIN: indicator_seconds = 300; break;
-        case Frequency::F30MIN: indicator_seconds = 1800; break;
-    }
-    
-    // 获取factor频率的秒数
-    switch (factor_freq) {
-        case Frequency::F15S: factor_seconds = 15; break;
-        case Frequency::F1MIN: factor_seconds = 60; break;
-        case Frequency::F5MIN: factor_seconds = 300; break;
-        case Frequency::F30MIN: factor_seconds = 1800; break;
-    }
-
-    // 计算比例（indicator频率 / factor频率）
-    int ratio = indicator_seconds / factor_seconds;
-    
-    if (ratio >= 1) {
-        // indicator频率 >= factor频率（如30min indicator vs 5min factor）
-        // 一个indicator时间桶对应多个factor时间桶
-        int indicator_ti = factor_ti / ratio;
-        return {indicator_ti, indicator_ti};  // 返回同一个indicator时间桶
-    } else {
-        // indicator频率 < factor频率（如1min indicator vs 5min factor）
-        // 一个factor时间桶对应多个indicator时间桶
-        int start_index = factor_ti * (factor_seconds / indicator_seconds);
-        int end_index = start_index + (factor_seconds / indicator_seconds) - 1;
-        return {start_index, end_index};
-    }
-}
-
 // 基于时间戳计算可用的数据范围（时间戳驱动）
 // 现在直接使用 IndicatorStorageHelper::get_available_data_range_from_timestamp()
 // 此函数已移除，所有调用都直接使用 IndicatorStorageHelper
@@ -7,21 +7,32 @@ class CalculationEngine;
 #include <memory>
 #include <mutex>
 #include <map>
+#include <set>
 #include <vector>
-#include <functional>
+#include <array>
+#include <utility>
 #include <string>
 
-// 通用差分指标 - 可以配置任意字段进行差分计算
+// 编译期字段描述符：输出键名 + TickData成员指针 + 桶内合并方式
+// Sum字段写入相邻tick累计值的差分，Last/Max/Min/First字段写入原始值
+struct DiffFieldDescriptor {
+    const char* output_key;           // 输出键名（如"volume", "amount"）
+    double TickData::* member;        // 对应的TickData字段
+    RollupMethod rollup;              // 桶内合并方式
+    const char* description;          // 字段描述
+};
+
+// 可选字段表（config.xml的fields属性从中选择，未配置时默认volume和amount）
+inline constexpr DiffFieldDescriptor kDiffFieldTable[] = {
+    {"volume",     &TickData::volume,             RollupMethod::Sum,  "成交量差分"},
+    {"amount",     &TickData::total_value_traded, RollupMethod::Sum,  "成交额差分"},
+    {"last_price", &TickData::last_price,         RollupMethod::Last, "最新价"},
+};
+inline constexpr size_t kDiffFieldCount = sizeof(kDiffFieldTable) / sizeof(kDiffFieldTable[0]);
+
+// 通用差分指标 - 从字段表中选择字段，每个tick一次性读取、差分并写入所有启用字段
 class DiffIndicator : public Indicator {
 public:
-    // 差分字段配置
-    struct DiffFieldConfig {
-        std::string field_name;           // 字段名（如"volume", "amount", "price"）
-        std::string output_key;           // 输出键名
-        std::function<double(const TickData&)> getter;  // 数据获取函数
-        std::string description;          // 字段描述
-    };
-
     explicit DiffIndicator(const ModuleConfig& module, int pre_days = 0) : Indicator(module), pre_days_(pre_days) {
         // 保存配置的存储频率
         storage_frequency_str_ = module.frequency;
@@ -47,15 +58,28 @@ public:
         spdlog::info("DiffIndicator[{}] 初始化完成: 存储频率={}, 内部频率={}, pre_days={}", 
                      module.name, module.frequency, static_cast<int>(frequency_), pre_days_);
         
-        // 默认配置volume和amount差分
-        setup_default_fields();
+        // 按配置启用字段，未配置时默认volume和amount差分
+        setup_fields(module.fields);
     }
 
     // 重写计算接口
     void Calculate(const SyncTickData& tick_data) override;
+
+    // 新增：融合tick内核（使用CalculationEngine预解析的上下文）
+    void calculate_with_context(const IndicatorTickContext& ctx) override;
+
+    // 新增：整日批量差分（离线回放），逐字段对整列做差分后按桶合并写入
+    bool supports_batch() const override { return true; }
+    void CalculateBatch(const IndicatorBatchContext& batch) override;
     
-    // 添加差分字段
-    void add_diff_field(const DiffFieldConfig& config);
+    // 启用字段表中的字段（按output_key），未知字段返回false
+    bool enable_field(const std::string& output_key);
+
+    // 新增：只保留下游因子实际读取的字段
+    void retain_fields(const std::set<std::string>& fields) override;
+
+    // 新增：字段表中的桶内合并方式（last_price为Last，其余差分字段为Sum）
+    RollupMethod field_rollup(const std::string& field) const override;
     
     // 重置差分存储
     void reset_diff_storage();
@@ -78,17 +102,21 @@ public:
     // 获取存储频率字符串
     const std::string& get_storage_frequency_str() const { return storage_frequency_str_; }
 
-    // 新增：聚合到指定频率
+    // 每只股票kDiffFieldCount个连续状态槽（前一个tick的字段值），kDiffFieldCount * kFrequencyCount个序列句柄槽（按 字段 × 频率 排布）
+    int state_slot_count() const override { return static_cast<int>(kDiffFieldCount); }
+    int handle_slot_count() const override { return static_cast<int>(kDiffFieldCount) * kFrequencyCount; }
+
+    // 新增：聚合到指定频率（聚合第一个差分字段）
     bool aggregate(const std::string& target_frequency,std::map<int, std::map<std::string, double>> &aggregated_data) override;
 
+    // 新增：聚合指定差分字段到目标频率（基于BarSeriesHolder前缀和的区间求和）
+    bool aggregate_field(const std::string& output_key, const std::string& target_frequency,
+                         std::map<int, std::map<std::string, double>>& aggregated_data);
+
 private:
-    // 差分字段配置
-    std::vector<DiffFieldConfig> diff_fields_;
-    
-    // 方案B：使用简单的成员变量存储前一个tick的TotalValueTraded
-    // 字段名 -> 股票 -> 前一个tick的TotalValueTraded
-    std::unordered_map<std::string, std::unordered_map<std::string, double>> prev_tick_values_;
-    
+    // 启用的字段在kDiffFieldTable中的下标
+    std::vector<size_t> enabled_fields_;
+
     // 存储频率（从配置文件读取）
     std::string storage_frequency_str_;
     
@@ -97,24 +125,14 @@ private:
     
     // 指向CalculationEngine的指针（用于获取指定股票的BarSeriesHolder）
     mutable std::shared_ptr<CalculationEngine> calculation_engine_;    
-    // 计算单个字段的差分
-    double calculate_field_diff(const std::string& field_name, 
-                              const std::string& stock_code,
-                              uint64_t current_time,
-                              double current_value);
-    
-    // 通过时间桶索引获取累积差值（更高效）
-    double get_accumulated_diff_by_bucket(const std::string& field_name, 
-                                         const std::string& stock_code,
-                                         int time_bucket_index,
-                                         BarSeriesHolder* stock_holder);
-    
-    // 方案B：从TickDataManager获取前一个tick的TotalValueTraded
-    double get_previous_tick_total_value(const std::string& field_name, 
-                                        const std::string& stock_code);
+    // 按字段表一次性读取tick中的所有字段（展开为逐成员读取，无函数对象调用）
+    template <size_t... I>
+    static std::array<double, sizeof...(I)> load_tick_fields(const TickData& tick, std::index_sequence<I...>) {
+        return {{ (tick.*(kDiffFieldTable[I].member))... }};
+    }
     
-    // 设置默认字段（volume和amount）
-    void setup_default_fields();
+    // 按配置设置字段（为空时启用volume和amount）
+    void setup_fields(const std::vector<std::string>& fields);
     
     // 聚合辅助函数
     int get_aggregation_ratio(const std::string& from_freq, const std::string& to_freq);
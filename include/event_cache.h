@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <atomic>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include "spdlog/spdlog.h"
+
+// 时间事件内的中间结果缓存：同一个时间事件中多个Factor线程并行计算，
+// 相同的中间量（同一字段的序列视图、同一区间的VWAP截面、同一滚动和……）只算一次
+//
+// 键由调用方按 算子|输入|参数 拼成字符串（股票列表用universe_key按内容编码）；第一个请求某个键的线程负责计算，
+// 并发请求同一键的线程等待该结果（shared_future），之后的请求直接共享
+// CalculationEngine在每个时间事件开始时begin_event，所有Factor完成后end_event释放全部条目；
+// 事件之外（如直接调用因子接口）缓存不生效，每次都直接计算
+class EventCache {
+public:
+    void begin_event() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        active_ = true;
+    }
+
+    void end_event() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        active_ = false;
+    }
+
+    bool active() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return active_;
+    }
+
+    // 取键对应的值，不存在时调用compute()计算并缓存（compute返回T）
+    // compute抛出的异常会传给正在等待该键的线程，该键随后被移除，下一个请求者重新计算
+    template <typename T, typename Compute>
+    std::shared_ptr<const T> get_or_compute(const std::string& key, Compute&& compute) {
+        enum class Role { Direct, Owner, Waiter };
+        Role role = Role::Direct;
+        std::promise<std::shared_ptr<const void>> promise;
+        std::shared_future<std::shared_ptr<const void>> future;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (active_) {
+                auto it = entries_.find(key);
+                if (it == entries_.end()) {
+                    future = promise.get_future().share();
+                    entries_.emplace(key, Entry{future, std::type_index(typeid(T))});
+                    role = Role::Owner;
+                    ++misses_;
+                } else if (it->second.type == std::type_index(typeid(T))) {
+                    future = it->second.value;
+                    role = Role::Waiter;
+                    ++hits_;
+                } else {
+                    spdlog::error("EventCache: 键[{}]已缓存为其他类型，本次直接计算", key);
+                }
+            }
+        }
+
+        switch (role) {
+            case Role::Direct:
+                return std::make_shared<const T>(compute());
+            case Role::Waiter:
+                return std::static_pointer_cast<const T>(future.get());
+            case Role::Owner:
+                break;
+        }
+
+        try {
+            std::shared_ptr<const T> value = std::make_shared<const T>(compute());
+            promise.set_value(value);
+            return value;
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            std::lock_guard<std::mutex> lock(mutex_);
+            entries_.erase(key);
+            throw;
+        }
+    }
+
+    // 股票列表的内容键（64位FNV-1a + 股票数），内容相同的列表得到同一个键，与列表对象的地址无关
+    static std::string universe_key(const std::vector<std::string>& stocks) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (const auto& stock : stocks) {
+            for (unsigned char c : stock) hash = (hash ^ c) * 1099511628211ULL;
+            hash = (hash ^ 0xffu) * 1099511628211ULL;  // 分隔符，避免{"ab","c"}与{"a","bc"}相同
+        }
+        return fmt::format("{:016x}:{}", hash, stocks.size());
+    }
+
+    size_t hits() const { return hits_.load(); }
+    size_t misses() const { return misses_.load(); }
+
+    void reset_stats() {
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+private:
+    struct Entry {
+        std::shared_future<std::shared_ptr<const void>> value;
+        std::type_index type;
+    };
+
+    mutable std::mutex mutex_;
+    bool active_ = false;
+    std::unordered_map<std::string, Entry> entries_;
+    std::atomic<size_t> hits_{0};
+    std::atomic<size_t> misses_{0};
+};
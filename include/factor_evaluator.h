@@ -0,0 +1,589 @@
+#pragma once
+
+#include "config.h"
+#include "cross_section.h"
+#include "columnar_file.h"
+#include <zlib.h>
+#include <filesystem>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <cmath>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include "spdlog/spdlog.h"
+#include "spdlog/fmt/bundled/format.h"
+
+namespace fs = std::filesystem;
+
+// 时间桶 × 股票的结果表（save_factor / 指标save_results写出的bar_index表）
+struct BarTable {
+    std::vector<std::string> stocks;    // 表头中的股票代码（列顺序）
+    FactorPanel panel;                  // bar_index行 × 股票列，缺失为NaN
+};
+
+// 单个因子的评估统计量（按时间桶累加，可跨日、跨线程合并）
+struct EvaluationStats {
+    // 均值/标准差的累加器
+    struct Moments {
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        int64_t count = 0;
+
+        void add(double value) {
+            if (!std::isfinite(value)) return;
+            sum += value;
+            sum_sq += value * value;
+            count++;
+        }
+        void merge(const Moments& other) {
+            sum += other.sum;
+            sum_sq += other.sum_sq;
+            count += other.count;
+        }
+        double mean() const { return count > 0 ? sum / count : std::numeric_limits<double>::quiet_NaN(); }
+        double stddev() const {
+            if (count < 2) return std::numeric_limits<double>::quiet_NaN();
+            double m = mean();
+            return std::sqrt(std::max(0.0, (sum_sq - count * m * m) / (count - 1)));
+        }
+        // 信息比率：均值 / 标准差
+        double ir() const {
+            double s = stddev();
+            return s > 0.0 ? mean() / s : std::numeric_limits<double>::quiet_NaN();
+        }
+    };
+
+    int days = 0;
+    std::vector<Moments> ic;              // 每个持有期的IC
+    std::vector<Moments> rank_ic;         // 每个持有期的rank IC
+    Moments autocorr;                     // 相邻时间桶因子值的截面秩相关
+    Moments turnover;                     // 最高分组成分的换手率
+    std::vector<Moments> quantile_returns;  // 各分组下一持有期（horizons[0]）平均收益
+    Moments long_short;                   // 最高组 - 最低组
+    Moments coverage;                     // 因子有效值占比
+
+    EvaluationStats() = default;
+    EvaluationStats(size_t horizon_count, int quantiles)
+        : ic(horizon_count), rank_ic(horizon_count), quantile_returns(std::max(quantiles, 0)) {}
+
+    void merge(const EvaluationStats& other) {
+        days += other.days;
+        if (ic.size() < other.ic.size()) ic.resize(other.ic.size());
+        if (rank_ic.size() < other.rank_ic.size()) rank_ic.resize(other.rank_ic.size());
+        if (quantile_returns.size() < other.quantile_returns.size()) quantile_returns.resize(other.quantile_returns.size());
+        for (size_t h = 0; h < other.ic.size(); ++h) ic[h].merge(other.ic[h]);
+        for (size_t h = 0; h < other.rank_ic.size(); ++h) rank_ic[h].merge(other.rank_ic[h]);
+        for (size_t q = 0; q < other.quantile_returns.size(); ++q) quantile_returns[q].merge(other.quantile_returns[q]);
+        autocorr.merge(other.autocorr);
+        turnover.merge(other.turnover);
+        long_short.merge(other.long_short);
+        coverage.merge(other.coverage);
+    }
+};
+
+// 因子评估器：读取因子结果和价格指标，按时间桶计算IC/rank IC（多持有期衰减）、自相关/换手率和分组收益
+// 远期收益由各时间桶最后价得到：ret[t, h] = price[t + h] / price[t] - 1（日内，不跨隔夜）
+// 日期间并行，单日内按因子并行；每个线程同一时间只持有一个价格面板和一个因子面板
+class FactorEvaluator {
+public:
+    static constexpr int kMinStocks = 10;   // 截面有效股票少于该数时不计入该时间桶
+
+    explicit FactorEvaluator(EvaluationConfig config) : config_(std::move(config)) {
+        if (config_.horizons.empty()) config_.horizons = {1};
+    }
+
+    const EvaluationConfig& config() const { return config_; }
+
+    // 评估日期范围内的所有因子，结果按因子名汇总
+    bool run(const std::string& default_date, std::map<std::string, EvaluationStats>& results) const {
+        std::vector<std::string> dates = list_dates(default_date);
+        if (dates.empty()) {
+            spdlog::error("FactorEvaluator: {}下没有可评估的日期", config_.factor_path);
+            return false;
+        }
+
+        int threads = config_.threads > 0 ? config_.threads : static_cast<int>(std::thread::hardware_concurrency());
+        threads = std::max(threads, 1);
+        int outer_threads = std::min(threads, static_cast<int>(dates.size()));
+        int inner_threads = std::max(1, threads / outer_threads);
+        spdlog::info("FactorEvaluator: {}个交易日，日期线程{}，因子线程{}", dates.size(), outer_threads, inner_threads);
+
+        std::mutex results_mutex;
+        std::atomic<size_t> next_date{0};
+        std::vector<std::thread> workers;
+        for (int w = 0; w < outer_threads; ++w) {
+            workers.emplace_back([&]() {
+                for (size_t d = next_date.fetch_add(1); d < dates.size(); d = next_date.fetch_add(1)) {
+                    std::map<std::string, EvaluationStats> day_results;
+                    evaluate_date(dates[d], inner_threads, day_results);
+                    std::lock_guard<std::mutex> lock(results_mutex);
+                    for (auto& [name, stats] : day_results) {
+                        auto it = results.find(name);
+                        if (it == results.end()) {
+                            results.emplace(name, std::move(stats));
+                        } else {
+                            it->second.merge(stats);
+                        }
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        return !results.empty();
+    }
+
+    // 评估一天的所有因子
+    bool evaluate_date(const std::string& date, int threads, std::map<std::string, EvaluationStats>& results) const {
+        BarTable prices;
+        if (!load_prices(date, prices)) return false;
+
+        // 各持有期远期收益，所有因子共用
+        std::vector<FactorPanel> forward(config_.horizons.size());
+        for (size_t h = 0; h < config_.horizons.size(); ++h) {
+            forward_returns(prices.panel, config_.horizons[h], forward[h]);
+        }
+        std::unordered_map<std::string, int> price_column;
+        for (size_t i = 0; i < prices.stocks.size(); ++i) price_column[prices.stocks[i]] = static_cast<int>(i);
+
+        std::vector<std::pair<std::string, fs::path>> factor_files = list_factor_files(date);
+        std::vector<EvaluationStats> day_stats(factor_files.size());
+        std::vector<char> ok(factor_files.size(), 0);
+        CrossSection::for_each_row(static_cast<int>(factor_files.size()), threads, [&](int f) {
+            BarTable table;
+            if (!read_bar_table(factor_files[f].second.string(), table)) {
+                spdlog::error("FactorEvaluator: 读取因子文件失败: {}", factor_files[f].second.string());
+                return;
+            }
+            FactorPanel aligned;
+            align_columns(table, price_column, static_cast<int>(prices.stocks.size()), prices.panel.buckets, aligned);
+            day_stats[f] = EvaluationStats(config_.horizons.size(), config_.quantiles);
+            evaluate_day(aligned, forward, day_stats[f]);
+            ok[f] = 1;
+        });
+
+        for (size_t f = 0; f < factor_files.size(); ++f) {
+            if (ok[f]) results[factor_files[f].first] = std::move(day_stats[f]);
+        }
+        spdlog::info("FactorEvaluator: {}完成{}/{}个因子", date, results.size(), factor_files.size());
+        return true;
+    }
+
+    // 单日评估核心：factor与forward各面板形状相同（时间桶 × 股票，列顺序一致）
+    // forward[h]为horizons[h]的远期收益；可直接用于进程内的因子结果（见panel_from_factor_data）
+    void evaluate_day(const FactorPanel& factor, const std::vector<FactorPanel>& forward, EvaluationStats& stats) const {
+        if (stats.ic.size() < forward.size()) stats = EvaluationStats(forward.size(), config_.quantiles);
+        stats.days++;
+        const int stocks = factor.stocks;
+        Workspace& ws = workspace(stocks);
+
+        std::vector<double>& previous_top = ws.previous_top;
+        std::fill(previous_top.begin(), previous_top.end(), 0.0);
+        bool has_previous_top = false;
+
+        for (int ti = 0; ti < factor.buckets; ++ti) {
+            const double* x = factor.row(ti);
+            int valid = 0;
+            for (int i = 0; i < stocks; ++i) valid += std::isfinite(x[i]) ? 1 : 0;
+            stats.coverage.add(stocks > 0 ? static_cast<double>(valid) / stocks : 0.0);
+
+            // IC / rank IC（各持有期）
+            for (size_t h = 0; h < forward.size() && ti < forward[h].buckets; ++h) {
+                int n = gather_pairs(x, forward[h].row(ti), stocks, ws.xs, ws.ys);
+                if (n < kMinStocks) continue;
+                stats.ic[h].add(pearson(ws.xs.data(), ws.ys.data(), n));
+                CrossSection::rank_row(ws.xs.data(), ws.x_rank.data(), n);
+                CrossSection::rank_row(ws.ys.data(), ws.y_rank.data(), n);
+                stats.rank_ic[h].add(pearson(ws.x_rank.data(), ws.y_rank.data(), n));
+
+                // 分组收益（第一个持有期）
+                if (h == 0) {
+                    int quantiles = static_cast<int>(stats.quantile_returns.size());
+                    CrossSection::quantile_bucket_row(ws.xs.data(), ws.x_rank.data(), n, quantiles);
+                    ws.group_sum.assign(quantiles, 0.0);
+                    ws.group_count.assign(quantiles, 0);
+                    for (int k = 0; k < n; ++k) {
+                        int q = static_cast<int>(ws.x_rank[k]);
+                        ws.group_sum[q] += ws.ys[k];
+                        ws.group_count[q]++;
+                    }
+                    for (int q = 0; q < quantiles; ++q) {
+                        if (ws.group_count[q] > 0) stats.quantile_returns[q].add(ws.group_sum[q] / ws.group_count[q]);
+                    }
+                    if (quantiles > 1 && ws.group_count[0] > 0 && ws.group_count[quantiles - 1] > 0) {
+                        stats.long_short.add(ws.group_sum[quantiles - 1] / ws.group_count[quantiles - 1] -
+                                             ws.group_sum[0] / ws.group_count[0]);
+                    }
+                }
+            }
+
+            if (valid < kMinStocks) {
+                has_previous_top = false;
+                continue;
+            }
+
+            // 自相关：与上一时间桶因子值的截面秩相关
+            if (ti > 0) {
+                int n = gather_pairs(factor.row(ti - 1), x, stocks, ws.xs, ws.ys);
+                if (n >= kMinStocks) {
+                    CrossSection::rank_row(ws.xs.data(), ws.x_rank.data(), n);
+                    CrossSection::rank_row(ws.ys.data(), ws.y_rank.data(), n);
+                    stats.autocorr.add(pearson(ws.x_rank.data(), ws.y_rank.data(), n));
+                }
+            }
+
+            // 换手率：最高分组成分相对上一时间桶的变化比例
+            int quantiles = static_cast<int>(stats.quantile_returns.size());
+            CrossSection::quantile_bucket_row(x, ws.buckets.data(), stocks, quantiles);
+            int top = 0, kept = 0;
+            for (int i = 0; i < stocks; ++i) {
+                bool in_top = ws.buckets[i] == quantiles - 1;
+                if (in_top) {
+                    top++;
+                    if (previous_top[i] > 0.0) kept++;
+                }
+                previous_top[i] = in_top ? 1.0 : 0.0;
+            }
+            if (has_previous_top && top > 0) stats.turnover.add(1.0 - static_cast<double>(kept) / top);
+            has_previous_top = top > 0;
+        }
+    }
+
+    // 远期收益：价格先在日内前向填充，ret[t] = p[t + h] / p[t] - 1，越过日末或价格无效时为NaN
+    static void forward_returns(const FactorPanel& prices, int horizon, FactorPanel& out) {
+        out.reshape(prices.buckets, prices.stocks);
+        std::vector<double> filled(prices.buckets);
+        for (int i = 0; i < prices.stocks; ++i) {
+            double last = std::numeric_limits<double>::quiet_NaN();
+            for (int ti = 0; ti < prices.buckets; ++ti) {
+                double p = prices.at(ti, i);
+                if (std::isfinite(p) && p > 0.0) last = p;
+                filled[ti] = last;
+            }
+            for (int ti = 0; ti < prices.buckets; ++ti) {
+                int target = ti + horizon;
+                out.at(ti, i) = (target < prices.buckets && filled[ti] > 0.0 && std::isfinite(filled[target]))
+                                ? filled[target] / filled[ti] - 1.0
+                                : std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+    }
+
+    // 进程内评估：把CalculationEngine::get_factor_data的结果按股票列表转成面板
+    static FactorPanel panel_from_factor_data(const std::map<int, std::unordered_map<std::string, double>>& data,
+                                              const std::vector<std::string>& stock_list, int buckets) {
+        FactorPanel panel(buckets, static_cast<int>(stock_list.size()));
+        for (const auto& [ti, values] : data) {
+            if (ti < 0 || ti >= buckets) continue;
+            for (size_t i = 0; i < stock_list.size(); ++i) {
+                auto it = values.find(stock_list[i]);
+                if (it != values.end()) panel.at(ti, static_cast<int>(i)) = it->second;
+            }
+        }
+        return panel;
+    }
+
+    // 读取评估频率的价格面板：优先读取该频率的价格文件；指标只保存了更细的基础频率时（如1min），
+    // 读取基础频率文件并按Last汇总到评估频率，与写入时的Last rollup结果相同
+    bool load_prices(const std::string& date, BarTable& prices) const {
+        Frequency target;
+        if (!parse_frequency(config_.frequency, target)) {
+            spdlog::error("FactorEvaluator: 未知的评估频率: {}", config_.frequency);
+            return false;
+        }
+        // 从评估频率开始依次尝试更细的频率
+        for (const char* source_name : {"30min", "5min", "1min", "15S"}) {
+            Frequency source;
+            parse_frequency(source_name, source);
+            // 评估频率第1个桶对应的源频率起始桶即一个评估桶包含的源桶数，为0表示源频率更粗
+            int ratio = get_time_bucket_range(1, source, target).first;
+            if (ratio == 0) continue;
+
+            fs::path price_file = price_file_path(date, source_name);
+            if (price_file.empty()) continue;
+            if (!read_bar_table(price_file.string(), prices)) {
+                spdlog::error("FactorEvaluator: 读取{}的价格失败: {}", date, price_file.string());
+                return false;
+            }
+            if (ratio > 1) {
+                FactorPanel rolled;
+                rollup_last(prices.panel, ratio, rolled);
+                prices.panel = std::move(rolled);
+                spdlog::info("FactorEvaluator: {}的价格由{}按Last汇总到{}", date, source_name, config_.frequency);
+            }
+            return true;
+        }
+        spdlog::error("FactorEvaluator: 读取{}的价格失败: {}下没有{}的{}文件", date,
+                      (fs::path(config_.price_path) / date).string(), config_.price_indicator, config_.price_field);
+        return false;
+    }
+
+    // 某频率的价格文件（列式优先），都不存在时返回空路径
+    fs::path price_file_path(const std::string& date, const std::string& frequency) const {
+        fs::path dir = fs::path(config_.price_path) / date / frequency;
+        std::string stem = fmt::format("{}_{}_{}_{}", config_.price_indicator, config_.price_field, date, frequency);
+        for (const std::string& extension : {std::string(ColumnarFile::kExtension), std::string(".csv.gz")}) {
+            fs::path file = dir / (stem + extension);
+            if (fs::exists(file)) return file;
+        }
+        return {};
+    }
+
+    // 每ratio个时间桶取最后一个有效值（全部缺失时为NaN）
+    static void rollup_last(const FactorPanel& source, int ratio, FactorPanel& out) {
+        out.reshape((source.buckets + ratio - 1) / ratio, source.stocks);
+        for (int tj = 0; tj < out.buckets; ++tj) {
+            double* dst = out.row(tj);
+            std::fill(dst, dst + out.stocks, std::numeric_limits<double>::quiet_NaN());
+            int end = std::min(source.buckets, (tj + 1) * ratio);
+            for (int ti = tj * ratio; ti < end; ++ti) {
+                const double* src = source.row(ti);
+                for (int i = 0; i < source.stocks; ++i) {
+                    if (std::isfinite(src[i])) dst[i] = src[i];
+                }
+            }
+        }
+    }
+
+    // 按扩展名读取结果表：.col为列式文件（mmap后按列拷入面板），其余按csv.gz解析
+    static bool read_bar_table(const std::string& file_path, BarTable& table) {
+        const std::string extension = ColumnarFile::kExtension;
+        if (file_path.size() < extension.size() ||
+            file_path.compare(file_path.size() - extension.size(), extension.size(), extension) != 0) {
+            return read_bar_table_gz(file_path, table);
+        }
+        ColumnarReader reader;
+        if (!reader.open(file_path)) return false;
+        table.stocks = reader.stocks();
+        table.panel = FactorPanel(reader.bucket_count(), reader.stock_count());
+        for (int i = 0; i < reader.stock_count(); ++i) {
+            GSeriesView column = reader.stock_view(i);
+            for (int ti = 0; ti < column.get_size(); ++ti) table.panel.at(ti, i) = column[ti];
+        }
+        return true;
+    }
+
+    // 读取bar_index表（首行为bar_index + 股票代码，其余每行一个时间桶，空值为NaN）
+    static bool read_bar_table_gz(const std::string& file_path, BarTable& table) {
+        gzFile gz_file = gzopen(file_path.c_str(), "rb");
+        if (!gz_file) return false;
+        std::string content;
+        char buffer[1 << 16];
+        int bytes = 0;
+        while ((bytes = gzread(gz_file, buffer, sizeof(buffer))) > 0) {
+            content.append(buffer, bytes);
+        }
+        gzclose(gz_file);
+        if (bytes < 0 || content.empty()) return false;
+
+        // 表头
+        size_t line_end = content.find('\n');
+        std::string header = content.substr(0, line_end);
+        if (!header.empty() && header.back() == '\r') header.pop_back();
+        table.stocks = split_list_attribute(header);
+        if (table.stocks.empty() || table.stocks.front() != "bar_index") return false;
+        table.stocks.erase(table.stocks.begin());
+        const int stocks = static_cast<int>(table.stocks.size());
+
+        // 数据行：先按行收集，再按最大bar_index建面板
+        std::vector<std::pair<int, size_t>> rows;   // bar_index, 行起始偏移
+        int max_bar = -1;
+        size_t pos = line_end == std::string::npos ? content.size() : line_end + 1;
+        while (pos < content.size()) {
+            size_t end = content.find('\n', pos);
+            if (end == std::string::npos) end = content.size();
+            if (end > pos) {
+                int bar = std::atoi(content.c_str() + pos);
+                if (bar >= 0) {
+                    rows.emplace_back(bar, pos);
+                    max_bar = std::max(max_bar, bar);
+                }
+            }
+            pos = end + 1;
+        }
+
+        table.panel = FactorPanel(max_bar + 1, stocks);
+        for (const auto& [bar, offset] : rows) {
+            const char* p = content.c_str() + offset;
+            while (*p && *p != ',' && *p != '\n') ++p;   // 跳过bar_index
+            double* out = table.panel.row(bar);
+            for (int i = 0; i < stocks && *p == ','; ++i) {
+                ++p;
+                if (*p == ',' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+                char* next = nullptr;
+                double value = std::strtod(p, &next);
+                if (next != p) {
+                    out[i] = value;
+                    p = next;
+                }
+                while (*p && *p != ',' && *p != '\n') ++p;
+            }
+        }
+        return true;
+    }
+
+    // 汇总报告（每个因子一行）
+    bool write_report(const std::map<std::string, EvaluationStats>& results, const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            spdlog::error("FactorEvaluator: 无法写入报告{}", path);
+            return false;
+        }
+        out << "factor,days,coverage";
+        for (int h : config_.horizons) {
+            out << fmt::format(",ic_h{0},icir_h{0},rank_ic_h{0},rank_icir_h{0}", h);
+        }
+        out << ",autocorr,turnover";
+        for (int q = 1; q <= config_.quantiles; ++q) out << ",q" << q << "_ret";
+        out << ",long_short,long_short_ir\n";
+
+        for (const auto& [name, stats] : results) {
+            out << name << "," << stats.days << "," << format_value(stats.coverage.mean());
+            for (size_t h = 0; h < config_.horizons.size(); ++h) {
+                const auto& ic = h < stats.ic.size() ? stats.ic[h] : EvaluationStats::Moments{};
+                const auto& ric = h < stats.rank_ic.size() ? stats.rank_ic[h] : EvaluationStats::Moments{};
+                out << "," << format_value(ic.mean()) << "," << format_value(ic.ir())
+                    << "," << format_value(ric.mean()) << "," << format_value(ric.ir());
+            }
+            out << "," << format_value(stats.autocorr.mean()) << "," << format_value(stats.turnover.mean());
+            for (int q = 0; q < config_.quantiles; ++q) {
+                double value = q < static_cast<int>(stats.quantile_returns.size())
+                               ? stats.quantile_returns[q].mean() : std::numeric_limits<double>::quiet_NaN();
+                out << "," << format_value(value);
+            }
+            out << "," << format_value(stats.long_short.mean()) << "," << format_value(stats.long_short.ir()) << "\n";
+        }
+        spdlog::info("FactorEvaluator: 报告已写入{}（{}个因子）", path, results.size());
+        return true;
+    }
+
+private:
+    // 每个线程复用的工作区
+    struct Workspace {
+        std::vector<double> xs, ys, x_rank, y_rank, buckets, previous_top, group_sum;
+        std::vector<int> group_count;
+    };
+
+    static Workspace& workspace(int stocks) {
+        thread_local Workspace ws;
+        size_t n = static_cast<size_t>(std::max(stocks, 0));
+        if (ws.xs.size() < n) {
+            ws.xs.resize(n);
+            ws.ys.resize(n);
+            ws.x_rank.resize(n);
+            ws.y_rank.resize(n);
+            ws.buckets.resize(n);
+        }
+        ws.previous_top.resize(n);
+        return ws;
+    }
+
+    // 收集两行都有效的股票，返回对数
+    static int gather_pairs(const double* x, const double* y, int stocks, std::vector<double>& xs, std::vector<double>& ys) {
+        int n = 0;
+        for (int i = 0; i < stocks; ++i) {
+            if (std::isfinite(x[i]) && std::isfinite(y[i])) {
+                xs[n] = x[i];
+                ys[n] = y[i];
+                n++;
+            }
+        }
+        return n;
+    }
+
+    static double pearson(const double* x, const double* y, int n) {
+        double mean_x = 0.0, mean_y = 0.0;
+        for (int i = 0; i < n; ++i) {
+            mean_x += x[i];
+            mean_y += y[i];
+        }
+        mean_x /= n;
+        mean_y /= n;
+        double sxy = 0.0, sxx = 0.0, syy = 0.0;
+        for (int i = 0; i < n; ++i) {
+            double dx = x[i] - mean_x;
+            double dy = y[i] - mean_y;
+            sxy += dx * dy;
+            sxx += dx * dx;
+            syy += dy * dy;
+        }
+        return (sxx > 0.0 && syy > 0.0) ? sxy / std::sqrt(sxx * syy) : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    static std::string format_value(double value) {
+        return std::isfinite(value) ? fmt::format("{:.6f}", value) : "";
+    }
+
+    // 把因子表的列按价格表的股票顺序重排，价格表中没有的股票丢弃
+    static void align_columns(const BarTable& table, const std::unordered_map<std::string, int>& price_column,
+                              int stocks, int buckets, FactorPanel& aligned) {
+        aligned = FactorPanel(buckets, stocks);
+        std::vector<std::pair<int, int>> mapping;   // 因子列 -> 价格列
+        for (size_t c = 0; c < table.stocks.size(); ++c) {
+            auto it = price_column.find(table.stocks[c]);
+            if (it != price_column.end()) mapping.emplace_back(static_cast<int>(c), it->second);
+        }
+        int rows = std::min(buckets, table.panel.buckets);
+        for (int ti = 0; ti < rows; ++ti) {
+            const double* src = table.panel.row(ti);
+            double* dst = aligned.row(ti);
+            for (const auto& [from, to] : mapping) dst[to] = src[from];
+        }
+    }
+
+    // 日期：factor_path下名为YYYYMMDD且在[start_date, end_date]内的子目录；未配置范围时只评估default_date
+    std::vector<std::string> list_dates(const std::string& default_date) const {
+        std::vector<std::string> dates;
+        if (config_.start_date.empty()) {
+            std::string date = default_date.substr(0, 8);
+            if (fs::exists(fs::path(config_.factor_path) / date)) dates.push_back(date);
+            return dates;
+        }
+        std::string end_date = config_.end_date.empty() ? config_.start_date : config_.end_date;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(config_.factor_path, ec)) {
+            if (!entry.is_directory()) continue;
+            std::string name = entry.path().filename().string();
+            bool is_date = name.size() == 8 && std::all_of(name.begin(), name.end(), ::isdigit);
+            if (is_date && name >= config_.start_date && name <= end_date) dates.push_back(name);
+        }
+        if (ec) spdlog::error("FactorEvaluator: 无法遍历{}: {}", config_.factor_path, ec.message());
+        std::sort(dates.begin(), dates.end());
+        return dates;
+    }
+
+    // 某日的因子文件：{factor_path}/{date}/{frequency}/{name}_{date}_{frequency}.col或.csv.gz
+    // 同一因子两种格式都存在时使用列式文件
+    std::vector<std::pair<std::string, fs::path>> list_factor_files(const std::string& date) const {
+        std::map<std::string, fs::path> found;
+        fs::path dir = fs::path(config_.factor_path) / date / config_.frequency;
+        const std::string suffixes[] = {fmt::format("_{}_{}{}", date, config_.frequency, ColumnarFile::kExtension),
+                                        fmt::format("_{}_{}.csv.gz", date, config_.frequency)};
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            std::string filename = entry.path().filename().string();
+            for (const auto& suffix : suffixes) {
+                if (filename.size() <= suffix.size() || filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) != 0) {
+                    continue;
+                }
+                std::string name = filename.substr(0, filename.size() - suffix.size());
+                if (!config_.factors.empty() &&
+                    std::find(config_.factors.begin(), config_.factors.end(), name) == config_.factors.end()) {
+                    break;
+                }
+                auto it = found.find(name);
+                if (it == found.end() || &suffix == &suffixes[0]) found[name] = entry.path();
+                break;
+            }
+        }
+        return std::vector<std::pair<std::string, fs::path>>(found.begin(), found.end());
+    }
+
+    EvaluationConfig config_;
+};
@@ -0,0 +1,640 @@
+#pragma once
+
+#include "cross_section.h"
+#include "rolling.h"
+#include "factor_utils.h"
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include "spdlog/spdlog.h"
+
+// 表达式节点的算子
+enum class ExprOp {
+    Input,          // 指标字段（叶子）
+    Constant,       // 常数
+    // 逐元素一元
+    Neg, Abs, Log, Sqrt, Sign,
+    // 逐元素二元
+    Add, Sub, Mul, Div, Pow, Max, Min,
+    // 时间序列（逐股票，沿时间桶方向）
+    TsSum, TsMean, TsStd, TsMax, TsMin, Delay, Delta, PctChange,
+    // 截面（逐时间桶）
+    Rank, ZScore
+};
+
+// 执行计划中的一个节点，节点按创建顺序即为拓扑序（参数总在使用者之前创建）
+struct ExprNode {
+    ExprOp op = ExprOp::Constant;
+    std::vector<int> args;                  // 参数节点下标
+    double value = std::numeric_limits<double>::quiet_NaN();   // Constant的值
+    int window = 0;                         // 时间序列算子的窗口或期数
+    int min_periods = 1;                    // 滚动统计所需的最少有效值个数
+    std::string indicator;                  // Input：指标模块名
+    std::string field;                      // Input：字段名，为空表示指标的单一输出（序列名即指标名）
+
+    // 在BarSeriesHolder中的序列名
+    const std::string& series_key() const { return field.empty() ? indicator : field; }
+};
+
+// 因子表达式的执行计划：config.xml中同一频率的表达式因子编译进同一个DAG（叶子按该频率加载），
+// 相同的子表达式（算子、参数和输入都相同）只建一个节点，整个计划每个时间事件只求值一次
+//
+// 语法：
+//   叶子    指标名.字段（如diff_volume_amount.amount），单一输出的指标可只写指标名（如vwap）
+//   运算    + - * / 一元负号 括号 数字常数
+//   逐元素  abs(x) log(x) sqrt(x) sign(x) pow(x, y) max(x, y) min(x, y)
+//   时间序列 ts_sum(x, n[, min_periods]) ts_mean(x, n[, min_periods]) ts_std(x, n[, min_periods])
+//           ts_max(x, n) ts_min(x, n) delay(x, n) delta(x, n) pct_change(x, n)
+//   截面    rank(x)（百分比排名，0~1） zscore(x)
+// 时间序列算子的窗口单位是因子的时间桶，只使用当日数据
+//
+// 每个节点的值是 时间桶 × 股票 的FactorPanel：逐元素算子对整块连续内存运算，
+// 时间序列算子逐股票调用Rolling/FactorUtils，截面算子逐时间桶调用CrossSection；
+// 逐时间事件求值时各节点面板跨事件保留，每次只计算上次之后新增的行（以及上次可能未收盘的最后一行），
+// 时间序列算子只回看窗口长度的尾部；整日回填一次算完，中间结果在最后一个使用者算完后归还到内存池
+class ExpressionPlan {
+public:
+    // 叶子加载：把input指向的指标字段的[first_row, out.buckets)行写入out（out已按 时间桶数 × 股票数 分配）
+    using InputLoader = std::function<void(const ExprNode& input, FactorPanel& out, int first_row)>;
+
+    // 编译一个表达式因子并加入计划，返回根下标；语法错误时记录日志并返回-1，计划不变
+    int add_root(const std::string& name, const std::string& expression) {
+        Parser parser(*this, expression);
+        int node = parser.parse();
+        if (node < 0) {
+            spdlog::error("表达式因子[{}]解析失败: {}（位置{}）: {}", name, parser.error(), parser.position(), expression);
+            nodes_.resize(parser.node_mark());
+            rebuild_index();
+            return -1;
+        }
+        roots_.push_back({name, node});
+        prepared_ = false;
+        spdlog::info("表达式因子[{}]已编译: 计划共{}个节点（解析出{}个，其中{}个复用已有节点）",
+                     name, nodes_.size(), parser.visited(), parser.reused());
+        return static_cast<int>(roots_.size()) - 1;
+    }
+
+    const std::vector<ExprNode>& nodes() const { return nodes_; }
+    size_t root_count() const { return roots_.size(); }
+    const std::string& root_name(int root) const { return roots_[root].name; }
+
+    // 根节点可达的叶子（去重）
+    std::vector<const ExprNode*> inputs_of(int root) const {
+        std::vector<char> seen(nodes_.size(), 0);
+        std::vector<const ExprNode*> inputs;
+        std::vector<int> stack{roots_[root].node};
+        while (!stack.empty()) {
+            int id = stack.back();
+            stack.pop_back();
+            if (seen[id]) continue;
+            seen[id] = 1;
+            if (nodes_[id].op == ExprOp::Input) inputs.push_back(&nodes_[id]);
+            for (int arg : nodes_[id].args) stack.push_back(arg);
+        }
+        return inputs;
+    }
+
+    // 根节点在第ti个时间桶的截面（只加载和计算[0, ti]的时间桶）
+    // 同一轮时间事件中第一个请求的因子求值整个计划，其余因子直接取各自根节点的结果；
+    // 某个根在本轮已取过结果时视为进入下一轮事件（指标可能已更新），重新求值。
+    // 上次已求值的行中只有最后一行可能在实时模式下仍在写入，其余行沿用上次结果
+    GSeries section(int root, int ti, int stocks, const InputLoader& load, int threads = 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refresh(root, ti + 1, stocks, load, threads);
+        return values_[roots_[root].node].section(ti);
+    }
+
+    // 根节点整日的截面列表（下标为时间桶），用于整日回填
+    std::vector<GSeries> full_day(int root, int bar_count, int stocks, const InputLoader& load, int threads = 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<GSeries> sections(std::max(bar_count, 0));
+        if (bar_count <= 0) return sections;
+        evaluate(bar_count, stocks, load, threads);
+        const FactorPanel& panel = values_[roots_[root].node];
+        for (int ti = 0; ti < bar_count; ++ti) sections[ti] = panel.section(ti);
+        return sections;
+    }
+
+    // 从头求值整个计划（rows个时间桶 × stocks只股票），结果保留在各根节点的面板中；
+    // 中间结果用完即归还内存池，之后的section从第0行重新求值
+    void evaluate(int rows, int stocks, const InputLoader& load, int threads = 1) {
+        evaluate_rows(0, rows, stocks, load, threads, true);
+        cached_rows_ = -1;
+    }
+
+    // 新的交易日：已求值的行全部作废
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cached_rows_ = -1;
+    }
+
+    const FactorPanel& root_value(int root) const { return values_[roots_[root].node]; }
+
+private:
+    static constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+    struct Root {
+        std::string name;
+        int node;
+    };
+
+    struct FunctionSpec {
+        const char* name;
+        ExprOp op;
+        int min_args;
+        int max_args;
+    };
+
+    static const FunctionSpec* find_function(const std::string& name) {
+        static const FunctionSpec kFunctions[] = {
+            {"abs", ExprOp::Abs, 1, 1},           {"log", ExprOp::Log, 1, 1},
+            {"sqrt", ExprOp::Sqrt, 1, 1},         {"sign", ExprOp::Sign, 1, 1},
+            {"pow", ExprOp::Pow, 2, 2},           {"max", ExprOp::Max, 2, 2},
+            {"min", ExprOp::Min, 2, 2},
+            {"ts_sum", ExprOp::TsSum, 2, 3},      {"ts_mean", ExprOp::TsMean, 2, 3},
+            {"ts_std", ExprOp::TsStd, 2, 3},      {"ts_max", ExprOp::TsMax, 2, 2},
+            {"ts_min", ExprOp::TsMin, 2, 2},      {"delay", ExprOp::Delay, 2, 2},
+            {"delta", ExprOp::Delta, 2, 2},       {"pct_change", ExprOp::PctChange, 2, 2},
+            {"rank", ExprOp::Rank, 1, 1},         {"zscore", ExprOp::ZScore, 1, 1},
+        };
+        for (const auto& spec : kFunctions) {
+            if (name == spec.name) return &spec;
+        }
+        return nullptr;
+    }
+
+    static bool is_time_series(ExprOp op) { return op >= ExprOp::TsSum && op <= ExprOp::PctChange; }
+    static bool is_elementwise(ExprOp op) { return op >= ExprOp::Neg && op <= ExprOp::Min; }
+    static bool is_commutative(ExprOp op) {
+        return op == ExprOp::Add || op == ExprOp::Mul || op == ExprOp::Max || op == ExprOp::Min;
+    }
+
+    // 逐元素算子的标量语义（常量折叠和向量化内核共用）
+    static double apply(ExprOp op, double a, double b) {
+        switch (op) {
+            case ExprOp::Neg: return -a;
+            case ExprOp::Abs: return std::fabs(a);
+            case ExprOp::Log: return a > 0.0 ? std::log(a) : kNaN;
+            case ExprOp::Sqrt: return a >= 0.0 ? std::sqrt(a) : kNaN;
+            case ExprOp::Sign: return std::isnan(a) ? kNaN : static_cast<double>((a > 0.0) - (a < 0.0));
+            case ExprOp::Add: return a + b;
+            case ExprOp::Sub: return a - b;
+            case ExprOp::Mul: return a * b;
+            case ExprOp::Div: return b != 0.0 ? a / b : kNaN;
+            case ExprOp::Pow: return std::pow(a, b);
+            case ExprOp::Max: return (std::isnan(a) || std::isnan(b)) ? kNaN : std::max(a, b);
+            case ExprOp::Min: return (std::isnan(a) || std::isnan(b)) ? kNaN : std::min(a, b);
+            default: return kNaN;
+        }
+    }
+
+    // 加入节点：相同的节点只保留一个（公共子表达式消除），逐元素算子的参数全为常数时直接折叠
+    int intern(ExprNode node, bool& reused) {
+        if (is_elementwise(node.op)) {
+            bool all_constant = true;
+            for (int arg : node.args) all_constant = all_constant && nodes_[arg].op == ExprOp::Constant;
+            if (all_constant) {
+                double a = nodes_[node.args[0]].value;
+                double b = node.args.size() > 1 ? nodes_[node.args[1]].value : kNaN;
+                ExprNode folded;
+                folded.value = apply(node.op, a, b);
+                return intern(std::move(folded), reused);
+            }
+        }
+        if (is_commutative(node.op)) std::sort(node.args.begin(), node.args.end());
+
+        std::string key = node_key(node);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            reused = true;
+            return it->second;
+        }
+        reused = false;
+        nodes_.push_back(std::move(node));
+        int id = static_cast<int>(nodes_.size()) - 1;
+        index_.emplace(std::move(key), id);
+        return id;
+    }
+
+    static std::string node_key(const ExprNode& node) {
+        std::string key = fmt::format("{}|{}|{}|", static_cast<int>(node.op), node.window, node.min_periods);
+        switch (node.op) {
+            case ExprOp::Constant: key += fmt::format("{}", node.value); break;
+            case ExprOp::Input: key += node.indicator + "." + node.field; break;
+            default:
+                for (int arg : node.args) key += fmt::format("{},", arg);
+                break;
+        }
+        return key;
+    }
+
+    void rebuild_index() {
+        index_.clear();
+        for (size_t id = 0; id < nodes_.size(); ++id) index_.emplace(node_key(nodes_[id]), static_cast<int>(id));
+    }
+
+    // 计划变化后重新计算：根可达的节点、每个节点的使用次数，以及需要展开成面板的常数
+    // （逐元素算子直接广播常数，根节点和时间序列/截面算子的参数才需要面板）
+    void prepare() {
+        if (prepared_) return;
+        size_t n = nodes_.size();
+        live_.assign(n, 0);
+        is_root_.assign(n, 0);
+        materialize_.assign(n, 0);
+        uses_.assign(n, 0);
+        values_.resize(n);
+        for (const auto& root : roots_) {
+            live_[root.node] = 1;
+            is_root_[root.node] = 1;
+            materialize_[root.node] = 1;
+        }
+        for (size_t id = n; id-- > 0;) {
+            if (!live_[id]) continue;
+            for (int arg : nodes_[id].args) {
+                live_[arg] = 1;
+                ++uses_[arg];
+                if (!is_elementwise(nodes_[id].op)) materialize_[arg] = 1;
+            }
+        }
+        served_.assign(roots_.size(), 0);
+        cached_rows_ = -1;
+        prepared_ = true;
+    }
+
+    void refresh(int root, int rows, int stocks, const InputLoader& load, int threads) {
+        prepare();
+        if (rows != cached_rows_ || stocks != cached_stocks_ || served_[root]) {
+            // 行数不减且股票不变时，上次求值的最后一行之前都已收盘；否则（新的一天、股票变化）从头算
+            bool extend = cached_rows_ > 0 && stocks == cached_stocks_ && rows >= cached_rows_;
+            evaluate_rows(extend ? cached_rows_ - 1 : 0, rows, stocks, load, threads, false);
+            cached_rows_ = rows;
+            cached_stocks_ = stocks;
+            std::fill(served_.begin(), served_.end(), 0);
+        }
+        served_[root] = 1;
+    }
+
+    // 计算各节点[first_row, rows)行；first_row之前的行沿用面板中已有的结果
+    // release为true时中间结果在最后一个使用者算完后归还内存池（之后不能再增量求值）
+    void evaluate_rows(int first_row, int rows, int stocks, const InputLoader& load, int threads, bool release) {
+        prepare();
+        std::vector<int> remaining = uses_;
+        for (size_t id = 0; id < nodes_.size(); ++id) {
+            if (!live_[id] || (nodes_[id].op == ExprOp::Constant && !materialize_[id])) continue;
+            const ExprNode& node = nodes_[id];
+
+            FactorPanel& out = values_[id];
+            if (out.values.empty() && !pool_.empty()) {
+                out = std::move(pool_.back());
+                pool_.pop_back();
+            }
+            grow(out, rows, stocks);
+            compute(node, out, first_row, load, threads);
+
+            if (!release) continue;
+            for (int arg : node.args) {
+                if (--remaining[arg] == 0 && !is_root_[arg] && !values_[arg].values.empty()) {
+                    pool_.push_back(std::move(values_[arg]));
+                    values_[arg] = FactorPanel();
+                }
+            }
+        }
+    }
+
+    // 面板按行存放，股票数不变时改变行数保留已有的行
+    static void grow(FactorPanel& panel, int rows, int stocks) {
+        if (panel.stocks != stocks) {
+            panel.reshape(rows, stocks);
+            return;
+        }
+        panel.buckets = rows;
+        panel.values.resize(static_cast<size_t>(std::max(rows, 0)) * std::max(stocks, 0), kNaN);
+    }
+
+    // 参数值：常数按步长0广播
+    struct Operand {
+        const double* data;
+        size_t step;
+    };
+
+    Operand operand(int arg, size_t offset) const {
+        if (nodes_[arg].op == ExprOp::Constant) return {&nodes_[arg].value, 0};
+        return {values_[arg].values.data() + offset, 1};
+    }
+
+    template <typename Fn>
+    static void map_binary(Operand a, Operand b, double* out, size_t n, Fn fn) {
+        for (size_t i = 0; i < n; ++i) out[i] = fn(a.data[i * a.step], b.data[i * b.step]);
+    }
+
+    template <typename Fn>
+    static void map_unary(Operand a, double* out, size_t n, Fn fn) {
+        for (size_t i = 0; i < n; ++i) out[i] = fn(a.data[i * a.step]);
+    }
+
+    // 计算out的[first_row, out.buckets)行
+    void compute(const ExprNode& node, FactorPanel& out, int first_row, const InputLoader& load, int threads) {
+        size_t offset = static_cast<size_t>(first_row) * out.stocks;
+        size_t n = out.values.size() - offset;
+        double* dst = out.values.data() + offset;
+        switch (node.op) {
+            case ExprOp::Constant:
+                std::fill(dst, dst + n, node.value);
+                return;
+            case ExprOp::Input:
+                std::fill(dst, dst + n, kNaN);
+                load(node, out, first_row);
+                return;
+            case ExprOp::Neg: map_unary(operand(node.args[0], offset), dst, n, [](double a) { return -a; }); return;
+            case ExprOp::Abs:
+                map_unary(operand(node.args[0], offset), dst, n, [](double a) { return std::fabs(a); });
+                return;
+            case ExprOp::Log:
+            case ExprOp::Sqrt:
+            case ExprOp::Sign: {
+                ExprOp op = node.op;
+                map_unary(operand(node.args[0], offset), dst, n, [op](double a) { return apply(op, a, kNaN); });
+                return;
+            }
+            case ExprOp::Add:
+                map_binary(operand(node.args[0], offset), operand(node.args[1], offset), dst, n,
+                           [](double a, double b) { return a + b; });
+                return;
+            case ExprOp::Sub:
+                map_binary(operand(node.args[0], offset), operand(node.args[1], offset), dst, n,
+                           [](double a, double b) { return a - b; });
+                return;
+            case ExprOp::Mul:
+                map_binary(operand(node.args[0], offset), operand(node.args[1], offset), dst, n,
+                           [](double a, double b) { return a * b; });
+                return;
+            case ExprOp::Div:
+                map_binary(operand(node.args[0], offset), operand(node.args[1], offset), dst, n,
+                           [](double a, double b) { return b != 0.0 ? a / b : kNaN; });
+                return;
+            case ExprOp::Pow:
+            case ExprOp::Max:
+            case ExprOp::Min: {
+                ExprOp op = node.op;
+                map_binary(operand(node.args[0], offset), operand(node.args[1], offset), dst, n,
+                           [op](double a, double b) { return apply(op, a, b); });
+                return;
+            }
+            case ExprOp::Rank: {
+                const FactorPanel& in = values_[node.args[0]];
+                CrossSection::for_each_row(out.buckets - first_row, threads, [&](int k) {
+                    int ti = first_row + k;
+                    CrossSection::rank_row(in.row(ti), out.row(ti), in.stocks, true, true, RankTies::Average);
+                });
+                return;
+            }
+            case ExprOp::ZScore: {
+                const FactorPanel& in = values_[node.args[0]];
+                CrossSection::for_each_row(out.buckets - first_row, threads, [&](int k) {
+                    int ti = first_row + k;
+                    CrossSection::z_score_row(in.row(ti), out.row(ti), in.stocks);
+                });
+                return;
+            }
+            default:
+                compute_time_series(node, values_[node.args[0]], out, first_row, threads);
+                return;
+        }
+    }
+
+    // 时间序列算子：逐股票取出时间桶方向的序列，调用Rolling/FactorUtils后写回[first_row, rows)行；
+    // 滚动窗口和delay/delta/pct_change的期数都不超过window，只需回看first_row之前window行
+    static void compute_time_series(const ExprNode& node, const FactorPanel& in, FactorPanel& out,
+                                    int first_row, int threads) {
+        const int begin = std::max(0, first_row - node.window);
+        const int rows = in.buckets - begin;
+        CrossSection::for_each_row(in.stocks, threads, [&](int i) {
+            thread_local std::vector<double> column;
+            column.resize(rows);
+            for (int ti = 0; ti < rows; ++ti) column[ti] = in.at(begin + ti, i);
+
+            std::vector<double> result;
+            switch (node.op) {
+                case ExprOp::TsSum: result = Rolling::rolling_sum(column, node.window, node.min_periods); break;
+                case ExprOp::TsMean: result = Rolling::rolling_mean(column, node.window, node.min_periods); break;
+                case ExprOp::TsStd: result = Rolling::rolling_std(column, node.window, node.min_periods); break;
+                case ExprOp::TsMax: result = Rolling::rolling_max(column, node.window); break;
+                case ExprOp::TsMin: result = Rolling::rolling_min(column, node.window); break;
+                case ExprOp::Delta: result = FactorUtils::diff(column, node.window); break;
+                case ExprOp::PctChange: result = FactorUtils::pct_change(column, node.window); break;
+                case ExprOp::Delay:
+                    result.assign(rows, kNaN);
+                    for (int ti = node.window; ti < rows; ++ti) result[ti] = column[ti - node.window];
+                    break;
+                default:
+                    result.assign(rows, kNaN);
+                    break;
+            }
+            for (int ti = first_row - begin; ti < rows; ++ti) out.at(begin + ti, i) = result[ti];
+        });
+    }
+
+    // 递归下降解析，边解析边加入计划
+    class Parser {
+    public:
+        Parser(ExpressionPlan& plan, const std::string& text)
+            : plan_(plan), text_(text), node_mark_(plan.nodes_.size()) {}
+
+        int parse() {
+            int node = parse_sum();
+            skip_space();
+            if (node >= 0 && pos_ < text_.size()) return fail("表达式末尾有多余字符");
+            return node;
+        }
+
+        const std::string& error() const { return error_; }
+        size_t position() const { return pos_; }
+        size_t node_mark() const { return node_mark_; }
+        int visited() const { return visited_; }
+        int reused() const { return reused_; }
+
+    private:
+        ExpressionPlan& plan_;
+        const std::string& text_;
+        size_t pos_ = 0;
+        size_t node_mark_;
+        std::string error_;
+        int visited_ = 0;
+        int reused_ = 0;
+
+        int fail(const std::string& message) {
+            if (error_.empty()) error_ = message;
+            return -1;
+        }
+
+        void skip_space() {
+            while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+        }
+
+        bool accept(char c) {
+            skip_space();
+            if (pos_ < text_.size() && text_[pos_] == c) {
+                ++pos_;
+                return true;
+            }
+            return false;
+        }
+
+        int add(ExprNode node) {
+            bool reused = false;
+            int id = plan_.intern(std::move(node), reused);
+            ++visited_;
+            if (reused) ++reused_;
+            return id;
+        }
+
+        int binary(ExprOp op, int lhs, int rhs) {
+            if (lhs < 0 || rhs < 0) return -1;
+            ExprNode node;
+            node.op = op;
+            node.args = {lhs, rhs};
+            return add(std::move(node));
+        }
+
+        int parse_sum() {
+            int lhs = parse_product();
+            while (lhs >= 0) {
+                if (accept('+')) lhs = binary(ExprOp::Add, lhs, parse_product());
+                else if (accept('-')) lhs = binary(ExprOp::Sub, lhs, parse_product());
+                else break;
+            }
+            return lhs;
+        }
+
+        int parse_product() {
+            int lhs = parse_unary();
+            while (lhs >= 0) {
+                if (accept('*')) lhs = binary(ExprOp::Mul, lhs, parse_unary());
+                else if (accept('/')) lhs = binary(ExprOp::Div, lhs, parse_unary());
+                else break;
+            }
+            return lhs;
+        }
+
+        int parse_unary() {
+            if (accept('-')) {
+                int operand = parse_unary();
+                if (operand < 0) return -1;
+                ExprNode node;
+                node.op = ExprOp::Neg;
+                node.args = {operand};
+                return add(std::move(node));
+            }
+            if (accept('+')) return parse_unary();
+            return parse_primary();
+        }
+
+        std::string parse_identifier() {
+            size_t start = pos_;
+            while (pos_ < text_.size() &&
+                   (std::isalnum(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_')) {
+                ++pos_;
+            }
+            return text_.substr(start, pos_ - start);
+        }
+
+        int parse_primary() {
+            skip_space();
+            if (pos_ >= text_.size()) return fail("表达式不完整");
+            char c = text_[pos_];
+            if (accept('(')) {
+                int inner = parse_sum();
+                if (inner >= 0 && !accept(')')) return fail("缺少右括号");
+                return inner;
+            }
+            if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+                const char* begin = text_.c_str() + pos_;
+                char* end = nullptr;
+                double value = std::strtod(begin, &end);
+                if (end == begin) return fail("无效的数字");
+                pos_ += static_cast<size_t>(end - begin);
+                ExprNode node;
+                node.value = value;
+                return add(std::move(node));
+            }
+            if (!std::isalpha(static_cast<unsigned char>(c)) && c != '_') return fail(fmt::format("无法识别的字符'{}'", c));
+
+            std::string name = parse_identifier();
+            if (accept('(')) return parse_call(name);
+
+            ExprNode node;
+            node.op = ExprOp::Input;
+            node.indicator = name;
+            if (accept('.')) {
+                skip_space();
+                node.field = parse_identifier();
+                if (node.field.empty()) return fail(fmt::format("指标{}后缺少字段名", name));
+            }
+            return add(std::move(node));
+        }
+
+        int parse_call(const std::string& name) {
+            const FunctionSpec* spec = find_function(name);
+            if (!spec) return fail(fmt::format("未知的函数{}", name));
+
+            std::vector<int> args;
+            if (!accept(')')) {
+                do {
+                    int arg = parse_sum();
+                    if (arg < 0) return -1;
+                    args.push_back(arg);
+                } while (accept(','));
+                if (!accept(')')) return fail(fmt::format("函数{}缺少右括号", name));
+            }
+            if (static_cast<int>(args.size()) < spec->min_args || static_cast<int>(args.size()) > spec->max_args) {
+                std::string expected = spec->min_args == spec->max_args
+                                           ? std::to_string(spec->min_args)
+                                           : fmt::format("{}~{}", spec->min_args, spec->max_args);
+                return fail(fmt::format("函数{}的参数个数为{}，应为{}个", name, args.size(), expected));
+            }
+
+            ExprNode node;
+            node.op = spec->op;
+            if (is_time_series(spec->op)) {
+                // 窗口和min_periods必须是正整数常数
+                int params[2] = {0, 1};
+                for (size_t k = 1; k < args.size(); ++k) {
+                    const ExprNode& param = plan_.nodes_[args[k]];
+                    if (param.op != ExprOp::Constant || param.value < 1 || param.value != std::floor(param.value)) {
+                        return fail(fmt::format("函数{}的第{}个参数必须是正整数常数", name, k + 1));
+                    }
+                    params[k - 1] = static_cast<int>(param.value);
+                }
+                node.window = params[0];
+                node.min_periods = std::min(params[1], node.window);
+                node.args = {args[0]};
+            } else {
+                node.args = std::move(args);
+            }
+            return add(std::move(node));
+        }
+    };
+
+    std::vector<ExprNode> nodes_;
+    std::unordered_map<std::string, int> index_;    // 节点键 -> 节点下标（公共子表达式消除）
+    std::vector<Root> roots_;
+
+    // 求值状态（由mutex_保护）
+    std::mutex mutex_;
+    bool prepared_ = false;
+    std::vector<char> live_;
+    std::vector<char> is_root_;
+    std::vector<char> materialize_;
+    std::vector<int> uses_;
+    std::vector<FactorPanel> values_;
+    std::vector<FactorPanel> pool_;
+    std::vector<char> served_;
+    int cached_rows_ = -1;
+    int cached_stocks_ = -1;
+};
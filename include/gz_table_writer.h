@@ -0,0 +1,175 @@
+#pragma once
+
+#include "data_structures.h"
+#include "cross_section.h"
+#include <string>
+#include <vector>
+#include <charconv>
+#include <cstdio>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <zlib.h>
+#include <unistd.h>
+#include "spdlog/spdlog.h"
+
+// bar_index宽表（首行bar_index + 股票代码，之后每行一个时间桶）的并行gzip写出器
+//
+// 行按块切分，每块在工作线程中用std::to_chars格式化到预分配的缓冲区，再独立压缩为一个gzip成员，
+// 最后按顺序拼接写出。多成员gzip是标准格式，gzip -d、zcat和zlib的gzread/gzgets都能连续读出
+// 单元格与原先逐行 fmt::format(",{:.6f}") 的输出逐字节一致，NaN和超出列长度的单元格留空
+class GzTableWriter {
+public:
+    // 每块未压缩数据的目标大小；块越大压缩率越接近单流，越小并行度越高
+    static constexpr size_t kChunkBytes = 1 << 20;
+
+    // 未显式指定线程数时使用的线程数（0表示CPU核心数），save_all_results并行保存多个模块时按模块数下调
+    static void set_default_threads(int threads) { default_threads_ref() = std::max(0, threads); }
+
+    static int default_threads() {
+        int threads = default_threads_ref().load();
+        if (threads > 0) return threads;
+        unsigned hw = std::thread::hardware_concurrency();
+        return hw == 0 ? 4 : static_cast<int>(hw);
+    }
+
+    // columns[i]为stocks[i]的序列（下标=时间桶），写出rows行（bar_index 0..rows-1）
+    static bool write(const std::string& file_path, const std::vector<std::string>& stocks,
+                      const std::vector<GSeriesView>& columns, int rows, int threads = 0) {
+        if (stocks.size() != columns.size()) {
+            spdlog::error("GzTableWriter: 股票数{}与列数{}不一致: {}", stocks.size(), columns.size(), file_path);
+            return false;
+        }
+        rows = std::max(rows, 0);
+        if (threads <= 0) threads = default_threads();
+
+        // 每行约 bar_index + 每列(逗号 + 约12个字符)，据此决定每块的行数
+        const size_t row_bytes_estimate = 8 + columns.size() * 13;
+        const int rows_per_chunk = static_cast<int>(std::max<size_t>(1, kChunkBytes / row_bytes_estimate));
+        const int chunk_count = std::max(1, (rows + rows_per_chunk - 1) / rows_per_chunk);
+
+        std::vector<std::string> members(chunk_count);
+        std::atomic<bool> ok{true};
+        CrossSection::for_each_row(chunk_count, threads, [&](int chunk) {
+            std::vector<char>& text = scratch();
+            size_t length = 0;
+            if (chunk == 0) format_header(stocks, text, length);
+            int begin = chunk * rows_per_chunk;
+            int end = std::min(rows, begin + rows_per_chunk);
+            for (int ti = begin; ti < end; ++ti) format_row(columns, ti, text, length);
+            if (!deflate_member(text.data(), length, members[chunk])) ok = false;
+        });
+        if (!ok) {
+            spdlog::error("GzTableWriter: 压缩失败: {}", file_path);
+            return false;
+        }
+
+        // 先写临时文件并落盘再改名，中途失败或崩溃时不会留下截断的结果文件
+        std::string tmp_path = file_path + ".tmp";
+        FILE* fp = std::fopen(tmp_path.c_str(), "wb");
+        if (!fp) {
+            spdlog::error("无法创建GZ文件: {}", tmp_path);
+            return false;
+        }
+        bool written = true;
+        for (const auto& member : members) {
+            if (std::fwrite(member.data(), 1, member.size(), fp) != member.size()) {
+                written = false;
+                break;
+            }
+        }
+        written = written && std::fflush(fp) == 0 && ::fsync(::fileno(fp)) == 0;
+        if (std::fclose(fp) != 0) written = false;
+        if (!written || std::rename(tmp_path.c_str(), file_path.c_str()) != 0) {
+            spdlog::error("GZ文件写入失败: {}", file_path);
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // 最后一个存在有效值的时间桶 + 1（原写法只输出到最大有效bar_index），全部无效时为0
+    static int valid_rows(const std::vector<GSeriesView>& columns) {
+        int rows = 0;
+        for (const auto& column : columns) {
+            for (int ti = column.get_size() - 1; ti >= rows; --ti) {
+                if (!std::isnan(column[ti])) {
+                    rows = ti + 1;
+                    break;
+                }
+            }
+        }
+        return rows;
+    }
+
+private:
+    // 单个单元格最长的输出：逗号 + 309位整数部分 + 小数点 + 6位小数（DBL_MAX）
+    static constexpr size_t kMaxCellChars = 320;
+
+    static std::atomic<int>& default_threads_ref() {
+        static std::atomic<int> threads{0};
+        return threads;
+    }
+
+    // 每个线程复用的格式化缓冲区
+    static std::vector<char>& scratch() {
+        thread_local std::vector<char> buffer(kChunkBytes + kMaxCellChars);
+        return buffer;
+    }
+
+    static void reserve(std::vector<char>& text, size_t length, size_t extra) {
+        if (text.size() < length + extra) text.resize(std::max(text.size() * 2, length + extra));
+    }
+
+    static void format_header(const std::vector<std::string>& stocks, std::vector<char>& text, size_t& length) {
+        static const char kHead[] = "bar_index";
+        reserve(text, length, sizeof(kHead));
+        std::copy(kHead, kHead + sizeof(kHead) - 1, text.data() + length);
+        length += sizeof(kHead) - 1;
+        for (const auto& stock : stocks) {
+            reserve(text, length, stock.size() + 2);
+            text[length++] = ',';
+            std::copy(stock.begin(), stock.end(), text.data() + length);
+            length += stock.size();
+        }
+        reserve(text, length, 1);
+        text[length++] = '\n';
+    }
+
+    static void format_row(const std::vector<GSeriesView>& columns, int ti, std::vector<char>& text, size_t& length) {
+        reserve(text, length, 16);
+        length = std::to_chars(text.data() + length, text.data() + text.size(), ti).ptr - text.data();
+        for (const auto& column : columns) {
+            reserve(text, length, kMaxCellChars);
+            char* out = text.data() + length;
+            *out++ = ',';
+            if (ti < column.get_size()) {
+                double value = column[ti];
+                if (!std::isnan(value)) {
+                    out = std::to_chars(out, text.data() + text.size(), value, std::chars_format::fixed, 6).ptr;
+                }
+            }
+            length = out - text.data();
+        }
+        reserve(text, length, 1);
+        text[length++] = '\n';
+    }
+
+    // 把一段文本压缩成一个完整的gzip成员（与gzopen "wb"相同的默认压缩级别）
+    static bool deflate_member(const char* data, size_t length, std::string& member) {
+        z_stream stream{};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        member.resize(deflateBound(&stream, static_cast<uLong>(length)));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = static_cast<uInt>(length);
+        stream.next_out = reinterpret_cast<Bytef*>(&member[0]);
+        stream.avail_out = static_cast<uInt>(member.size());
+        int status = deflate(&stream, Z_FINISH);
+        member.resize(stream.total_out);
+        deflateEnd(&stream);
+        return status == Z_STREAM_END;
+    }
+};
@@ -10,6 +10,8 @@
 #include <vector>
 #include <limits>
 #include <queue>
+#include <algorithm>
+#include <cstdint>
 #include "spdlog/spdlog.h"
 
 // 增量计算算子基类
@@ -97,14 +99,347 @@ public:
     void clear() override;
 };
 
+// ==================== 流式分位数（P²算法） ====================
+// Jain & Chlamtac的P²算法：5个标记点按抛物线插值逼近p分位数，O(1)内存、O(1)更新
+// 不足5个样本时精确计算；也可由一段已排序样本初始化（见seed_sorted）
+class P2Quantile {
+public:
+    explicit P2Quantile(double p = 0.5) : p_(p) {
+        increments_[0] = 0.0; increments_[1] = p / 2.0; increments_[2] = p;
+        increments_[3] = (1.0 + p) / 2.0; increments_[4] = 1.0;
+    }
+
+    void add(double x) {
+        if (!std::isfinite(x)) return;
+        if (count_ < 5) {
+            heights_[count_++] = x;
+            if (count_ == 5) {
+                std::sort(heights_, heights_ + 5);
+                for (int i = 0; i < 5; ++i) {
+                    positions_[i] = i + 1.0;
+                    desired_[i] = 1.0 + 4.0 * increments_[i];
+                }
+            }
+            return;
+        }
+        ++count_;
+
+        int k;
+        if (x < heights_[0]) {
+            heights_[0] = x;
+            k = 0;
+        } else if (x >= heights_[4]) {
+            heights_[4] = std::max(heights_[4], x);
+            k = 3;
+        } else {
+            k = 0;
+            while (k < 3 && x >= heights_[k + 1]) ++k;
+        }
+        for (int i = k + 1; i < 5; ++i) positions_[i] += 1.0;
+        for (int i = 0; i < 5; ++i) desired_[i] += increments_[i];
+
+        for (int i = 1; i <= 3; ++i) {
+            double d = desired_[i] - positions_[i];
+            if ((d >= 1.0 && positions_[i + 1] - positions_[i] > 1.0) ||
+                (d <= -1.0 && positions_[i - 1] - positions_[i] < -1.0)) {
+                double sign = d > 0 ? 1.0 : -1.0;
+                double candidate = parabolic(i, sign);
+                if (heights_[i - 1] < candidate && candidate < heights_[i + 1]) {
+                    heights_[i] = candidate;
+                } else {
+                    heights_[i] = linear(i, sign);
+                }
+                positions_[i] += sign;
+            }
+        }
+    }
+
+    // 由已排序的样本（通常是精确阶段的缓冲）初始化标记点，之后继续流式更新
+    void seed_sorted(const std::vector<double>& sorted) {
+        clear();
+        if (sorted.size() < 5) {
+            for (double x : sorted) add(x);
+            return;
+        }
+        const double n = static_cast<double>(sorted.size());
+        for (int i = 0; i < 5; ++i) {
+            desired_[i] = 1.0 + (n - 1.0) * increments_[i];
+            positions_[i] = std::clamp(std::round(desired_[i]), i + 1.0, n - (4 - i));
+            if (i > 0 && positions_[i] <= positions_[i - 1]) positions_[i] = positions_[i - 1] + 1.0;
+        }
+        for (int i = 0; i < 5; ++i) heights_[i] = sorted[static_cast<size_t>(positions_[i]) - 1];
+        count_ = static_cast<int64_t>(sorted.size());
+    }
+
+    double value() const {
+        if (count_ == 0) return std::numeric_limits<double>::quiet_NaN();
+        if (count_ < 5) {
+            double sorted[5];
+            std::copy(heights_, heights_ + count_, sorted);
+            std::sort(sorted, sorted + count_);
+            double rank = p_ * (count_ - 1);
+            int lo = static_cast<int>(std::floor(rank));
+            int hi = std::min<int>(lo + 1, static_cast<int>(count_) - 1);
+            return sorted[lo] + (rank - lo) * (sorted[hi] - sorted[lo]);
+        }
+        return heights_[2];
+    }
+
+    int64_t count() const { return count_; }
+
+    void clear() { count_ = 0; }
+
+private:
+    double parabolic(int i, double d) const {
+        const double* q = heights_;
+        const double* n = positions_;
+        return q[i] + d / (n[i + 1] - n[i - 1]) *
+               ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+                (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+    }
+
+    double linear(int i, double d) const {
+        int j = i + static_cast<int>(d);
+        return heights_[i] + d * (heights_[j] - heights_[i]) / (positions_[j] - positions_[i]);
+    }
+
+    double p_;
+    int64_t count_ = 0;
+    double heights_[5] = {};      // 标记点高度
+    double positions_[5] = {};    // 标记点实际位置（1起）
+    double desired_[5] = {};      // 标记点期望位置
+    double increments_[5] = {};   // 每个样本期望位置的增量
+};
+
 // 中位数增量计算
+// 默认始终用双堆精确计算；指定streaming_after > 0时，样本数超过该值后用堆中的有序样本初始化P²并释放堆，
+// 之后为近似值，内存不再随窗口增长
 class IncreaseMedian : public BaseIncrease {
 private:
     std::priority_queue<double, std::vector<double>, std::less<double>> p;      // 最大堆（左半部分）
     std::priority_queue<double, std::vector<double>, std::greater<double>> q;   // 最小堆（右半部分）
+    size_t streaming_after_;           // 0表示不切换到P²
+    P2Quantile estimator_{0.5};        // 长窗口阶段的流式估计
+    bool streaming_ = false;
 
 public:
+    explicit IncreaseMedian(size_t streaming_after = 0) : streaming_after_(streaming_after) {}
+
     void increase(const double& num) override;
     double get_value() const override;
     void clear() override;
+};
+
+// ==================== 可组合的模板增量累加器 ====================
+// 每个统计量是一个无虚函数的小结构体，提供 add / merge / clear；
+// Accumulators<...> 把多个统计量组合为一个结构体，一次add更新全部，编译期展开、无虚调用。
+// merge按时间顺序合并（other在后），15S桶的累加器可直接合并为1min/5min/30min的结果。
+// 目前只作为库提供：BarSeriesHolder的频率汇总仍按RollupMethod逐字段合并，尚未接入这些累加器。
+// 非有限值（NaN/Inf）在Accumulators::add中统一跳过。
+
+// 有效样本数
+struct AccCount {
+    int64_t n = 0;
+    void add(double) { ++n; }
+    void merge(const AccCount& other) { n += other.n; }
+    void clear() { n = 0; }
+    int64_t count() const { return n; }
+};
+
+// 求和
+struct AccSum {
+    double total = 0.0;
+    bool has_value = false;
+    void add(double x) { total += x; has_value = true; }
+    void merge(const AccSum& other) { total += other.total; has_value = has_value || other.has_value; }
+    void clear() { total = 0.0; has_value = false; }
+    double sum() const { return has_value ? total : std::numeric_limits<double>::quiet_NaN(); }
+};
+
+// 最小值
+struct AccMin {
+    double lo = std::numeric_limits<double>::infinity();
+    void add(double x) { lo = std::min(lo, x); }
+    void merge(const AccMin& other) { lo = std::min(lo, other.lo); }
+    void clear() { lo = std::numeric_limits<double>::infinity(); }
+    double min() const { return std::isinf(lo) && lo > 0 ? std::numeric_limits<double>::quiet_NaN() : lo; }
+};
+
+// 最大值
+struct AccMax {
+    double hi = -std::numeric_limits<double>::infinity();
+    void add(double x) { hi = std::max(hi, x); }
+    void merge(const AccMax& other) { hi = std::max(hi, other.hi); }
+    void clear() { hi = -std::numeric_limits<double>::infinity(); }
+    double max() const { return std::isinf(hi) && hi < 0 ? std::numeric_limits<double>::quiet_NaN() : hi; }
+};
+
+// 第一个值
+struct AccFirst {
+    double value = std::numeric_limits<double>::quiet_NaN();
+    void add(double x) { if (std::isnan(value)) value = x; }
+    void merge(const AccFirst& other) { if (std::isnan(value)) value = other.value; }
+    void clear() { value = std::numeric_limits<double>::quiet_NaN(); }
+    double first() const { return value; }
+};
+
+// 最后一个值
+struct AccLast {
+    double value = std::numeric_limits<double>::quiet_NaN();
+    void add(double x) { value = x; }
+    void merge(const AccLast& other) { if (!std::isnan(other.value)) value = other.value; }
+    void clear() { value = std::numeric_limits<double>::quiet_NaN(); }
+    double last() const { return value; }
+};
+
+// 中心矩（Order = 2/3/4 分别支持到方差/偏度/峰度），合并使用Pébay的两组合并公式
+// 偏度、峰度的无偏修正与IncreaseSkew/IncreaseKurt一致
+template <int Order = 4>
+struct AccMoments {
+    static_assert(Order >= 1 && Order <= 4, "AccMoments支持1~4阶");
+    double n = 0.0;
+    double mu = 0.0;
+    double m2 = 0.0;
+    double m3 = 0.0;
+    double m4 = 0.0;
+
+    void add(double x) {
+        const double n1 = n;
+        n += 1.0;
+        const double delta = x - mu;
+        const double delta_n = delta / n;
+        mu += delta_n;
+        if constexpr (Order >= 2) {
+            const double term1 = delta * delta_n * n1;
+            if constexpr (Order >= 4) {
+                m4 += term1 * delta_n * delta_n * (n * n - 3.0 * n + 3.0) + 6.0 * delta_n * delta_n * m2 - 4.0 * delta_n * m3;
+            }
+            if constexpr (Order >= 3) {
+                m3 += term1 * delta_n * (n - 2.0) - 3.0 * delta_n * m2;
+            }
+            m2 += term1;
+        }
+    }
+
+    void merge(const AccMoments& other) {
+        if (other.n == 0.0) return;
+        if (n == 0.0) { *this = other; return; }
+        const double na = n, nb = other.n, total = na + nb;
+        const double delta = other.mu - mu;
+        const double delta2 = delta * delta;
+        if constexpr (Order >= 4) {
+            m4 += other.m4 + delta2 * delta2 * na * nb * (na * na - na * nb + nb * nb) / (total * total * total) +
+                  6.0 * delta2 * (na * na * other.m2 + nb * nb * m2) / (total * total) +
+                  4.0 * delta * (na * other.m3 - nb * m3) / total;
+        }
+        if constexpr (Order >= 3) {
+            m3 += other.m3 + delta2 * delta * na * nb * (na - nb) / (total * total) +
+                  3.0 * delta * (na * other.m2 - nb * m2) / total;
+        }
+        if constexpr (Order >= 2) {
+            m2 += other.m2 + delta2 * na * nb / total;
+        }
+        mu += delta * nb / total;
+        n = total;
+    }
+
+    void clear() { n = mu = m2 = m3 = m4 = 0.0; }
+
+    double mean() const { return n > 0 ? mu : std::numeric_limits<double>::quiet_NaN(); }
+
+    double var() const {
+        static_assert(Order >= 2, "方差需要Order >= 2");
+        return n > 1 ? m2 / (n - 1.0) : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    double stddev() const { return std::sqrt(var()); }
+
+    double skew() const {
+        static_assert(Order >= 3, "偏度需要Order >= 3");
+        if (n < 3 || m2 <= 0) return std::numeric_limits<double>::quiet_NaN();
+        return (n / (n - 2.0)) * std::sqrt(n - 1.0) * m3 / std::pow(m2, 1.5);
+    }
+
+    double kurt() const {
+        static_assert(Order >= 4, "峰度需要Order >= 4");
+        if (n < 4 || m2 <= 0) return std::numeric_limits<double>::quiet_NaN();
+        double g2 = n * m4 / (m2 * m2) - 3.0;
+        return (n - 1.0) / ((n - 2.0) * (n - 3.0)) * ((n + 1.0) * g2 + 6.0);
+    }
+};
+
+// 流式分位数（不可精确合并，因此不提供merge，含它的组合不能调用merge）
+template <int PermilleQuantile = 500>
+struct AccQuantile {
+    P2Quantile estimator{PermilleQuantile / 1000.0};
+    void add(double x) { estimator.add(x); }
+    void clear() { estimator.clear(); }
+    double quantile() const { return estimator.value(); }
+};
+
+// 组合累加器：一次add更新所有统计量
+template <typename... Stats>
+struct Accumulators : Stats... {
+    void add(double x) {
+        if (!std::isfinite(x)) return;
+        (Stats::add(x), ...);
+    }
+
+    void merge(const Accumulators& other) {
+        (Stats::merge(static_cast<const Stats&>(other)), ...);
+    }
+
+    void clear() {
+        (Stats::clear(), ...);
+    }
+};
+
+// 常用组合：一个bar内的完整描述统计
+using BarStatistics = Accumulators<AccCount, AccSum, AccMin, AccMax, AccFirst, AccLast, AccMoments<4>>;
+
+// 两个序列的乘积和与协矩（相关系数、协方差、回归斜率），可合并
+struct AccCrossMoments {
+    double n = 0.0;
+    double mean_x = 0.0, mean_y = 0.0;
+    double m2_x = 0.0, m2_y = 0.0;
+    double c_xy = 0.0;           // 协矩 sum((x - mean_x)(y - mean_y))
+    double sum_xy = 0.0;         // 乘积和 sum(x * y)
+
+    void add(double x, double y) {
+        if (!std::isfinite(x) || !std::isfinite(y)) return;
+        n += 1.0;
+        const double dx = x - mean_x;
+        mean_x += dx / n;
+        const double dy = y - mean_y;
+        mean_y += dy / n;
+        m2_x += dx * (x - mean_x);
+        m2_y += dy * (y - mean_y);
+        c_xy += dx * (y - mean_y);
+        sum_xy += x * y;
+    }
+
+    void merge(const AccCrossMoments& other) {
+        if (other.n == 0.0) return;
+        if (n == 0.0) { *this = other; return; }
+        const double total = n + other.n;
+        const double dx = other.mean_x - mean_x;
+        const double dy = other.mean_y - mean_y;
+        const double factor = n * other.n / total;
+        m2_x += other.m2_x + dx * dx * factor;
+        m2_y += other.m2_y + dy * dy * factor;
+        c_xy += other.c_xy + dx * dy * factor;
+        mean_x += dx * other.n / total;
+        mean_y += dy * other.n / total;
+        sum_xy += other.sum_xy;
+        n = total;
+    }
+
+    void clear() { *this = AccCrossMoments(); }
+
+    double sum_of_products() const { return n > 0 ? sum_xy : std::numeric_limits<double>::quiet_NaN(); }
+    double cov() const { return n > 1 ? c_xy / (n - 1.0) : std::numeric_limits<double>::quiet_NaN(); }
+    double corr() const {
+        return (n > 1 && m2_x > 0 && m2_y > 0) ? c_xy / std::sqrt(m2_x * m2_y) : std::numeric_limits<double>::quiet_NaN();
+    }
+    double beta() const { return (n > 1 && m2_x > 0) ? c_xy / m2_x : std::numeric_limits<double>::quiet_NaN(); }
 }; 
\ No newline at end of file
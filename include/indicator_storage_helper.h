@@ -2,6 +2,8 @@
 
 #include "data_structures.h"
 #include <unordered_map>
+#include <map>
+#include <memory>
 #include <vector>
 #include <utility>
 #include <spdlog/spdlog.h>
@@ -55,6 +57,52 @@ public:
         int pre_days
     );
 
+    // 新增：频率字符串（"15S"/"15s"/"1min"/"5min"/"30min"）转换为Frequency，未知频率返回false
+    static bool parse_frequency(const std::string& freq_str, Frequency& frequency);
+
+    // 新增：把各股票base_freq下的可加字段聚合到目标频率，输出 时间桶 -> 股票 -> 聚合值（只保留有效值）
+    // 每个目标桶是一次前缀和区间查询，与聚合比率无关；目标频率已在写入时汇总（rollup）则直接读取
+    static bool aggregate_additive(
+        const std::unordered_map<std::string, std::shared_ptr<BarSeriesHolder>>& holders,
+        Frequency base_freq,
+        const std::string& key,                 // 数据键名（如 "volume", "amount"）
+        const std::string& target_frequency,
+        std::map<int, std::map<std::string, double>>& aggregated_data,
+        bool target_pre_aggregated = false      // 目标频率的bar是否已在写入时汇总
+    );
+
+    // 新增：按 bar_index,股票1,股票2,... 的格式写出GZ压缩表（多字段指标按字段分别写出，见GzTableWriter）
+    static bool write_bar_table_gz(
+        const std::string& file_path,
+        const std::unordered_map<std::string, std::shared_ptr<BarSeriesHolder>>& holders,
+        const std::map<int, std::map<std::string, double>>& aggregated_data
+    );
+
+    // 新增：按模块配置的格式写出时间桶表：csv.gz宽表，或列式二进制.col（见columnar_file.h）
+    // file_stem为不含扩展名的路径（如.../DiffIndicator_volume_20240701_1min），实际写出的文件路径通过written_path返回
+    static bool write_bar_table(
+        const std::string& file_stem,
+        const std::string& frequency,
+        const std::unordered_map<std::string, std::shared_ptr<BarSeriesHolder>>& holders,
+        const std::map<int, std::map<std::string, double>>& aggregated_data,
+        const ModuleConfig& module,
+        std::string& written_path
+    );
+
+    // 新增：同write_bar_table，数据直接按列给出（columns[i]为stocks[i]的整日序列视图），不经过map
+    // csv.gz输出到最后一个有效时间桶为止；列式文件至少写满frequency的整日时间桶数
+    static bool write_bar_columns(
+        const std::string& file_stem,
+        const std::string& frequency,
+        const std::vector<std::string>& stocks,
+        const std::vector<GSeriesView>& columns,
+        const ModuleConfig& module,
+        std::string& written_path
+    );
+
+    // 新增：创建结果目录（已存在视为成功；多个模块并行保存时可能同时创建同一目录）
+    static bool ensure_directory(const std::string& dir);
+
 private:
     // 计算时间桶索引（支持不同频率）
     static int calculate_time_bucket(uint64_t timestamp, Frequency frequency);
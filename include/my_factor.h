@@ -1,6 +1,7 @@
 #pragma once
 #include "data_structures.h"
 #include "indicator_storage_helper.h"
+#include "factor_expression.h"
 // 前向声明，避免循环包含
 class CalculationEngine;
 #include <unordered_map>
@@ -17,6 +18,11 @@ public:
         spdlog::warn("VolumeFactor::Calculate被调用，但应该使用definition函数");
     }
 
+    // 读取volume指标基础频率的bar
+    std::vector<IndicatorRequirement> required_inputs() const override {
+        return {{"volume", "volume", "", pre_days_}};
+    }
+
     // 实现Factor的definition函数
     GSeries definition(
         const std::unordered_map<std::string, BarSeriesHolder*>& barRunner,
@@ -31,7 +37,13 @@ public:
         int ti
     ) override;
 
-
+    // 新增：整日回填（每只股票的volume序列只取一次）
+    bool supports_full_day() const override { return true; }
+    std::vector<GSeries> definition_full_day(
+        const std::shared_ptr<CalculationEngine>& cal_engine,
+        const std::vector<std::string>& sorted_stock_list,
+        int bar_count
+    ) override;
 
     // 新增：使用访问器模式的实现
     GSeries definition_with_accessor(
@@ -57,6 +69,13 @@ public:
     void Calculate(const std::vector<const Indicator*>& indicators) override {
         spdlog::warn("PriceFactor::Calculate被调用，但应该使用definition函数");
     }
+
+    // 优先读取vwap指标的5min bar，未配置时回退到差分指标的amount/volume（有5min汇总时读5min）
+    std::vector<IndicatorRequirement> required_inputs() const override {
+        return {{"vwap", "", "5min", pre_days_, true},
+                {"diff_volume_amount", "amount", "5min", pre_days_},
+                {"diff_volume_amount", "volume", "5min", pre_days_}};
+    }
     
     // 原有的定义方法 - 修复参数类型
     GSeries definition(
@@ -71,6 +90,14 @@ public:
         const std::vector<std::string>& sorted_stock_list,
         int ti
     ) override;
+
+    // 新增：整日回填（每只股票的vwap序列或amount/volume前缀和只取一次）
+    bool supports_full_day() const override { return true; }
+    std::vector<GSeries> definition_full_day(
+        const std::shared_ptr<CalculationEngine>& cal_engine,
+        const std::vector<std::string>& sorted_stock_list,
+        int bar_count
+    ) override;
     
     // 重写基类的definition_with_timestamp方法（保持参数一致）
     GSeries definition_with_timestamp(
@@ -117,4 +144,107 @@ private:
     // 新增：字符串频率转换为Frequency枚举
     static Frequency string_to_frequency(const std::string& freq_str);
     static std::string frequency_to_string(Frequency& frequency);
-}; 
\ No newline at end of file
+}; 
+
+// 日内累计VWAP因子：开盘至当前时间桶的 sum(amount) / sum(volume)
+// 使用增量生命周期：每只股票保存已收盘行的累计量，每个时间事件只读取新到的行
+class IntradayVwapFactor : public Factor {
+public:
+    IntradayVwapFactor(const ModuleConfig& module) : Factor(module.name, module.id, module.path, module.frequency) {}
+
+    void Calculate(const std::vector<const Indicator*>& /*indicators*/) override {
+        spdlog::warn("IntradayVwapFactor::Calculate被调用，但应该使用definition函数");
+    }
+
+    // 读取差分指标基础频率的amount/volume
+    std::vector<IndicatorRequirement> required_inputs() const override {
+        return {{"diff_volume_amount", "amount", "", pre_days_},
+                {"diff_volume_amount", "volume", "", pre_days_}};
+    }
+
+    // 非增量计算：由前缀和直接得到[0, end]区间VWAP（增量路径的对照和回退）
+    GSeries definition_with_cal_engine(
+        const std::shared_ptr<CalculationEngine>& cal_engine,
+        const std::vector<std::string>& sorted_stock_list,
+        int ti
+    ) override;
+
+    // 新增：增量生命周期
+    bool supports_incremental() const override { return true; }
+    void on_day_start(
+        const std::shared_ptr<CalculationEngine>& cal_engine,
+        const std::vector<std::string>& sorted_stock_list
+    ) override;
+    GSeries on_bucket(
+        const std::shared_ptr<CalculationEngine>& cal_engine,
+        const std::vector<std::string>& sorted_stock_list,
+        int ti
+    ) override;
+
+private:
+    // 单只股票的累计状态（只包含已收盘的行）
+    // 两个字段各自累加有效值并计数，与BarSeriesHolder::range_vwap的NaN规则一致
+    struct RunningState {
+        double amount = 0.0;
+        double volume = 0.0;
+        int amount_count = 0;
+        int volume_count = 0;
+        int next_row = 0;       // 下一个待消化的输入行
+    };
+
+    static void accumulate_row(RunningState& state, double amount, double volume);
+
+    std::vector<RunningState> states_;                 // 与sorted_stock_list一一对应
+    Frequency input_frequency_ = Frequency::F1MIN;     // 输入指标的基础频率
+};
+
+// 新增：表达式因子 - 在config.xml中用expression属性定义（如rank(ts_mean(diff_volume_amount.amount, 6))），
+// 同一Framework中频率相同的表达式因子编译进共享的ExpressionPlan，公共子表达式只算一次
+class ExpressionFactor : public Factor {
+public:
+    ExpressionFactor(const ModuleConfig& module, std::shared_ptr<ExpressionPlan> plan, int root)
+        : Factor(module.name, module.id, module.path, module.frequency), plan_(std::move(plan)), root_(root) {}
+
+    void Calculate(const std::vector<const Indicator*>& /*indicators*/) override {
+        spdlog::warn("ExpressionFactor::Calculate被调用，但应该使用definition函数");
+    }
+
+    // 表达式中出现的指标字段，按因子频率读取（指标未汇总到因子频率时按字段的合并方式聚合基础频率）
+    std::vector<IndicatorRequirement> required_inputs() const override;
+
+    // 计划求值到第ti个时间桶，取本因子的截面
+    // 在引擎的因子工作线程内求值（每个时间事件每个因子已占一个线程），计划内部串行
+    GSeries definition_with_cal_engine(
+        const std::shared_ptr<CalculationEngine>& cal_engine,
+        const std::vector<std::string>& sorted_stock_list,
+        int ti
+    ) override;
+
+    // 增量生命周期：新的一天作废计划中已求值的行，之后每个时间事件只计算新增的行
+    bool supports_incremental() const override { return true; }
+    void on_day_start(
+        const std::shared_ptr<CalculationEngine>& cal_engine,
+        const std::vector<std::string>& sorted_stock_list
+    ) override;
+    GSeries on_bucket(
+        const std::shared_ptr<CalculationEngine>& cal_engine,
+        const std::vector<std::string>& sorted_stock_list,
+        int ti
+    ) override;
+
+    // 整日回填：计划对整日面板只求值一次
+    bool supports_full_day() const override { return true; }
+    std::vector<GSeries> definition_full_day(
+        const std::shared_ptr<CalculationEngine>& cal_engine,
+        const std::vector<std::string>& sorted_stock_list,
+        int bar_count
+    ) override;
+
+private:
+    // 从CalculationEngine的BarSeriesHolder读取叶子节点
+    ExpressionPlan::InputLoader make_loader(const std::shared_ptr<CalculationEngine>& cal_engine,
+                                            const std::vector<std::string>& sorted_stock_list) const;
+
+    std::shared_ptr<ExpressionPlan> plan_;
+    int root_;
+};
@@ -8,7 +8,6 @@
 #include "data_structures.h"  // 包含基类Indicator定义
 #include <unordered_map>
 #include <memory> //智能指针
-#include <mutex>  // 添加mutex支持
 
 // 前向声明
 class CalculationEngine;
@@ -22,6 +21,9 @@ public:
 
     // 重写计算接口
     void Calculate(const SyncTickData& tick_data) override;
+
+    // 新增：融合tick内核（使用CalculationEngine预解析的上下文）
+    void calculate_with_context(const IndicatorTickContext& ctx) override;
     BarSeriesHolder* get_bar_series_holder(const std::string& stock_code) const;
 
     // 实现获取指定股票BarSeriesHolder的纯虚函数
@@ -32,15 +34,15 @@ public:
 
     // 新增：重置差分存储
     void reset_diff_storage();
+
+    // 前一个tick的累计值存放在一个状态槽中，序列句柄槽按频率下标排布
+    int state_slot_count() const override { return 1; }
+    int handle_slot_count() const override { return kFrequencyCount; }
     
     // 实现纯虚函数aggregate
     bool aggregate(const std::string& target_frequency, std::map<int, std::map<std::string, double>>& aggregated_data) override;
 
 private:
-    // 使用时间序列索引存储累积值：股票 -> 时间戳 -> 累积值
-    std::unordered_map<std::string, std::map<uint64_t, double>> time_series_volume_cache_;
-    mutable std::mutex volume_cache_mutex_;  // 保护time_series_volume_cache_的访问
-    
     // 指向CalculationEngine的指针（用于获取指定股票的BarSeriesHolder）
     mutable std::shared_ptr<CalculationEngine> calculation_engine_;
 };
@@ -53,6 +55,9 @@ public:
 
     // 重写计算接口
     void Calculate(const SyncTickData& tick_data) override;
+
+    // 新增：融合tick内核（使用CalculationEngine预解析的上下文）
+    void calculate_with_context(const IndicatorTickContext& ctx) override;
     BarSeriesHolder* get_bar_series_holder(const std::string& stock_code) const;
     
     // 实现获取指定股票BarSeriesHolder的纯虚函数
@@ -63,15 +68,49 @@ public:
     
     // 新增：重置差分存储
     void reset_diff_storage();
+
+    // 前一个tick的累计值存放在一个状态槽中，序列句柄槽按频率下标排布
+    int state_slot_count() const override { return 1; }
+    int handle_slot_count() const override { return kFrequencyCount; }
     
     // 实现纯虚函数aggregate
     bool aggregate(const std::string& target_frequency, std::map<int, std::map<std::string, double>>& aggregated_data) override;
 
 private:
-    // 使用时间序列索引存储累积值：股票 -> 时间戳 -> 累积值
-    std::unordered_map<std::string, std::map<uint64_t, double>> time_series_amount_cache_;
-    mutable std::mutex amount_cache_mutex_;  // 保护time_series_amount_cache_的访问
-    
+    // 指向CalculationEngine的指针（用于获取指定股票的BarSeriesHolder）
+    mutable std::shared_ptr<CalculationEngine> calculation_engine_;
+};
+
+// 新增：成交均价指标（派生指标）- 读取上游指标的volume/amount桶值，计算每个桶的VWAP
+// 上游由配置inputs指定（默认diff_volume_amount），基础频率和汇总频率分别按各自的桶计算
+class VwapIndicator : public Indicator {
+public:
+    explicit VwapIndicator(const ModuleConfig& module) : Indicator(module) {
+        if (input_names_.empty()) {
+            input_names_.push_back("diff_volume_amount");
+        }
+    }
+
+    // 重写计算接口
+    void Calculate(const SyncTickData& tick_data) override;
+
+    // 新增：融合tick内核（使用CalculationEngine预解析的上下文）
+    void calculate_with_context(const IndicatorTickContext& ctx) override;
+
+    // 实现获取指定股票BarSeriesHolder的纯虚函数
+    BarSeriesHolder* get_stock_bar_holder(const std::string& stock_code) const override;
+
+    // 设置CalculationEngine引用（用于获取指定股票的BarSeriesHolder）
+    void set_calculation_engine(std::shared_ptr<CalculationEngine> engine);
+
+    // volume、amount（输入）和vwap（输出）在各频率下的序列句柄槽
+    int handle_slot_count() const override { return 3 * kFrequencyCount; }
+
+    // VWAP不可加，只支持读取写入时已汇总的频率
+    RollupMethod field_rollup(const std::string& /*field*/) const override { return RollupMethod::Last; }
+    bool aggregate(const std::string& target_frequency, std::map<int, std::map<std::string, double>>& aggregated_data) override;
+
+private:
     // 指向CalculationEngine的指针（用于获取指定股票的BarSeriesHolder）
     mutable std::shared_ptr<CalculationEngine> calculation_engine_;
 };
@@ -0,0 +1,246 @@
+#pragma once
+
+#include "cross_section.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "spdlog/spdlog.h"
+
+// 中性化的回归变量：行业哑变量 + 风格暴露（如市值、波动率）
+// industry为空时只带截距（所有股票视为同一组）；styles中每个面板的股票数与因子相同，
+// 时间桶数与因子相同，或为1（整日共用的静态暴露，如前收盘市值）
+struct NeutralizationExposure {
+    std::vector<int> industry;                  // 按股票列表顺序的行业组号（0开始），负数表示缺失
+    std::vector<const FactorPanel*> styles;     // 风格暴露面板
+};
+
+// 多因子批量中性化：每个时间桶对截面做最小二乘 y = X b + e，输出残差e
+// 同一时间桶内所有因子共享设计矩阵X的法方程X'X，只分解一次；
+// 因子自身有额外缺失值时，从共享的X'X中减去缺失行再分解，不重新扫描整个截面
+// 行业哑变量按稀疏方式累加，每只股票O(K^2)（K为风格数）；时间桶间可并行
+// 法方程对量纲敏感，市值等风格暴露应先取对数或标准化（如CrossSection::z_score）
+class Neutralizer {
+public:
+    // factors和residuals一一对应，residuals可与factors指向同一面板（原地中性化）
+    // 行业或任一风格暴露缺失、或因子值缺失的股票，残差为NaN
+    static bool neutralize(const NeutralizationExposure& exposure,
+                           const std::vector<const FactorPanel*>& factors,
+                           const std::vector<FactorPanel*>& residuals,
+                           int threads = 1) {
+        if (factors.size() != residuals.size()) {
+            spdlog::error("Neutralizer: 因子数量{}与输出数量{}不一致", factors.size(), residuals.size());
+            return false;
+        }
+        if (factors.empty()) return true;
+
+        const int buckets = factors[0]->buckets;
+        const int stocks = factors[0]->stocks;
+        for (size_t f = 0; f < factors.size(); ++f) {
+            if (!factors[f] || !residuals[f] || factors[f]->buckets != buckets || factors[f]->stocks != stocks) {
+                spdlog::error("Neutralizer: 第{}个因子面板为空或形状不一致", f);
+                return false;
+            }
+        }
+        if (!exposure.industry.empty() && static_cast<int>(exposure.industry.size()) != stocks) {
+            spdlog::error("Neutralizer: 行业分组数量{}与股票数量{}不一致", exposure.industry.size(), stocks);
+            return false;
+        }
+        for (size_t k = 0; k < exposure.styles.size(); ++k) {
+            const FactorPanel* style = exposure.styles[k];
+            if (!style || style->stocks != stocks || (style->buckets != buckets && style->buckets != 1)) {
+                spdlog::error("Neutralizer: 第{}个风格暴露面板为空或形状不一致", k);
+                return false;
+            }
+        }
+
+        for (size_t f = 0; f < residuals.size(); ++f) {
+            if (residuals[f] != factors[f]) residuals[f]->reshape(buckets, stocks);
+        }
+
+        int group_count = 1;
+        if (!exposure.industry.empty()) {
+            group_count = std::max(0, *std::max_element(exposure.industry.begin(), exposure.industry.end()) + 1);
+        }
+
+        CrossSection::for_each_row(buckets, threads, [&](int ti) {
+            solve_bucket(exposure, group_count, factors, residuals, ti, stocks);
+        });
+        return true;
+    }
+
+    // 单个截面的便捷接口
+    static GSeries neutralize_section(const GSeries& factor, const std::vector<int>& industry,
+                                      const std::vector<GSeries>& styles) {
+        int stocks = factor.get_size();
+        FactorPanel factor_panel = FactorPanel::from_sections({factor}, stocks);
+        std::vector<FactorPanel> style_panels;
+        style_panels.reserve(styles.size());
+        NeutralizationExposure exposure{industry, {}};
+        for (const auto& style : styles) {
+            style_panels.push_back(FactorPanel::from_sections({style}, stocks));
+        }
+        for (const auto& panel : style_panels) exposure.styles.push_back(&panel);
+
+        FactorPanel residual;
+        if (!neutralize(exposure, {&factor_panel}, {&residual})) return GSeries();
+        return residual.section(0);
+    }
+
+private:
+    static constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+    static constexpr double kPivotTolerance = 1e-10;    // 相对主元阈值，低于时视为共线列并剔除
+
+    // 每个线程复用的工作区
+    struct Scratch {
+        std::vector<const double*> style_rows;
+        std::vector<double> style_values;
+        std::vector<int> groups;            // 每只股票在本桶的组号，-1表示暴露缺失
+        std::vector<double> base_xtx;       // 共享法方程X'X（P×P行主序）
+        std::vector<double> base_chol;      // 共享法方程的Cholesky分解
+        std::vector<char> base_dropped;
+        std::vector<double> xtx;            // 因子专属的法方程（有额外缺失时）
+        std::vector<double> chol;
+        std::vector<char> dropped;
+        std::vector<double> xty;
+        std::vector<double> beta;
+    };
+
+    static Scratch& scratch() {
+        thread_local Scratch ws;
+        return ws;
+    }
+
+    // 对称矩阵加上 sign * x x'，x为第g个哑变量 + 风格值
+    static void add_outer(std::vector<double>& a, int p, int group_count, int g, const double* styles, int k_count,
+                          double sign) {
+        a[static_cast<size_t>(g) * p + g] += sign;
+        for (int k = 0; k < k_count; ++k) {
+            int col = group_count + k;
+            a[static_cast<size_t>(g) * p + col] += sign * styles[k];
+            a[static_cast<size_t>(col) * p + g] += sign * styles[k];
+            for (int l = 0; l < k_count; ++l) {
+                a[static_cast<size_t>(col) * p + group_count + l] += sign * styles[k] * styles[l];
+            }
+        }
+    }
+
+    // 半正定矩阵的Cholesky分解：主元过小（共线或空行业）的列记为剔除，对应系数取0
+    static void cholesky(const std::vector<double>& a, std::vector<double>& l, std::vector<char>& dropped, int p) {
+        l.assign(static_cast<size_t>(p) * p, 0.0);
+        dropped.assign(p, 0);
+        for (int j = 0; j < p; ++j) {
+            double diag = a[static_cast<size_t>(j) * p + j];
+            double d = diag;
+            for (int k = 0; k < j; ++k) d -= l[static_cast<size_t>(j) * p + k] * l[static_cast<size_t>(j) * p + k];
+            if (!(diag > 0.0) || d <= kPivotTolerance * diag) {
+                dropped[j] = 1;
+                continue;
+            }
+            double ljj = std::sqrt(d);
+            l[static_cast<size_t>(j) * p + j] = ljj;
+            for (int i = j + 1; i < p; ++i) {
+                double s = a[static_cast<size_t>(i) * p + j];
+                for (int k = 0; k < j; ++k) s -= l[static_cast<size_t>(i) * p + k] * l[static_cast<size_t>(j) * p + k];
+                l[static_cast<size_t>(i) * p + j] = s / ljj;
+            }
+        }
+    }
+
+    // 解 L L' beta = rhs，剔除列的系数为0
+    static void solve(const std::vector<double>& l, const std::vector<char>& dropped, const std::vector<double>& rhs,
+                      std::vector<double>& beta, int p) {
+        beta.assign(p, 0.0);
+        for (int i = 0; i < p; ++i) {
+            if (dropped[i]) continue;
+            double s = rhs[i];
+            for (int k = 0; k < i; ++k) s -= l[static_cast<size_t>(i) * p + k] * beta[k];
+            beta[i] = s / l[static_cast<size_t>(i) * p + i];
+        }
+        for (int i = p - 1; i >= 0; --i) {
+            if (dropped[i]) continue;
+            double s = beta[i];
+            for (int k = i + 1; k < p; ++k) s -= l[static_cast<size_t>(k) * p + i] * beta[k];
+            beta[i] = s / l[static_cast<size_t>(i) * p + i];
+        }
+    }
+
+    static void solve_bucket(const NeutralizationExposure& exposure, int group_count,
+                             const std::vector<const FactorPanel*>& factors,
+                             const std::vector<FactorPanel*>& residuals, int ti, int stocks) {
+        Scratch& ws = scratch();
+        const int k_count = static_cast<int>(exposure.styles.size());
+        const int p = group_count + k_count;
+
+        ws.style_rows.resize(k_count);
+        for (int k = 0; k < k_count; ++k) {
+            const FactorPanel* style = exposure.styles[k];
+            ws.style_rows[k] = style->row(style->buckets == 1 ? 0 : ti);
+        }
+
+        // 本桶暴露完整的股票及其组号，同时累加共享的X'X
+        std::vector<double>& style_values = ws.style_values;
+        style_values.resize(k_count);
+        ws.groups.assign(stocks, -1);
+        ws.base_xtx.assign(static_cast<size_t>(p) * p, 0.0);
+        for (int i = 0; i < stocks; ++i) {
+            int g = exposure.industry.empty() ? 0 : exposure.industry[i];
+            if (g < 0 || g >= group_count) continue;
+            bool complete = true;
+            for (int k = 0; k < k_count; ++k) {
+                style_values[k] = ws.style_rows[k][i];
+                if (!std::isfinite(style_values[k])) { complete = false; break; }
+            }
+            if (!complete) continue;
+            ws.groups[i] = g;
+            add_outer(ws.base_xtx, p, group_count, g, style_values.data(), k_count, 1.0);
+        }
+        bool base_factored = false;
+
+        for (size_t f = 0; f < factors.size(); ++f) {
+            const double* y = factors[f]->row(ti);
+            double* out = residuals[f]->row(ti);
+
+            // X'y，以及因子自身缺失（暴露完整但因子为NaN）的行
+            ws.xty.assign(p, 0.0);
+            bool has_missing = false;
+            for (int i = 0; i < stocks; ++i) {
+                int g = ws.groups[i];
+                if (g < 0) continue;
+                if (!std::isfinite(y[i])) { has_missing = true; continue; }
+                ws.xty[g] += y[i];
+                for (int k = 0; k < k_count; ++k) ws.xty[group_count + k] += ws.style_rows[k][i] * y[i];
+            }
+
+            if (!has_missing) {
+                if (!base_factored) {
+                    cholesky(ws.base_xtx, ws.base_chol, ws.base_dropped, p);
+                    base_factored = true;
+                }
+                solve(ws.base_chol, ws.base_dropped, ws.xty, ws.beta, p);
+            } else {
+                ws.xtx = ws.base_xtx;
+                for (int i = 0; i < stocks; ++i) {
+                    int g = ws.groups[i];
+                    if (g < 0 || std::isfinite(y[i])) continue;
+                    for (int k = 0; k < k_count; ++k) style_values[k] = ws.style_rows[k][i];
+                    add_outer(ws.xtx, p, group_count, g, style_values.data(), k_count, -1.0);
+                }
+                cholesky(ws.xtx, ws.chol, ws.dropped, p);
+                solve(ws.chol, ws.dropped, ws.xty, ws.beta, p);
+            }
+
+            // 残差（在读取完y之后写出，支持原地）
+            for (int i = 0; i < stocks; ++i) {
+                int g = ws.groups[i];
+                if (g < 0 || !std::isfinite(y[i])) {
+                    out[i] = kNaN;
+                    continue;
+                }
+                double fitted = ws.beta[g];
+                for (int k = 0; k < k_count; ++k) fitted += ws.beta[group_count + k] * ws.style_rows[k][i];
+                out[i] = y[i] - fitted;
+            }
+        }
+    }
+};
@@ -0,0 +1,322 @@
+#pragma once
+#include "data_structures.h"
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+// 盘口方向
+enum class BookSide { Bid, Ask };
+
+// 单个价位的聚合信息
+struct BookLevel {
+    double price = NAN;     // 价格
+    double volume = 0.0;    // 该价位挂单总量
+    int orders = 0;         // 该价位挂单笔数（队列长度）
+};
+
+// 逐笔重建的单只股票L2订单簿
+// 价位按最小变动价位离散为整数tick，存放在以首个报价为中心的连续价位数组中（越界时扩展），
+// 买卖一档及top-N深度只需在数组上顺序扫描；委托号 -> 挂单的哈希表使撤单和成交回报O(1)定位。
+// 每只股票的事件由同一线程处理，不加锁。
+class OrderBook {
+public:
+    // tick_size <= 0时按证券代码推断
+    explicit OrderBook(std::string symbol = "", double tick_size = 0.0)
+        : symbol_(std::move(symbol)), tick_size_(tick_size > 0 ? tick_size : infer_tick_size(symbol_)) {}
+
+    // 按证券代码推断最小变动价位：基金/ETF（沪市5开头，深市15/16/18开头）和可转债（沪市11、深市12开头）
+    // 为0.001元，其余为0.01元
+    static double infer_tick_size(const std::string& symbol) {
+        if (symbol.size() < 2) return 0.01;
+        bool sz = symbol.find(".SZ") != std::string::npos;
+        bool sh = symbol.find(".SH") != std::string::npos;
+        char c0 = symbol[0], c1 = symbol[1];
+        if (sh && (c0 == '5' || (c0 == '1' && c1 == '1'))) return 0.001;
+        if (sz && c0 == '1' && (c1 == '5' || c1 == '6' || c1 == '8' || c1 == '2')) return 0.001;
+        return 0.01;
+    }
+
+    // 委托：新增挂单，上交所删除委托（order_kind='D'）按撤单处理
+    void on_order(const OrderData& order) {
+        last_update_time_ = order.real_time;
+        if (order.order_kind == 'D') {
+            reduce_order(order.order_number, order.volume > 0 ? order.volume : -1.0);
+            return;
+        }
+        bool is_bid = is_bid_flag(order.bs_flag);
+        if (!is_bid && !is_ask_flag(order.bs_flag)) return;
+        BookSide side = is_bid ? BookSide::Bid : BookSide::Ask;
+
+        int64_t tick = 0;
+        if (order.price > 0) {
+            tick = to_tick(order.price);
+        } else if (order.order_kind == 'U') {
+            // 本方最优：以本方当前最优价挂单
+            int best = side == BookSide::Bid ? best_bid_ : best_ask_;
+            if (!has_level(best)) return;
+            tick = base_tick_ + best;
+        } else {
+            // 市价委托立即与对手方成交，不进入簿内，成交由逐笔成交回报扣减对手方挂单
+            return;
+        }
+        if (order.volume <= 0) return;
+
+        // 首次挂单时才预留挂单表，没有逐笔委托的股票不占内存
+        if (orders_.empty() && orders_.bucket_count() < kInitialOrderCapacity) orders_.reserve(kInitialOrderCapacity);
+        auto [it, inserted] = orders_.try_emplace(order.order_number);
+        if (!inserted) {
+            // 重复委托号：视为改单，先移除旧挂单
+            remove_from_level(it->second, it->second.remaining);
+        }
+        int idx = ensure_tick(tick);
+        it->second = {tick, order.volume, side};
+        Level& level = levels_[idx];
+        if (side == BookSide::Bid) {
+            level.bid_volume += order.volume;
+            level.bid_orders++;
+            if (idx > best_bid_) best_bid_ = idx;
+        } else {
+            level.ask_volume += order.volume;
+            level.ask_orders++;
+            if (best_ask_ < 0 || idx < best_ask_) best_ask_ = idx;
+        }
+    }
+
+    // 成交：扣减买卖双方挂单；深交所撤单以成交回报的形式下发（cancel_flag='C'或价格为0）
+    void on_trade(const TradeData& trade) {
+        last_update_time_ = trade.real_time;
+        if (trade.cancel_flag == 'C' || trade.price <= 0) {
+            reduce_order(trade.bid_no != 0 ? trade.bid_no : trade.ask_no, trade.volume);
+            return;
+        }
+        reduce_order(trade.bid_no, trade.volume);
+        reduce_order(trade.ask_no, trade.volume);
+        last_trade_price_ = trade.price;
+    }
+
+    // 清空订单簿（换日时调用）
+    void clear() {
+        orders_.clear();
+        levels_.clear();
+        base_tick_ = 0;
+        best_bid_ = -1;
+        best_ask_ = -1;
+        last_trade_price_ = NAN;
+        last_update_time_ = 0;
+    }
+
+    // 新增：检查点读写（挂单表、价位数组和最优价位置原样保存）
+    void save_state(BinaryWriter& out) const {
+        out.put(tick_size_);
+        out.put(base_tick_);
+        out.put<int32_t>(best_bid_);
+        out.put<int32_t>(best_ask_);
+        out.put(last_trade_price_);
+        out.put(last_update_time_);
+        out.put_vector(levels_);
+        out.put<uint64_t>(orders_.size());
+        for (const auto& [order_number, order] : orders_) {
+            out.put(order_number);
+            out.put(order);
+        }
+    }
+
+    bool restore_state(BinaryReader& in) {
+        OrderBook book(symbol_);
+        int32_t best_bid = -1, best_ask = -1;
+        uint64_t order_count = 0;
+        if (!in.get(book.tick_size_) || !in.get(book.base_tick_) || !in.get(best_bid) || !in.get(best_ask) ||
+            !in.get(book.last_trade_price_) || !in.get(book.last_update_time_) || !in.get_vector(book.levels_) ||
+            !in.get(order_count) || order_count > in.remaining() / (sizeof(int64_t) + sizeof(RestingOrder))) {
+            return false;
+        }
+        const int level_count = static_cast<int>(book.levels_.size());
+        if (best_bid < -1 || best_bid >= level_count || best_ask < -1 || best_ask >= level_count) return false;
+        book.best_bid_ = best_bid;
+        book.best_ask_ = best_ask;
+        for (uint64_t i = 0; i < order_count; ++i) {
+            int64_t order_number = 0;
+            RestingOrder order;
+            if (!in.get(order_number) || !in.get(order)) return false;
+            if (order.tick < book.base_tick_ ||
+                order.tick >= book.base_tick_ + static_cast<int64_t>(book.levels_.size())) {
+                return false;
+            }
+            book.orders_.emplace(order_number, order);
+        }
+        *this = std::move(book);
+        return true;
+    }
+
+    const std::string& symbol() const { return symbol_; }
+    double tick_size() const { return tick_size_; }
+    uint64_t last_update_time() const { return last_update_time_; }
+    double last_trade_price() const { return last_trade_price_; }
+    size_t order_count() const { return orders_.size(); }
+
+    // 买一/卖一价，无挂单时返回NaN
+    double best_bid() const { return has_level(best_bid_) ? to_price(best_bid_) : NAN; }
+    double best_ask() const { return has_level(best_ask_) ? to_price(best_ask_) : NAN; }
+
+    double mid_price() const {
+        double bid = best_bid();
+        double ask = best_ask();
+        return (std::isnan(bid) || std::isnan(ask)) ? NAN : (bid + ask) / 2.0;
+    }
+
+    double spread() const { return best_ask() - best_bid(); }
+
+    // 最优价位的排队信息（挂单总量与笔数）
+    BookLevel best_level(BookSide side) const {
+        BookLevel level;
+        depth(side, 1, &level);
+        return level;
+    }
+
+    // 前n档深度（从最优价向外），写入out，返回实际档数
+    int depth(BookSide side, int n, BookLevel* out) const {
+        int count = 0;
+        if (side == BookSide::Bid) {
+            for (int idx = best_bid_; idx >= 0 && count < n; --idx) {
+                const Level& level = levels_[idx];
+                if (level.bid_orders > 0) out[count++] = {to_price(idx), level.bid_volume, level.bid_orders};
+            }
+        } else if (best_ask_ >= 0) {
+            for (int idx = best_ask_; idx < static_cast<int>(levels_.size()) && count < n; ++idx) {
+                const Level& level = levels_[idx];
+                if (level.ask_orders > 0) out[count++] = {to_price(idx), level.ask_volume, level.ask_orders};
+            }
+        }
+        return count;
+    }
+
+    std::vector<BookLevel> depth(BookSide side, int n) const {
+        std::vector<BookLevel> levels(n);
+        levels.resize(depth(side, n, levels.data()));
+        return levels;
+    }
+
+    // 前n档挂单总量
+    double depth_volume(BookSide side, int n) const {
+        double total = 0.0;
+        int count = 0;
+        if (side == BookSide::Bid) {
+            for (int idx = best_bid_; idx >= 0 && count < n; --idx) {
+                if (levels_[idx].bid_orders > 0) { total += levels_[idx].bid_volume; ++count; }
+            }
+        } else if (best_ask_ >= 0) {
+            for (int idx = best_ask_; idx < static_cast<int>(levels_.size()) && count < n; ++idx) {
+                if (levels_[idx].ask_orders > 0) { total += levels_[idx].ask_volume; ++count; }
+            }
+        }
+        return total;
+    }
+
+    // 前n档委托量不平衡度：(买量 - 卖量) / (买量 + 卖量)，双边都无挂单时返回NaN
+    double imbalance(int n = 1) const {
+        double bid = depth_volume(BookSide::Bid, n);
+        double ask = depth_volume(BookSide::Ask, n);
+        double total = bid + ask;
+        return total > 0 ? (bid - ask) / total : NAN;
+    }
+
+private:
+    struct Level {
+        double bid_volume = 0.0;
+        double ask_volume = 0.0;
+        int32_t bid_orders = 0;
+        int32_t ask_orders = 0;
+    };
+
+    struct RestingOrder {
+        int64_t tick = 0;           // 价格（整数tick）
+        double remaining = 0.0;     // 剩余未成交量
+        BookSide side = BookSide::Bid;
+    };
+
+    static constexpr size_t kInitialOrderCapacity = 1 << 14;
+    static constexpr int kInitialHalfWidth = 1024;     // 初始价位数组覆盖首个报价上下各1024档
+
+    static bool is_bid_flag(char flag) { return flag == 'B' || flag == '1'; }
+    static bool is_ask_flag(char flag) { return flag == 'S' || flag == '2'; }
+
+    int64_t to_tick(double price) const { return static_cast<int64_t>(std::llround(price / tick_size_)); }
+    double to_price(int idx) const { return static_cast<double>(base_tick_ + idx) * tick_size_; }
+    bool has_level(int idx) const { return idx >= 0 && idx < static_cast<int>(levels_.size()); }
+
+    // 保证tick落在价位数组内，返回其下标；越界时扩展数组（最优价下标随之平移）
+    int ensure_tick(int64_t tick) {
+        if (levels_.empty()) {
+            base_tick_ = std::max<int64_t>(0, tick - kInitialHalfWidth);
+            levels_.resize(static_cast<size_t>(tick - base_tick_ + kInitialHalfWidth));
+            return static_cast<int>(tick - base_tick_);
+        }
+        int64_t end_tick = base_tick_ + static_cast<int64_t>(levels_.size());
+        if (tick >= base_tick_ && tick < end_tick) {
+            return static_cast<int>(tick - base_tick_);
+        }
+        // 按越界方向至少扩展一倍，避免频繁搬移
+        int64_t grow = std::max<int64_t>(static_cast<int64_t>(levels_.size()), kInitialHalfWidth);
+        int64_t new_base = tick < base_tick_ ? std::max<int64_t>(0, std::min(tick, base_tick_ - grow)) : base_tick_;
+        int64_t new_end = tick >= end_tick ? std::max(tick + 1, end_tick + grow) : end_tick;
+        int shift = static_cast<int>(base_tick_ - new_base);
+        std::vector<Level> levels(static_cast<size_t>(new_end - new_base));
+        std::copy(levels_.begin(), levels_.end(), levels.begin() + shift);
+        levels_.swap(levels);
+        base_tick_ = new_base;
+        if (best_bid_ >= 0) best_bid_ += shift;
+        if (best_ask_ >= 0) best_ask_ += shift;
+        return static_cast<int>(tick - base_tick_);
+    }
+
+    // 扣减挂单剩余量，quantity < 0表示全部撤销；未知委托号（市价单、簿外委托）忽略
+    void reduce_order(int64_t order_number, double quantity) {
+        if (order_number == 0) return;
+        auto it = orders_.find(order_number);
+        if (it == orders_.end()) return;
+        RestingOrder& order = it->second;
+        double filled = (quantity < 0 || quantity >= order.remaining) ? order.remaining : quantity;
+        remove_from_level(order, filled);
+        order.remaining -= filled;
+        if (order.remaining <= 0) orders_.erase(it);
+    }
+
+    // 从价位上扣减filled；挂单完全消失时减少笔数，必要时重新定位最优价
+    void remove_from_level(const RestingOrder& order, double filled) {
+        int idx = static_cast<int>(order.tick - base_tick_);
+        Level& level = levels_[idx];
+        bool gone = filled >= order.remaining;
+        if (order.side == BookSide::Bid) {
+            level.bid_volume -= filled;
+            if (gone && --level.bid_orders == 0) {
+                level.bid_volume = 0.0;
+                if (idx == best_bid_) {
+                    while (best_bid_ >= 0 && levels_[best_bid_].bid_orders == 0) --best_bid_;
+                }
+            }
+        } else {
+            level.ask_volume -= filled;
+            if (gone && --level.ask_orders == 0) {
+                level.ask_volume = 0.0;
+                if (idx == best_ask_) {
+                    int size = static_cast<int>(levels_.size());
+                    while (best_ask_ < size && levels_[best_ask_].ask_orders == 0) ++best_ask_;
+                    if (best_ask_ >= size) best_ask_ = -1;
+                }
+            }
+        }
+    }
+
+    std::string symbol_;
+    double tick_size_;
+    std::unordered_map<int64_t, RestingOrder> orders_;   // 委托号 -> 挂单
+    std::vector<Level> levels_;                          // 价位数组，下标 = tick - base_tick_
+    int64_t base_tick_ = 0;
+    int best_bid_ = -1;                                  // 买一下标，-1表示无买单
+    int best_ask_ = -1;                                  // 卖一下标，-1表示无卖单
+    double last_trade_price_ = NAN;
+    uint64_t last_update_time_ = 0;
+};
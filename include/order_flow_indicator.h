@@ -0,0 +1,107 @@
+#pragma once
+#include "data_structures.h"
+#include "indicator_storage_helper.h"
+// 前向声明，避免循环包含
+class CalculationEngine;
+#include <memory>
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+
+// 订单流字段下标（与kOrderFlowFieldTable一一对应）
+enum OrderFlowField : size_t {
+    kActiveBuyVolume = 0,
+    kActiveBuyAmount,
+    kActiveSellVolume,
+    kActiveSellAmount,
+    kBuyOrderCount,
+    kSellOrderCount,
+    kLimitOrderCount,
+    kMarketOrderCount,
+    kCancelVolume,
+    kLargeBuyVolume,
+    kLargeSellVolume,
+    kLargeOrderVolume,
+    kTradeCountSmall,
+    kTradeCountMedium,
+    kTradeCountLarge,
+    kTradeCountXLarge,
+    kOrderFlowFieldCount
+};
+
+struct OrderFlowFieldDescriptor {
+    const char* output_key;           // 输出键名
+    const char* description;          // 字段描述
+};
+
+// 可选字段表（config.xml的fields属性从中选择，未配置时全部启用），所有字段桶内按Sum合并
+inline constexpr OrderFlowFieldDescriptor kOrderFlowFieldTable[kOrderFlowFieldCount] = {
+    {"active_buy_volume",  "主动买成交量"},
+    {"active_buy_amount",  "主动买成交额"},
+    {"active_sell_volume", "主动卖成交量"},
+    {"active_sell_amount", "主动卖成交额"},
+    {"buy_order_count",    "买方新增委托笔数"},
+    {"sell_order_count",   "卖方新增委托笔数"},
+    {"limit_order_count",  "限价委托笔数"},
+    {"market_order_count", "市价/本方最优委托笔数"},
+    {"cancel_volume",      "撤单量"},
+    {"large_buy_volume",   "大单主动买成交量"},
+    {"large_sell_volume",  "大单主动卖成交量"},
+    {"large_order_volume", "大单新增委托量"},
+    {"trade_count_small",  "小单成交笔数"},
+    {"trade_count_medium", "中单成交笔数"},
+    {"trade_count_large",  "大单成交笔数"},
+    {"trade_count_xlarge", "特大单成交笔数"},
+};
+
+// 订单流指标族 - 把快照间的逐笔成交(trans)和委托(orders)按桶汇总
+// 每批逐笔数据先整理为列式数组（按字段连续存放的double），再对各列做一次无分支的归约，
+// 结果通过预解析句柄写入基础频率和所有汇总频率
+// size_thresholds按成交金额划分小/中/大/特大单（默认4万、20万、100万），第二个阈值起算作大单
+class OrderFlowIndicator : public Indicator {
+public:
+    explicit OrderFlowIndicator(const ModuleConfig& module);
+
+    // 重写计算接口
+    void Calculate(const SyncTickData& tick_data) override;
+
+    // 新增：融合tick内核（使用CalculationEngine预解析的上下文）
+    void calculate_with_context(const IndicatorTickContext& ctx) override;
+
+    // 只保留下游因子实际读取的字段
+    void retain_fields(const std::set<std::string>& fields) override;
+
+    // 每只股票kOrderFlowFieldCount * kFrequencyCount个序列句柄槽（按 字段 × 频率 排布）
+    int handle_slot_count() const override { return static_cast<int>(kOrderFlowFieldCount) * kFrequencyCount; }
+
+    // 实现获取指定股票BarSeriesHolder的纯虚函数
+    BarSeriesHolder* get_stock_bar_holder(const std::string& stock_code) const override;
+
+    // 设置CalculationEngine引用（用于获取指定股票的BarSeriesHolder）
+    void set_calculation_engine(std::shared_ptr<CalculationEngine> engine);
+
+    // 聚合到指定频率（聚合第一个启用字段），所有字段可加
+    bool aggregate(const std::string& target_frequency, std::map<int, std::map<std::string, double>>& aggregated_data) override;
+
+    // 聚合指定字段到目标频率
+    bool aggregate_field(const std::string& output_key, const std::string& target_frequency,
+                         std::map<int, std::map<std::string, double>>& aggregated_data);
+
+    // 保存结果（每个启用字段一个文件）
+    bool save_results(const ModuleConfig& module, const std::string& date);
+
+    // 对一批逐笔成交/委托做列式归约，累加到totals（按OrderFlowField下标）
+    void reduce_trades(const std::vector<TradeData>& trades, double* totals) const;
+    void reduce_orders(const std::vector<OrderData>& orders, double* totals) const;
+
+private:
+    // 启用的字段在kOrderFlowFieldTable中的下标
+    std::vector<size_t> enabled_fields_;
+
+    // 按成交金额划分单笔大小的升序阈值（3个，划分4档）
+    double size_thresholds_[3] = {40000.0, 200000.0, 1000000.0};
+
+    // 指向CalculationEngine的指针（用于获取指定股票的BarSeriesHolder）
+    mutable std::shared_ptr<CalculationEngine> calculation_engine_;
+};
@@ -0,0 +1,337 @@
+#pragma once
+
+#include "data_structures.h"
+#include "config.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <limits>
+#include <functional>
+#include <zlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "spdlog/spdlog.h"
+
+// 盘中结果日志（.journal）：每个模块一个只追加文件，时间桶一封口就把该桶的截面写进去
+//
+// 文件布局（本机字节序）：
+//   [Header]   魔数、版本、股票数、股票字典的crc32
+//   [股票字典] stock_count个 (u16长度 + 股票代码字节)，截面按此顺序存放
+//   [记录]...  Record{魔数, ti, 数值个数, crc32} + count个double（NaN为缺失）
+// 同一ti可出现多条记录（如崩溃后重跑），读取时按写入顺序用非NaN值覆盖，与引擎内存储的语义一致
+// 进程崩溃时最后一条记录可能只写了一半，读取到第一条不完整/校验失败的记录即停止，之前的记录都有效
+//
+// 写入：每条记录一次fwrite + fflush，进程崩溃不丢已封口的桶；fsync按JournalSync决定是否等落盘
+// 收盘时compact顺序读一遍日志（O(文件大小)）得到整日的列，写成与save_factor相同的日文件
+class ResultJournal {
+public:
+    static constexpr char kMagic[8] = {'A', 'F', 'J', 'O', 'U', 'R', 'N', 'L'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kRecordMagic = 0x4B434254;  // "TBCK"
+    static constexpr const char* kExtension = ".journal";
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t stock_count;
+        uint32_t dict_bytes;
+        uint32_t dict_crc;
+    };
+    static_assert(sizeof(Header) == 24, "ResultJournal::Header布局变化会破坏已有日志");
+
+    struct Record {
+        uint32_t magic;
+        int32_t ti;
+        uint32_t count;
+        uint32_t crc;       // ti、count和数值部分的crc32
+    };
+    static_assert(sizeof(Record) == 16, "ResultJournal::Record布局变化会破坏已有日志");
+
+    ResultJournal() = default;
+    ResultJournal(const ResultJournal&) = delete;
+    ResultJournal& operator=(const ResultJournal&) = delete;
+    ~ResultJournal() { close(); }
+
+    // 打开日志：文件不存在时新建；已存在且股票字典相同时（上次运行中途退出）截掉不完整的尾部后继续追加
+    bool open(const std::string& file_path, const std::vector<std::string>& stocks, JournalSync sync) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        close_locked();
+        path_ = file_path;
+        stocks_ = stocks;
+        sync_ = sync;
+        pending_ti_ = -1;
+        sealed_count_ = 0;
+
+        std::string dict = encode_dict(stocks);
+        Header header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.stock_count = static_cast<uint32_t>(stocks.size());
+        header.dict_bytes = static_cast<uint32_t>(dict.size());
+        header.dict_crc = crc32_of(dict.data(), dict.size());
+
+        std::vector<std::string> existing_stocks;
+        uint64_t valid_bytes = 0;
+        struct stat st {};
+        if (::stat(file_path.c_str(), &st) == 0 && st.st_size > 0) {
+            size_t records = scan(file_path, existing_stocks, valid_bytes, nullptr);
+            if (valid_bytes > 0 && existing_stocks == stocks) {
+                if (static_cast<uint64_t>(st.st_size) > valid_bytes &&
+                    ::truncate(file_path.c_str(), static_cast<off_t>(valid_bytes)) != 0) {
+                    spdlog::error("ResultJournal: 无法截断日志尾部: {}", file_path);
+                    return false;
+                }
+                fp_ = std::fopen(file_path.c_str(), "ab");
+                if (!fp_) {
+                    spdlog::error("ResultJournal: 无法打开日志: {}", file_path);
+                    return false;
+                }
+                spdlog::info("ResultJournal: 续写已有日志{}（{}条有效记录）", file_path, records);
+                return true;
+            }
+            spdlog::warn("ResultJournal: 已有日志{}无效或股票列表不同，重新创建", file_path);
+        }
+
+        fp_ = std::fopen(file_path.c_str(), "wb");
+        if (!fp_) {
+            spdlog::error("ResultJournal: 无法创建日志: {}", file_path);
+            return false;
+        }
+        if (std::fwrite(&header, sizeof(header), 1, fp_) != 1 ||
+            std::fwrite(dict.data(), 1, dict.size(), fp_) != dict.size() || !flush_locked(true)) {
+            spdlog::error("ResultJournal: 日志头写入失败: {}", file_path);
+            std::fclose(fp_);
+            fp_ = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    bool is_open() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return fp_ != nullptr;
+    }
+
+    const std::string& path() const { return path_; }
+
+    // 提交时间桶ti的截面（values按open时的股票顺序）
+    // 同一ti可多次提交（时间事件比因子频率密时），非NaN值覆盖之前的值；ti变化时上一个桶封口并写入日志
+    void stage(int ti, const GSeries& values) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!fp_ || ti < 0) return;
+        if (pending_ti_ >= 0 && ti != pending_ti_) append_pending_locked();
+        if (pending_ti_ != ti) {
+            pending_ti_ = ti;
+            pending_.assign(stocks_.size(), std::numeric_limits<double>::quiet_NaN());
+        }
+        int count = std::min(values.get_size(), static_cast<int>(pending_.size()));
+        for (int i = 0; i < count; ++i) {
+            double value = values.get(i);
+            if (!std::isnan(value)) pending_[i] = value;
+        }
+    }
+
+    // 把尚未封口的桶写入日志（当日时间事件处理完时调用，最后一个桶没有后继事件来封口）
+    void seal() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fp_ && pending_ti_ >= 0) append_pending_locked();
+    }
+
+    // 封口剩余的桶并关闭文件，JournalSync::Close及以上在此fsync
+    bool close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return close_locked();
+    }
+
+    size_t sealed_count() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sealed_count_;
+    }
+
+    // 顺序读取日志，按写入顺序对每条完整记录调用on_record(ti, values, count)，返回有效记录数
+    // stocks输出日志的股票字典，valid_bytes输出最后一条有效记录的结束位置；文件头无效时返回0且valid_bytes为0
+    static size_t scan(const std::string& file_path, std::vector<std::string>& stocks, uint64_t& valid_bytes,
+                       const std::function<void(int, const double*, uint32_t)>& on_record) {
+        stocks.clear();
+        valid_bytes = 0;
+        std::vector<char> data;
+        if (!read_file(file_path, data)) return 0;
+
+        Header header{};
+        if (data.size() < sizeof(Header)) return 0;
+        std::memcpy(&header, data.data(), sizeof(Header));
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+            data.size() < sizeof(Header) + header.dict_bytes ||
+            crc32_of(data.data() + sizeof(Header), header.dict_bytes) != header.dict_crc) {
+            spdlog::error("ResultJournal: 日志头无效: {}", file_path);
+            return 0;
+        }
+        if (!decode_dict(data.data() + sizeof(Header), header.dict_bytes, header.stock_count, stocks)) {
+            spdlog::error("ResultJournal: 股票字典无效: {}", file_path);
+            stocks.clear();
+            return 0;
+        }
+
+        size_t offset = sizeof(Header) + header.dict_bytes;
+        valid_bytes = offset;
+        size_t records = 0;
+        std::vector<double> values;
+        while (offset + sizeof(Record) <= data.size()) {
+            Record record{};
+            std::memcpy(&record, data.data() + offset, sizeof(Record));
+            size_t payload = static_cast<size_t>(record.count) * sizeof(double);
+            if (record.magic != kRecordMagic || record.ti < 0 || record.count > header.stock_count ||
+                offset + sizeof(Record) + payload > data.size()) {
+                break;
+            }
+            const char* body = data.data() + offset + sizeof(Record);
+            if (record_crc(record.ti, record.count, body, payload) != record.crc) break;
+            if (on_record) {
+                values.resize(record.count);
+                std::memcpy(values.data(), body, payload);
+                on_record(record.ti, values.data(), record.count);
+            }
+            offset += sizeof(Record) + payload;
+            valid_bytes = offset;
+            ++records;
+        }
+        if (offset < data.size()) {
+            spdlog::warn("ResultJournal: {}在偏移{}处有{}字节不完整的记录，已忽略",
+                         file_path, offset, data.size() - offset);
+        }
+        return records;
+    }
+
+    // 读出整日的列：columns[i]为stocks[i]的序列，长度为最后一个有有效值的时间桶+1（无有效值时为0）
+    static bool compact(const std::string& file_path, std::vector<std::string>& stocks,
+                        std::vector<std::vector<double>>& columns, int& rows) {
+        columns.clear();
+        rows = 0;
+        uint64_t valid_bytes = 0;
+        std::vector<std::string> dict;
+        // 一遍顺序扫描：列随出现的最大ti增长，按非NaN覆盖填值，最后截到最后一个有有效值的时间桶
+        scan(file_path, dict, valid_bytes, [&](int ti, const double* values, uint32_t count) {
+            if (columns.empty()) columns.resize(dict.size());
+            for (uint32_t i = 0; i < count; ++i) {
+                if (std::isnan(values[i])) continue;
+                if (static_cast<int>(columns[i].size()) <= ti) {
+                    columns[i].resize(ti + 1, std::numeric_limits<double>::quiet_NaN());
+                }
+                columns[i][ti] = values[i];
+                rows = std::max(rows, ti + 1);
+            }
+        });
+        if (valid_bytes == 0) return false;
+        columns.resize(dict.size());
+        for (auto& column : columns) column.resize(rows, std::numeric_limits<double>::quiet_NaN());
+        stocks = std::move(dict);
+        return true;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    FILE* fp_ = nullptr;
+    std::string path_;
+    std::vector<std::string> stocks_;
+    JournalSync sync_ = JournalSync::None;
+    int pending_ti_ = -1;
+    std::vector<double> pending_;
+    std::vector<char> record_buffer_;
+    size_t sealed_count_ = 0;
+
+    void append_pending_locked() {
+        Record record{};
+        record.magic = kRecordMagic;
+        record.ti = pending_ti_;
+        record.count = static_cast<uint32_t>(pending_.size());
+        size_t payload = pending_.size() * sizeof(double);
+        record.crc = record_crc(record.ti, record.count, reinterpret_cast<const char*>(pending_.data()), payload);
+
+        // 整条记录拼好后一次写入，减少崩溃时留下半条记录的机会
+        record_buffer_.resize(sizeof(Record) + payload);
+        std::memcpy(record_buffer_.data(), &record, sizeof(Record));
+        std::memcpy(record_buffer_.data() + sizeof(Record), pending_.data(), payload);
+        if (std::fwrite(record_buffer_.data(), 1, record_buffer_.size(), fp_) != record_buffer_.size() ||
+            !flush_locked(sync_ == JournalSync::Bucket)) {
+            spdlog::error("ResultJournal: 写入时间桶{}失败: {}", pending_ti_, path_);
+        } else {
+            ++sealed_count_;
+        }
+        pending_ti_ = -1;
+        pending_.clear();
+    }
+
+    bool flush_locked(bool durable) {
+        if (std::fflush(fp_) != 0) return false;
+        return !durable || ::fsync(::fileno(fp_)) == 0;
+    }
+
+    bool close_locked() {
+        if (!fp_) return true;
+        if (pending_ti_ >= 0) append_pending_locked();
+        bool ok = flush_locked(sync_ != JournalSync::None);
+        if (std::fclose(fp_) != 0) ok = false;
+        fp_ = nullptr;
+        if (!ok) spdlog::error("ResultJournal: 关闭日志失败: {}", path_);
+        return ok;
+    }
+
+    static uint32_t crc32_of(const char* data, size_t length) {
+        return static_cast<uint32_t>(::crc32(0L, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(length)));
+    }
+
+    static uint32_t record_crc(int32_t ti, uint32_t count, const char* payload, size_t length) {
+        uLong crc = ::crc32(0L, reinterpret_cast<const Bytef*>(&ti), sizeof(ti));
+        crc = ::crc32(crc, reinterpret_cast<const Bytef*>(&count), sizeof(count));
+        crc = ::crc32(crc, reinterpret_cast<const Bytef*>(payload), static_cast<uInt>(length));
+        return static_cast<uint32_t>(crc);
+    }
+
+    static std::string encode_dict(const std::vector<std::string>& stocks) {
+        std::string dict;
+        for (const auto& stock : stocks) {
+            uint16_t len = static_cast<uint16_t>(std::min<size_t>(stock.size(), 0xFFFF));
+            dict.append(reinterpret_cast<const char*>(&len), sizeof(len));
+            dict.append(stock, 0, len);
+        }
+        return dict;
+    }
+
+    static bool decode_dict(const char* data, size_t length, uint32_t stock_count, std::vector<std::string>& stocks) {
+        size_t offset = 0;
+        stocks.reserve(stock_count);
+        for (uint32_t i = 0; i < stock_count; ++i) {
+            uint16_t len = 0;
+            if (offset + sizeof(len) > length) return false;
+            std::memcpy(&len, data + offset, sizeof(len));
+            offset += sizeof(len);
+            if (offset + len > length) return false;
+            stocks.emplace_back(data + offset, len);
+            offset += len;
+        }
+        return offset == length;
+    }
+
+    static bool read_file(const std::string& file_path, std::vector<char>& data) {
+        FILE* fp = std::fopen(file_path.c_str(), "rb");
+        if (!fp) {
+            spdlog::error("ResultJournal: 无法打开日志: {}", file_path);
+            return false;
+        }
+        std::fseek(fp, 0, SEEK_END);
+        long size = std::ftell(fp);
+        std::fseek(fp, 0, SEEK_SET);
+        bool ok = size >= 0;
+        if (ok) {
+            data.resize(static_cast<size_t>(size));
+            ok = data.empty() || std::fread(data.data(), 1, data.size(), fp) == data.size();
+        }
+        std::fclose(fp);
+        if (!ok) spdlog::error("ResultJournal: 读取日志失败: {}", file_path);
+        return ok;
+    }
+};
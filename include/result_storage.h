@@ -9,6 +9,10 @@
 #include "cal_engine.h"
 #include "config.h"
 #include "diff_indicator.h"
+#include "order_flow_indicator.h"
+#include "columnar_file.h"
+#include "gz_table_writer.h"
+#include "result_journal.h"
 #include <fstream>
 #include <zlib.h>
 #include <filesystem>
@@ -55,11 +59,14 @@ public:
                     return diff_ind->save_results(module, date, cal_engine);
                 }
             }
+            // 订单流指标为多字段输出，每个字段一个文件
+            if (auto order_flow_ind = std::dynamic_pointer_cast<OrderFlowIndicator>(indicator)) {
+                return order_flow_ind->save_results(module, date);
+            }
 
             // 3. 创建存储目录
             fs::path base_path = fs::path(module.path) / date / module.frequency;
-            if (!fs::exists(base_path) && !fs::create_directories(base_path)) {
-                spdlog::error("创建目录失败: {}", base_path.string());
+            if (!IndicatorStorageHelper::ensure_directory(base_path.string())) {
                 return false;
             }
 
@@ -82,109 +89,60 @@ public:
                 stock_list.push_back(stock_code);
             }
 
-            // 按bar_index分组收集数据
-            std::map<int, std::map<std::string, double>> bar_data;  // bar_index -> {股票 -> 数值}
-            int max_bar_index = -1;
-
             int bars_per_day = indicator->get_bars_per_day();
-            for (const auto& [stock_code, holder_ptr] : all_bar_holders) {
+
+            // 对于DiffIndicator，需要特殊处理
+            std::string key_to_use = module.name;
+            if (module.id == "DiffIndicator") {
+                // DiffIndicator使用第一个字段的output_key作为默认键
+                // 这里我们暂时使用"volume"作为默认键，实际应该从DiffIndicator获取
+                key_to_use = "volume";
+                spdlog::debug("DiffIndicator[{}]使用键名: {}", module.name, key_to_use);
+            }
+
+            // 按股票取T日序列视图作为列（float32存储时读取提升为double），不再经过 时间桶 -> 股票 的map
+            std::vector<GSeriesView> columns;
+            columns.reserve(stock_list.size());
+            bool has_data = false;
+            for (const auto& stock_code : stock_list) {
+                const auto& holder_ptr = all_bar_holders.at(stock_code);
                 if (!holder_ptr) {
                     spdlog::warn("股票[{}]的BarSeriesHolder为空，跳过", stock_code);
+                    columns.emplace_back();
                     continue;
                 }
-                
-                const BarSeriesHolder* holder = holder_ptr.get();
-                if (!holder) {
-                    spdlog::warn("股票[{}]的BarSeriesHolder指针为空，跳过", stock_code);
-                    continue;
-                }
-                
-                // 对于DiffIndicator，需要特殊处理
-                std::string key_to_use = module.name;
-                if (module.id == "DiffIndicator") {
-                    // DiffIndicator使用第一个字段的output_key作为默认键
-                    // 这里我们暂时使用"volume"作为默认键，实际应该从DiffIndicator获取
-                    key_to_use = "volume";
-                    spdlog::debug("DiffIndicator[{}]使用键名: {}", module.name, key_to_use);
-                }
-                
-                // 从BarSeriesHolder获取T日数据
-                GSeries series = holder->get_m_bar(key_to_use);
-                
-                // 检查series是否有效
+                GSeriesView series = holder_ptr->get_m_bar_view(key_to_use);
                 if (series.get_size() == 0) {
                     spdlog::warn("指标[{}]的股票[{}]键[{}]数据为空，跳过", module.name, stock_code, key_to_use);
-                    continue;
-                }
-                
-                // 确保series长度和bars_per_day一致
-                if (series.get_size() < bars_per_day) {
-                    series.resize(bars_per_day);
-                }
-                
-                for (int ti = 0; ti < bars_per_day; ++ti) {
-                    double value = series.get(ti);
-                    bar_data[ti][stock_code] = value;
-                    if (ti > max_bar_index) max_bar_index = ti;
+                } else {
+                    has_data = true;
                 }
+                columns.push_back(series);
             }
 
-            if (bar_data.empty()) {
+            if (!has_data) {
                 spdlog::warn("指标[{}]无有效数据可保存", module.name);
                 return true;
             }
 
-            // 4. 生成GZ压缩文件（格式：指标名_日期_频率.csv.gz）
-            std::string filename = fmt::format("{}_{}_{}.csv.gz",
-                                               module.name, date, module.frequency);
-            fs::path file_path = base_path / filename;
-
-            // 5. 写入GZ文件
-            gzFile gz_file = gzopen(file_path.string().c_str(), "wb");
-            if (!gz_file) {
-                spdlog::error("无法创建GZ文件: {}", file_path.string());
-                return false;
-            }
-
-            // 5.1 写入表头（bar_index + 所有股票代码）
-            std::string header = "bar_index";
-            for (const auto& stock_code : stock_list) {
-                header += "," + stock_code;
-            }
-            header += "\n";
-            gzwrite(gz_file, header.data(), header.size());
-
-            // 5.2 按bar_index写入每行数据（确保所有bar_index连续）
-            for (int ti = 0; ti <= max_bar_index; ++ti) {
-                std::string line = std::to_string(ti);  // 行首为bar_index
-
-                // 为每个股票填充对应bar的数据
-                for (const auto& stock_code : stock_list) {
-                    auto bar_it = bar_data.find(ti);
-                    if (bar_it != bar_data.end()) {
-                        auto stock_it = bar_it->second.find(stock_code);
-                        if (stock_it != bar_it->second.end()) {
-                            double value = stock_it->second;
-                            if (std::isnan(value)) {
-                                line += ",";  // NaN值留空
-                            } else {
-                                line += fmt::format(",{:.6f}", value);  // 有数据
-                            }
-                        } else {
-                            line += ",";  // 无数据（留空）
-                        }
-                    } else {
-                        line += ",";  // 该bar_index无任何数据
-                    }
+            // 4. 生成结果文件：列式.col，或GZ压缩宽表（格式：指标名_日期_频率.csv.gz，长度不足bars_per_day的部分留空）
+            fs::path file_path;
+            if (is_columnar_format(module.format)) {
+                file_path = base_path / fmt::format("{}_{}_{}{}", module.name, date, module.frequency,
+                                                    ColumnarFile::kExtension);
+                if (!ColumnarFile::write(file_path.string(), module.frequency, stock_list, columns, bars_per_day,
+                                         module.precision, module.format == StorageFormat::ColumnarZlib)) {
+                    return false;
+                }
+            } else {
+                file_path = base_path / fmt::format("{}_{}_{}.csv.gz", module.name, date, module.frequency);
+                if (!GzTableWriter::write(file_path.string(), stock_list, columns, bars_per_day)) {
+                    return false;
                 }
-                line += "\n";
-                gzwrite(gz_file, line.data(), line.size());
             }
 
-            // 6. 关闭文件并输出日志
-            gzclose(gz_file);
             spdlog::info("指标[{}]数据保存成功：{}（{}个时间桶，{}只股票）",
-                         module.name, file_path.string(), max_bar_index + 1, stock_list.size());
+                         module.name, file_path.string(), bars_per_day, stock_list.size());
             return true;
 
         } catch (const std::exception& e) {
@@ -235,6 +193,12 @@ public:
             std::string hist_date = get_prev_date(T_date, i);
             spdlog::info("开始加载历史日期[{}]的指标数据", hist_date);
             std::vector<std::string> hist_stock_list = load_stock_list(universe, hist_date);
+
+            // 列式文件（.col）优先
+            if (load_columnar_indicator_files(module, hist_date, i, cal_engine)) {
+                spdlog::info("历史日期[{}]列式指标数据加载完成", hist_date);
+                continue;
+            }
             
             // 检查是否为多元素指标
             fs::path base_path = fs::path(module.path) / hist_date / module.frequency;
@@ -276,14 +240,15 @@ public:
                     }
                     
                     // 将每个output_key的数据存储到对应的股票下
-                    for (const auto& [stock, series] : stock_series) {
-                        stock_output_data[stock][output_key] = series;
+                    for (auto& [stock, series] : stock_series) {
+                        stock_output_data[stock][output_key] = std::move(series);
                     }
                 }
                 
-                // 将多元素历史数据直接存储到indicator的存储结构中
+                // 将多元素历史数据直接存储到BarSeriesHolder的历史序列中
                 if (!stock_output_data.empty()) {
-                    store_multiple_historical_indicator_data(indicator, hist_date, i, stock_output_data);
+                    store_multiple_historical_indicator_data(indicator, hist_date, i, stock_output_data,
+                                                             module.frequency, module.precision, cal_engine);
                     spdlog::info("历史日期[{}]多元素指标数据存储完成", hist_date);
                 }
                 
@@ -295,23 +260,19 @@ public:
                     continue;
                 }
                 
-                // 步骤4：重索引并存储到indicator->get_storage()
+                // 步骤4：重索引并存储到BarSeriesHolder的多日缓冲（按模块配置的精度）
+                int bar_count = 0;
+                if (!hist_stock_list.empty() && hist_raw_data.count(hist_stock_list[0])) {
+                    bar_count = hist_raw_data.at(hist_stock_list[0]).get_size();
+                }
+                const GSeries empty_series(bar_count);  // 不存在的股票用NAN填充
                 for (const auto& stock : T_stock_list) {
-                    GSeries series;
-                    if (hist_raw_data.count(stock)) {
-                        series = hist_raw_data.at(stock);
-                    } else {
-                        // 不存在的股票用NAN填充
-                        int bar_count = 0;
-                        if (!hist_stock_list.empty() && hist_raw_data.count(hist_stock_list[0])) {
-                            bar_count = hist_raw_data.at(hist_stock_list[0]).get_size();
-                        }
-                        for (int k = 0; k < bar_count; ++k) {
-                            series.push(NAN);
-                        }
+                    auto raw_it = hist_raw_data.find(stock);
+                    const GSeries& series = raw_it != hist_raw_data.end() ? raw_it->second : empty_series;
+                    auto holder = cal_engine ? cal_engine->get_bar_series_holder(stock) : nullptr;
+                    if (holder) {
+                        holder->set_his_series_with_frequency(module.frequency, module.name, i, series, module.precision);
                     }
-                    // TODO: 由于Indicator不再有本地存储，需要从CalculationEngine获取数据
-                    spdlog::warn("load_and_reindex_indicator: 需要从CalculationEngine获取数据，当前跳过存储");
                 }
                 spdlog::info("历史日期[{}]单元素指标重索引完成", hist_date);
             }
@@ -333,6 +294,11 @@ static bool load_single_day_indicator(
     spdlog::info("更新指标[{}]频率为: {}", module.name, module.frequency);
     
     fs::path base_path = fs::path(module.path) / date / module.frequency;
+
+    // 0. 列式文件（.col）优先，mmap后直接按列写入，不做文本解析
+    if (load_columnar_indicator_files(module, date, 0, cal_engine)) {
+        return true;
+    }
     
     // 1. 尝试加载单文件（兼容现有Indicator）
     fs::path single_file = base_path / fmt::format("{}_{}_{}.csv.gz", 
@@ -356,6 +322,76 @@ static bool load_single_day_indicator(
     return false;
 }
 
+// 新增：加载列式指标文件（{name}_{date}_{freq}.col 或多字段的 {name}_{output_key}_{date}_{freq}.col）
+// mmap后把每只股票的列视图直接写入BarSeriesHolder：his_day_index为0时写T日序列，否则写对应的历史日槽
+// 返回是否找到并加载了列式文件；没有时由调用方回退到csv.gz
+static bool load_columnar_indicator_files(
+        const ModuleConfig& module,
+        const std::string& date,
+        int his_day_index,
+        const std::shared_ptr<CalculationEngine>& cal_engine
+) {
+    fs::path base_path = fs::path(module.path) / date / module.frequency;
+    std::vector<std::pair<std::string, fs::path>> files;  // output_key -> 文件
+    fs::path single_file = base_path / fmt::format("{}_{}_{}{}", module.name, date, module.frequency,
+                                                   ColumnarFile::kExtension);
+    if (fs::exists(single_file)) {
+        files.emplace_back(module.name, single_file);
+    } else {
+        std::string prefix = fmt::format("{}_", module.name);
+        std::string suffix = fmt::format("_{}_{}{}", date, module.frequency, ColumnarFile::kExtension);
+        for (const auto& file_path : scan_indicator_files(base_path, prefix + "*" + suffix)) {
+            std::string filename = file_path.filename().string();
+            files.emplace_back(filename.substr(prefix.size(), filename.size() - prefix.size() - suffix.size()), file_path);
+        }
+    }
+    if (files.empty()) {
+        return false;
+    }
+    if (!cal_engine) {
+        spdlog::warn("load_columnar_indicator_files: CalculationEngine为空，跳过存储");
+        return true;
+    }
+
+    bool loaded = false;
+    const auto& all_bar_holders = cal_engine->get_all_bar_series_holders();
+    for (const auto& [output_key, file_path] : files) {
+        ColumnarReader reader;
+        if (!reader.open(file_path.string())) {
+            continue;
+        }
+        if (reader.frequency() != module.frequency) {
+            spdlog::warn("列式文件{}的频率{}与模块配置{}不一致", file_path.string(), reader.frequency(), module.frequency);
+        }
+
+        // 文件中没有的股票：T日不写入，历史日写NaN（与csv单文件历史加载一致）
+        const std::vector<double> missing(reader.bucket_count(), std::numeric_limits<double>::quiet_NaN());
+        int matched = 0;
+        for (const auto& [stock_code, holder] : all_bar_holders) {
+            if (!holder) continue;
+            GSeriesView column = reader.stock_view(stock_code);
+            if (column.empty()) {
+                if (his_day_index > 0) {
+                    holder->set_his_series_with_frequency(module.frequency, output_key, his_day_index, GSeriesView(missing),
+                                                          module.precision);
+                }
+                continue;
+            }
+            if (his_day_index == 0) {
+                holder->offline_set_m_bar_with_frequency(module.frequency, output_key, column, module.precision);
+            } else {
+                holder->set_his_series_with_frequency(module.frequency, output_key, his_day_index, column, module.precision);
+            }
+            ++matched;
+        }
+        loaded = true;
+        spdlog::info("加载列式指标文件：{} -> output_key: {}（{}个时间桶，{}/{}只股票{}）", file_path.filename().string(),
+                     output_key, reader.bucket_count(), matched, reader.stock_count(),
+                     reader.is_zero_copy() ? "，零拷贝" : "，已解压");
+    }
+    return loaded;
+}
+
 // 辅助函数：扫描匹配的文件
 static std::vector<fs::path> scan_indicator_files(
         const fs::path& dir, 
@@ -414,7 +450,7 @@ static bool load_single_indicator_file(
             // 检查是否有该股票的数据
             if (stock_series.count(stock_code)) {
                 // 使用新的方法，按照frequency.indicator_name.pre_length格式存储
-                holder->offline_set_m_bar_with_frequency(module.frequency, module.name, stock_series[stock_code], 0);
+                holder->offline_set_m_bar_with_frequency(module.frequency, module.name, std::move(stock_series[stock_code]), 0, module.precision);
                 spdlog::debug("已加载股票[{}]的指标[{}]数据到BarSeriesHolder，key格式: {}.{}.0", 
                              stock_code, module.name, module.frequency, module.name);
             }
@@ -475,7 +511,7 @@ static bool load_multiple_indicator_files(
                 // 检查是否有该股票的数据
                 if (stock_series.count(stock_code)) {
                     // 使用新的方法，按照frequency.indicator_name.pre_length格式存储
-                    holder->offline_set_m_bar_with_frequency(module.frequency, output_key, stock_series[stock_code], 0);
+                    holder->offline_set_m_bar_with_frequency(module.frequency, output_key, std::move(stock_series[stock_code]), 0, module.precision);
                     spdlog::debug("已加载股票[{}]的指标[{}] output_key[{}]数据到BarSeriesHolder，key格式: {}.{}.0", 
                                  stock_code, module.name, output_key, module.frequency, output_key);
                 }
@@ -513,8 +549,7 @@ static bool save_factor(
 
         // 2. 创建存储目录
         fs::path base_path = fs::path(module.path) / date / "5min";
-        if (!fs::exists(base_path) && !fs::create_directories(base_path)) {
-            spdlog::error("创建目录失败: {}", base_path.string());
+        if (!IndicatorStorageHelper::ensure_directory(base_path.string())) {
             return false;
         }
 
@@ -524,95 +559,115 @@ static bool save_factor(
             return false;
         }
         
-        // 收集因子数据
-        std::map<int, std::map<std::string, double>> factor_data;  // bar_index -> {股票 -> 数值}
-        int max_bar_index = -1;
-        
         // 从CalculationEngine的Factor存储中获取数据
         auto factor_data_map = cal_engine->get_factor_data(module.name);
         if (factor_data_map.empty()) {
             spdlog::warn("因子[{}]在CalculationEngine中无数据可保存", module.name);
             return true;
         }
-        
-        // 遍历Factor存储的每个时间桶
+
+        // 输出到最后一个有有效值的时间桶
+        int max_bar_index = -1;
         for (const auto& [ti, stock_value_map] : factor_data_map) {
-            // 遍历每个股票的数值
             for (const auto& [stock_code, value] : stock_value_map) {
-                if (!std::isnan(value)) {
-                    factor_data[ti][stock_code] = value;
-                    if (ti > max_bar_index) max_bar_index = ti;
-                }
+                if (!std::isnan(value) && ti > max_bar_index) max_bar_index = ti;
             }
         }
-
-        if (factor_data.empty()) {
+        if (max_bar_index < 0) {
             spdlog::warn("因子[{}]无有效数据可保存", module.name);
             return true;
         }
 
-        // 4. 生成GZ压缩文件（格式：因子名_日期_5min.csv.gz）
-        std::string filename = fmt::format("{}_{}_5min.csv.gz", module.name, date);
-        fs::path file_path = base_path / filename;
-
-        // 5. 写入GZ文件
-        gzFile gz_file = gzopen(file_path.string().c_str(), "wb");
-        if (!gz_file) {
-            spdlog::error("无法创建GZ文件: {}", file_path.string());
-            return false;
+        // 按传入的股票列表转为列（bar_index -> 数值，缺失为NaN）
+        std::unordered_map<std::string, size_t> column_of;
+        for (size_t i = 0; i < stock_list.size(); ++i) column_of.emplace(stock_list[i], i);
+        std::vector<std::vector<double>> values(stock_list.size(),
+                                                std::vector<double>(max_bar_index + 1, std::numeric_limits<double>::quiet_NaN()));
+        for (const auto& [ti, stock_value_map] : factor_data_map) {
+            if (ti < 0 || ti > max_bar_index) continue;
+            for (const auto& [stock_code, value] : stock_value_map) {
+                auto it = column_of.find(stock_code);
+                if (it != column_of.end()) values[it->second][ti] = value;
+            }
         }
+        std::vector<GSeriesView> columns;
+        columns.reserve(values.size());
+        for (const auto& column : values) columns.emplace_back(column);
 
-        // 5.1 写入表头（bar_index + 所有股票代码）
-        std::string header = "bar_index";
-        // 使用传入的股票列表
+        // 4. 生成结果文件：列式（因子名_日期_5min.col），或GZ压缩宽表（因子名_日期_5min.csv.gz）
+        return write_factor_file(module, date, stock_list, columns, max_bar_index + 1);
 
-        for (const auto& stock_code : stock_list) {
-            header += "," + stock_code;
-        }
-        header += "\n";
-        gzwrite(gz_file, header.data(), header.size());
+    } catch (const std::exception& e) {
+        spdlog::error("保存因子[{}]失败：{}", module.name, e.what());
+        return false;
+    }
+}
 
-        // 5.2 按bar_index写入每行数据
-        for (int ti = 0; ti <= max_bar_index; ++ti) {
-            std::string line = std::to_string(ti);  // 行首为bar_index
+// 新增：因子盘中结果日志的路径（与日文件同目录：因子名_日期_5min.journal）
+static std::string factor_journal_path(const ModuleConfig& module, const std::string& date) {
+    return (fs::path(module.path) / date / "5min" /
+            fmt::format("{}_{}_5min{}", module.name, date, ResultJournal::kExtension)).string();
+}
 
-            // 为每个股票填充对应bar的数据
-            for (const auto& stock_code : stock_list) {
-                auto bar_it = factor_data.find(ti);
-                if (bar_it != factor_data.end()) {
-                    auto stock_it = bar_it->second.find(stock_code);
-                    if (stock_it != bar_it->second.end()) {
-                        double value = stock_it->second;
-                        if (std::isnan(value)) {
-                            line += ",";  // NaN值留空
-                        } else {
-                            line += fmt::format(",{:.6f}", value);  // 有数据
-                        }
-                    } else {
-                        line += ",";  // 无数据（留空）
-                    }
-                } else {
-                    line += ",";  // 该bar_index无任何数据
-                }
+// 新增：把因子的盘中结果日志压缩为日文件（顺序读一遍日志，不依赖CalculationEngine中的数据）
+// 收盘保存时调用；进程中途崩溃后也可单独调用，用已封口的时间桶生成日文件。成功后删除日志
+static bool compact_factor_journal(const ModuleConfig& module, const std::string& date) {
+    try {
+        std::string journal_path = factor_journal_path(module, date);
+        std::vector<std::string> stocks;
+        std::vector<std::vector<double>> values;
+        int rows = 0;
+        if (!ResultJournal::compact(journal_path, stocks, values, rows)) {
+            spdlog::error("因子[{}]的盘中日志无法读取: {}", module.name, journal_path);
+            return false;
+        }
+        if (rows == 0) {
+            spdlog::warn("因子[{}]的盘中日志中无有效数据", module.name);
+        } else {
+            std::vector<GSeriesView> columns;
+            columns.reserve(values.size());
+            for (const auto& column : values) columns.emplace_back(column);
+            if (!write_factor_file(module, date, stocks, columns, rows)) {
+                return false;
             }
-            line += "\n";
-            gzwrite(gz_file, line.data(), line.size());
         }
-        
-        // 6. 关闭文件并输出日志
-        gzclose(gz_file);
-        spdlog::info("因子[{}]数据保存成功：{}（{}个时间桶）",
-                     module.name, file_path.string(), max_bar_index + 1);
+        std::error_code ec;
+        fs::remove(journal_path, ec);
         return true;
-
     } catch (const std::exception& e) {
-        spdlog::error("保存因子[{}]失败：{}", module.name, e.what());
+        spdlog::error("压缩因子[{}]的盘中日志失败：{}", module.name, e.what());
         return false;
     }
 }
 
 private:
 
+    // 新增：写出因子日文件：列式（因子名_日期_5min.col），或GZ压缩宽表（因子名_日期_5min.csv.gz）
+    static bool write_factor_file(const ModuleConfig& module, const std::string& date,
+                                  const std::vector<std::string>& stock_list,
+                                  const std::vector<GSeriesView>& columns, int rows) {
+        fs::path base_path = fs::path(module.path) / date / "5min";
+        if (!IndicatorStorageHelper::ensure_directory(base_path.string())) {
+            return false;
+        }
+        fs::path file_path;
+        if (is_columnar_format(module.format)) {
+            file_path = base_path / fmt::format("{}_{}_5min{}", module.name, date, ColumnarFile::kExtension);
+            if (!ColumnarFile::write(file_path.string(), "5min", stock_list, columns, rows,
+                                     module.precision, module.format == StorageFormat::ColumnarZlib)) {
+                return false;
+            }
+        } else {
+            file_path = base_path / fmt::format("{}_{}_5min.csv.gz", module.name, date);
+            if (!GzTableWriter::write(file_path.string(), stock_list, columns, rows)) {
+                return false;
+            }
+        }
+
+        spdlog::info("因子[{}]数据保存成功：{}（{}个时间桶）", module.name, file_path.string(), rows);
+        return true;
+    }
+
     // 子函数2：加载历史指标原始数据（未重索引）
     static bool load_historical_indicator_data(
             const std::shared_ptr<Indicator>& indicator,
@@ -840,12 +895,30 @@ private:
             const std::shared_ptr<Indicator>& indicator,
             const std::string& hist_date,
             int his_day_index,
-            const std::unordered_map<std::string, std::unordered_map<std::string, GSeries>>& stock_output_data
+            const std::unordered_map<std::string, std::unordered_map<std::string, GSeries>>& stock_output_data,
+            const std::string& frequency_str,
+            StoragePrecision precision,
+            const std::shared_ptr<CalculationEngine>& cal_engine
     ) {
-        spdlog::info("存储历史日期[{}]的多元素指标数据，his_day_index={}", hist_date, his_day_index);
-        
-        // TODO: 由于Indicator不再有本地存储，需要从CalculationEngine获取数据
-        spdlog::warn("store_historical_data: 需要从CalculationEngine获取数据，当前跳过存储");
+        spdlog::info("存储历史日期[{}]的多元素指标数据，his_day_index={}, 精度={}",
+                     hist_date, his_day_index, storage_precision_to_string(precision));
+
+        if (!cal_engine) {
+            spdlog::warn("store_historical_data: CalculationEngine为空，跳过存储");
+            return;
+        }
+
+        // 写入每只股票BarSeriesHolder的多日缓冲：{frequency}.{output_key}.0 的第his_day_index个历史日槽
+        int stored = 0;
+        for (const auto& [stock, output_map] : stock_output_data) {
+            auto holder = cal_engine->get_bar_series_holder(stock);
+            if (!holder) continue;
+            for (const auto& [output_key, series] : output_map) {
+                holder->set_his_series_with_frequency(frequency_str, output_key, his_day_index, series, precision);
+                ++stored;
+            }
+        }
+        spdlog::info("历史日期[{}]共存储{}条历史序列", hist_date, stored);
     }
 
     // 子函数2：历史数据重索引（按T日股票列表对齐）
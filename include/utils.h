@@ -9,6 +9,8 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <unordered_map>
+#include <ctime>
 #include <spdlog/spdlog.h>
 
 // 辅助函数：计算指定日期的前n天（返回"YYYYMMDD"格式）
@@ -37,6 +39,17 @@ std::string get_prev_date(const std::string& date, int n) {
     return fmt::format("{:04d}{:02d}{:02d}", year, month, day);
 }
 
+// 辅助函数：计算指定日期之后第n个自然日（返回"YYYYMMDD"格式，月末、闰年由mktime归一化）
+inline std::string get_next_date(const std::string& date, int n) {
+    std::tm tm{};
+    tm.tm_year = std::stoi(date.substr(0, 4)) - 1900;
+    tm.tm_mon = std::stoi(date.substr(4, 2)) - 1;
+    tm.tm_mday = std::stoi(date.substr(6, 2)) + n;
+    tm.tm_hour = 12;  // 避开夏令时切换导致的日期偏移
+    std::mktime(&tm);
+    return fmt::format("{:04d}{:02d}{:02d}", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+}
+
 // 辅助函数：从股票池文件读取指定交易日的股票列表
 std::vector<std::string> load_stock_list(const std::string& universe_name, const std::string& trading_day) {
     std::vector<std::string> stock_list;
@@ -54,4 +67,24 @@ std::vector<std::string> load_stock_list(const std::string& universe_name, const
     return stock_list;
 }
 
+// 辅助函数：读取股票行业文件（每行"股票代码,行业代码"）
+inline std::unordered_map<std::string, std::string> load_stock_industries(const std::string& filename) {
+    std::unordered_map<std::string, std::string> industries;
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        spdlog::error("无法读取股票行业文件: {}", filename);
+        return industries;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t comma = line.find(',');
+        if (comma == std::string::npos || comma == 0 || comma + 1 >= line.size()) continue;
+        std::string industry = line.substr(comma + 1);
+        if (!industry.empty() && industry.back() == '\r') industry.pop_back();
+        if (!industry.empty()) industries[line.substr(0, comma)] = industry;
+    }
+    spdlog::info("加载股票行业[{}]：{}只股票", filename, industries.size());
+    return industries;
+}
+
 #endif //ALPHAFACTORFRAMEWORK_UTILS_H
@@ -29,15 +29,33 @@ int main() {
         framework.register_indicators_factors(config.modules);
         framework.load_all_indicators();
 
-        // 4. 加载并排序行情数据
+        // 4~6. 逐日加载行情、运行引擎并保存结果（配置了end_date时连续回放多日）
         DataLoader data_loader;
-        std::vector<MarketAllField> all_tick_datas = framework.load_and_sort_market_data(data_loader);
+        std::string date = config.calculate_date;
+        while (true) {
+            // 4. 加载并排序行情数据
+            std::vector<MarketAllField> all_tick_datas = framework.load_and_sort_market_data(data_loader);
 
-        // 5. 运行引擎
-        framework.run_engine(all_tick_datas);
+            if (all_tick_datas.empty() && !config.end_date.empty()) {
+                spdlog::warn("{}无行情数据（非交易日），跳过", date);
+            } else {
+                // 5. 运行引擎（配置了检查点且检查点与行情一致时从断点继续）
+                if (framework.restore_checkpoint(all_tick_datas)) {
+                    spdlog::info("已从检查点{}恢复引擎状态", config.checkpoint.path);
+                }
+                // 配置了检查点间隔时逐事件回放，按间隔写检查点；否则整日批量回放
+                bool batch_mode = config.checkpoint.path.empty() || config.checkpoint.interval_seconds == 0;
+                framework.run_engine(all_tick_datas, batch_mode);
 
-        // 6. 保存结果
-        framework.save_all_results();
+                // 6. 保存结果，之后检查点不再需要
+                framework.save_all_results();
+                framework.discard_checkpoint();
+            }
+
+            if (config.end_date.empty() || date >= config.end_date) break;
+            date = get_next_date(date, 1);
+            framework.advance_to_date(date);
+        }
 
         spdlog::info("结果保存完成");
     } catch (const std::exception& e) {
@@ -63,6 +63,7 @@ private:
         
         // 设置factor依赖关系
         framework_.setup_factor_dependencies();
+        framework_.open_result_journals();
         
         spdlog::info("共享存储初始化完成");
     }
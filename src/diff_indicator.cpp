@@ -11,100 +11,121 @@
 
 namespace fs = std::filesystem;
 
-void DiffIndicator::setup_default_fields() {
-    // 配置volume差分
-    DiffFieldConfig volume_config;
-    volume_config.field_name = "volume";
-    volume_config.output_key = "volume";
-//    volume_config.output_key = fmt::format("{}.{}.{}", storage_frequency_str_, "volume", pre_days_);
-    volume_config.getter = [](const TickData& tick) -> double { return tick.volume; };
-    volume_config.description = "成交量差分";
-    add_diff_field(volume_config);
-    
-    // 配置amount差分
-    DiffFieldConfig amount_config;
-    amount_config.field_name = "amount";
-    amount_config.output_key = "amount";
-//    amount_config.output_key = fmt::format("{}.{}.{}", storage_frequency_str_, "amount", pre_days_);
-    amount_config.getter = [](const TickData& tick) -> double { return tick.total_value_traded; };
-    amount_config.description = "成交额差分";
-    add_diff_field(amount_config);
+void DiffIndicator::setup_fields(const std::vector<std::string>& fields) {
+    if (fields.empty()) {
+        enable_field("volume");
+        enable_field("amount");
+        return;
+    }
+    for (const auto& field : fields) {
+        if (!enable_field(field)) {
+            spdlog::warn("[DiffIndicator] 未知差分字段: {}，已忽略", field);
+        }
+    }
 }
 
-void DiffIndicator::add_diff_field(const DiffFieldConfig& config) {
-    diff_fields_.push_back(config);
-    
-    // 方案2：不再需要cache和mutex，因为已经移除cache依赖
-    
-    spdlog::info("[DiffIndicator] 添加差分字段: {} ({})", config.field_name, config.description);
+bool DiffIndicator::enable_field(const std::string& output_key) {
+    for (size_t i = 0; i < kDiffFieldCount; ++i) {
+        if (output_key == kDiffFieldTable[i].output_key) {
+            if (std::find(enabled_fields_.begin(), enabled_fields_.end(), i) == enabled_fields_.end()) {
+                enabled_fields_.push_back(i);
+                spdlog::info("[DiffIndicator] 启用差分字段: {} ({})", output_key, kDiffFieldTable[i].description);
+            }
+            return true;
+        }
+    }
+    return false;
 }
 
-void DiffIndicator::Calculate(const SyncTickData& tick_data) {
-    auto thread_id = std::this_thread::get_id();
-    std::ostringstream oss;
-    oss << thread_id;
-    std::string thread_id_str = oss.str();
+void DiffIndicator::retain_fields(const std::set<std::string>& fields) {
+    enabled_fields_.erase(std::remove_if(enabled_fields_.begin(), enabled_fields_.end(),
+                                         [&](size_t i) { return fields.count(kDiffFieldTable[i].output_key) == 0; }),
+                          enabled_fields_.end());
+    if (enabled_fields_.empty()) {
+        spdlog::warn("[DiffIndicator] {} 裁剪后没有需要计算的字段", name_);
+    }
+}
 
-    spdlog::info("[DiffCalculate-Enter] symbol={} thread_id={}", tick_data.symbol, thread_id_str);
+RollupMethod DiffIndicator::field_rollup(const std::string& field) const {
+    for (const auto& descriptor : kDiffFieldTable) {
+        if (field == descriptor.output_key) return descriptor.rollup;
+    }
+    return RollupMethod::Sum;
+}
 
+void DiffIndicator::Calculate(const SyncTickData& tick_data) {
     // 修改：使用新的get_stock_bar_holder方法获取对应股票的BarSeriesHolder
     BarSeriesHolder* stock_holder = get_stock_bar_holder(tick_data.symbol);
     if (!stock_holder) {
         spdlog::warn("[DiffIndicator] 无法获取股票{}的BarSeriesHolder", tick_data.symbol);
         return;
     }
+    calculate_with_context(IndicatorTickContext::resolve(tick_data, stock_holder));
+}
 
-    // 为每个配置的字段计算差分
-    for (const auto& field_config : diff_fields_) {
-        const std::string& field_name = field_config.field_name;
-        const std::string& output_key = field_config.output_key;
-        
-        // 获取当前字段的值
-        double current_value = field_config.getter(tick_data.tick_data);
-        
-        // 计算差分
-        double field_diff = calculate_field_diff(field_name, tick_data.symbol, 
-                                               tick_data.tick_data.real_time, current_value);
-        
-        // 获取当前频率的时间桶索引（使用对应股票的BarSeriesHolder的内部索引）
-        int time_bucket_index = stock_holder->get_idx(frequency_);
-        if (time_bucket_index < 0) {
-            spdlog::warn("[DiffIndicator] 频率{}的索引无效: {}", 
-                         static_cast<int>(frequency_), time_bucket_index);
-            continue;
-        }
-        
-        // 获取当前时间桶的累积差值并累加新的差值
-        double accumulated_diff = get_accumulated_diff_by_bucket(output_key, tick_data.symbol, time_bucket_index, stock_holder);
-        double new_accumulated_diff = accumulated_diff + field_diff;
-        
-        // 使用新的store_result_to_stock方法存储累积差值到指定股票的BarSeriesHolder
-        store_result_to_stock(output_key, new_accumulated_diff, tick_data.symbol);
-        
-        spdlog::debug("[DiffCalculate] symbol={} bucket={} {}_diff={} accumulated_diff={} -> new_accumulated_diff={} (thread_id={})", 
-                     tick_data.symbol, time_bucket_index, output_key, field_diff, accumulated_diff, new_accumulated_diff, thread_id_str);
+void DiffIndicator::calculate_with_context(const IndicatorTickContext& ctx) {
+    BarSeriesHolder* stock_holder = ctx.holder;
+    if (!stock_holder) return;
+
+    // 一次读取字段表中的所有字段，与该股票状态槽中的上一tick值做差分
+    std::array<double, kDiffFieldCount> current = load_tick_fields(ctx.tick->tick_data, std::make_index_sequence<kDiffFieldCount>{});
+    double* prev = stock_holder->state_block(state_slot_base_, static_cast<int>(kDiffFieldCount));
+
+    std::array<FieldContribution, kDiffFieldCount> contributions;
+    size_t count = 0;
+    for (size_t i : enabled_fields_) {
+        const DiffFieldDescriptor& field = kDiffFieldTable[i];
+        // Sum语义写入tick差分（首个tick的上一值视为0），其余语义写入字段原始值
+        double value = field.rollup == RollupMethod::Sum
+                       ? current[i] - (std::isnan(prev[i]) ? 0.0 : prev[i])
+                       : current[i];
+        prev[i] = current[i];
+        contributions[count++] = {field.output_key, value, field.rollup};
     }
+
+    // 通过预解析句柄在一次加锁内写入基础频率和所有汇总频率的当前桶
+    write_fields_with_context(ctx, handle_slot_base_, enabled_fields_.data(), contributions.data(), count);
+
+    spdlog::debug("[DiffCalculate] symbol={} fields={} rollup_freqs={}", 
+                 ctx.tick->symbol, count, rollup_frequencies_.size());
 }
 
-double DiffIndicator::calculate_field_diff(const std::string& field_name, 
-                                         const std::string& stock_code,
-                                         uint64_t current_time,
-                                         double current_value) {
-    // 方案B：从简单的成员变量获取前一个tick的TotalValueTraded，完全移除cache依赖
-    
-    // 获取前一个tick的TotalValueTraded
-    double prev_total = get_previous_tick_total_value(field_name, stock_code);
-    
-    // 计算真正的diff：当前TotalValueTraded - 前一个tick的TotalValueTraded
-    double field_diff = current_value - prev_total;
-    
-    // 更新前一个tick的值，为下一个tick做准备
-    prev_tick_values_[field_name][stock_code] = current_value;
-    
-    spdlog::debug("[DiffCalculate] symbol={} field={} current_value={} prev_total={} diff={}", 
-                 stock_code, field_name, current_value, prev_total, field_diff);
-    
-    return field_diff;
+void DiffIndicator::CalculateBatch(const IndicatorBatchContext& batch) {
+    BarSeriesHolder* stock_holder = batch.holder;
+    if (!stock_holder || batch.count == 0) return;
+
+    const size_t n = batch.count;
+    double* prev = stock_holder->state_block(state_slot_base_, static_cast<int>(kDiffFieldCount));
+    std::vector<double> current(n);
+    std::vector<double> values(n);
+
+    for (size_t field_index : enabled_fields_) {
+        const DiffFieldDescriptor& field = kDiffFieldTable[field_index];
+
+        // 1. 取出整列字段值
+        for (size_t i = 0; i < n; ++i) {
+            current[i] = batch.ticks[i].tick_data.*(field.member);
+        }
+
+        // 2. Sum语义整列差分（与逐tick路径一致：上一值为NaN时视为0），循环间无依赖可向量化
+        if (field.rollup == RollupMethod::Sum) {
+            values[0] = current[0] - (std::isnan(prev[field_index]) ? 0.0 : prev[field_index]);
+            const double* cur = current.data();
+            double* out = values.data();
+            for (size_t i = 1; i < n; ++i) {
+                const double last = cur[i - 1];
+                out[i] = cur[i] - (last != last ? 0.0 : last);
+            }
+        } else {
+            std::copy(current.begin(), current.end(), values.begin());
+        }
+        prev[field_index] = current[n - 1];
+
+        // 3. 按桶合并后一次写入基础频率和所有汇总频率
+        write_column_with_batch(batch, handle_slot_base_, field_index, field.output_key, values.data(), field.rollup);
+    }
+
+    spdlog::debug("[DiffCalculateBatch] ticks={} fields={} rollup_freqs={}", n, enabled_fields_.size(), rollup_frequencies_.size());
 }
 
 BarSeriesHolder* DiffIndicator::get_field_bar_series_holder(const std::string& stock_code, const std::string& field_name) const {
@@ -135,8 +156,13 @@ void DiffIndicator::set_calculation_engine(std::shared_ptr<CalculationEngine> en
 }
 
 void DiffIndicator::reset_diff_storage() {
-    // 方案B：清理前一个tick的值
-    prev_tick_values_.clear();
+    if (!calculation_engine_) return;
+    for (const auto& [stock_code, holder] : calculation_engine_->get_all_bar_series_holders()) {
+        if (!holder) continue;
+        for (size_t i = 0; i < kDiffFieldCount; ++i) {
+            holder->clear_state_slot(state_slot_base_ + static_cast<int>(i));
+        }
+    }
     spdlog::info("[DiffIndicator] 已清理前一个tick的值");
 }
 
@@ -161,8 +187,7 @@ bool DiffIndicator::save_results(const ModuleConfig& module, const std::string&
         // 3. 如果配置就是15S，直接保存原始数据
         spdlog::info("DiffIndicator保存数据");
         fs::path base_path = fs::path(module.path) / date / storage_frequency_str_;
-        if (!fs::exists(base_path) && !fs::create_directories(base_path)) {
-            spdlog::error("创建目录失败: {}", base_path.string());
+        if (!IndicatorStorageHelper::ensure_directory(base_path.string())) {
             return false;
         }
 
@@ -181,83 +206,28 @@ bool DiffIndicator::save_results(const ModuleConfig& module, const std::string&
         }
 
         // 为每个字段分别进行聚合和保存
-        for (const auto& field_config : diff_fields_) {
-            const std::string& output_key = field_config.output_key;
-
-            // 收集聚合后的数据
-            std::map<int, std::map<std::string, double>> aggregated_data;
-            
-            // 从CalculationEngine获取数据并处理
+        for (size_t field_index : enabled_fields_) {
+            const std::string output_key = kDiffFieldTable[field_index].output_key;
+
+            // 直接按股票取base频率序列的视图作为列，不再经过 时间桶 -> 股票 的map
+            std::vector<std::string> stocks;
+            std::vector<GSeriesView> columns;
+            stocks.reserve(all_bar_holders.size());
+            columns.reserve(all_bar_holders.size());
             for (const auto& [stock_code, holder_ptr] : all_bar_holders) {
-                if (!holder_ptr) continue;
-                
-                const BarSeriesHolder* holder = holder_ptr.get();
-                GSeries base_series = holder->get_m_bar(fmt::format("{}.{}.{}", storage_frequency_str_, output_key, pre_days_));
-                
-                // 保存所有时间桶的数据
-                for (int i = 0; i < base_series.get_size(); ++i) {
-                    double val = base_series.get(i);
-                    if (!std::isnan(val)) {
-                        aggregated_data[i][stock_code] = val;
-                    }
-                }
+                stocks.push_back(stock_code);
+                columns.push_back(holder_ptr ? holder_ptr->get_data_view(frequency_, output_key, 0, -1) : GSeriesView());
             }
 
-            // 生成GZ压缩文件
-            std::string filename = fmt::format("{}_{}_{}_{}.csv.gz",
-                                               module.name, output_key, date, storage_frequency_str_);
-            fs::path file_path = base_path / filename;
-
-            // 写入GZ文件
-            gzFile gz_file = gzopen(file_path.string().c_str(), "wb");
-            if (!gz_file) {
-                spdlog::error("无法创建GZ文件: {}", file_path.string());
+            // 按模块配置的格式生成文件（csv.gz或列式.col）
+            fs::path file_stem = base_path / fmt::format("{}_{}_{}_{}", module.name, output_key, date, storage_frequency_str_);
+            std::string file_path;
+            if (!IndicatorStorageHelper::write_bar_columns(file_stem.string(), storage_frequency_str_, stocks, columns,
+                                                           module, file_path)) {
                 return false;
             }
 
-            // 写入表头
-            std::string header = "bar_index";
-            for (const auto& [stock_code, _] : all_bar_holders) {
-                header += "," + stock_code;
-            }
-            header += "\n";
-            gzwrite(gz_file, header.data(), header.size());
-
-            // 写入数据
-            // 确定有多少个时间桶
-            int max_time_bucket = -1;
-            for (const auto& [ti, _] : aggregated_data) {
-                if (ti > max_time_bucket) max_time_bucket = ti;
-            }
-            
-            // 写入所有时间桶的数据
-            for (int ti = 0; ti <= max_time_bucket; ++ti) {
-                std::string line = std::to_string(ti);
-
-                for (const auto& [stock_code, _] : all_bar_holders) {
-                    auto bar_it = aggregated_data.find(ti);
-                    if (bar_it != aggregated_data.end()) {
-                        auto stock_it = bar_it->second.find(stock_code);
-                        if (stock_it != bar_it->second.end()) {
-                            double value = stock_it->second;
-                            if (std::isnan(value)) {
-                                line += ",";
-                            } else {
-                                line += fmt::format(",{:.6f}", value);
-                            }
-                        } else {
-                            line += ",";
-                        }
-                    } else {
-                        line += ",";
-                    }
-                }
-                line += "\n";
-                gzwrite(gz_file, line.data(), line.size());
-            }
-
-            gzclose(gz_file);
-            spdlog::info("聚合数据保存成功：{}", file_path.string());
+            spdlog::info("聚合数据保存成功：{}", file_path);
         }
 
         return true;
@@ -268,33 +238,45 @@ bool DiffIndicator::save_results(const ModuleConfig& module, const std::string&
 }
 
 bool DiffIndicator::aggregate(const std::string& target_frequency,std::map<int, std::map<std::string, double>> &aggregated_data){
-    try {
-        // 如果目标频率与基础频率相同，直接调用原始保存方法
-        std::string base_freq = "15S";
-        switch (get_frequency()) {
-            case Frequency::F15S: base_freq = "15S"; break;
-            case Frequency::F1MIN: base_freq = "1min"; break;
-            case Frequency::F5MIN: base_freq = "5min"; break;
-            case Frequency::F30MIN: base_freq = "30min"; break;
-        }
+    // 单一输出接口只承载一个字段，默认聚合第一个差分字段（通常为volume）
+    if (enabled_fields_.empty()) {
+        spdlog::warn("DiffIndicator[{}] 未配置差分字段，无法聚合", name_);
+        return false;
+    }
+    return aggregate_field(kDiffFieldTable[enabled_fields_.front()].output_key, target_frequency, aggregated_data);
+}
 
-        if (base_freq == target_frequency) {
-            return true;
+bool DiffIndicator::aggregate_field(const std::string& output_key, const std::string& target_frequency,
+                                    std::map<int, std::map<std::string, double>>& aggregated_data) {
+    try {
+        if (!calculation_engine_) {
+            spdlog::error("DiffIndicator::aggregate: CalculationEngine为空，无法获取数据");
+            return false;
         }
 
-        // 获取聚合比率
-        int ratio = get_aggregation_ratio(base_freq, target_frequency);
-        int target_bars = get_target_bars_per_day(target_frequency);
+        spdlog::info("开始聚合：{}.{} -> {}", storage_frequency_str_, output_key, target_frequency);
 
-        spdlog::info("开始聚合：{} -> {}，聚合比率: {}，目标桶数: {}", base_freq, target_frequency, ratio, target_bars);
+        // 差分字段可加，目标桶的值即为base频率对应区间之和，由前缀和O(1)得到
+        // 目标频率在写入时已汇总则直接读取
+        Frequency target_freq;
+        if (!IndicatorStorageHelper::parse_frequency(target_frequency, target_freq)) {
+            spdlog::error("不支持的聚合目标频率: {}", target_frequency);
+            return false;
+        }
+        bool pre_aggregated = has_frequency(target_freq);
 
-        // Clear output parameter first
-        aggregated_data.clear();
+        // 非Sum字段（如last_price）不可按区间求和，只能读取写入时汇总的bar
+        for (size_t i : enabled_fields_) {
+            if (output_key == kDiffFieldTable[i].output_key && kDiffFieldTable[i].rollup != RollupMethod::Sum &&
+                !pre_aggregated && target_freq != frequency_) {
+                spdlog::error("字段{}不可加，请在rollup中配置{}频率", output_key, target_frequency);
+                return false;
+            }
+        }
 
-        // 在新的架构中，数据存储在CalculationEngine的BarSeriesHolder中
-        // 这个方法现在需要从外部传入数据，或者暂时返回false
-        spdlog::warn("DiffIndicator::aggregate: 新架构中需要从外部获取数据");
-        return false;
+        return IndicatorStorageHelper::aggregate_additive(calculation_engine_->get_all_bar_series_holders(),
+                                                          frequency_, output_key, target_frequency, aggregated_data,
+                                                          pre_aggregated);
 
     } catch (const std::exception& e) {
         spdlog::error("聚合失败：{}", e.what());
@@ -305,35 +287,42 @@ bool DiffIndicator::aggregate(const std::string& target_frequency,std::map<int,
 bool DiffIndicator::save_results_with_frequency(const ModuleConfig& module, const std::string& date, const std::string& target_frequency) {
     try {
         // 如果目标频率与基础频率相同，直接调用原始保存方法
-        std::string base_freq = "15S";
-        switch (get_frequency()) {
-            case Frequency::F15S: base_freq = "15S"; break;
-            case Frequency::F1MIN: base_freq = "1min"; break;
-            case Frequency::F5MIN: base_freq = "5min"; break;
-            case Frequency::F30MIN: base_freq = "30min"; break;
+        Frequency target_freq;
+        if (!IndicatorStorageHelper::parse_frequency(target_frequency, target_freq)) {
+            spdlog::error("不支持的聚合目标频率: {}", target_frequency);
+            return false;
         }
-
-        if (base_freq == target_frequency) {
-            return save_results(module, date);
+        if (target_freq == frequency_) {
+            return save_results(module, date, calculation_engine_);
+        }
+        if (!calculation_engine_) {
+            spdlog::error("CalculationEngine为空，无法获取数据");
+            return false;
         }
         
         // 创建存储目录
         fs::path base_path = fs::path(module.path) / date / target_frequency;
-        if (!fs::exists(base_path) && !fs::create_directories(base_path)) {
-            spdlog::error("创建目录失败: {}", base_path.string());
+        if (!IndicatorStorageHelper::ensure_directory(base_path.string())) {
             return false;
         }
 
-        // 获取聚合比率
-        int ratio = get_aggregation_ratio(base_freq, target_frequency);
-        int target_bars = get_target_bars_per_day(target_frequency);
-        
-        spdlog::info("开始聚合：{} -> {}，聚合比率: {}，目标桶数: {}", base_freq, target_frequency, ratio, target_bars);
+        const auto& all_bar_holders = calculation_engine_->get_all_bar_series_holders();
+        for (size_t field_index : enabled_fields_) {
+            const std::string output_key = kDiffFieldTable[field_index].output_key;
 
-        // 在新的架构中，数据存储在CalculationEngine的BarSeriesHolder中
-        // 这个方法现在需要从外部传入数据，或者暂时返回false
-        spdlog::warn("DiffIndicator::aggregate: 新架构中需要从外部获取数据");
-        return false;
+            std::map<int, std::map<std::string, double>> aggregated_data;
+            if (!aggregate_field(output_key, target_frequency, aggregated_data)) {
+                return false;
+            }
+
+            fs::path file_stem = base_path / fmt::format("{}_{}_{}_{}", module.name, output_key, date, target_frequency);
+            std::string file_path;
+            if (!IndicatorStorageHelper::write_bar_table(file_stem.string(), target_frequency, all_bar_holders,
+                                                         aggregated_data, module, file_path)) {
+                return false;
+            }
+            spdlog::info("聚合数据保存成功：{}", file_path);
+        }
 
         return true;
 
@@ -363,106 +352,27 @@ int DiffIndicator::get_target_bars_per_day(const std::string& frequency) {
 
 void DiffIndicator::aggregate_time_segment(const GSeries& base_series, GSeries& output_series, 
                                          int base_start, int base_end, int ratio, int output_start) {
-    int segment_length = base_end - base_start + 1;
-    int output_buckets = segment_length / ratio;
-    
-    // 处理完整的聚合桶
-    for (int i = 0; i < output_buckets; i++) {
-        double sum = 0.0;
-        int valid_count = 0;
-        
-        for (int j = 0; j < ratio; j++) {
-            int base_idx = base_start + i * ratio + j;
-            if (base_idx <= base_end && base_idx < base_series.get_size()) {
-                double value = base_series.get(base_idx);
-                if (!std::isnan(value)) {
-                    sum += value;
-                    valid_count++;
-                }
-            }
-        }
-        
-        if (valid_count > 0 && (output_start + i) < output_series.get_size()) {
-            output_series.set(output_start + i, sum);
-        }
-    }
-    
-    // 处理最后一个不完整的桶（如果有剩余数据）
-    int remaining_length = segment_length % ratio;
-    if (remaining_length > 0) {
-        int last_bucket_start = base_start + output_buckets * ratio;
-        double sum = 0.0;
-        int valid_count = 0;
-        
-        for (int j = 0; j < remaining_length; j++) {
-            int base_idx = last_bucket_start + j;
-            if (base_idx <= base_end && base_idx < base_series.get_size()) {
-                double value = base_series.get(base_idx);
-                if (!std::isnan(value)) {
-                    sum += value;
-                    valid_count++;
-                }
-            }
-        }
-        
-        if (valid_count > 0 && (output_start + output_buckets) < output_series.get_size()) {
-            output_series.set(output_start + output_buckets, sum);
-            spdlog::debug("处理不完整桶: 输出位置={}, 有效数据={}, 总和={}", 
-                         output_start + output_buckets, valid_count, sum);
-        }
-    }
-}
-
+    if (ratio <= 0) return;
+    base_end = std::min(base_end, base_series.get_size() - 1);
+    if (base_start > base_end) return;
 
-
-double DiffIndicator::get_accumulated_diff_by_bucket(const std::string& field_name, 
-                                                    const std::string& stock_code,
-                                                    int time_bucket_index,
-                                                    BarSeriesHolder* stock_holder) {
-    // 从指定股票的BarSeriesHolder获取指定时间桶的累积差值
-    if (!stock_holder) {
-        spdlog::warn("[DiffIndicator] stock_holder为空，无法获取累积差值");
-        return 0.0;
-    }
-    
-    // 从BarSeriesHolder获取该时间桶的当前值
-    std::string series_key = fmt::format("{}.{}.{}", storage_frequency_str_, field_name, pre_days_);
-    GSeries series = stock_holder->get_m_bar(series_key);
-    
-    if (time_bucket_index >= series.get_size()) {
-        spdlog::warn("[DiffIndicator] 时间桶索引超出范围: index={}, size={}", time_bucket_index, series.get_size());
-        return 0.0;
-    }
-    
-    double current_value = series.get(time_bucket_index);
-    
-    // 如果当前值不是NaN，返回它；否则返回0.0
-    if (std::isnan(current_value)) {
-        spdlog::debug("[DiffIndicator] 时间桶{}的累积差值为NaN，返回0.0", time_bucket_index);
-        return 0.0;
+    // 一次扫描建立区间前缀和，之后每个输出桶（包括最后一个不完整桶）都是O(1)
+    int segment_length = base_end - base_start + 1;
+    std::vector<double> prefix_sum(segment_length + 1, 0.0);
+    std::vector<int> prefix_cnt(segment_length + 1, 0);
+    for (int k = 0; k < segment_length; ++k) {
+        double value = base_series.get(base_start + k);
+        bool valid = !std::isnan(value);
+        prefix_sum[k + 1] = prefix_sum[k] + (valid ? value : 0.0);
+        prefix_cnt[k + 1] = prefix_cnt[k] + (valid ? 1 : 0);
     }
-    
-    spdlog::debug("[DiffIndicator] 通过索引获取时间桶{}的累积差值: {}", time_bucket_index, current_value);
-    return current_value;
-}
 
-double DiffIndicator::get_previous_tick_total_value(const std::string& field_name, 
-                                                   const std::string& stock_code) {
-    // 方案B：从简单的成员变量获取前一个tick的TotalValueTraded
-    
-    auto field_it = prev_tick_values_.find(field_name);
-    if (field_it != prev_tick_values_.end()) {
-        auto stock_it = field_it->second.find(stock_code);
-        if (stock_it != field_it->second.end()) {
-            double prev_value = stock_it->second;
-            spdlog::debug("[DiffIndicator] 获取前一个tick的TotalValueTraded: field={}, stock={}, value={}", 
-                         field_name, stock_code, prev_value);
-            return prev_value;
+    int output_buckets = (segment_length + ratio - 1) / ratio;
+    for (int i = 0; i < output_buckets; i++) {
+        int lo = i * ratio;
+        int hi = std::min(lo + ratio, segment_length);
+        if (prefix_cnt[hi] - prefix_cnt[lo] > 0 && (output_start + i) < output_series.get_size()) {
+            output_series.set(output_start + i, prefix_sum[hi] - prefix_sum[lo]);
         }
     }
-    
-    // 如果没有找到前一个tick的值，返回0（表示这是第一个tick）
-    spdlog::debug("[DiffIndicator] 没有找到前一个tick的TotalValueTraded: field={}, stock={}, 返回0", 
-                 field_name, stock_code);
-    return 0.0;
 }
\ No newline at end of file
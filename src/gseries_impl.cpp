@@ -172,7 +172,7 @@ GSeries GSeries::nan_reduce_sort(const bool & reverse) const {
         std::sort(valid_data.begin(), valid_data.end());
     }
     
-    return GSeries(valid_data);
+    return GSeries(std::move(valid_data));
 }
 
 GSeries GSeries::pos_shift(const int & n) const {
@@ -182,7 +182,7 @@ GSeries GSeries::pos_shift(const int & n) const {
     for (int i = n; i < size; ++i) {
         result[i] = d_vec[i - n];
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 GSeries GSeries::neg_shift(const int & n) const {
@@ -192,7 +192,7 @@ GSeries GSeries::neg_shift(const int & n) const {
     for (int i = 0; i < size - n; ++i) {
         result[i] = d_vec[i + n];
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 double GSeries::nanquantile(const double & q) const {
@@ -342,7 +342,7 @@ GSeries GSeries::slice(const std::vector<int> & idx) const {
             slice_data.push_back(std::numeric_limits<double>::quiet_NaN());
         }
     }
-    return GSeries(slice_data);
+    return GSeries(std::move(slice_data));
 }
 
 GSeries GSeries::cumsum() const {
@@ -366,7 +366,7 @@ GSeries GSeries::diff(const int & num, const bool & is_ffill) const {
     if (is_ffill) {
         diff_data = FactorUtils::ffill(diff_data);
     }
-    return GSeries(diff_data);
+    return GSeries(std::move(diff_data));
 }
 
 GSeries GSeries::z_score() const {
@@ -385,7 +385,7 @@ GSeries GSeries::mean_fold(const bool & mean_first) const {
             result.push_back(std::numeric_limits<double>::quiet_NaN());
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::mean_fold_inplace(const bool & mean_first) {
@@ -419,7 +419,7 @@ GSeries GSeries::pct_change(const int & num, const bool & is_ffill) const {
     if (is_ffill) {
         pct_data = FactorUtils::ffill(pct_data);
     }
-    return GSeries(pct_data);
+    return GSeries(std::move(pct_data));
 }
 
 GSeries GSeries::pct_change(const int & limits) const {
@@ -432,7 +432,7 @@ GSeries GSeries::rank(const bool & is_pct, const bool & is_ascending) const {
     } else {
         auto ranks = FactorUtils::rank(d_vec, is_ascending);
         std::vector<double> rank_doubles(ranks.begin(), ranks.end());
-        return GSeries(rank_doubles);
+        return GSeries(std::move(rank_doubles));
     }
 }
 
@@ -454,10 +454,7 @@ std::vector<int> GSeries::arg_sort() const {
 }
 
 GSeries GSeries::tail(const int & num) const {
-    if (num <= 0) return GSeries();
-    int start = std::max(0, size - num);
-    std::vector<double> tail_data(d_vec.begin() + start, d_vec.end());
-    return GSeries(tail_data);
+    return tail_view(num).to_series();
 }
 
 GSeries GSeries::tail_rn(const int & num) const {
@@ -465,10 +462,7 @@ GSeries GSeries::tail_rn(const int & num) const {
 }
 
 GSeries GSeries::head(const int & num) const {
-    if (num <= 0) return GSeries();
-    int end = std::min(size, num);
-    std::vector<double> head_data(d_vec.begin(), d_vec.begin() + end);
-    return GSeries(head_data);
+    return head_view(num).to_series();
 }
 
 GSeries GSeries::head_rn(const int & num) const {
@@ -478,42 +472,42 @@ GSeries GSeries::head_rn(const int & num) const {
 // 滚动窗口方法
 GSeries GSeries::rolling_sum(const int & num, const int & min_period) const {
     auto rolling_data = Rolling::rolling_sum(d_vec, num, min_period);
-    return GSeries(rolling_data);
+    return GSeries(std::move(rolling_data));
 }
 
 GSeries GSeries::rolling_skew(const int & num) const {
     auto rolling_data = Rolling::rolling_skew(d_vec, num);
-    return GSeries(rolling_data);
+    return GSeries(std::move(rolling_data));
 }
 
 GSeries GSeries::rolling_kurt(const int & num) const {
     auto rolling_data = Rolling::rolling_kurt(d_vec, num);
-    return GSeries(rolling_data);
+    return GSeries(std::move(rolling_data));
 }
 
 GSeries GSeries::rolling_max(const int & num) const {
     auto rolling_data = Rolling::rolling_max(d_vec, num);
-    return GSeries(rolling_data);
+    return GSeries(std::move(rolling_data));
 }
 
 GSeries GSeries::rolling_min(const int & num) const {
     auto rolling_data = Rolling::rolling_min(d_vec, num);
-    return GSeries(rolling_data);
+    return GSeries(std::move(rolling_data));
 }
 
 GSeries GSeries::rolling_mean(const int & num, const int & min_period) const {
     auto rolling_data = Rolling::rolling_mean(d_vec, num, min_period);
-    return GSeries(rolling_data);
+    return GSeries(std::move(rolling_data));
 }
 
 GSeries GSeries::rolling_median(const int & num) const {
     auto rolling_data = Rolling::rolling_median(d_vec, num);
-    return GSeries(rolling_data);
+    return GSeries(std::move(rolling_data));
 }
 
 GSeries GSeries::rolling_std(const int & num, const int & min_period) const {
     auto rolling_data = Rolling::rolling_std(d_vec, num, min_period);
-    return GSeries(rolling_data);
+    return GSeries(std::move(rolling_data));
 }
 
 // 跳跃滚动窗口方法（简化实现）
@@ -528,7 +522,7 @@ GSeries GSeries::rolling_jump_min(const int & jump_num, const int & start_point)
             result[i] = d_vec[i];
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 GSeries GSeries::rolling_jump_max(const int & jump_num, const int & start_point) const {
@@ -567,7 +561,7 @@ GSeries GSeries::element_mul(const GSeries &other) const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_mul_inplace(const GSeries &other) {
@@ -592,7 +586,7 @@ GSeries GSeries::element_div(const GSeries &other) const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_div_inplace(const GSeries &other) {
@@ -617,7 +611,7 @@ GSeries GSeries::element_add(const GSeries &other) const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_add_inplace(const GSeries &other) {
@@ -642,7 +636,7 @@ GSeries GSeries::element_sub(const GSeries &other) const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_sub_inplace(const GSeries &other) {
@@ -666,7 +660,7 @@ GSeries GSeries::element_abs() const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_abs_inplace() {
@@ -686,7 +680,7 @@ GSeries GSeries::element_pow(const double &_x) const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_pow_inplace(const double &_x) {
@@ -707,7 +701,7 @@ GSeries GSeries::element_add(const double &_x) const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_add_inplace(const double &_x) {
@@ -727,7 +721,7 @@ GSeries GSeries::element_sub(const double &_x) const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_sub_inplace(const double &_x) {
@@ -747,7 +741,7 @@ GSeries GSeries::element_rsub(const double &_x) const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_rsub_inplace(const double &_x) {
@@ -772,7 +766,7 @@ GSeries GSeries::element_div(const double &_x) const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_div_inplace(const double &_x) {
@@ -799,7 +793,7 @@ GSeries GSeries::element_mul(const double &_x) const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_mul_inplace(const double &_x) {
@@ -819,7 +813,7 @@ GSeries GSeries::element_rdiv(const double &_x) const {
             result[i] = std::numeric_limits<double>::quiet_NaN();
         }
     }
-    return GSeries(result);
+    return GSeries(std::move(result));
 }
 
 void GSeries::element_rdiv_inplace(const double &_x) {
@@ -831,4 +825,213 @@ void GSeries::element_rdiv_inplace(const double &_x) {
         }
     }
     valid_num = std::count_if(d_vec.begin(), d_vec.end(), [](double v) { return !std::isnan(v); });
-} 
\ No newline at end of file
+} 
+// GSeriesView 统计方法实现（直接在视图上遍历，不物化数据）
+double GSeriesView::locate(const int & idx) const {
+    if (idx < 0 || idx >= length_) {
+        spdlog::error("GSeriesView index out of range: {} (size: {})", idx, length_);
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return (*this)[idx];
+}
+
+double GSeriesView::r_locate(const int & idx) const {
+    if (idx < 0 || idx >= length_) {
+        spdlog::error("GSeriesView index out of range: {} (size: {})", idx, length_);
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return (*this)[length_ - 1 - idx];
+}
+
+double GSeriesView::first_valid() const {
+    for (int i = 0; i < length_; ++i) {
+        if (std::isfinite((*this)[i])) return (*this)[i];
+    }
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+double GSeriesView::last_valid() const {
+    for (int i = length_ - 1; i >= 0; --i) {
+        if (std::isfinite((*this)[i])) return (*this)[i];
+    }
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+int GSeriesView::count() const {
+    if (valid_num_ < 0) {
+        int n = 0;
+        for (int i = 0; i < length_; ++i) {
+            if (!std::isnan((*this)[i])) n++;
+        }
+        valid_num_ = n;
+    }
+    return valid_num_;
+}
+
+double GSeriesView::nansum() const {
+    double sum = 0.0;
+    int n = 0;
+    for (int i = 0; i < length_; ++i) {
+        double v = (*this)[i];
+        if (std::isfinite(v)) {
+            sum += v;
+            n++;
+        }
+    }
+    return n > 0 ? sum : std::numeric_limits<double>::quiet_NaN();
+}
+
+double GSeriesView::nansum(const int & head_num) const {
+    if (head_num <= 0 || head_num > length_) return std::numeric_limits<double>::quiet_NaN();
+    return head(head_num).nansum();
+}
+
+double GSeriesView::nanmean() const {
+    double sum = 0.0;
+    int n = 0;
+    for (int i = 0; i < length_; ++i) {
+        double v = (*this)[i];
+        if (std::isfinite(v)) {
+            sum += v;
+            n++;
+        }
+    }
+    return n > 0 ? sum / n : std::numeric_limits<double>::quiet_NaN();
+}
+
+double GSeriesView::nanmean(const int & head_num) const {
+    if (head_num <= 0 || head_num > length_) return std::numeric_limits<double>::quiet_NaN();
+    return head(head_num).nanmean();
+}
+
+double GSeriesView::nanstd() const {
+    double mean = nanmean();
+    if (!std::isfinite(mean)) return std::numeric_limits<double>::quiet_NaN();
+    double sum_sq = 0.0;
+    int n = 0;
+    for (int i = 0; i < length_; ++i) {
+        double v = (*this)[i];
+        if (std::isfinite(v)) {
+            sum_sq += (v - mean) * (v - mean);
+            n++;
+        }
+    }
+    return n > 1 ? std::sqrt(sum_sq / (n - 1)) : std::numeric_limits<double>::quiet_NaN();
+}
+
+double GSeriesView::nanmedian() const {
+    // 中位数需要排序，只拷贝有效值
+    std::vector<double> valid_vals;
+    valid_vals.reserve(length_);
+    for (int i = 0; i < length_; ++i) {
+        if (std::isfinite((*this)[i])) valid_vals.push_back((*this)[i]);
+    }
+    return ComputeUtils::nan_median(valid_vals);
+}
+
+double GSeriesView::nanquantile(const double & q) const {
+    std::vector<double> valid_vals;
+    valid_vals.reserve(length_);
+    for (int i = 0; i < length_; ++i) {
+        if (std::isfinite((*this)[i])) valid_vals.push_back((*this)[i]);
+    }
+    return ComputeUtils::nan_quantile(valid_vals, q);
+}
+
+double GSeriesView::skewness() const {
+    double mean = nanmean();
+    if (!std::isfinite(mean)) return std::numeric_limits<double>::quiet_NaN();
+    double std_dev = nanstd();
+    if (!std::isfinite(std_dev) || std_dev == 0.0) return std::numeric_limits<double>::quiet_NaN();
+    double sum_cube = 0.0;
+    int n = 0;
+    for (int i = 0; i < length_; ++i) {
+        double v = (*this)[i];
+        if (std::isfinite(v)) {
+            double z = (v - mean) / std_dev;
+            sum_cube += z * z * z;
+            n++;
+        }
+    }
+    return n > 0 ? sum_cube / n : std::numeric_limits<double>::quiet_NaN();
+}
+
+double GSeriesView::kurtosis() const {
+    double mean = nanmean();
+    if (!std::isfinite(mean)) return std::numeric_limits<double>::quiet_NaN();
+    double std_dev = nanstd();
+    if (!std::isfinite(std_dev) || std_dev == 0.0) return std::numeric_limits<double>::quiet_NaN();
+    double sum_quad = 0.0;
+    int n = 0;
+    for (int i = 0; i < length_; ++i) {
+        double v = (*this)[i];
+        if (std::isfinite(v)) {
+            double z = (v - mean) / std_dev;
+            sum_quad += z * z * z * z;
+            n++;
+        }
+    }
+    return n > 0 ? (sum_quad / n) - 3.0 : std::numeric_limits<double>::quiet_NaN();
+}
+
+double GSeriesView::max() const {
+    int idx = argmax();
+    return idx >= 0 ? (*this)[idx] : std::numeric_limits<double>::quiet_NaN();
+}
+
+double GSeriesView::min() const {
+    int idx = argmin();
+    return idx >= 0 ? (*this)[idx] : std::numeric_limits<double>::quiet_NaN();
+}
+
+int GSeriesView::argmax() const {
+    int max_idx = -1;
+    for (int i = 0; i < length_; ++i) {
+        double v = (*this)[i];
+        if (std::isfinite(v) && (max_idx < 0 || v > (*this)[max_idx])) max_idx = i;
+    }
+    return max_idx;
+}
+
+int GSeriesView::argmin() const {
+    int min_idx = -1;
+    for (int i = 0; i < length_; ++i) {
+        double v = (*this)[i];
+        if (std::isfinite(v) && (min_idx < 0 || v < (*this)[min_idx])) min_idx = i;
+    }
+    return min_idx;
+}
+
+double GSeriesView::corrwith(const GSeriesView &other) const {
+    if (length_ != other.length_) return std::numeric_limits<double>::quiet_NaN();
+    double mean1 = nanmean();
+    double mean2 = other.nanmean();
+    if (!std::isfinite(mean1) || !std::isfinite(mean2)) return std::numeric_limits<double>::quiet_NaN();
+
+    double sum_prod = 0.0, sum_sq1 = 0.0, sum_sq2 = 0.0;
+    int n = 0;
+    for (int i = 0; i < length_; ++i) {
+        double a = (*this)[i];
+        double b = other[i];
+        if (std::isfinite(a) && std::isfinite(b)) {
+            sum_prod += (a - mean1) * (b - mean2);
+            sum_sq1 += (a - mean1) * (a - mean1);
+            sum_sq2 += (b - mean2) * (b - mean2);
+            n++;
+        }
+    }
+    if (n < 2) return std::numeric_limits<double>::quiet_NaN();
+    double denominator = std::sqrt(sum_sq1 * sum_sq2);
+    return denominator != 0.0 ? sum_prod / denominator : std::numeric_limits<double>::quiet_NaN();
+}
+
+std::vector<double> GSeriesView::to_vector() const {
+    if (stride_ == 1 && !fptr_) {
+        return std::vector<double>(ptr_, ptr_ + length_);
+    }
+    std::vector<double> result(length_);
+    for (int i = 0; i < length_; ++i) {
+        result[i] = (*this)[i];
+    }
+    return result;
+}
@@ -145,6 +145,10 @@ void IncreaseKurt::clear() {
 // IncreaseMedian 实现
 void IncreaseMedian::increase(const double& num) {
     if (!std::isfinite(num)) return;
+    if (streaming_) {
+        estimator_.add(num);
+        return;
+    }
     if (p.empty() || num < p.top()) {
         p.push(num);
     } else {
@@ -160,9 +164,30 @@ void IncreaseMedian::increase(const double& num) {
         p.push(q.top());
         q.pop();
     }
+
+    // 长窗口（需显式开启）：把两个堆的样本按序取出初始化P²，之后不再保存样本
+    if (streaming_after_ > 0 && p.size() + q.size() > streaming_after_) {
+        std::vector<double> sorted(p.size() + q.size());
+        for (size_t i = p.size(); i > 0; --i) {
+            sorted[i - 1] = p.top();
+            p.pop();
+        }
+        size_t offset = sorted.size() - q.size();
+        for (size_t i = offset; i < sorted.size(); ++i) {
+            sorted[i] = q.top();
+            q.pop();
+        }
+        estimator_.seed_sorted(sorted);
+        decltype(p)().swap(p);
+        decltype(q)().swap(q);
+        streaming_ = true;
+    }
 }
 
 double IncreaseMedian::get_value() const {
+    if (streaming_) {
+        return estimator_.value();
+    }
     if (p.empty() && q.empty()) {
         return std::numeric_limits<double>::quiet_NaN();
     } else {
@@ -173,5 +198,6 @@ double IncreaseMedian::get_value() const {
 void IncreaseMedian::clear() {
     while (!p.empty()) p.pop();
     while (!q.empty()) q.pop();
+    estimator_.clear();
+    streaming_ = false;
 }
-
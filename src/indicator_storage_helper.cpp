@@ -1,5 +1,11 @@
 #include "indicator_storage_helper.h"
+#include "columnar_file.h"
+#include "gz_table_writer.h"
+#include <filesystem>
+#include <mutex>
 #include <spdlog/spdlog.h>
+#include "spdlog/fmt/fmt.h"
+#include <zlib.h>
 
 // 静态成员初始化
 std::unordered_map<Frequency, IndicatorStorageHelper::FrequencyConfig> IndicatorStorageHelper::frequency_configs_;
@@ -56,9 +62,9 @@ void IndicatorStorageHelper::init_frequency_configs() {
 }
 
 const IndicatorStorageHelper::FrequencyConfig& IndicatorStorageHelper::get_frequency_config(Frequency frequency) {
-    if (!configs_initialized_) {
-        init_frequency_configs();
-    }
+    // 新增：tick处理线程和并行保存的线程可能同时首次访问，只初始化一次
+    static std::once_flag init_flag;
+    std::call_once(init_flag, init_frequency_configs);
     
     auto it = frequency_configs_.find(frequency);
     if (it == frequency_configs_.end()) {
@@ -309,9 +315,9 @@ std::pair<GSeries, int> IndicatorStorageHelper::get_fused_series_with_today_inde
     // 1. 添加历史数据（按pre_days指定的天数）
     if (pre_days > 0) {
         for (int his_index = pre_days; his_index >= 1; his_index--) {
-            GSeries his_series = holder->his_slice_bar(output_key, his_index);
+            GSeriesView his_series = holder->his_slice_bar_view(output_key, his_index);
             if (his_series.get_size() > 0) {
-                fused_series.append(his_series);
+                for (int j = 0; j < his_series.get_size(); ++j) fused_series.push(his_series[j]);
                 spdlog::debug("添加历史数据: 第{}天, 大小={}, 累计大小={}", 
                              his_index, his_series.get_size(), fused_series.get_size());
             } else {
@@ -325,8 +331,8 @@ std::pair<GSeries, int> IndicatorStorageHelper::get_fused_series_with_today_inde
     
     // 2. 添加当日数据（从0到today_end_index）
     if (holder->has_m_bar(output_key)) {
-        GSeries today_series = holder->get_m_bar(output_key).head(today_end_index + 1);
-        fused_series.append(today_series);
+        GSeriesView today_series = holder->get_m_bar_view(output_key).head(today_end_index + 1);
+        for (int j = 0; j < today_series.get_size(); ++j) fused_series.push(today_series[j]);
         spdlog::debug("添加当日数据: 大小={}, 总融合数据大小={}", 
                      today_series.get_size(), fused_series.get_size());
     } else {
@@ -370,3 +376,131 @@ std::pair<int, int> IndicatorStorageHelper::get_fused_data_range_from_timestamp(
     
     return {start_index, end_index};
 }
+
+// 新增：频率字符串转换为Frequency
+bool IndicatorStorageHelper::parse_frequency(const std::string& freq_str, Frequency& frequency) {
+    return ::parse_frequency(freq_str, frequency);
+}
+
+// 新增：基于前缀和的可加字段频率聚合
+bool IndicatorStorageHelper::aggregate_additive(
+    const std::unordered_map<std::string, std::shared_ptr<BarSeriesHolder>>& holders,
+    Frequency base_freq,
+    const std::string& key,
+    const std::string& target_frequency,
+    std::map<int, std::map<std::string, double>>& aggregated_data,
+    bool target_pre_aggregated
+) {
+    Frequency target_freq;
+    if (!parse_frequency(target_frequency, target_freq)) {
+        spdlog::error("不支持的聚合目标频率: {}", target_frequency);
+        return false;
+    }
+
+    aggregated_data.clear();
+    for (const auto& [stock_code, holder] : holders) {
+        if (!holder) continue;
+        if (target_pre_aggregated || target_freq == base_freq) {
+            GSeriesView series = holder->get_data_view(target_freq, key, 0, -1);
+            for (int ti = 0; ti < series.get_size(); ++ti) {
+                if (series.is_valid(ti)) {
+                    aggregated_data[ti][stock_code] = series[ti];
+                }
+            }
+            continue;
+        }
+        GSeries series = holder->aggregate_series(base_freq, key, target_freq);
+        for (int ti = 0; ti < series.get_size(); ++ti) {
+            double value = series.get(ti);
+            if (!std::isnan(value)) {
+                aggregated_data[ti][stock_code] = value;
+            }
+        }
+    }
+
+    spdlog::debug("聚合完成: key={}, {} -> {}, 股票数={}, 时间桶数={}",
+                  key, static_cast<int>(base_freq), target_frequency, holders.size(), aggregated_data.size());
+    return true;
+}
+
+// 把 时间桶 -> 股票 -> 数值 转为按holders顺序的列（缺失为NaN），行数为最大时间桶 + 1
+static void bar_map_to_columns(const std::unordered_map<std::string, std::shared_ptr<BarSeriesHolder>>& holders,
+                               const std::map<int, std::map<std::string, double>>& aggregated_data,
+                               std::vector<std::string>& stocks, std::vector<std::vector<double>>& values,
+                               std::vector<GSeriesView>& columns) {
+    int rows = aggregated_data.empty() ? 0 : aggregated_data.rbegin()->first + 1;
+    std::unordered_map<std::string, size_t> column_of;
+    stocks.clear();
+    for (const auto& [stock_code, _] : holders) {
+        column_of.emplace(stock_code, stocks.size());
+        stocks.push_back(stock_code);
+    }
+    values.assign(stocks.size(), std::vector<double>(rows, std::numeric_limits<double>::quiet_NaN()));
+    for (const auto& [ti, row] : aggregated_data) {
+        if (ti < 0) continue;
+        for (const auto& [stock_code, value] : row) {
+            auto it = column_of.find(stock_code);
+            if (it != column_of.end()) values[it->second][ti] = value;
+        }
+    }
+    columns.clear();
+    columns.reserve(values.size());
+    for (const auto& column : values) columns.emplace_back(column);
+}
+
+bool IndicatorStorageHelper::write_bar_table_gz(const std::string& file_path,
+                                                 const std::unordered_map<std::string, std::shared_ptr<BarSeriesHolder>>& holders,
+                                                 const std::map<int, std::map<std::string, double>>& aggregated_data) {
+    std::vector<std::string> stocks;
+    std::vector<std::vector<double>> values;
+    std::vector<GSeriesView> columns;
+    bar_map_to_columns(holders, aggregated_data, stocks, values, columns);
+    int rows = aggregated_data.empty() ? 0 : aggregated_data.rbegin()->first + 1;
+    return GzTableWriter::write(file_path, stocks, columns, rows);
+}
+
+bool IndicatorStorageHelper::write_bar_table(const std::string& file_stem,
+                                             const std::string& frequency,
+                                             const std::unordered_map<std::string, std::shared_ptr<BarSeriesHolder>>& holders,
+                                             const std::map<int, std::map<std::string, double>>& aggregated_data,
+                                             const ModuleConfig& module,
+                                             std::string& written_path) {
+    std::vector<std::string> stocks;
+    std::vector<std::vector<double>> values;
+    std::vector<GSeriesView> columns;
+    bar_map_to_columns(holders, aggregated_data, stocks, values, columns);
+    return write_bar_columns(file_stem, frequency, stocks, columns, module, written_path);
+}
+
+bool IndicatorStorageHelper::write_bar_columns(const std::string& file_stem,
+                                               const std::string& frequency,
+                                               const std::vector<std::string>& stocks,
+                                               const std::vector<GSeriesView>& columns,
+                                               const ModuleConfig& module,
+                                               std::string& written_path) {
+    int rows = GzTableWriter::valid_rows(columns);
+    if (!is_columnar_format(module.format)) {
+        written_path = file_stem + ".csv.gz";
+        return GzTableWriter::write(written_path, stocks, columns, rows);
+    }
+
+    // 列式文件按整日时间桶数写出，缺失为NaN
+    int bucket_count = rows;
+    Frequency freq;
+    if (parse_frequency(frequency, freq)) {
+        bucket_count = std::max(bucket_count, get_frequency_config(freq).bars_per_day);
+    }
+    written_path = file_stem + ColumnarFile::kExtension;
+    return ColumnarFile::write(written_path, frequency, stocks, columns, bucket_count, module.precision,
+                               module.format == StorageFormat::ColumnarZlib);
+}
+
+bool IndicatorStorageHelper::ensure_directory(const std::string& dir) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (!std::filesystem::is_directory(dir)) {
+        spdlog::error("创建目录失败: {}{}", dir, ec ? fmt::format(" ({})", ec.message()) : "");
+        return false;
+    }
+    return true;
+}
@@ -47,33 +47,21 @@ GSeries VolumeFactor::definition(
             double total_volume = 0.0;
             int valid_count = 0;
             
+            // 循环外一次取得融合视图：[历史数据pre_length天] + [当日数据(0到end_indicator_index)]
+            // 多日缓冲中各日连续存放，当日数据位于视图末尾
+            GSeriesView series = it->second->get_today_min_series_view("volume", pre_length, end_indicator_index);
+            int today_start = series.get_size() - (end_indicator_index + 1);
+
             for (int i = start_indicator_index; i <= end_indicator_index; ++i) {
-                // 获取融合数据
-                GSeries series = it->second->get_today_min_series("volume", pre_length, i);
-                
-                // get_today_min_series返回的数据结构：
-                // [历史数据pre_length天] + [历史数据pre_length-1天] + ... + [历史数据1天] + [当日数据(0到i)]
-                // 我们要访问的是当日数据的第i个位置
-                // 当日数据从索引 (历史数据总长度) 开始
-                
-                // 计算历史数据的总长度
-                int total_history_length = 0;
-                if (pre_length > 0) {
-                    for (int his_index = pre_length; his_index >= 1; his_index--) {
-                        GSeries his_series = it->second->his_slice_bar("volume", his_index);
-                        total_history_length += his_series.get_size();
-                    }
-                }
-                
                 // 当日数据的索引 = 历史数据总长度 + 当日数据中的位置i
-                int today_index = total_history_length + i;
+                int today_index = today_start + i;
                 
                 spdlog::debug("股票{}: {}频率索引={}, 历史数据总长度={}, 当日索引={}, 序列大小={}", 
-                             stock, static_cast<int>(indicator_freq), i, total_history_length, today_index, series.get_size());
+                             stock, static_cast<int>(indicator_freq), i, today_start, today_index, series.get_size());
                 
                 // 修复：检查索引是否在有效范围内
-                if (today_index >= 0 && today_index < series.get_size() && series.is_valid(today_index)) {
-                    double volume = series.get(today_index);
+                if (today_start >= 0 && today_index >= 0 && today_index < series.get_size() && series.is_valid(today_index)) {
+                    double volume = series[today_index];
                     if (!std::isnan(volume)) {
                         total_volume += volume;
                         valid_count++;
@@ -127,34 +115,31 @@ GSeries VolumeFactor::definition_with_cal_engine(
     
     spdlog::debug("cal_engine因子计算: ti={}, 映射到{}频率范围: [{}, {}]", ti, static_cast<int>(indicator_freq), start_indicator_index, end_indicator_index);
     
+    // 各股票volume序列的视图在同一时间事件内由所有Factor共享
+    auto volume_views = cal_engine->shared_field_views(sorted_stock_list, indicator_freq, "volume");
+
     // 从CalculationEngine获取数据
     for (size_t i = 0; i < sorted_stock_list.size(); ++i) {
-        const std::string& stock = sorted_stock_list[i];
         double value = NAN;
         
-        // 获取该股票的BarSeriesHolder
-        auto bar_holder = cal_engine->get_bar_series_holder(stock);
-        if (bar_holder) {
-            // 从BarSeriesHolder获取volume数据
-            GSeries volume_series = bar_holder->get_data(indicator_freq, "volume", 0, end_indicator_index);
+        const GSeriesView& volume_series = (*volume_views)[i];
+        
+        if (volume_series.get_size() > 0) {
+            // 计算平均值
+            double total_volume = 0.0;
+            int valid_count = 0;
             
-            if (volume_series.get_size() > 0) {
-                // 计算平均值
-                double total_volume = 0.0;
-                int valid_count = 0;
-                
-                for (int j = start_indicator_index; j <= end_indicator_index && j < volume_series.get_size(); ++j) {
-                    double vol = volume_series.get(j);
-                    if (!std::isnan(vol)) {
-                        total_volume += vol;
-                        valid_count++;
-                    }
-                }
-                
-                if (valid_count > 0) {
-                    value = total_volume / valid_count;
+            for (int j = start_indicator_index; j <= end_indicator_index && j < volume_series.get_size(); ++j) {
+                double vol = volume_series.get(j);
+                if (!std::isnan(vol)) {
+                    total_volume += vol;
+                    valid_count++;
                 }
             }
+            
+            if (valid_count > 0) {
+                value = total_volume / valid_count;
+            }
         }
         
         result.set(i, value);
@@ -165,6 +150,48 @@ GSeries VolumeFactor::definition_with_cal_engine(
 
 
 
+// VolumeFactor的整日回填：每个时间桶取映射到的volume桶的均值，与definition_with_cal_engine逐桶结果一致
+std::vector<GSeries> VolumeFactor::definition_full_day(
+    const std::shared_ptr<CalculationEngine>& cal_engine,
+    const std::vector<std::string>& sorted_stock_list,
+    int bar_count
+) {
+    std::vector<GSeries> panel(std::max(bar_count, 0));
+    for (auto& section : panel) {
+        section.resize(sorted_stock_list.size());
+    }
+
+    auto volume_indicator = get_indicator_by_name("volume");
+    if (!cal_engine || !volume_indicator) {
+        spdlog::error("VolumeFactor整日回填缺少CalculationEngine或volume indicator");
+        return panel;
+    }
+    Frequency indicator_freq = volume_indicator->frequency();
+
+    for (size_t i = 0; i < sorted_stock_list.size(); ++i) {
+        auto bar_holder = cal_engine->get_bar_series_holder(sorted_stock_list[i]);
+        GSeriesView volume_series;
+        if (bar_holder) {
+            volume_series = bar_holder->get_data_view(indicator_freq, "volume", 0, -1);
+        }
+
+        for (int ti = 0; ti < bar_count; ++ti) {
+            auto [start_index, end_index] = get_time_bucket_range(ti, indicator_freq, Frequency::F1MIN);
+            double total_volume = 0.0;
+            int valid_count = 0;
+            for (int j = start_index; j <= end_index && j < volume_series.get_size(); ++j) {
+                double vol = volume_series[j];
+                if (!std::isnan(vol)) {
+                    total_volume += vol;
+                    valid_count++;
+                }
+            }
+            panel[ti].set(i, valid_count > 0 ? total_volume / valid_count : NAN);
+        }
+    }
+    return panel;
+}
+
 // VolumeFactor的访问器模式实现
 GSeries VolumeFactor::definition_with_accessor(
     std::function<std::shared_ptr<Indicator>(const std::string&)> get_indicator,
@@ -304,8 +331,8 @@ GSeries PriceFactor::definition(
             
             for (int i = start_indicator_index; i <= end_indicator_index; ++i) {
                 // 修复：直接获取完整序列，然后访问第i个元素
-                GSeries amount_series = it->second->get_m_bar("amount");
-                GSeries volume_series = it->second->get_m_bar("volume");
+                GSeriesView amount_series = it->second->get_m_bar_view("amount");
+                GSeriesView volume_series = it->second->get_m_bar_view("volume");
                 
                 // 直接访问第i个索引
                 if (i >= 0 && i < amount_series.get_size() && i < volume_series.get_size() &&
@@ -352,6 +379,19 @@ GSeries PriceFactor::definition_with_cal_engine(
         return result;
     }
     
+    // 若配置了派生的vwap指标且已汇总出5min bar，直接读取共享的中间结果，无需在因子内重算
+    const Indicator* vwap_indicator = get_indicator_by_name("vwap");
+    if (vwap_indicator && vwap_indicator->has_frequency(Frequency::F5MIN)) {
+        auto vwap_views = cal_engine->shared_field_views(sorted_stock_list, Frequency::F5MIN, vwap_indicator->name());
+        for (size_t i = 0; i < sorted_stock_list.size(); ++i) {
+            const GSeriesView& vwap_series = (*vwap_views)[i];
+            result.set(i, vwap_series.empty() ? NAN : vwap_series.get(ti));
+        }
+        spdlog::info("PriceFactor计算完成(vwap指标): 股票数量={}, 有效数据={}/{}", 
+                     sorted_stock_list.size(), result.get_valid_num(), result.get_size());
+        return result;
+    }
+
     // 获取amount和volume indicator的频率
 //    const Indicator* amount_indicator = get_indicator_by_name("amount");
 //    const Indicator* volume_indicator = get_indicator_by_name("volume");
@@ -362,8 +402,8 @@ GSeries PriceFactor::definition_with_cal_engine(
         return result;
     }
 
-    // 提取indicator的频率
-    Frequency diff_freq = diff_indicator->frequency();
+    // 提取indicator的频率；若indicator在写入时已汇总出5min bar，直接读取5min桶
+    Frequency diff_freq = diff_indicator->has_frequency(Frequency::F5MIN) ? Frequency::F5MIN : diff_indicator->frequency();
 
     
     // 使用通用的频率匹配函数计算时间桶映射范围
@@ -372,43 +412,9 @@ GSeries PriceFactor::definition_with_cal_engine(
     spdlog::debug("PriceFactor计算: ti={}, 映射到{}频率范围: [{}, {}]", 
                   ti, static_cast<int>(diff_freq), start_indicator_index, end_indicator_index);
     
-    // 从CalculationEngine获取数据
-    for (size_t i = 0; i < sorted_stock_list.size(); ++i) {
-        const std::string& stock = sorted_stock_list[i];
-        double value = NAN;
-        
-        // 获取该股票的BarSeriesHolder
-        auto bar_holder = cal_engine->get_bar_series_holder(stock);
-        if (bar_holder) {
-            // 从BarSeriesHolder获取amount和volume数据
-            GSeries amount_series = bar_holder->get_data(diff_freq, "amount", 0, end_indicator_index);
-            GSeries volume_series = bar_holder->get_data(diff_freq, "volume", 0, end_indicator_index);
-            
-            if (amount_series.get_size() > 0 && volume_series.get_size() > 0) {
-                // 计算VWAP
-                double total_amount = 0.0;
-                double total_volume = 0.0;
-                int valid_count = 0;
-                
-                for (int j = start_indicator_index; j <= end_indicator_index && j < amount_series.get_size() && j < volume_series.get_size(); ++j) {
-                    double amount = amount_series.get(j);
-                    double volume = volume_series.get(j);
-                    
-                    if (!std::isnan(amount) && !std::isnan(volume) && volume > 0) {
-                        total_amount += amount;
-                        total_volume += volume;
-                        valid_count++;
-                    }
-                }
-                
-                if (valid_count > 0 && total_volume > 0) {
-                    value = total_amount / total_volume;
-                }
-            }
-        }
-        
-        result.set(i, value);
-    }
+    // 区间VWAP = sum(amount) / sum(volume)，由前缀和O(1)得到；同一时间事件内相同区间的截面由各Factor共享
+    // 两个字段的NaN各自跳过（见BarSeriesHolder::range_vwap）
+    result = *cal_engine->shared_range_vwap(sorted_stock_list, diff_freq, start_indicator_index, end_indicator_index);
     
     spdlog::info("PriceFactor计算完成: 股票数量={}, 有效数据={}/{}", 
                  sorted_stock_list.size(), result.get_valid_num(), result.get_size());
@@ -418,6 +424,58 @@ GSeries PriceFactor::definition_with_cal_engine(
 
  
 
+// PriceFactor的整日回填：与definition_with_cal_engine的两条路径一致，外层按股票遍历
+std::vector<GSeries> PriceFactor::definition_full_day(
+    const std::shared_ptr<CalculationEngine>& cal_engine,
+    const std::vector<std::string>& sorted_stock_list,
+    int bar_count
+) {
+    std::vector<GSeries> panel(std::max(bar_count, 0));
+    for (auto& section : panel) {
+        section.resize(sorted_stock_list.size());
+    }
+    if (!cal_engine) {
+        spdlog::error("CalculationEngine为空，无法获取数据");
+        return panel;
+    }
+
+    const Indicator* vwap_indicator = get_indicator_by_name("vwap");
+    const Indicator* diff_indicator = get_indicator_by_name("diff_volume_amount");
+    bool use_vwap = vwap_indicator && vwap_indicator->has_frequency(Frequency::F5MIN);
+    if (!use_vwap && !diff_indicator) {
+        spdlog::error("找不到diff indicator");
+        return panel;
+    }
+    Frequency diff_freq = Frequency::F5MIN;
+    if (!use_vwap && !diff_indicator->has_frequency(Frequency::F5MIN)) {
+        diff_freq = diff_indicator->frequency();
+    }
+
+    for (size_t i = 0; i < sorted_stock_list.size(); ++i) {
+        auto bar_holder = cal_engine->get_bar_series_holder(sorted_stock_list[i]);
+        if (!bar_holder) {
+            for (int ti = 0; ti < bar_count; ++ti) panel[ti].set(i, NAN);
+            continue;
+        }
+        if (use_vwap) {
+            // 已汇总的5min vwap序列整段读取一次
+            GSeriesView vwap_series = bar_holder->get_data_view(Frequency::F5MIN, vwap_indicator->name(), 0, -1);
+            for (int ti = 0; ti < bar_count; ++ti) {
+                panel[ti].set(i, vwap_series.get(ti));
+            }
+        } else {
+            // 各桶区间VWAP由前缀和O(1)得到，前缀和在首个桶时一次建好
+            for (int ti = 0; ti < bar_count; ++ti) {
+                auto [start_index, end_index] = get_time_bucket_range(ti, diff_freq, Frequency::F5MIN);
+                panel[ti].set(i, bar_holder->range_vwap(diff_freq, start_index, end_index));
+            }
+        }
+    }
+
+    spdlog::info("PriceFactor整日回填完成: 股票数量={}, 时间桶数量={}", sorted_stock_list.size(), bar_count);
+    return panel;
+}
+
 // 重写基类的definition_with_timestamp方法（保持参数一致）
 GSeries PriceFactor::definition_with_timestamp(
     std::function<std::shared_ptr<Indicator>(const std::string&)> get_indicator,
@@ -513,34 +571,10 @@ double PriceFactor::calculate_aggregated_vwap(
 ) {
     // 计算基础15s数据的起始和结束索引
     int base_start = target_index * ratio;
-    int base_end = std::min(base_start + ratio - 1, 947); // 避免超出范围
-    
-    // 聚合amount和volume
-    double aggregated_amount = 0.0;
-    double aggregated_volume = 0.0;
-    int valid_count = 0;
-    
-    for (int i = base_start; i <= base_end; ++i) {
-        if (i >= diff_holder->get_m_bar("amount").get_size() || 
-            i >= diff_holder->get_m_bar("volume").get_size()) {
-            continue;
-        }
-        
-        double amount = diff_holder->get_m_bar("amount").get(i);
-        double volume = diff_holder->get_m_bar("volume").get(i);
-        
-        if (!std::isnan(amount) && !std::isnan(volume) && volume > 0) {
-            aggregated_amount += amount;
-            aggregated_volume += volume;
-            valid_count++;
-        }
-    }
+    int base_end = std::min(base_start + ratio - 1, get_bars_per_day(Frequency::F15S) - 1); // 避免超出范围
     
-    if (valid_count > 0 && aggregated_volume > 0) {
-        return aggregated_amount / aggregated_volume;
-    }
-    
-    return NAN;
+    // 基于前缀和的区间求和，聚合成本与ratio无关（NaN按字段各自跳过，见BarSeriesHolder::range_vwap）
+    return diff_holder->range_vwap("amount", "volume", base_start, base_end);
 }
 
 // 新增：静态聚合工具函数
@@ -648,4 +682,183 @@ GSeries PriceFactor::definition_with_timestamp_original(
     }
     
     return result;
-} 
\ No newline at end of file
+} 
+// IntradayVwapFactor：非增量路径，每次由前缀和求[0, end]区间VWAP
+GSeries IntradayVwapFactor::definition_with_cal_engine(
+    const std::shared_ptr<CalculationEngine>& cal_engine,
+    const std::vector<std::string>& sorted_stock_list,
+    int ti
+) {
+    GSeries result;
+    result.resize(sorted_stock_list.size());
+
+    const Indicator* diff_indicator = get_indicator_by_name("diff_volume_amount");
+    if (!cal_engine || !diff_indicator) {
+        spdlog::error("IntradayVwapFactor缺少CalculationEngine或diff indicator");
+        return result;
+    }
+    Frequency input_freq = diff_indicator->frequency();
+    int end_index = get_time_bucket_range(ti, input_freq, get_frequency()).second;
+    return *cal_engine->shared_range_vwap(sorted_stock_list, input_freq, 0, end_index);
+}
+
+void IntradayVwapFactor::on_day_start(
+    const std::shared_ptr<CalculationEngine>& /*cal_engine*/,
+    const std::vector<std::string>& sorted_stock_list
+) {
+    states_.assign(sorted_stock_list.size(), RunningState{});
+    const Indicator* diff_indicator = get_indicator_by_name("diff_volume_amount");
+    if (diff_indicator) {
+        input_frequency_ = diff_indicator->frequency();
+    } else {
+        spdlog::error("IntradayVwapFactor找不到diff indicator");
+    }
+}
+
+// 字段各自只累加有效值（range_vwap的前缀和也按字段独立跳过NaN），某行只有一个字段缺失时另一个字段仍计入
+void IntradayVwapFactor::accumulate_row(RunningState& state, double amount, double volume) {
+    if (std::isfinite(amount)) {
+        state.amount += amount;
+        ++state.amount_count;
+    }
+    if (std::isfinite(volume)) {
+        state.volume += volume;
+        ++state.volume_count;
+    }
+}
+
+// 当前时间桶之前的输入行已收盘，并入累计状态；当前桶内的行可能仍在写入（实时模式），只临时累加
+GSeries IntradayVwapFactor::on_bucket(
+    const std::shared_ptr<CalculationEngine>& cal_engine,
+    const std::vector<std::string>& sorted_stock_list,
+    int ti
+) {
+    GSeries result;
+    result.resize(sorted_stock_list.size());
+    if (!cal_engine || states_.size() != sorted_stock_list.size()) {
+        spdlog::error("IntradayVwapFactor未初始化当日状态");
+        return result;
+    }
+
+    auto [start_index, end_index] = get_time_bucket_range(ti, input_frequency_, get_frequency());
+    auto amount_views = cal_engine->shared_field_views(sorted_stock_list, input_frequency_, "amount");
+    auto volume_views = cal_engine->shared_field_views(sorted_stock_list, input_frequency_, "volume");
+
+    for (size_t i = 0; i < sorted_stock_list.size(); ++i) {
+        const GSeriesView& amount_series = (*amount_views)[i];
+        const GSeriesView& volume_series = (*volume_views)[i];
+        int size = std::min(amount_series.get_size(), volume_series.get_size());
+
+        RunningState& state = states_[i];
+        for (; state.next_row < start_index && state.next_row < size; ++state.next_row) {
+            accumulate_row(state, amount_series[state.next_row], volume_series[state.next_row]);
+        }
+
+        RunningState total = state;
+        for (int j = std::max(start_index, state.next_row); j <= end_index && j < size; ++j) {
+            accumulate_row(total, amount_series[j], volume_series[j]);
+        }
+        bool valid = total.amount_count > 0 && total.volume_count > 0 && total.volume > 0.0;
+        result.set(i, valid ? total.amount / total.volume : NAN);
+    }
+    return result;
+}
+
+// ExpressionFactor实现
+
+std::vector<IndicatorRequirement> ExpressionFactor::required_inputs() const {
+    std::string frequency;
+    switch (frequency_) {
+        case Frequency::F15S: frequency = "15S"; break;
+        case Frequency::F1MIN: frequency = "1min"; break;
+        case Frequency::F5MIN: frequency = "5min"; break;
+        case Frequency::F30MIN: frequency = "30min"; break;
+    }
+    std::vector<IndicatorRequirement> requirements;
+    for (const ExprNode* input : plan_->inputs_of(root_)) {
+        requirements.push_back({input->indicator, input->field, frequency, pre_days_});
+    }
+    return requirements;
+}
+
+ExpressionPlan::InputLoader ExpressionFactor::make_loader(
+    const std::shared_ptr<CalculationEngine>& cal_engine,
+    const std::vector<std::string>& sorted_stock_list
+) const {
+    Frequency factor_freq = get_frequency();
+    return [cal_engine, &sorted_stock_list, factor_freq](const ExprNode& input, FactorPanel& out, int first_row) {
+        // 计划求值时可能加载其他表达式因子的叶子，因此从engine按名称查找指标，而不是本因子的依赖列表
+        std::shared_ptr<Indicator> indicator = cal_engine->get_indicator(input.indicator);
+        if (!indicator) {
+            spdlog::error("表达式输入的指标[{}]未配置", input.indicator);
+            return;
+        }
+        // 指标已汇总到因子频率时直接读取，否则按字段的合并方式把基础频率的行聚合到因子时间桶
+        bool direct = indicator->has_frequency(factor_freq);
+        Frequency read_freq = direct ? factor_freq : indicator->frequency();
+        RollupMethod method = indicator->field_rollup(input.series_key());
+        int stocks = std::min(out.stocks, static_cast<int>(sorted_stock_list.size()));
+
+        auto views = cal_engine->shared_field_views(sorted_stock_list, read_freq, input.series_key());
+
+        for (int i = 0; i < stocks; ++i) {
+            const GSeriesView& series = (*views)[i];
+            int size = series.get_size();
+            for (int ti = first_row; ti < out.buckets; ++ti) {
+                double value = NAN;
+                if (direct) {
+                    if (ti < size) value = series[ti];
+                } else {
+                    auto [start_index, end_index] = get_time_bucket_range(ti, read_freq, factor_freq);
+                    for (int j = start_index; j <= end_index && j < size; ++j) {
+                        value = rollup_combine(method, value, series[j]);
+                    }
+                }
+                out.at(ti, i) = value;
+            }
+        }
+    };
+}
+
+GSeries ExpressionFactor::definition_with_cal_engine(
+    const std::shared_ptr<CalculationEngine>& cal_engine,
+    const std::vector<std::string>& sorted_stock_list,
+    int ti
+) {
+    if (!cal_engine || !plan_ || ti < 0) {
+        spdlog::error("ExpressionFactor[{}]缺少CalculationEngine或执行计划", name_);
+        GSeries result;
+        result.resize(sorted_stock_list.size());
+        return result;
+    }
+    return plan_->section(root_, ti, static_cast<int>(sorted_stock_list.size()),
+                          make_loader(cal_engine, sorted_stock_list));
+}
+
+void ExpressionFactor::on_day_start(
+    const std::shared_ptr<CalculationEngine>& /*cal_engine*/,
+    const std::vector<std::string>& /*sorted_stock_list*/
+) {
+    if (plan_) plan_->reset();
+}
+
+GSeries ExpressionFactor::on_bucket(
+    const std::shared_ptr<CalculationEngine>& cal_engine,
+    const std::vector<std::string>& sorted_stock_list,
+    int ti
+) {
+    return definition_with_cal_engine(cal_engine, sorted_stock_list, ti);
+}
+
+std::vector<GSeries> ExpressionFactor::definition_full_day(
+    const std::shared_ptr<CalculationEngine>& cal_engine,
+    const std::vector<std::string>& sorted_stock_list,
+    int bar_count
+) {
+    if (!cal_engine || !plan_) {
+        spdlog::error("ExpressionFactor[{}]缺少CalculationEngine或执行计划", name_);
+        return std::vector<GSeries>(std::max(bar_count, 0));
+    }
+    return plan_->full_day(root_, bar_count, static_cast<int>(sorted_stock_list.size()),
+                           make_loader(cal_engine, sorted_stock_list));
+}
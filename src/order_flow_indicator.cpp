@@ -0,0 +1,282 @@
+#include "order_flow_indicator.h"
+#include "cal_engine.h"
+#include <filesystem>
+#include <algorithm>
+#include "spdlog/fmt/fmt.h"
+#include "spdlog/spdlog.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 一批逐笔数据的列式视图；每个计算线程一份，跨tick复用，避免逐批分配
+struct TradeColumns {
+    std::vector<double> volume, amount, buy, sell, cancel;
+
+    void resize(size_t n) {
+        volume.resize(n); amount.resize(n); buy.resize(n); sell.resize(n); cancel.resize(n);
+    }
+};
+
+struct OrderColumns {
+    std::vector<double> volume, amount, buy, sell, limit, market, cancel;
+
+    void resize(size_t n) {
+        volume.resize(n); amount.resize(n); buy.resize(n); sell.resize(n);
+        limit.resize(n); market.resize(n); cancel.resize(n);
+    }
+};
+
+thread_local TradeColumns tls_trade_columns;
+thread_local OrderColumns tls_order_columns;
+
+inline bool is_buy_flag(char flag) { return flag == 'B' || flag == '1'; }
+inline bool is_sell_flag(char flag) { return flag == 'S' || flag == '2'; }
+
+}  // namespace
+
+OrderFlowIndicator::OrderFlowIndicator(const ModuleConfig& module) : Indicator(module) {
+    if (module.size_thresholds.size() == 3 &&
+        std::is_sorted(module.size_thresholds.begin(), module.size_thresholds.end())) {
+        std::copy(module.size_thresholds.begin(), module.size_thresholds.end(), size_thresholds_);
+    } else if (!module.size_thresholds.empty()) {
+        spdlog::warn("OrderFlowIndicator[{}] size_thresholds需要3个升序金额，使用默认值", module.name);
+    }
+
+    for (const auto& field : module.fields) {
+        bool found = false;
+        for (size_t i = 0; i < kOrderFlowFieldCount; ++i) {
+            if (field == kOrderFlowFieldTable[i].output_key) {
+                if (std::find(enabled_fields_.begin(), enabled_fields_.end(), i) == enabled_fields_.end()) {
+                    enabled_fields_.push_back(i);
+                }
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            spdlog::warn("[OrderFlowIndicator] 未知字段: {}，已忽略", field);
+        }
+    }
+    if (module.fields.empty()) {
+        for (size_t i = 0; i < kOrderFlowFieldCount; ++i) enabled_fields_.push_back(i);
+    }
+
+    spdlog::info("OrderFlowIndicator[{}] 初始化完成: 频率={}, 字段数={}, 单笔金额阈值={}/{}/{}",
+                 module.name, module.frequency, enabled_fields_.size(),
+                 size_thresholds_[0], size_thresholds_[1], size_thresholds_[2]);
+}
+
+void OrderFlowIndicator::Calculate(const SyncTickData& tick_data) {
+    BarSeriesHolder* holder = get_stock_bar_holder(tick_data.symbol);
+    if (!holder) {
+        spdlog::warn("[OrderFlowIndicator] 无法获取股票{}的BarSeriesHolder", tick_data.symbol);
+        return;
+    }
+    calculate_with_context(IndicatorTickContext::resolve(tick_data, holder));
+}
+
+void OrderFlowIndicator::calculate_with_context(const IndicatorTickContext& ctx) {
+    if (!ctx.holder || enabled_fields_.empty()) return;
+
+    double totals[kOrderFlowFieldCount] = {};
+    reduce_trades(ctx.tick->trans, totals);
+    reduce_orders(ctx.tick->orders, totals);
+
+    FieldContribution contributions[kOrderFlowFieldCount];
+    size_t count = 0;
+    for (size_t i : enabled_fields_) {
+        contributions[count++] = {kOrderFlowFieldTable[i].output_key, totals[i], RollupMethod::Sum};
+    }
+    write_fields_with_context(ctx, handle_slot_base_, enabled_fields_.data(), contributions, count);
+}
+
+void OrderFlowIndicator::reduce_trades(const std::vector<TradeData>& trades, double* totals) const {
+    const size_t n = trades.size();
+    if (n == 0) return;
+
+    // 1. 整理为列式数组：方向和撤单标志转为0/1
+    TradeColumns& c = tls_trade_columns;
+    c.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const TradeData& trade = trades[i];
+        bool cancel = trade.cancel_flag == 'C' || trade.price <= 0;
+        c.volume[i] = trade.volume;
+        c.amount[i] = trade.trade_money > 0 ? trade.trade_money : trade.price * trade.volume;
+        c.cancel[i] = cancel ? 1.0 : 0.0;
+        c.buy[i] = (!cancel && is_buy_flag(trade.side)) ? 1.0 : 0.0;
+        c.sell[i] = (!cancel && is_sell_flag(trade.side)) ? 1.0 : 0.0;
+    }
+
+    // 2. 单次遍历归约，循环体内无分支
+    const double* volume = c.volume.data();
+    const double* amount = c.amount.data();
+    const double* buy = c.buy.data();
+    const double* sell = c.sell.data();
+    const double* cancel = c.cancel.data();
+    const double t0 = size_thresholds_[0], t1 = size_thresholds_[1], t2 = size_thresholds_[2];
+    double buy_volume = 0, buy_amount = 0, sell_volume = 0, sell_amount = 0, cancel_volume = 0;
+    double large_buy = 0, large_sell = 0, small = 0, medium = 0, large = 0, xlarge = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const double fill = 1.0 - cancel[i];
+        const double a = amount[i];
+        const double is_large = static_cast<double>(a >= t1);
+        buy_volume += buy[i] * volume[i];
+        buy_amount += buy[i] * a;
+        sell_volume += sell[i] * volume[i];
+        sell_amount += sell[i] * a;
+        cancel_volume += cancel[i] * volume[i];
+        large_buy += buy[i] * is_large * volume[i];
+        large_sell += sell[i] * is_large * volume[i];
+        small += fill * static_cast<double>(a < t0);
+        medium += fill * static_cast<double>(a >= t0 && a < t1);
+        large += fill * static_cast<double>(a >= t1 && a < t2);
+        xlarge += fill * static_cast<double>(a >= t2);
+    }
+
+    totals[kActiveBuyVolume] += buy_volume;
+    totals[kActiveBuyAmount] += buy_amount;
+    totals[kActiveSellVolume] += sell_volume;
+    totals[kActiveSellAmount] += sell_amount;
+    totals[kCancelVolume] += cancel_volume;
+    totals[kLargeBuyVolume] += large_buy;
+    totals[kLargeSellVolume] += large_sell;
+    totals[kTradeCountSmall] += small;
+    totals[kTradeCountMedium] += medium;
+    totals[kTradeCountLarge] += large;
+    totals[kTradeCountXLarge] += xlarge;
+}
+
+void OrderFlowIndicator::reduce_orders(const std::vector<OrderData>& orders, double* totals) const {
+    const size_t n = orders.size();
+    if (n == 0) return;
+
+    // 1. 整理为列式数组；上交所删除委托（order_kind='D'）计为撤单，不计入新增委托
+    OrderColumns& c = tls_order_columns;
+    c.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const OrderData& order = orders[i];
+        bool cancel = order.order_kind == 'D';
+        c.volume[i] = order.volume;
+        c.amount[i] = order.price * order.volume;
+        c.cancel[i] = cancel ? 1.0 : 0.0;
+        c.buy[i] = (!cancel && is_buy_flag(order.bs_flag)) ? 1.0 : 0.0;
+        c.sell[i] = (!cancel && is_sell_flag(order.bs_flag)) ? 1.0 : 0.0;
+        c.limit[i] = (!cancel && order.price > 0) ? 1.0 : 0.0;
+        c.market[i] = (!cancel && order.price <= 0) ? 1.0 : 0.0;
+    }
+
+    // 2. 单次遍历归约
+    const double* volume = c.volume.data();
+    const double* amount = c.amount.data();
+    const double* buy = c.buy.data();
+    const double* sell = c.sell.data();
+    const double* limit = c.limit.data();
+    const double* market = c.market.data();
+    const double* cancel = c.cancel.data();
+    const double t1 = size_thresholds_[1];
+    double buy_count = 0, sell_count = 0, limit_count = 0, market_count = 0, cancel_volume = 0, large_volume = 0;
+    for (size_t i = 0; i < n; ++i) {
+        buy_count += buy[i];
+        sell_count += sell[i];
+        limit_count += limit[i];
+        market_count += market[i];
+        cancel_volume += cancel[i] * volume[i];
+        large_volume += limit[i] * static_cast<double>(amount[i] >= t1) * volume[i];
+    }
+
+    totals[kBuyOrderCount] += buy_count;
+    totals[kSellOrderCount] += sell_count;
+    totals[kLimitOrderCount] += limit_count;
+    totals[kMarketOrderCount] += market_count;
+    totals[kCancelVolume] += cancel_volume;
+    totals[kLargeOrderVolume] += large_volume;
+}
+
+void OrderFlowIndicator::retain_fields(const std::set<std::string>& fields) {
+    enabled_fields_.erase(std::remove_if(enabled_fields_.begin(), enabled_fields_.end(),
+                                         [&](size_t i) { return fields.count(kOrderFlowFieldTable[i].output_key) == 0; }),
+                          enabled_fields_.end());
+}
+
+BarSeriesHolder* OrderFlowIndicator::get_stock_bar_holder(const std::string& stock_code) const {
+    if (!calculation_engine_) {
+        spdlog::warn("[OrderFlowIndicator] calculation_engine_为空，无法获取股票{}的BarSeriesHolder", stock_code);
+        return nullptr;
+    }
+    return calculation_engine_->get_stock_bar_holder(stock_code);
+}
+
+void OrderFlowIndicator::set_calculation_engine(std::shared_ptr<CalculationEngine> engine) {
+    calculation_engine_ = engine;
+    spdlog::info("[OrderFlowIndicator] 已设置CalculationEngine引用");
+}
+
+bool OrderFlowIndicator::aggregate(const std::string& target_frequency, std::map<int, std::map<std::string, double>>& aggregated_data) {
+    if (enabled_fields_.empty()) {
+        spdlog::warn("OrderFlowIndicator[{}] 未启用任何字段，无法聚合", name_);
+        return false;
+    }
+    return aggregate_field(kOrderFlowFieldTable[enabled_fields_.front()].output_key, target_frequency, aggregated_data);
+}
+
+bool OrderFlowIndicator::aggregate_field(const std::string& output_key, const std::string& target_frequency,
+                                         std::map<int, std::map<std::string, double>>& aggregated_data) {
+    try {
+        if (!calculation_engine_) {
+            spdlog::error("OrderFlowIndicator::aggregate: CalculationEngine为空，无法获取数据");
+            return false;
+        }
+        Frequency target_freq;
+        bool pre_aggregated = IndicatorStorageHelper::parse_frequency(target_frequency, target_freq) && has_frequency(target_freq);
+        return IndicatorStorageHelper::aggregate_additive(calculation_engine_->get_all_bar_series_holders(),
+                                                          frequency_, output_key, target_frequency, aggregated_data,
+                                                          pre_aggregated);
+    } catch (const std::exception& e) {
+        spdlog::error("OrderFlowIndicator聚合失败：{}", e.what());
+        return false;
+    }
+}
+
+bool OrderFlowIndicator::save_results(const ModuleConfig& module, const std::string& date) {
+    try {
+        if (!calculation_engine_) {
+            spdlog::error("CalculationEngine为空，无法获取数据");
+            return false;
+        }
+        fs::path base_path = fs::path(module.path) / date / module.frequency;
+        if (!IndicatorStorageHelper::ensure_directory(base_path.string())) {
+            return false;
+        }
+
+        const auto& all_bar_holders = calculation_engine_->get_all_bar_series_holders();
+        if (all_bar_holders.empty()) {
+            spdlog::warn("没有找到任何BarSeriesHolder，无数据可保存");
+            return true;
+        }
+
+        for (size_t field_index : enabled_fields_) {
+            const std::string output_key = kOrderFlowFieldTable[field_index].output_key;
+            std::vector<std::string> stocks;
+            std::vector<GSeriesView> columns;
+            stocks.reserve(all_bar_holders.size());
+            columns.reserve(all_bar_holders.size());
+            for (const auto& [stock_code, holder] : all_bar_holders) {
+                stocks.push_back(stock_code);
+                columns.push_back(holder ? holder->get_data_view(frequency_, output_key, 0, -1) : GSeriesView());
+            }
+
+            fs::path file_stem = base_path / fmt::format("{}_{}_{}_{}", module.name, output_key, date, module.frequency);
+            std::string file_path;
+            if (!IndicatorStorageHelper::write_bar_columns(file_stem.string(), module.frequency, stocks, columns,
+                                                           module, file_path)) {
+                return false;
+            }
+            spdlog::info("订单流数据保存成功：{}", file_path);
+        }
+        return true;
+    } catch (const std::exception& e) {
+        spdlog::error("保存指标[{}]失败：{}", module.name, e.what());
+        return false;
+    }
+}
@@ -0,0 +1,149 @@
+// 模板累加器的合并与单次遍历一致、与两遍公式一致；P²分位数的精度；IncreaseMedian默认精确
+#include "test_common.h"
+#include "increasing.h"
+#include <random>
+
+namespace {
+
+bool close(double a, double b, double tolerance = 1e-9) {
+    return (std::isnan(a) && std::isnan(b)) || std::fabs(a - b) <= tolerance * std::max(1.0, std::fabs(b));
+}
+
+double exact_quantile(std::vector<double> values, double q) {
+    std::sort(values.begin(), values.end());
+    double rank = q * (values.size() - 1);
+    size_t lo = static_cast<size_t>(std::floor(rank));
+    size_t hi = std::min(lo + 1, values.size() - 1);
+    return values[lo] + (rank - lo) * (values[hi] - values[lo]);
+}
+
+// 两遍公式的样本统计量（偏度、峰度的修正与IncreaseSkew/IncreaseKurt一致）
+struct Direct {
+    double mean = 0.0, var = 0.0, skew = 0.0, kurt = 0.0;
+
+    explicit Direct(const std::vector<double>& x) {
+        double n = static_cast<double>(x.size());
+        for (double v : x) mean += v;
+        mean /= n;
+        double m2 = 0.0, m3 = 0.0, m4 = 0.0;
+        for (double v : x) {
+            double d = v - mean;
+            m2 += d * d;
+            m3 += d * d * d;
+            m4 += d * d * d * d;
+        }
+        var = m2 / (n - 1.0);
+        skew = (n / (n - 2.0)) * std::sqrt(n - 1.0) * m3 / std::pow(m2, 1.5);
+        double g2 = n * m4 / (m2 * m2) - 3.0;
+        kurt = (n - 1.0) / ((n - 2.0) * (n - 3.0)) * ((n + 1.0) * g2 + 6.0);
+    }
+};
+
+}  // namespace
+
+int main() {
+    std::mt19937 rng(20240701);
+    std::lognormal_distribution<double> price(0.0, 0.5);
+    std::normal_distribution<double> noise(0.0, 1.0);
+
+    // 4个15S桶的累加器按时间顺序合并为1min，与整段单次累加、两遍公式一致；桶大小不等且含空桶
+    const std::vector<int> bucket_sizes = {37, 0, 121, 58};
+    std::vector<double> all_x, all_y;
+    BarStatistics merged;
+    AccCrossMoments merged_cross;
+    for (int size : bucket_sizes) {
+        BarStatistics bucket;
+        AccCrossMoments bucket_cross;
+        for (int k = 0; k < size; ++k) {
+            double x = 100.0 * price(rng);
+            double y = 0.3 * x + noise(rng);
+            all_x.push_back(x);
+            all_y.push_back(y);
+            bucket.add(x);
+            bucket_cross.add(x, y);
+        }
+        merged.merge(bucket);
+        merged_cross.merge(bucket_cross);
+    }
+    BarStatistics single;
+    AccCrossMoments single_cross;
+    for (size_t i = 0; i < all_x.size(); ++i) {
+        single.add(all_x[i]);
+        single_cross.add(all_x[i], all_y[i]);
+    }
+    Direct direct(all_x);
+    CHECK(merged.count() == static_cast<int64_t>(all_x.size()));
+    CHECK(close(merged.sum(), single.sum()));
+    CHECK(merged.min() == *std::min_element(all_x.begin(), all_x.end()));
+    CHECK(merged.max() == *std::max_element(all_x.begin(), all_x.end()));
+    CHECK(merged.first() == all_x.front());
+    CHECK(merged.last() == all_x.back());
+    CHECK(close(merged.mean(), direct.mean));
+    CHECK(close(merged.var(), direct.var));
+    CHECK(close(merged.skew(), direct.skew));
+    CHECK(close(merged.kurt(), direct.kurt));
+    CHECK(close(single.kurt(), direct.kurt));
+
+    double mean_x = direct.mean, mean_y = 0.0, cxy = 0.0, sxx = 0.0, syy = 0.0, sum_xy = 0.0;
+    for (double y : all_y) mean_y += y;
+    mean_y /= all_y.size();
+    for (size_t i = 0; i < all_x.size(); ++i) {
+        cxy += (all_x[i] - mean_x) * (all_y[i] - mean_y);
+        sxx += (all_x[i] - mean_x) * (all_x[i] - mean_x);
+        syy += (all_y[i] - mean_y) * (all_y[i] - mean_y);
+        sum_xy += all_x[i] * all_y[i];
+    }
+    CHECK(close(merged_cross.cov(), cxy / (all_x.size() - 1.0)));
+    CHECK(close(merged_cross.corr(), cxy / std::sqrt(sxx * syy)));
+    CHECK(close(merged_cross.beta(), cxy / sxx));
+    CHECK(close(merged_cross.sum_of_products(), sum_xy));
+    CHECK(close(merged_cross.corr(), single_cross.corr()));
+
+    // 非有限值跳过；空累加器的统计量为NaN
+    BarStatistics empty;
+    empty.add(NAN);
+    CHECK(empty.count() == 0);
+    CHECK(std::isnan(empty.mean()) && std::isnan(empty.min()) && std::isnan(empty.sum()));
+
+    // P²：长序列上的中位数和90%分位数误差在分布尺度的1%以内
+    std::vector<double> stream;
+    P2Quantile median(0.5), p90(0.9);
+    for (int k = 0; k < 100000; ++k) {
+        double x = 100.0 * price(rng);
+        stream.push_back(x);
+        median.add(x);
+        p90.add(x);
+    }
+    double scale = exact_quantile(stream, 0.9) - exact_quantile(stream, 0.1);
+    CHECK(std::fabs(median.value() - exact_quantile(stream, 0.5)) < 0.01 * scale);
+    CHECK(std::fabs(p90.value() - exact_quantile(stream, 0.9)) < 0.01 * scale);
+
+    // 不足5个样本时精确；seed_sorted用有序样本初始化后继续流式更新
+    P2Quantile small(0.5);
+    for (double x : {3.0, 1.0, 2.0, 10.0}) small.add(x);
+    CHECK(close(small.value(), 2.5));
+    std::vector<double> head(stream.begin(), stream.begin() + 2000);
+    std::sort(head.begin(), head.end());
+    P2Quantile seeded(0.5);
+    seeded.seed_sorted(head);
+    CHECK(seeded.count() == 2000);
+    CHECK(std::fabs(seeded.value() - exact_quantile(head, 0.5)) < 0.01 * scale);
+    for (size_t k = 2000; k < stream.size(); ++k) seeded.add(stream[k]);
+    CHECK(std::fabs(seeded.value() - exact_quantile(stream, 0.5)) < 0.01 * scale);
+    P2Quantile seeded_small(0.5);
+    seeded_small.seed_sorted({1.0, 2.0, 4.0});
+    CHECK(close(seeded_small.value(), 2.0));
+
+    // IncreaseMedian默认精确；开启P²后超过阈值转为近似并保持精度
+    std::vector<double> window(stream.begin(), stream.begin() + 5001);
+    IncreaseMedian exact;
+    IncreaseMedian streaming(1024);
+    for (double x : window) {
+        exact.increase(x);
+        streaming.increase(x);
+    }
+    CHECK(exact.get_value() == exact_quantile(window, 0.5));
+    CHECK(std::fabs(streaming.get_value() - exact_quantile(window, 0.5)) < 0.01 * scale);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,106 @@
+// BarBuffer多日缓冲：换日（环形前移当日槽）、跨日窗口（含环绕）和历史天数不足时的截断
+#include "test_common.h"
+
+namespace {
+
+void fill_today(BarBuffer& buffer, double base) {
+    for (int i = 0; i < buffer.get_size(); ++i) buffer.set(i, base + i);
+}
+
+void check_roll(StoragePrecision precision) {
+    BarBuffer buffer(4, precision, 3);
+    fill_today(buffer, 10.0);
+    CHECK(buffer.range_sum(0, 3) == 46.0);
+
+    // 换日：原当日成为T-1，新的当日为NaN，前缀和随之失效
+    buffer.roll_day();
+    CHECK(std::isnan(buffer.get(0)));
+    CHECK(std::isnan(buffer.range_sum(0, 3)));
+    CHECK(buffer.day_view(1)[0] == 10.0 && buffer.day_view(1)[3] == 13.0);
+    fill_today(buffer, 20.0);
+
+    // 跨日窗口物理连续：[T-1全天, 当日0..1]
+    GSeriesView window = buffer.window_view(1, 1);
+    CHECK(window.get_size() == 6);
+    CHECK(window[0] == 10.0 && window[3] == 13.0 && window[4] == 20.0 && window[5] == 21.0);
+
+    // 再换两日后最早的一日被丢弃
+    buffer.roll_day();
+    fill_today(buffer, 30.0);
+    CHECK(buffer.day_view(2)[0] == 10.0 && buffer.day_view(1)[0] == 20.0);
+    buffer.roll_day();
+    fill_today(buffer, 40.0);
+    CHECK(buffer.day_view(2)[0] == 20.0 && buffer.day_view(1)[0] == 30.0 && buffer.get(0) == 40.0);
+    // 当日槽已绕回环首：窗口取镜像副本，仍按时间顺序连续
+    GSeriesView wrapped = buffer.window_view(2, 3);
+    CHECK(wrapped.get_size() == 12);
+    CHECK(wrapped[0] == 20.0 && wrapped[4] == 30.0 && wrapped[8] == 40.0 && wrapped[11] == 43.0);
+    CHECK(buffer.last_n_view(5, 3)[0] == 33.0);
+    CHECK(buffer.day_view(3).empty());
+
+    // 读取不修改布局：先取视图，再次读取窗口后视图内容不变
+    GSeriesView held = buffer.day_view(1);
+    buffer.window_view(2, 0);
+    buffer.last_n_view(9, 0);
+    CHECK(held[0] == 30.0 && held[3] == 33.0);
+
+    // 换日只移动当日槽：再换一日后T-1即原当日，跨日窗口与逐日视图一致，当日写入同步到镜像
+    buffer.roll_day();
+    buffer.set(0, 50.0);
+    GSeriesView window2 = buffer.window_view(2, 0);
+    CHECK(window2.get_size() == 9);
+    CHECK(window2[0] == 30.0 && window2[4] == 40.0 && window2[8] == 50.0);
+    CHECK(buffer.day_view(1)[3] == 43.0 && buffer.get(0) == 50.0);
+}
+
+void check_holder_roll() {
+    BarSeriesHolder holder("000001.SZ");
+    holder.set_pre_days(1);
+    holder.update_time(test::market_time(0));
+    holder.update(Frequency::F1MIN, "volume", 5.0);
+    holder.update_time(test::market_time(60));
+    holder.update(Frequency::F1MIN, "volume", 7.0);
+
+    holder.roll_day();
+    holder.reset_indices();
+    holder.update_time(test::market_time(0));
+    holder.update(Frequency::F1MIN, "volume", 9.0);
+
+    // 换日后原当日成为T-1：[T-1全天, 当日第0个bar]
+    GSeriesView exact = holder.get_today_min_series_view("1min.volume.0", 1, 0);
+    CHECK(exact.get_size() == 238);
+    CHECK(exact[0] == 5.0 && exact[1] == 7.0 && exact[237] == 9.0);
+
+    // 请求的历史天数超过保留天数时截断为保留天数，当日数据仍在视图末尾
+    GSeriesView clamped = holder.get_today_min_series_view("1min.volume.0", 3, 0);
+    CHECK(!clamped.empty());
+    CHECK(test::same_series(clamped, exact));
+}
+
+// 区间VWAP：两个字段各自跳过NaN，区间内无成交量或无有效值时为NaN
+void check_range_vwap() {
+    BarSeriesHolder holder("000001.SZ");
+    const double amounts[] = {100.0, NAN, 300.0, 0.0};
+    const double volumes[] = {10.0, 20.0, NAN, 0.0};
+    for (int i = 0; i < 4; ++i) {
+        holder.update_time(test::market_time(60 * i));
+        holder.update(Frequency::F1MIN, "amount", amounts[i]);
+        holder.update(Frequency::F1MIN, "volume", volumes[i]);
+    }
+    CHECK(holder.range_vwap(Frequency::F1MIN, 0, 0) == 10.0);
+    // 桶1只有volume、桶2只有amount，各自计入：(100 + 300) / (10 + 20)
+    CHECK(std::fabs(holder.range_vwap(Frequency::F1MIN, 0, 2) - 400.0 / 30.0) < 1e-12);
+    CHECK(std::isnan(holder.range_vwap(Frequency::F1MIN, 1, 1)));  // 区间内没有有效的amount
+    CHECK(std::isnan(holder.range_vwap(Frequency::F1MIN, 3, 3)));  // 成交量为0
+}
+
+}  // namespace
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+    check_roll(StoragePrecision::Float64);
+    check_roll(StoragePrecision::Float32);
+    check_holder_roll();
+    check_range_vwap();
+    return TEST_RESULT();
+}
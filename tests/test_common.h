@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "data_structures.h"
+
+// 单元测试的最小断言工具：CHECK失败时打印位置并计数，不中断后续检查；main返回TEST_RESULT()
+namespace test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+// NaN与NaN视为相等
+inline bool same_value(double a, double b) {
+    return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+// 逐元素比较，较短一侧缺少的尾部视为NaN（从文件加载的序列只到最后一个有效时间桶）
+inline bool same_series(const GSeriesView& a, const GSeriesView& b) {
+    int size = std::max(a.get_size(), b.get_size());
+    for (int i = 0; i < size; ++i) {
+        double x = i < a.get_size() ? a[i] : NAN;
+        double y = i < b.get_size() ? b[i] : NAN;
+        if (!same_value(x, y)) return false;
+    }
+    return true;
+}
+
+// 每个测试独立的临时目录，已存在时先清空
+inline std::filesystem::path temp_dir(const std::string& name) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / ("aff_test_" + name);
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+// 北京时间 2024-07-01 09:30:00 之后offset_seconds秒的纳秒时间戳（与DataLoader的时间单位一致）
+inline uint64_t market_time(int offset_seconds) {
+    constexpr uint64_t kOpen = 1719797400ULL;  // 2024-07-01 01:30:00 UTC
+    return (kOpen + offset_seconds) * 1000000000ULL;
+}
+
+}  // namespace test
+
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) 失败\n", __FILE__, __LINE__, #cond); \
+            ++test::failures();                                                       \
+        }                                                                             \
+    } while (0)
+
+#define TEST_RESULT() (test::failures() == 0 ? 0 : 1)
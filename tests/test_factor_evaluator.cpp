@@ -0,0 +1,109 @@
+// FactorEvaluator的默认价格来源：DiffIndicator只保存基础频率（1min）的last_price时，评估频率（5min）的价格按Last汇总得到
+#include "test_common.h"
+#include "factor_evaluator.h"
+#include "diff_indicator.h"
+#include "cal_engine.h"
+
+namespace {
+
+const std::string kDate = "20240701";
+constexpr int kStockCount = 12;
+
+std::string stock_code(int s) { return fmt::format("{:06d}.SZ", s + 1); }
+
+// 每只股票价格以不同速度上涨，保证截面上远期收益有差异
+std::vector<MarketAllField> make_ticks(const std::string& symbol, int s) {
+    std::vector<MarketAllField> events;
+    uint64_t seq = 1;
+    for (int second = 0; second < 1800; second += 3) {
+        MarketAllField field(MarketBufferType::Tick, symbol, test::market_time(second), seq++);
+        field.tick.symbol = symbol;
+        field.tick.real_time = test::market_time(second);
+        field.tick.volume = 100.0 * second;
+        field.tick.total_value_traded = 1000.0 * second;
+        field.tick.last_price = 10.0 * (1.0 + 0.0001 * (s + 1) * second / 60.0);
+        events.push_back(field);
+    }
+    return events;
+}
+
+}  // namespace
+
+int main() {
+    spdlog::set_level(spdlog::level::err);
+    const fs::path root = test::temp_dir("factor_evaluator");
+    GlobalConfig config;
+    config.pre_days = 0;
+    config.calculate_date = kDate;
+    config.worker_thread_count = 1;
+
+    ModuleConfig module;
+    module.name = "diff_volume_amount";
+    module.id = "DiffIndicator";
+    module.handler = "Indicator";
+    module.frequency = "1min";
+    module.path = (root / "indicator").string();
+    module.fields = {"volume", "amount", "last_price"};
+
+    std::vector<std::string> stocks;
+    for (int s = 0; s < kStockCount; ++s) stocks.push_back(stock_code(s));
+    auto engine = std::make_shared<CalculationEngine>(config);
+    engine->init_indicator_storage(stocks);
+    auto indicator = std::make_shared<DiffIndicator>(module);
+    indicator->set_calculation_engine(engine);
+    engine->add_indicator(indicator->name(), indicator);
+    engine->compile_indicators();
+    for (int s = 0; s < kStockCount; ++s) engine->process_stock_batch(stocks[s], make_ticks(stocks[s], s));
+    CHECK(indicator->save_results(module, kDate, engine));
+
+    // 5min因子：股票序号，与价格涨速同序
+    std::vector<std::vector<double>> factor_values(kStockCount, std::vector<double>(6));
+    std::vector<GSeriesView> columns;
+    for (int s = 0; s < kStockCount; ++s) {
+        std::fill(factor_values[s].begin(), factor_values[s].end(), static_cast<double>(s));
+        columns.emplace_back(factor_values[s].data(), static_cast<int>(factor_values[s].size()));
+    }
+    ModuleConfig factor_module;
+    factor_module.name = "speed";
+    factor_module.handler = "Factor";
+    factor_module.path = (root / "factor").string();
+    fs::create_directories(root / "factor" / kDate / "5min");
+    std::string written;
+    CHECK(IndicatorStorageHelper::write_bar_columns((root / "factor" / kDate / "5min" / ("speed_" + kDate + "_5min")).string(),
+                                                   "5min", stocks, columns, factor_module, written));
+
+    EvaluationConfig evaluation;
+    evaluation.factor_path = (root / "factor").string();
+    evaluation.price_path = (root / "indicator").string();
+    evaluation.horizons = {1};
+    evaluation.threads = 1;
+    FactorEvaluator evaluator(evaluation);
+
+    // 没有5min价格文件，由1min文件按Last汇总：5min第1个桶等于1min第9个桶
+    BarTable minute_prices, prices;
+    fs::path minute_file = evaluator.price_file_path(kDate, "1min");
+    CHECK(!minute_file.empty());
+    CHECK(evaluator.price_file_path(kDate, "5min").empty());
+    CHECK(FactorEvaluator::read_bar_table(minute_file.string(), minute_prices));
+    CHECK(evaluator.load_prices(kDate, prices));
+    CHECK(prices.stocks == minute_prices.stocks);
+    CHECK(prices.panel.buckets >= 6 && minute_prices.panel.buckets >= 30);
+    if (prices.panel.buckets >= 6 && minute_prices.panel.buckets >= 30) {
+        for (int i = 0; i < prices.panel.stocks; ++i) {
+            CHECK(std::isfinite(prices.panel.at(1, i)));
+            CHECK(prices.panel.at(1, i) == minute_prices.panel.at(9, i));
+        }
+    }
+
+    // 端到端：评估得到正IC
+    std::map<std::string, EvaluationStats> results;
+    CHECK(evaluator.run(kDate, results));
+    CHECK(results.count("speed") == 1);
+    if (results.count("speed")) {
+        CHECK(results["speed"].ic[0].count > 0);
+        CHECK(results["speed"].rank_ic[0].mean() > 0.9);
+    }
+
+    fs::remove_all(root);
+    return TEST_RESULT();
+}
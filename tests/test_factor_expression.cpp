@@ -0,0 +1,83 @@
+// ExpressionPlan逐时间事件增量求值（只算新增的行和上次未收盘的最后一行）与整日一次求值一致
+#include "test_common.h"
+#include "factor_expression.h"
+
+namespace {
+
+constexpr int kRows = 48;
+constexpr int kStocks = 20;
+
+// 确定性的伪随机数据，少量NaN
+double sample(int ti, int i, int field, double revision) {
+    if ((ti * 7 + i * 3 + field) % 29 == 0) return NAN;
+    double x = std::sin(0.37 * ti + 1.3 * i + 2.1 * field) + 0.01 * i * (field + 1);
+    return 100.0 + 10.0 * x + revision;
+}
+
+bool close(double a, double b) {
+    return (std::isnan(a) && std::isnan(b)) || std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b));
+}
+
+}  // namespace
+
+int main() {
+    spdlog::set_level(spdlog::level::err);
+    ExpressionPlan plan;
+    std::vector<int> roots = {
+        plan.add_root("momentum", "rank(delta(ind.price, 3) / ts_std(ind.price, 5, 2))"),
+        plan.add_root("flow", "zscore(ts_mean(ind.volume, 4) - delay(ind.volume, 2))"),
+        plan.add_root("mix", "pct_change(ind.price, 1) * abs(ts_sum(ind.volume, 6)) + max(ts_max(ind.price, 3), 100)"),
+    };
+    for (int root : roots) CHECK(root >= 0);
+
+    // current_row之前的行是最终值，current_row本身先给出未收盘的临时值
+    int current_row = -1;
+    double pending_revision = 0.0;
+    ExpressionPlan::InputLoader load = [&](const ExprNode& input, FactorPanel& out, int first_row) {
+        int field = input.field == "price" ? 0 : 1;
+        for (int ti = first_row; ti < out.buckets; ++ti) {
+            double revision = ti == current_row ? pending_revision : 0.0;
+            for (int i = 0; i < out.stocks; ++i) out.at(ti, i) = sample(ti, i, field, revision);
+        }
+    };
+
+    // 每个时间桶两轮事件：第一轮当前行未收盘，第二轮收盘后重新请求同一个时间桶
+    std::vector<std::vector<GSeries>> incremental(roots.size(), std::vector<GSeries>(kRows));
+    for (int ti = 0; ti < kRows; ++ti) {
+        current_row = ti;
+        pending_revision = 5.0;
+        for (size_t r = 0; r < roots.size(); ++r) plan.section(roots[r], ti, kStocks, load);
+        pending_revision = 0.0;
+        for (size_t r = 0; r < roots.size(); ++r) incremental[r][ti] = plan.section(roots[r], ti, kStocks, load);
+    }
+
+    current_row = -1;
+    bool all_match = true;
+    int finite = 0;
+    for (size_t r = 0; r < roots.size(); ++r) {
+        std::vector<GSeries> full = plan.full_day(roots[r], kRows, kStocks, load);
+        for (int ti = 0; ti < kRows; ++ti) {
+            for (int i = 0; i < kStocks; ++i) {
+                if (!close(incremental[r][ti].get(i), full[ti].get(i))) all_match = false;
+                if (std::isfinite(full[ti].get(i))) ++finite;
+            }
+        }
+    }
+    CHECK(all_match);
+    CHECK(finite > 0);
+
+    // 整日回填后（中间结果已归还内存池）以及新的一天从头求值
+    plan.reset();
+    GSeries first = plan.section(roots[0], 0, kStocks, load);
+    std::vector<GSeries> full = plan.full_day(roots[0], 1, kStocks, load);
+    bool first_match = true;
+    for (int i = 0; i < kStocks; ++i) first_match = first_match && close(first.get(i), full[0].get(i));
+    CHECK(first_match);
+    GSeries later = plan.section(roots[1], 10, kStocks, load);
+    bool later_match = true;
+    std::vector<GSeries> full_flow = plan.full_day(roots[1], 11, kStocks, load);
+    for (int i = 0; i < kStocks; ++i) later_match = later_match && close(later.get(i), full_flow[10].get(i));
+    CHECK(later_match);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,120 @@
+// IntradayVwapFactor的增量路径（on_day_start + on_bucket）与非增量路径（range_vwap前缀和）整日逐桶一致，
+// 包括amount/volume只有一个字段缺失的行
+#include "test_common.h"
+#include "my_factor.h"
+#include "diff_indicator.h"
+#include "cal_engine.h"
+
+namespace {
+
+const std::string kDate = "20240701";
+const std::vector<std::string> kStocks = {"000001.SZ", "000002.SZ", "600000.SH"};
+
+std::vector<MarketAllField> make_ticks(const std::string& symbol, int seed) {
+    std::vector<MarketAllField> events;
+    double volume = 0.0, amount = 0.0;
+    uint64_t seq = 1;
+    for (int second = 0; second < 1800; second += 3) {
+        volume += 100.0 * (1 + (second / 3 + seed) % 5);
+        amount += volume * 0.01 * (100 + 7 * seed + second % 11);
+        MarketAllField field(MarketBufferType::Tick, symbol, test::market_time(second), seq++);
+        field.tick.symbol = symbol;
+        field.tick.real_time = test::market_time(second);
+        field.tick.volume = volume;
+        field.tick.total_value_traded = amount;
+        field.tick.last_price = 10.0;
+        events.push_back(field);
+    }
+    return events;
+}
+
+// 把某只股票第minute分钟的字段改为NaN
+void blank(BarSeriesHolder* holder, int minute, const std::string& field) {
+    holder->update_time(test::market_time(minute * 60));
+    holder->update(Frequency::F1MIN, field, NAN);
+}
+
+// 逐字段只累加有效值的直接计算
+double direct_vwap(const GSeriesView& amount, const GSeriesView& volume, int end) {
+    double amount_sum = 0.0, volume_sum = 0.0;
+    int amount_count = 0, volume_count = 0;
+    for (int j = 0; j <= end; ++j) {
+        if (j < amount.get_size() && std::isfinite(amount[j])) { amount_sum += amount[j]; ++amount_count; }
+        if (j < volume.get_size() && std::isfinite(volume[j])) { volume_sum += volume[j]; ++volume_count; }
+    }
+    return amount_count > 0 && volume_count > 0 && volume_sum > 0.0 ? amount_sum / volume_sum : NAN;
+}
+
+bool close(double a, double b) {
+    return (std::isnan(a) && std::isnan(b)) || std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b));
+}
+
+}  // namespace
+
+int main() {
+    spdlog::set_level(spdlog::level::err);
+    const std::filesystem::path root = test::temp_dir("intraday_vwap");
+    GlobalConfig config;
+    config.pre_days = 0;
+    config.calculate_date = kDate;
+    config.worker_thread_count = 1;
+
+    ModuleConfig module;
+    module.name = "diff_volume_amount";
+    module.id = "DiffIndicator";
+    module.handler = "Indicator";
+    module.frequency = "1min";
+    module.path = (root / "indicator").string();
+    module.fields = {"volume", "amount"};
+
+    auto engine = std::make_shared<CalculationEngine>(config);
+    engine->init_indicator_storage(kStocks);
+    auto indicator = std::make_shared<DiffIndicator>(module);
+    indicator->set_calculation_engine(engine);
+    engine->add_indicator(indicator->name(), indicator);
+    engine->compile_indicators();
+    for (size_t s = 0; s < kStocks.size(); ++s) {
+        engine->process_stock_batch(kStocks[s], make_ticks(kStocks[s], static_cast<int>(s)));
+    }
+
+    // 只有amount缺失、只有volume缺失、开盘几分钟两者都缺失
+    blank(engine->get_stock_bar_holder(kStocks[0]), 5, "amount");
+    blank(engine->get_stock_bar_holder(kStocks[1]), 7, "volume");
+    for (int minute = 0; minute < 3; ++minute) {
+        blank(engine->get_stock_bar_holder(kStocks[2]), minute, "amount");
+        blank(engine->get_stock_bar_holder(kStocks[2]), minute, "volume");
+    }
+
+    ModuleConfig factor_module;
+    factor_module.name = "intraday_vwap";
+    factor_module.id = "IntradayVwapFactor";
+    factor_module.handler = "Factor";
+    factor_module.frequency = "1min";
+    factor_module.path = (root / "factor").string();
+    IntradayVwapFactor incremental(factor_module);
+    IntradayVwapFactor reference(factor_module);
+    incremental.set_dependent_indicators({indicator.get()});
+    reference.set_dependent_indicators({indicator.get()});
+
+    incremental.on_day_start(engine, kStocks);
+    const int buckets = engine->get_stock_bar_holder(kStocks[0])->get_bars_per_day(Frequency::F1MIN);
+    int finite = 0;
+    bool all_match = true;
+    for (int ti = 0; ti < buckets; ++ti) {
+        engine->event_cache().begin_event();
+        GSeries actual = incremental.on_bucket(engine, kStocks, ti);
+        GSeries expected = reference.definition_with_cal_engine(engine, kStocks, ti);
+        for (size_t s = 0; s < kStocks.size(); ++s) {
+            BarSeriesHolder* holder = engine->get_stock_bar_holder(kStocks[s]);
+            double direct = direct_vwap(holder->get_data_view(Frequency::F1MIN, "amount", 0, -1),
+                                        holder->get_data_view(Frequency::F1MIN, "volume", 0, -1), ti);
+            if (!close(actual.get(s), expected.get(s)) || !close(expected.get(s), direct)) all_match = false;
+            if (std::isfinite(actual.get(s))) ++finite;
+        }
+    }
+    CHECK(all_match);
+    CHECK(finite > 0);
+
+    std::filesystem::remove_all(root);
+    return TEST_RESULT();
+}
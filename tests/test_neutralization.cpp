@@ -0,0 +1,241 @@
+// Neutralizer的残差与直接最小二乘（Gram-Schmidt正交投影）一致，包括因子/暴露缺失的行、
+// 空行业和与行业哑变量共线的风格（剔除列）；CalculationEngine按配置的暴露中性化后存储
+#include "test_common.h"
+#include "neutralization.h"
+#include "diff_indicator.h"
+#include "my_factor.h"
+#include "cal_engine.h"
+
+namespace {
+
+const std::string kDate = "20240701";
+
+// y在[行业哑变量, 风格]列空间上的正交投影残差；行业缺失、任一暴露或y缺失的行为NaN，
+// 与前面的列线性相关的列在正交化后范数接近0，直接跳过
+std::vector<double> direct_residual(const std::vector<double>& y, const std::vector<int>& industry,
+                                    const std::vector<std::vector<double>>& styles) {
+    const size_t n = y.size();
+    std::vector<size_t> rows;
+    for (size_t i = 0; i < n; ++i) {
+        bool ok = std::isfinite(y[i]) && (industry.empty() || industry[i] >= 0);
+        for (const auto& style : styles) ok = ok && std::isfinite(style[i]);
+        if (ok) rows.push_back(i);
+    }
+    std::vector<std::vector<double>> columns;
+    int groups = industry.empty() ? 1 : *std::max_element(industry.begin(), industry.end()) + 1;
+    for (int g = 0; g < groups; ++g) {
+        std::vector<double> column;
+        for (size_t i : rows) column.push_back(industry.empty() || industry[i] == g ? 1.0 : 0.0);
+        columns.push_back(column);
+    }
+    for (const auto& style : styles) {
+        std::vector<double> column;
+        for (size_t i : rows) column.push_back(style[i]);
+        columns.push_back(column);
+    }
+
+    std::vector<std::vector<double>> basis;
+    for (auto column : columns) {
+        double original = 0.0;
+        for (double v : column) original += v * v;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (const auto& q : basis) {
+                double dot = 0.0;
+                for (size_t r = 0; r < rows.size(); ++r) dot += q[r] * column[r];
+                for (size_t r = 0; r < rows.size(); ++r) column[r] -= dot * q[r];
+            }
+        }
+        double norm = 0.0;
+        for (double v : column) norm += v * v;
+        if (original == 0.0 || norm <= 1e-12 * original) continue;
+        for (double& v : column) v /= std::sqrt(norm);
+        basis.push_back(column);
+    }
+
+    std::vector<double> residual(n, NAN);
+    std::vector<double> e;
+    for (size_t i : rows) e.push_back(y[i]);
+    for (const auto& q : basis) {
+        double dot = 0.0;
+        for (size_t r = 0; r < rows.size(); ++r) dot += q[r] * e[r];
+        for (size_t r = 0; r < rows.size(); ++r) e[r] -= dot * q[r];
+    }
+    for (size_t r = 0; r < rows.size(); ++r) residual[rows[r]] = e[r];
+    return residual;
+}
+
+bool close(double a, double b) {
+    return (std::isnan(a) && std::isnan(b)) || std::fabs(a - b) <= 1e-8 * std::max(1.0, std::fabs(b));
+}
+
+bool matches(const GSeries& actual, const std::vector<double>& expected) {
+    if (actual.get_size() != static_cast<int>(expected.size())) return false;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (!close(actual.get(i), expected[i])) return false;
+    }
+    return true;
+}
+
+std::vector<MarketAllField> make_ticks(const std::string& symbol, int seed) {
+    std::vector<MarketAllField> events;
+    double volume = 0.0, amount = 0.0;
+    uint64_t seq = 1;
+    for (int second = 0; second < 1800; second += 3) {
+        volume += 100.0 * (1 + (second / 3 * (seed + 1)) % 7);
+        amount += volume * 0.01 * (100 + 7 * seed + second % 11);
+        MarketAllField field(MarketBufferType::Tick, symbol, test::market_time(second), seq++);
+        field.tick.symbol = symbol;
+        field.tick.real_time = test::market_time(second);
+        field.tick.volume = volume;
+        field.tick.total_value_traded = amount;
+        field.tick.last_price = 10.0;
+        events.push_back(field);
+    }
+    return events;
+}
+
+}  // namespace
+
+int main() {
+    spdlog::set_level(spdlog::level::err);
+
+    // 截面：5个行业组号，组3没有股票（空行业）；第二个风格是组2的哑变量（与行业共线）
+    constexpr int kStocks = 40;
+    constexpr int kBuckets = 3;
+    std::vector<int> industry(kStocks);
+    std::vector<std::vector<double>> size(kBuckets, std::vector<double>(kStocks));
+    std::vector<std::vector<double>> dummy(kBuckets, std::vector<double>(kStocks));
+    std::vector<std::vector<double>> y(kBuckets, std::vector<double>(kStocks));
+    for (int i = 0; i < kStocks; ++i) {
+        int g = i % 4;
+        industry[i] = g == 3 ? 4 : g;
+        for (int ti = 0; ti < kBuckets; ++ti) {
+            size[ti][i] = std::log(1e8 * (1.0 + (i * 37 + ti * 11) % 23));
+            dummy[ti][i] = industry[i] == 2 ? 1.0 : 0.0;
+            y[ti][i] = std::sin(0.7 * i + ti) + 0.3 * size[ti][i] + 0.5 * industry[i];
+        }
+    }
+    industry[5] = -1;             // 行业缺失
+    size[0][7] = NAN;             // 暴露缺失
+    y[0][11] = NAN;               // 因子缺失（从共享的法方程中减去该行）
+    y[1][12] = NAN;
+    y[1][13] = NAN;
+
+    // 单截面接口
+    bool section_match = true;
+    for (int ti = 0; ti < kBuckets; ++ti) {
+        GSeries factor, size_section, dummy_section;
+        factor.resize(kStocks);
+        size_section.resize(kStocks);
+        dummy_section.resize(kStocks);
+        for (int i = 0; i < kStocks; ++i) {
+            factor.set(i, y[ti][i]);
+            size_section.set(i, size[ti][i]);
+            dummy_section.set(i, dummy[ti][i]);
+        }
+        GSeries residual = Neutralizer::neutralize_section(factor, industry, {size_section, dummy_section});
+        section_match = section_match && matches(residual, direct_residual(y[ti], industry, {size[ti], dummy[ti]}));
+        GSeries intercept_only = Neutralizer::neutralize_section(factor, {}, {size_section});
+        section_match = section_match && matches(intercept_only, direct_residual(y[ti], {}, {size[ti]}));
+    }
+    CHECK(section_match);
+
+    // 面板接口：两个因子共享设计矩阵，多线程，原地输出
+    FactorPanel y_panel(kBuckets, kStocks), z_panel(kBuckets, kStocks), size_panel(kBuckets, kStocks),
+        dummy_panel(kBuckets, kStocks);
+    std::vector<std::vector<double>> z(kBuckets, std::vector<double>(kStocks));
+    for (int ti = 0; ti < kBuckets; ++ti) {
+        for (int i = 0; i < kStocks; ++i) {
+            z[ti][i] = ti == 2 && i == 20 ? NAN : std::cos(1.3 * i - ti) * size[ti][i];
+            y_panel.at(ti, i) = y[ti][i];
+            z_panel.at(ti, i) = z[ti][i];
+            size_panel.at(ti, i) = size[ti][i];
+            dummy_panel.at(ti, i) = dummy[ti][i];
+        }
+    }
+    NeutralizationExposure exposure{industry, {&size_panel, &dummy_panel}};
+    FactorPanel y_residual;
+    CHECK(Neutralizer::neutralize(exposure, {&y_panel, &z_panel}, {&y_residual, &z_panel}, 2));
+    bool panel_match = true;
+    for (int ti = 0; ti < kBuckets; ++ti) {
+        panel_match = panel_match && matches(y_residual.section(ti), direct_residual(y[ti], industry, {size[ti], dummy[ti]}));
+        panel_match = panel_match && matches(z_panel.section(ti), direct_residual(z[ti], industry, {size[ti], dummy[ti]}));
+    }
+    CHECK(panel_match);
+    CHECK(std::isnan(y_residual.at(0, 5)) && std::isnan(y_residual.at(0, 7)) && std::isnan(y_residual.at(0, 11)));
+
+    // 引擎：按配置的行业和成交量暴露中性化后存储，成交量按1min逐桶汇总到5min因子时间桶
+    const std::filesystem::path root = test::temp_dir("neutralization");
+    GlobalConfig config;
+    config.pre_days = 0;
+    config.calculate_date = kDate;
+    config.worker_thread_count = 1;
+
+    ModuleConfig module;
+    module.name = "diff_volume_amount";
+    module.id = "DiffIndicator";
+    module.handler = "Indicator";
+    module.frequency = "1min";
+    module.path = (root / "indicator").string();
+    module.fields = {"volume", "amount"};
+
+    const std::vector<std::string> stocks = {"000001.SZ", "000002.SZ", "000004.SZ", "000005.SZ",
+                                             "600000.SH", "600004.SH", "600006.SH", "600007.SH"};
+    auto engine = std::make_shared<CalculationEngine>(config);
+    engine->init_indicator_storage(stocks);
+    auto indicator = std::make_shared<DiffIndicator>(module);
+    indicator->set_calculation_engine(engine);
+    engine->add_indicator(indicator->name(), indicator);
+    engine->compile_indicators();
+    for (size_t s = 0; s < stocks.size(); ++s) {
+        engine->process_stock_batch(stocks[s], make_ticks(stocks[s], static_cast<int>(s)));
+    }
+
+    ModuleConfig factor_module;
+    factor_module.name = "neutral_vwap";
+    factor_module.id = "IntradayVwapFactor";
+    factor_module.handler = "Factor";
+    factor_module.frequency = "5min";
+    factor_module.path = (root / "factor").string();
+    engine->add_factor(std::make_shared<IntradayVwapFactor>(factor_module));
+
+    // 000005.SZ没有行业
+    engine->set_stock_industries({{"000001.SZ", "bank"}, {"000002.SZ", "estate"}, {"000004.SZ", "bank"},
+                                  {"600000.SH", "bank"}, {"600004.SH", "transport"}, {"600006.SH", "estate"},
+                                  {"600007.SH", "transport"}});
+    CHECK(!engine->set_factor_neutralization(factor_module.name, {"industry", "missing_indicator.volume"}));
+    CHECK(engine->set_factor_neutralization(factor_module.name, {"industry", "diff_volume_amount.volume"}));
+
+    const int ti = 4;
+    GSeries raw;
+    raw.resize(stocks.size());
+    std::vector<double> raw_values, volume_5min;
+    for (size_t s = 0; s < stocks.size(); ++s) {
+        raw.set(s, std::sin(3.1 * s) + 0.2 * s);
+        raw_values.push_back(raw.get(s));
+        GSeriesView volume = engine->get_stock_bar_holder(stocks[s])->get_data_view(Frequency::F1MIN, "volume", 0, -1);
+        double sum = 0.0;
+        for (int j = ti * 5; j < ti * 5 + 5; ++j) sum += volume[j];
+        volume_5min.push_back(sum);
+    }
+    engine->event_cache().begin_event();
+    engine->set_factor_result_batch(factor_module.name, ti, stocks, raw);
+
+    // 行业组号按行业代码排序：bank=0, estate=1, transport=2
+    std::vector<double> expected = direct_residual(raw_values, {0, 1, 0, -1, 0, 2, 1, 2}, {volume_5min});
+    bool engine_match = true;
+    for (size_t s = 0; s < stocks.size(); ++s) {
+        engine_match = engine_match && close(engine->get_factor_result(factor_module.name, ti, stocks[s]), expected[s]);
+    }
+    CHECK(engine_match);
+    CHECK(std::isnan(engine->get_factor_result(factor_module.name, ti, "000005.SZ")));
+    CHECK(std::isfinite(engine->get_factor_result(factor_module.name, ti, "000001.SZ")));
+
+    // 取消中性化后按原值存储
+    CHECK(engine->set_factor_neutralization(factor_module.name, {}));
+    engine->set_factor_result_batch(factor_module.name, ti + 1, stocks, raw);
+    CHECK(close(engine->get_factor_result(factor_module.name, ti + 1, stocks[0]), raw_values[0]));
+
+    std::filesystem::remove_all(root);
+    return TEST_RESULT();
+}